@@ -30,12 +30,21 @@
 #include <stdbool.h>
 #include <stddef.h>
 
-struct cc_list;
-struct cdc_hash_table;
 struct cdc_data_info;
 
+// The full 2Q algorithm. New entries go to the a1_in fifo. Entries pushed out
+// of a1_in leave their keys in the a1_out fifo of recently evicted keys, and
+// a key that is inserted again while it is in a1_out goes to the am lru.
+// Entries that are used once never reach am, so scans cannot flush it.
+//
+// a1_out holds keys only. An entry moved there loses its value first, so
+// info->dfree gets the pair in two calls: the value with a NULL key when the
+// entry leaves a1_in and the key with a NULL value when it leaves a1_out.
 struct cc_2q_cache {
   size_t max_size;
+  // Target size of a1_in; am gets the rest.
+  size_t in_max_size;
+  struct cdc_data_info *dinfo;
   struct cc_fifo_cache *a1_in;
   struct cc_fifo_cache *a1_out;
   struct cc_lru_cache *am;
@@ -48,10 +57,11 @@ void cc_2q_cache_dtor(struct cc_2q_cache *c);
 
 // Lookup
 enum cdc_stat cc_2q_cache_get(struct cc_2q_cache *c, void *key, void **value);
+// Does not count as a use of the entry.
 bool cc_2q_cache_contains(struct cc_2q_cache *c, void *key);
 
 // Capacity
-size_t cc_2q_cache_max_size(struct cc_2q_cache *c)
+static inline size_t cc_2q_cache_max_size(struct cc_2q_cache *c)
 {
   assert(c != NULL);
 
@@ -72,27 +82,29 @@ void cc_2q_cache_take(struct cc_2q_cache *c, void *key, struct cdc_pair *kv);
 void cc_2q_cache_clear(struct cc_2q_cache *c);
 
 // Short names
+// Identifiers cannot start with a digit, hence the q2 prefix.
 #ifdef CDC_USE_SHORT_NAMES
-typedef struct cc_2q_cache 2q_cache_t;
+typedef struct cc_2q_cache q2_cache_t;
 
 // Base
-#define 2q_cache_ctor(...)cc_2q_cache_ctor(__VA_ARGS__)
-#define 2q_cache_dtor(...)cc_2q_cache_dtor(__VA_ARGS__)
+#define q2_cache_ctor(...) cc_2q_cache_ctor(__VA_ARGS__)
+#define q2_cache_dtor(...) cc_2q_cache_dtor(__VA_ARGS__)
 
 // Lookup
-#define 2q_cache_get(...)cc_2q_cache_get(__VA_ARGS__)
-#define 2q_cache_contains(...)cc_2q_cache_contains(__VA_ARGS__)
+#define q2_cache_get(...) cc_2q_cache_get(__VA_ARGS__)
+#define q2_cache_contains(...) cc_2q_cache_contains(__VA_ARGS__)
 
 // Capacity
-#define 2q_cache_max_size(...)cc_2q_cache_max_size(__VA_ARGS__)
-#define 2q_cache_size(...)cc_2q_cache_size(__VA_ARGS__)
-#define 2q_cache_empty(...)cc_2q_cache_empty(__VA_ARGS__)
+#define q2_cache_max_size(...) cc_2q_cache_max_size(__VA_ARGS__)
+#define q2_cache_size(...) cc_2q_cache_size(__VA_ARGS__)
+#define q2_cache_empty(...) cc_2q_cache_empty(__VA_ARGS__)
 
 // Modifiers
-#define 2q_cache_insert(...)cc_2q_cache_insert(__VA_ARGS__)
-#define 2q_cache_insert_or_assign(...)cc_2q_cache_insert_or_assign(__VA_ARGS__)
-#define 2q_cache_erase(...)cc_2q_cache_erase(__VA_ARGS__)
-#define 2q_cache_take(...)cc_2q_cache_take(__VA_ARGS__)
-#define 2q_cache_clear(...)cc_2q_cache_clear(__VA_ARGS__)
+#define q2_cache_insert(...) cc_2q_cache_insert(__VA_ARGS__)
+#define q2_cache_insert_or_assign(...) \
+  cc_2q_cache_insert_or_assign(__VA_ARGS__)
+#define q2_cache_erase(...) cc_2q_cache_erase(__VA_ARGS__)
+#define q2_cache_take(...) cc_2q_cache_take(__VA_ARGS__)
+#define q2_cache_clear(...) cc_2q_cache_clear(__VA_ARGS__)
 #endif
 #endif  // CCACHE_INCLUDE_CCACHE_2Q_H
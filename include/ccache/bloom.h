@@ -0,0 +1,75 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_INCLUDE_CCACHE_BLOOM_H
+#define CCACHE_INCLUDE_CCACHE_BLOOM_H
+#include <cdcontainers/common.h>
+#include <cdcontainers/status.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A counting Bloom filter split into blocks of one cache line. All probes of
+// a key fall into the same block, so a query touches a single cache line.
+// Every block holds 128 four bit counters, which lets keys be removed. A
+// counter that reaches its maximum sticks there and is never decremented,
+// so a removal can only leave false positives behind, never false
+// negatives.
+struct cc_bloom_filter {
+  uint64_t *blocks;
+  size_t block_count;
+  cdc_hash_fn_t hash;
+};
+
+// Base
+// Sizes the filter for about 1% false positives with capacity keys.
+enum cdc_stat cc_bloom_filter_ctor(struct cc_bloom_filter **f, size_t capacity,
+                                   cdc_hash_fn_t hash);
+void cc_bloom_filter_dtor(struct cc_bloom_filter *f);
+
+// Lookup
+// Returns false if the key was definitely not added.
+bool cc_bloom_filter_may_contain(struct cc_bloom_filter *f, void *key);
+
+// Modifiers
+void cc_bloom_filter_add(struct cc_bloom_filter *f, void *key);
+// The key must have been added before.
+void cc_bloom_filter_remove(struct cc_bloom_filter *f, void *key);
+void cc_bloom_filter_clear(struct cc_bloom_filter *f);
+
+// Short names
+#ifdef CDC_USE_SHORT_NAMES
+typedef struct cc_bloom_filter bloom_filter_t;
+
+// Base
+#define bloom_filter_ctor(...) cc_bloom_filter_ctor(__VA_ARGS__)
+#define bloom_filter_dtor(...) cc_bloom_filter_dtor(__VA_ARGS__)
+
+// Lookup
+#define bloom_filter_may_contain(...) cc_bloom_filter_may_contain(__VA_ARGS__)
+
+// Modifiers
+#define bloom_filter_add(...) cc_bloom_filter_add(__VA_ARGS__)
+#define bloom_filter_remove(...) cc_bloom_filter_remove(__VA_ARGS__)
+#define bloom_filter_clear(...) cc_bloom_filter_clear(__VA_ARGS__)
+#endif
+#endif  // CCACHE_INCLUDE_CCACHE_BLOOM_H
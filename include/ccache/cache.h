@@ -0,0 +1,194 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_INCLUDE_CCACHE_CACHE_H
+#define CCACHE_INCLUDE_CCACHE_CACHE_H
+#include <cdcontainers/common.h>
+#include <cdcontainers/status.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct cdc_data_info;
+
+enum cc_policy {
+  CC_POLICY_LRU,
+  CC_POLICY_FIFO,
+  CC_POLICY_2Q,
+  CC_POLICY_LFU,
+  CC_POLICY_SLRU,
+  CC_POLICY_SAMPLED,
+};
+
+struct cc_cache_config {
+  enum cc_policy policy;
+  size_t max_size;
+  // hash and eq are required, dfree is optional. dfree gets the whole pair
+  // when an entry is removed and the old value with a NULL key when a value
+  // is replaced. The 2q policy also frees the two halves of a pair in
+  // separate calls, see cc_2q_cache. A dfree must free the non-NULL parts
+  // only and must not tell the cases apart by a NULL key.
+  struct cdc_data_info *info;
+};
+
+struct cc_cache_ops {
+  const char *name;
+  void (*dtor)(void *impl);
+  enum cdc_stat (*get)(void *impl, void *key, void **value);
+  bool (*contains)(void *impl, void *key);
+  size_t (*max_size)(void *impl);
+  size_t (*size)(void *impl);
+  enum cdc_stat (*insert)(void *impl, void *key, void *value, bool *inserted);
+  enum cdc_stat (*insert_or_assign)(void *impl, void *key, void *value,
+                                    bool *inserted);
+  void (*erase)(void *impl, void *key);
+  void (*take)(void *impl, void *key, struct cdc_pair *kv);
+  void (*clear)(void *impl);
+};
+
+// A cache whose policy is chosen at run time. Every call costs one indirect
+// call on top of the call to the policy.
+struct cc_cache {
+  const struct cc_cache_ops *ops;
+  void *impl;
+};
+
+// Parses a policy name: "lru", "fifo", "2q", "lfu", "slru" or "sampled".
+// Returns CDC_STATUS_NOT_FOUND for an unknown name.
+enum cdc_stat cc_policy_from_name(const char *name, enum cc_policy *policy);
+const char *cc_policy_name(enum cc_policy policy);
+
+// Base
+enum cdc_stat cc_cache_ctor(struct cc_cache **c,
+                            const struct cc_cache_config *config);
+void cc_cache_dtor(struct cc_cache *c);
+
+// Returns the name of the policy.
+static inline const char *cc_cache_policy(struct cc_cache *c)
+{
+  assert(c != NULL);
+
+  return c->ops->name;
+}
+
+// Lookup
+static inline enum cdc_stat cc_cache_get(struct cc_cache *c, void *key,
+                                         void **value)
+{
+  assert(c != NULL);
+
+  return c->ops->get(c->impl, key, value);
+}
+
+static inline bool cc_cache_contains(struct cc_cache *c, void *key)
+{
+  assert(c != NULL);
+
+  return c->ops->contains(c->impl, key);
+}
+
+// Capacity
+static inline size_t cc_cache_max_size(struct cc_cache *c)
+{
+  assert(c != NULL);
+
+  return c->ops->max_size(c->impl);
+}
+
+static inline size_t cc_cache_size(struct cc_cache *c)
+{
+  assert(c != NULL);
+
+  return c->ops->size(c->impl);
+}
+
+static inline bool cc_cache_empty(struct cc_cache *c)
+{
+  return cc_cache_size(c) == 0;
+}
+
+// Modifiers
+static inline enum cdc_stat cc_cache_insert(struct cc_cache *c, void *key,
+                                            void *value, bool *inserted)
+{
+  assert(c != NULL);
+
+  return c->ops->insert(c->impl, key, value, inserted);
+}
+
+static inline enum cdc_stat cc_cache_insert_or_assign(struct cc_cache *c,
+                                                      void *key, void *value,
+                                                      bool *inserted)
+{
+  assert(c != NULL);
+
+  return c->ops->insert_or_assign(c->impl, key, value, inserted);
+}
+
+static inline void cc_cache_erase(struct cc_cache *c, void *key)
+{
+  assert(c != NULL);
+
+  c->ops->erase(c->impl, key);
+}
+
+static inline void cc_cache_take(struct cc_cache *c, void *key,
+                                 struct cdc_pair *kv)
+{
+  assert(c != NULL);
+
+  c->ops->take(c->impl, key, kv);
+}
+
+static inline void cc_cache_clear(struct cc_cache *c)
+{
+  assert(c != NULL);
+
+  c->ops->clear(c->impl);
+}
+
+// Short names
+#ifdef CDC_USE_SHORT_NAMES
+typedef struct cc_cache cache_t;
+typedef struct cc_cache_config cache_config_t;
+
+// Base
+#define cache_ctor(...) cc_cache_ctor(__VA_ARGS__)
+#define cache_dtor(...) cc_cache_dtor(__VA_ARGS__)
+#define cache_policy(...) cc_cache_policy(__VA_ARGS__)
+
+// Lookup
+#define cache_get(...) cc_cache_get(__VA_ARGS__)
+#define cache_contains(...) cc_cache_contains(__VA_ARGS__)
+
+// Capacity
+#define cache_max_size(...) cc_cache_max_size(__VA_ARGS__)
+#define cache_size(...) cc_cache_size(__VA_ARGS__)
+#define cache_empty(...) cc_cache_empty(__VA_ARGS__)
+
+// Modifiers
+#define cache_insert(...) cc_cache_insert(__VA_ARGS__)
+#define cache_insert_or_assign(...) cc_cache_insert_or_assign(__VA_ARGS__)
+#define cache_erase(...) cc_cache_erase(__VA_ARGS__)
+#define cache_take(...) cc_cache_take(__VA_ARGS__)
+#define cache_clear(...) cc_cache_clear(__VA_ARGS__)
+#endif
+#endif  // CCACHE_INCLUDE_CCACHE_CACHE_H
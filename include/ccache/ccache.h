@@ -18,4 +18,26 @@
 // LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
+#include <ccache/2q.h>
+#include <ccache/bloom.h>
+#include <ccache/cache.h>
+#include <ccache/cfifo.h>
+#include <ccache/codec.h>
+#include <ccache/compressed.h>
+#include <ccache/epoch.h>
+#include <ccache/executor.h>
+#include <ccache/fifo.h>
+#include <ccache/frozen.h>
+#include <ccache/gdsf.h>
+#include <ccache/handle.h>
+#include <ccache/hash.h>
+#include <ccache/lfu.h>
 #include <ccache/lru.h>
+#include <ccache/near.h>
+#include <ccache/ordered.h>
+#include <ccache/partitioned.h>
+#include <ccache/refresh.h>
+#include <ccache/sampled.h>
+#include <ccache/shards.h>
+#include <ccache/slru.h>
+#include <ccache/topk.h>
@@ -0,0 +1,154 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_INCLUDE_CCACHE_CFIFO_H
+#define CCACHE_INCLUDE_CCACHE_CFIFO_H
+#include <cdcontainers/common.h>
+#include <cdcontainers/status.h>
+
+#include <ccache/epoch.h>
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct cdc_data_info;
+struct cc_cfifo_node;
+
+// A concurrent fifo cache. Lookups never change a fifo cache, so readers
+// walk the index without locks and only announce themselves to the epoch
+// based reclamation. Writers are serialized by a mutex. Removed entries and
+// replaced values are freed once no reader can see them.
+//
+// The index has a fixed number of buckets chosen from max_size, so it never
+// has to be resized under the readers.
+struct cc_cfifo_cache {
+  size_t max_size;
+  size_t size;
+  struct cc_cfifo_node **buckets;
+  size_t bucket_mask;
+  // The newest and the oldest entry. Only writers use them.
+  struct cc_cfifo_node *head;
+  struct cc_cfifo_node *tail;
+  struct cdc_data_info *dinfo;
+  struct cc_epoch *epoch;
+  pthread_mutex_t mutex;
+};
+
+// Base
+enum cdc_stat cc_cfifo_cache_ctor(struct cc_cfifo_cache **c, size_t max_size,
+                                  struct cdc_data_info *info);
+// No thread may use the cache during and after the call.
+void cc_cfifo_cache_dtor(struct cc_cfifo_cache *c);
+
+// Readers
+// Every thread that reads the cache needs its own record.
+static inline enum cdc_stat cc_cfifo_cache_register(struct cc_cfifo_cache *c,
+                                                    struct cc_epoch_record **r)
+{
+  assert(c != NULL);
+
+  return cc_epoch_register(c->epoch, r);
+}
+
+static inline void cc_cfifo_cache_unregister(struct cc_epoch_record *r)
+{
+  cc_epoch_unregister(r);
+}
+
+// Lookups must be made between cc_cfifo_cache_enter and
+// cc_cfifo_cache_leave. Values returned by cc_cfifo_cache_get stay valid
+// until cc_cfifo_cache_leave even if they are evicted meanwhile. Keep the
+// sections short: nothing is freed while a reader stays inside.
+static inline void cc_cfifo_cache_enter(struct cc_epoch_record *r)
+{
+  cc_epoch_enter(r);
+}
+
+static inline void cc_cfifo_cache_leave(struct cc_epoch_record *r)
+{
+  cc_epoch_leave(r);
+}
+
+// Lookup
+enum cdc_stat cc_cfifo_cache_get(struct cc_cfifo_cache *c,
+                                 struct cc_epoch_record *r, void *key,
+                                 void **value);
+bool cc_cfifo_cache_contains(struct cc_cfifo_cache *c,
+                             struct cc_epoch_record *r, void *key);
+
+// Capacity
+static inline size_t cc_cfifo_cache_max_size(struct cc_cfifo_cache *c)
+{
+  assert(c != NULL);
+
+  return c->max_size;
+}
+
+size_t cc_cfifo_cache_size(struct cc_cfifo_cache *c);
+bool cc_cfifo_cache_empty(struct cc_cfifo_cache *c);
+
+// Modifiers
+// Writers may be called from inside a read section.
+enum cdc_stat cc_cfifo_cache_insert(struct cc_cfifo_cache *c, void *key,
+                                    void *value, bool *inserted);
+enum cdc_stat cc_cfifo_cache_insert_or_assign(struct cc_cfifo_cache *c,
+                                              void *key, void *value,
+                                              bool *inserted);
+void cc_cfifo_cache_erase(struct cc_cfifo_cache *c, void *key);
+void cc_cfifo_cache_clear(struct cc_cfifo_cache *c);
+// Frees the removed entries that no reader can see any more. Writers do it
+// on every call; this is for the time when there are no writes. Returns
+// the number of freed entries.
+size_t cc_cfifo_cache_collect(struct cc_cfifo_cache *c);
+
+// Short names
+#ifdef CDC_USE_SHORT_NAMES
+typedef struct cc_cfifo_cache cfifo_cache_t;
+
+// Base
+#define cfifo_cache_ctor(...) cc_cfifo_cache_ctor(__VA_ARGS__)
+#define cfifo_cache_dtor(...) cc_cfifo_cache_dtor(__VA_ARGS__)
+
+// Readers
+#define cfifo_cache_register(...) cc_cfifo_cache_register(__VA_ARGS__)
+#define cfifo_cache_unregister(...) cc_cfifo_cache_unregister(__VA_ARGS__)
+#define cfifo_cache_enter(...) cc_cfifo_cache_enter(__VA_ARGS__)
+#define cfifo_cache_leave(...) cc_cfifo_cache_leave(__VA_ARGS__)
+
+// Lookup
+#define cfifo_cache_get(...) cc_cfifo_cache_get(__VA_ARGS__)
+#define cfifo_cache_contains(...) cc_cfifo_cache_contains(__VA_ARGS__)
+
+// Capacity
+#define cfifo_cache_max_size(...) cc_cfifo_cache_max_size(__VA_ARGS__)
+#define cfifo_cache_size(...) cc_cfifo_cache_size(__VA_ARGS__)
+#define cfifo_cache_empty(...) cc_cfifo_cache_empty(__VA_ARGS__)
+
+// Modifiers
+#define cfifo_cache_insert(...) cc_cfifo_cache_insert(__VA_ARGS__)
+#define cfifo_cache_insert_or_assign(...) \
+  cc_cfifo_cache_insert_or_assign(__VA_ARGS__)
+#define cfifo_cache_erase(...) cc_cfifo_cache_erase(__VA_ARGS__)
+#define cfifo_cache_clear(...) cc_cfifo_cache_clear(__VA_ARGS__)
+#define cfifo_cache_collect(...) cc_cfifo_cache_collect(__VA_ARGS__)
+#endif
+#endif  // CCACHE_INCLUDE_CCACHE_CFIFO_H
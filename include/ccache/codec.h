@@ -0,0 +1,64 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_INCLUDE_CCACHE_CODEC_H
+#define CCACHE_INCLUDE_CCACHE_CODEC_H
+#include <stdbool.h>
+#include <stddef.h>
+
+// Compresses src into dst, which holds dst_capacity bytes. Returns the
+// compressed size, or 0 if the result does not fit.
+typedef size_t (*cc_compress_fn_t)(void *ctx, const void *src,
+                                   size_t src_size, void *dst,
+                                   size_t dst_capacity);
+// Decompresses src into exactly dst_size bytes. Returns false if src is
+// corrupt or does not decompress to dst_size bytes.
+typedef bool (*cc_decompress_fn_t)(void *ctx, const void *src,
+                                   size_t src_size, void *dst,
+                                   size_t dst_size);
+
+// A value codec. ctx is passed to both functions.
+struct cc_codec {
+  const char *name;
+  cc_compress_fn_t compress;
+  cc_decompress_fn_t decompress;
+  void *ctx;
+};
+
+// A byte oriented LZ77 codec in the style of LZ4. A sequence is a token
+// byte with the literal length in the high nibble and the match length in
+// the low one, the literals, a 16 bit offset and the extra length bytes.
+// Matches are found through a single hash probe of the next four bytes,
+// which trades some ratio for a few hundred MB/s per core on both sides.
+extern const struct cc_codec cc_lz_codec;
+
+size_t cc_lz_compress(void *ctx, const void *src, size_t src_size, void *dst,
+                      size_t dst_capacity);
+bool cc_lz_decompress(void *ctx, const void *src, size_t src_size, void *dst,
+                      size_t dst_size);
+
+// Short names
+#ifdef CDC_USE_SHORT_NAMES
+typedef struct cc_codec codec_t;
+
+#define lz_compress(...) cc_lz_compress(__VA_ARGS__)
+#define lz_decompress(...) cc_lz_decompress(__VA_ARGS__)
+#endif
+#endif  // CCACHE_INCLUDE_CCACHE_CODEC_H
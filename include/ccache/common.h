@@ -0,0 +1,38 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_INCLUDE_CCACHE_COMMON_H
+#define CCACHE_INCLUDE_CCACHE_COMMON_H
+#include <stdbool.h>
+
+// Visits a pair during iteration. Returning false stops the iteration.
+typedef bool (*cc_visit_fn_t)(void *key, void *value, void *ctx);
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CC_PREFETCH(addr) __builtin_prefetch(addr)
+#define CC_LIKELY(x) __builtin_expect(!!(x), 1)
+#define CC_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#define CC_PREFETCH(addr) ((void)(addr))
+#define CC_LIKELY(x) (x)
+#define CC_UNLIKELY(x) (x)
+#endif
+
+#endif  // CCACHE_INCLUDE_CCACHE_COMMON_H
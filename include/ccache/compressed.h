@@ -0,0 +1,141 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_INCLUDE_CCACHE_COMPRESSED_H
+#define CCACHE_INCLUDE_CCACHE_COMPRESSED_H
+#include <cdcontainers/common.h>
+#include <cdcontainers/status.h>
+
+#include <ccache/codec.h>
+#include <ccache/gdsf.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// A cache of byte string pairs which keeps its values compressed. Values of
+// at least threshold bytes go through the codec on insert and are
+// decompressed into a buffer of the caller on get; smaller values and
+// values which do not compress are stored raw. The cache copies the pairs.
+//
+// The capacity is measured in stored bytes: the key, the compressed value
+// and the headers of both. Entries are evicted by a GDSF cache in which
+// every entry costs 1, so small entries are kept first.
+struct cc_compressed_cache {
+  struct cc_gdsf_cache *cache;
+  const struct cc_codec *codec;
+  size_t threshold;
+  // Input and output bytes of the values that were compressed.
+  size_t compressed_in;
+  size_t compressed_out;
+};
+
+// Base
+// Uses cc_lz_codec if codec is NULL.
+enum cdc_stat cc_compressed_cache_ctor(struct cc_compressed_cache **c,
+                                       size_t max_bytes,
+                                       const struct cc_codec *codec,
+                                       size_t threshold);
+void cc_compressed_cache_dtor(struct cc_compressed_cache *c);
+
+// Lookup
+// Decompresses the value into buf and sets value_size to its size. Fails
+// with CDC_STATUS_OUT_OF_RANGE if buf is smaller than the value, which
+// still sets value_size, and with CDC_STATUS_UNKNOWN_ERROR if the codec
+// rejects the stored data.
+enum cdc_stat cc_compressed_cache_get(struct cc_compressed_cache *c,
+                                      const void *key, size_t key_size,
+                                      void *buf, size_t buf_size,
+                                      size_t *value_size);
+bool cc_compressed_cache_contains(struct cc_compressed_cache *c,
+                                  const void *key, size_t key_size);
+
+// Capacity
+static inline size_t cc_compressed_cache_max_bytes(
+    struct cc_compressed_cache *c)
+{
+  assert(c != NULL);
+
+  return cc_gdsf_cache_max_bytes(c->cache);
+}
+
+static inline size_t cc_compressed_cache_bytes(struct cc_compressed_cache *c)
+{
+  assert(c != NULL);
+
+  return cc_gdsf_cache_bytes(c->cache);
+}
+
+static inline size_t cc_compressed_cache_size(struct cc_compressed_cache *c)
+{
+  assert(c != NULL);
+
+  return cc_gdsf_cache_size(c->cache);
+}
+
+static inline bool cc_compressed_cache_empty(struct cc_compressed_cache *c)
+{
+  assert(c != NULL);
+
+  return cc_gdsf_cache_empty(c->cache);
+}
+
+// Modifiers
+// A pair larger than max_bytes after compression is not stored and inserted
+// is set to false. insert_or_assign then removes the old entry of the key.
+enum cdc_stat cc_compressed_cache_insert(struct cc_compressed_cache *c,
+                                         const void *key, size_t key_size,
+                                         const void *value, size_t value_size,
+                                         bool *inserted);
+enum cdc_stat cc_compressed_cache_insert_or_assign(
+    struct cc_compressed_cache *c, const void *key, size_t key_size,
+    const void *value, size_t value_size, bool *inserted);
+void cc_compressed_cache_erase(struct cc_compressed_cache *c, const void *key,
+                               size_t key_size);
+void cc_compressed_cache_clear(struct cc_compressed_cache *c);
+
+// Short names
+#ifdef CDC_USE_SHORT_NAMES
+typedef struct cc_compressed_cache compressed_cache_t;
+
+// Base
+#define compressed_cache_ctor(...) cc_compressed_cache_ctor(__VA_ARGS__)
+#define compressed_cache_dtor(...) cc_compressed_cache_dtor(__VA_ARGS__)
+
+// Lookup
+#define compressed_cache_get(...) cc_compressed_cache_get(__VA_ARGS__)
+#define compressed_cache_contains(...) \
+  cc_compressed_cache_contains(__VA_ARGS__)
+
+// Capacity
+#define compressed_cache_max_bytes(...) \
+  cc_compressed_cache_max_bytes(__VA_ARGS__)
+#define compressed_cache_bytes(...) cc_compressed_cache_bytes(__VA_ARGS__)
+#define compressed_cache_size(...) cc_compressed_cache_size(__VA_ARGS__)
+#define compressed_cache_empty(...) cc_compressed_cache_empty(__VA_ARGS__)
+
+// Modifiers
+#define compressed_cache_insert(...) cc_compressed_cache_insert(__VA_ARGS__)
+#define compressed_cache_insert_or_assign(...) \
+  cc_compressed_cache_insert_or_assign(__VA_ARGS__)
+#define compressed_cache_erase(...) cc_compressed_cache_erase(__VA_ARGS__)
+#define compressed_cache_clear(...) cc_compressed_cache_clear(__VA_ARGS__)
+#endif
+#endif  // CCACHE_INCLUDE_CCACHE_COMPRESSED_H
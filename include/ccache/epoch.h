@@ -0,0 +1,129 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_INCLUDE_CCACHE_EPOCH_H
+#define CCACHE_INCLUDE_CCACHE_EPOCH_H
+#include <cdcontainers/status.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct cc_epoch_entry;
+
+typedef void (*cc_retire_fn_t)(struct cc_epoch_entry *entry, void *ctx);
+
+// Header of an object waiting for reclamation. Embed it into the object.
+struct cc_epoch_entry {
+  struct cc_epoch_entry *next;
+  uint64_t epoch;
+  cc_retire_fn_t fn;
+  void *ctx;
+};
+
+// State of a reader thread. The lowest bit of state is set while the reader
+// is inside a critical section; the other bits hold the epoch it observed.
+struct cc_epoch_record {
+  struct cc_epoch_record *next;
+  struct cc_epoch *epoch;
+  uint64_t state;
+  int in_use;
+};
+
+// Epoch based reclamation. Readers announce the global epoch when they
+// enter a critical section. An object retired in epoch e is freed once the
+// global epoch reaches e + 2, which can only happen after every reader that
+// might still see the object has left its critical section. Readers never
+// block and never write shared state except their own record.
+//
+// cc_epoch_retire and cc_epoch_collect must be serialized by the caller.
+struct cc_epoch {
+  uint64_t global;
+  struct cc_epoch_record *records;
+  struct cc_epoch_entry *retired_head;
+  struct cc_epoch_entry *retired_tail;
+  size_t retired_count;
+};
+
+// Base
+enum cdc_stat cc_epoch_ctor(struct cc_epoch **e);
+// Frees every retired object. No reader may be inside a critical section.
+void cc_epoch_dtor(struct cc_epoch *e);
+
+// Readers
+// Records are reused after cc_epoch_unregister and freed by cc_epoch_dtor.
+enum cdc_stat cc_epoch_register(struct cc_epoch *e, struct cc_epoch_record **r);
+void cc_epoch_unregister(struct cc_epoch_record *r);
+
+static inline void cc_epoch_enter(struct cc_epoch_record *r)
+{
+  assert(r != NULL);
+  assert(!(r->state & 1));
+
+  uint64_t global = __atomic_load_n(&r->epoch->global, __ATOMIC_ACQUIRE);
+  __atomic_exchange_n(&r->state, (global << 1) | 1, __ATOMIC_SEQ_CST);
+}
+
+static inline void cc_epoch_leave(struct cc_epoch_record *r)
+{
+  assert(r != NULL);
+  assert(r->state & 1);
+
+  __atomic_store_n(&r->state, 0, __ATOMIC_RELEASE);
+}
+
+static inline bool cc_epoch_active(struct cc_epoch_record *r)
+{
+  assert(r != NULL);
+
+  return r->state & 1;
+}
+
+// Writers
+// Queues entry to be passed to fn once no reader can see it.
+void cc_epoch_retire(struct cc_epoch *e, struct cc_epoch_entry *entry,
+                     cc_retire_fn_t fn, void *ctx);
+// Advances the global epoch if possible and frees the retired objects that
+// became unreachable. Returns the number of freed objects.
+size_t cc_epoch_collect(struct cc_epoch *e);
+
+// Short names
+#ifdef CDC_USE_SHORT_NAMES
+typedef struct cc_epoch epoch_t;
+typedef struct cc_epoch_record epoch_record_t;
+typedef struct cc_epoch_entry epoch_entry_t;
+
+// Base
+#define epoch_ctor(...) cc_epoch_ctor(__VA_ARGS__)
+#define epoch_dtor(...) cc_epoch_dtor(__VA_ARGS__)
+
+// Readers
+#define epoch_register(...) cc_epoch_register(__VA_ARGS__)
+#define epoch_unregister(...) cc_epoch_unregister(__VA_ARGS__)
+#define epoch_enter(...) cc_epoch_enter(__VA_ARGS__)
+#define epoch_leave(...) cc_epoch_leave(__VA_ARGS__)
+#define epoch_active(...) cc_epoch_active(__VA_ARGS__)
+
+// Writers
+#define epoch_retire(...) cc_epoch_retire(__VA_ARGS__)
+#define epoch_collect(...) cc_epoch_collect(__VA_ARGS__)
+#endif
+#endif  // CCACHE_INCLUDE_CCACHE_EPOCH_H
@@ -0,0 +1,81 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_INCLUDE_CCACHE_EXECUTOR_H
+#define CCACHE_INCLUDE_CCACHE_EXECUTOR_H
+#include <cdcontainers/common.h>
+#include <cdcontainers/status.h>
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef void (*cc_task_fn_t)(void *arg);
+typedef void (*cc_execute_fn_t)(void *ctx, cc_task_fn_t task, void *arg);
+
+// Runs tasks on behalf of a cache (e.g. background reloads).
+struct cc_executor {
+  cc_execute_fn_t execute;
+  void *ctx;
+};
+
+static inline void cc_executor_execute(struct cc_executor *e, cc_task_fn_t task,
+                                       void *arg)
+{
+  assert(e != NULL);
+  assert(task != NULL);
+
+  e->execute(e->ctx, task, arg);
+}
+
+// Runs the task in the calling thread. Useful for tests.
+void cc_executor_sync(void *ctx, cc_task_fn_t task, void *arg);
+
+struct cc_thread_pool_task;
+
+struct cc_thread_pool {
+  pthread_t *threads;
+  size_t nthreads;
+  struct cc_thread_pool_task *head;
+  struct cc_thread_pool_task *tail;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  bool stop;
+};
+
+// Base
+enum cdc_stat cc_thread_pool_ctor(struct cc_thread_pool **p, size_t nthreads);
+// Runs all queued tasks and joins the workers.
+void cc_thread_pool_dtor(struct cc_thread_pool *p);
+
+// Modifiers
+void cc_thread_pool_execute(void *p, cc_task_fn_t task, void *arg);
+
+static inline struct cc_executor cc_thread_pool_executor(
+    struct cc_thread_pool *p)
+{
+  assert(p != NULL);
+
+  struct cc_executor e = {cc_thread_pool_execute, p};
+  return e;
+}
+
+#endif  // CCACHE_INCLUDE_CCACHE_EXECUTOR_H
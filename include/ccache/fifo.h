@@ -23,11 +23,18 @@
 #include <cdcontainers/common.h>
 #include <cdcontainers/status.h>
 
+#include <ccache/common.h>
+#include <ccache/memory.h>
+
 #include <assert.h>
 #include <stdbool.h>
 #include <stddef.h>
 
+struct cc_bloom_filter;
 struct cc_list;
+struct cc_list_node;
+struct cc_shards;
+struct cc_top_keys;
 struct cdc_hash_table;
 struct cdc_data_info;
 
@@ -37,17 +44,42 @@ struct cc_fifo_cache {
   struct cc_list *list;
   // Stores pairs of key and list iterator.
   struct cdc_hash_table *table;
+  cc_size_fn_t payload_size;
+  size_t payload_bytes;
+  struct cc_shards *shards;
+  struct cc_top_keys *top_keys;
+  // Rules out most absent keys before the index is probed.
+  struct cc_bloom_filter *filter;
+  // Bounds of batched eviction. Zero high_watermark means that inserts evict
+  // one entry at a time.
+  size_t low_watermark;
+  size_t high_watermark;
+};
+
+// Iterates over the entries without changing their order.
+struct cc_fifo_cache_iter {
+  struct cc_list_node *current;
 };
 
 // Base
 enum cdc_stat cc_fifo_cache_ctor(struct cc_fifo_cache **c, size_t max_size,
                                  struct cdc_data_info *info);
+// If reserve is set, allocates the index and the nodes for max_size entries
+// up front, so that filling the cache neither rehashes nor calls malloc.
+enum cdc_stat cc_fifo_cache_ctor1(struct cc_fifo_cache **c, size_t max_size,
+                                  struct cdc_data_info *info, bool reserve);
 void cc_fifo_cache_dtor(struct cc_fifo_cache *c);
 
 // Lookup
 enum cdc_stat cc_fifo_cache_get(struct cc_fifo_cache *c, void *key,
                                 void **value);
 bool cc_fifo_cache_contains(struct cc_fifo_cache *c, void *key);
+// Puts a counting Bloom filter sized for max_size keys in front of the
+// index, so that most lookups of absent keys cost one cache line. Calling it
+// again rebuilds the filter, e.g. after cc_fifo_cache_set_max_size grew the
+// cache.
+enum cdc_stat cc_fifo_cache_enable_filter(struct cc_fifo_cache *c);
+void cc_fifo_cache_disable_filter(struct cc_fifo_cache *c);
 
 // Capacity
 static inline size_t cc_fifo_cache_max_size(struct cc_fifo_cache *c)
@@ -60,40 +92,163 @@ static inline size_t cc_fifo_cache_max_size(struct cc_fifo_cache *c)
 size_t cc_fifo_cache_size(struct cc_fifo_cache *c);
 bool cc_fifo_cache_empty(struct cc_fifo_cache *c);
 
+// Growing takes effect immediately. Shrinking evicts lazily: each insert
+// evicts a few extra entries and cc_fifo_cache_trim evicts up to budget
+// entries, so that no single call has to evict the whole difference.
+void cc_fifo_cache_set_max_size(struct cc_fifo_cache *c, size_t max_size);
+// Returns the number of evicted entries.
+size_t cc_fifo_cache_trim(struct cc_fifo_cache *c, size_t budget);
+// Makes an insert evict down to low entries in one pass once the size
+// reaches high, so that the following inserts do not evict at all.
+// cc_fifo_cache_maintain runs the same eviction outside of inserts, which
+// lets an idle loop take it off the insert path. Requires
+// low < high <= max_size; zero high restores single evictions at max_size.
+void cc_fifo_cache_set_watermarks(struct cc_fifo_cache *c, size_t low,
+                                  size_t high);
+// Returns the number of evicted entries.
+size_t cc_fifo_cache_maintain(struct cc_fifo_cache *c);
+// Reserves space in the index for at least count entries.
+enum cdc_stat cc_fifo_cache_reserve(struct cc_fifo_cache *c, size_t count);
+
+// Memory
+// Sets the callback which reports the payload size of a pair.
+void cc_fifo_cache_set_payload_size(struct cc_fifo_cache *c, cc_size_fn_t fn);
+struct cc_memory_usage cc_fifo_cache_memory_usage(struct cc_fifo_cache *c);
+// Returns the estimated metadata bytes of a full cache of max_size entries.
+size_t cc_fifo_cache_bytes_for(size_t max_size);
+
+// Statistics
+// Feeds every cc_fifo_cache_get to the miss ratio curve estimator s. The
+// cache does not own s; pass NULL to detach it.
+void cc_fifo_cache_set_shards(struct cc_fifo_cache *c, struct cc_shards *s);
+// Feeds the keys of every get and insert to the heavy hitter tracker t. The
+// cache does not own t; pass NULL to detach it. Unless t copies keys with
+// info->cp, it keeps the key pointers passed to the cache, so they must stay
+// valid for as long as t is attached.
+void cc_fifo_cache_set_top_keys(struct cc_fifo_cache *c, struct cc_top_keys *t);
+// Writes up to k most frequent keys to keys. Returns their number.
+size_t cc_fifo_cache_top_keys(struct cc_fifo_cache *c, size_t k, void **keys);
+
+// Destruction
+// Makes evicted, erased, replaced and cleared entries go to a queue instead
+// of dfree. The queue is drained by cc_fifo_cache_reclaim or, if background
+// is set, by a thread of its own, which then calls dfree concurrently with
+// the cache. Calling it again drains the old queue first.
+enum cdc_stat cc_fifo_cache_enable_reclaimer(struct cc_fifo_cache *c,
+                                             bool background);
+// Frees the queued entries and goes back to freeing them inline.
+void cc_fifo_cache_disable_reclaimer(struct cc_fifo_cache *c);
+// Frees up to budget queued entries. Returns their number.
+size_t cc_fifo_cache_reclaim(struct cc_fifo_cache *c, size_t budget);
+
 // Modifiers
 enum cdc_stat cc_fifo_cache_insert(struct cc_fifo_cache *c, void *key,
                                    void *value, bool *inserted);
 enum cdc_stat cc_fifo_cache_insert_or_assign(struct cc_fifo_cache *c, void *key,
                                              void *value, bool *inserted);
 
+// Inserts the pairs in the order of the arrays, as a sequence of
+// cc_fifo_cache_insert calls would, but reserves the index once and evicts
+// only after the free capacity is used up. Pairs whose key is already cached
+// are skipped and stay owned by the caller, as do all pairs after an error.
+// Writes the number of stored pairs to loaded if it is not NULL.
+enum cdc_stat cc_fifo_cache_bulk_load(struct cc_fifo_cache *c, void **keys,
+                                      void **values, size_t n, size_t *loaded);
+
 void cc_fifo_cache_erase(struct cc_fifo_cache *c, void *key);
 void cc_fifo_cache_take(struct cc_fifo_cache *c, void *key,
                         struct cdc_pair *kv);
 void cc_fifo_cache_clear(struct cc_fifo_cache *c);
 
+// Iterators
+// Iteration goes from the newest to the oldest entry. Iterators are
+// invalidated by the modifiers.
+void cc_fifo_cache_begin(struct cc_fifo_cache *c,
+                         struct cc_fifo_cache_iter *it);
+void cc_fifo_cache_rbegin(struct cc_fifo_cache *c,
+                          struct cc_fifo_cache_iter *it);
+void cc_fifo_cache_for_each(struct cc_fifo_cache *c, cc_visit_fn_t fn,
+                            void *ctx);
+void cc_fifo_cache_rfor_each(struct cc_fifo_cache *c, cc_visit_fn_t fn,
+                             void *ctx);
+
+// Returns false when the iterator is past the end.
+static inline bool cc_fifo_cache_iter_valid(struct cc_fifo_cache_iter *it)
+{
+  assert(it != NULL);
+
+  return it->current != NULL;
+}
+
+void cc_fifo_cache_iter_next(struct cc_fifo_cache_iter *it);
+void cc_fifo_cache_iter_prev(struct cc_fifo_cache_iter *it);
+void *cc_fifo_cache_iter_key(struct cc_fifo_cache_iter *it);
+void *cc_fifo_cache_iter_value(struct cc_fifo_cache_iter *it);
+
 // Short names
 #ifdef CDC_USE_SHORT_NAMES
 typedef struct cc_fifo_cache fifo_cache_t;
+typedef struct cc_fifo_cache_iter fifo_cache_iter_t;
 
 // Base
 #define fifo_cache_ctor(...) cc_fifo_cache_ctor(__VA_ARGS__)
+#define fifo_cache_ctor1(...) cc_fifo_cache_ctor1(__VA_ARGS__)
 #define fifo_cache_dtor(...) cc_fifo_cache_dtor(__VA_ARGS__)
 
 // Lookup
 #define fifo_cache_get(...) cc_fifo_cache_get(__VA_ARGS__)
 #define fifo_cache_contains(...) cc_fifo_cache_contains(__VA_ARGS__)
+#define fifo_cache_enable_filter(...) cc_fifo_cache_enable_filter(__VA_ARGS__)
+#define fifo_cache_disable_filter(...) \
+  cc_fifo_cache_disable_filter(__VA_ARGS__)
 
 // Capacity
 #define fifo_cache_max_size(...) cc_fifo_cache_max_size(__VA_ARGS__)
 #define fifo_cache_size(...) cc_fifo_cache_size(__VA_ARGS__)
 #define fifo_cache_empty(...) cc_fifo_cache_empty(__VA_ARGS__)
+#define fifo_cache_set_max_size(...) cc_fifo_cache_set_max_size(__VA_ARGS__)
+#define fifo_cache_trim(...) cc_fifo_cache_trim(__VA_ARGS__)
+#define fifo_cache_set_watermarks(...) \
+  cc_fifo_cache_set_watermarks(__VA_ARGS__)
+#define fifo_cache_maintain(...) cc_fifo_cache_maintain(__VA_ARGS__)
+#define fifo_cache_reserve(...) cc_fifo_cache_reserve(__VA_ARGS__)
+
+// Memory
+#define fifo_cache_set_payload_size(...) \
+  cc_fifo_cache_set_payload_size(__VA_ARGS__)
+#define fifo_cache_memory_usage(...) cc_fifo_cache_memory_usage(__VA_ARGS__)
+#define fifo_cache_bytes_for(...) cc_fifo_cache_bytes_for(__VA_ARGS__)
+
+// Statistics
+#define fifo_cache_set_shards(...) cc_fifo_cache_set_shards(__VA_ARGS__)
+#define fifo_cache_set_top_keys(...) cc_fifo_cache_set_top_keys(__VA_ARGS__)
+#define fifo_cache_top_keys(...) cc_fifo_cache_top_keys(__VA_ARGS__)
+
+// Destruction
+#define fifo_cache_enable_reclaimer(...) \
+  cc_fifo_cache_enable_reclaimer(__VA_ARGS__)
+#define fifo_cache_disable_reclaimer(...) \
+  cc_fifo_cache_disable_reclaimer(__VA_ARGS__)
+#define fifo_cache_reclaim(...) cc_fifo_cache_reclaim(__VA_ARGS__)
 
 // Modifiers
 #define fifo_cache_insert(...) cc_fifo_cache_insert(__VA_ARGS__)
 #define fifo_cache_insert_or_assign(...) \
   cc_fifo_cache_insert_or_assign(__VA_ARGS__)
+#define fifo_cache_bulk_load(...) cc_fifo_cache_bulk_load(__VA_ARGS__)
 #define fifo_cache_erase(...) cc_fifo_cache_erase(__VA_ARGS__)
 #define fifo_cache_take(...) cc_fifo_cache_take(__VA_ARGS__)
 #define fifo_cache_clear(...) cc_fifo_cache_clear(__VA_ARGS__)
+
+// Iterators
+#define fifo_cache_begin(...) cc_fifo_cache_begin(__VA_ARGS__)
+#define fifo_cache_rbegin(...) cc_fifo_cache_rbegin(__VA_ARGS__)
+#define fifo_cache_for_each(...) cc_fifo_cache_for_each(__VA_ARGS__)
+#define fifo_cache_rfor_each(...) cc_fifo_cache_rfor_each(__VA_ARGS__)
+#define fifo_cache_iter_valid(...) cc_fifo_cache_iter_valid(__VA_ARGS__)
+#define fifo_cache_iter_next(...) cc_fifo_cache_iter_next(__VA_ARGS__)
+#define fifo_cache_iter_prev(...) cc_fifo_cache_iter_prev(__VA_ARGS__)
+#define fifo_cache_iter_key(...) cc_fifo_cache_iter_key(__VA_ARGS__)
+#define fifo_cache_iter_value(...) cc_fifo_cache_iter_value(__VA_ARGS__)
 #endif
 #endif  // CCACHE_INCLUDE_CCACHE_FIFO_H
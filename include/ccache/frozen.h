@@ -0,0 +1,131 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_INCLUDE_CCACHE_FROZEN_H
+#define CCACHE_INCLUDE_CCACHE_FROZEN_H
+#include <cdcontainers/common.h>
+#include <cdcontainers/status.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CC_FROZEN_MAX_LEVELS 32
+
+struct cc_frozen_pair;
+struct cc_frozen_record;
+
+// Collects byte string pairs and writes them to an immutable image.
+struct cc_frozen_builder {
+  struct cc_frozen_pair *pairs;
+  size_t size;
+  size_t capacity;
+};
+
+// A read-only cache mapped from an image written by cc_frozen_builder_write.
+// Keys are found with a minimal perfect hash in the style of BBHash: every
+// level is a bitmap in which a key owns the bit it hashes to unless another
+// key of the level hashes there too, and the keys that collide move on to
+// the next level. The rank of the owned bit over all levels is the index of
+// the key. A 16 bit fingerprint per index rejects most absent keys before
+// the record and the key bytes are read. Lookups run directly on the
+// mapping.
+struct cc_frozen_cache {
+  void *map;
+  size_t map_size;
+  size_t size;
+  size_t levels;
+  size_t level_words[CC_FROZEN_MAX_LEVELS];
+  const uint64_t *bits;
+  // Number of set bits before every block of eight words.
+  const uint64_t *ranks;
+  const uint16_t *fingerprints;
+  const struct cc_frozen_record *records;
+  const unsigned char *data;
+  size_t data_size;
+};
+
+// Builder
+enum cdc_stat cc_frozen_builder_ctor(struct cc_frozen_builder **b);
+void cc_frozen_builder_dtor(struct cc_frozen_builder *b);
+// Copies the pair. Keys must be distinct.
+enum cdc_stat cc_frozen_builder_add(struct cc_frozen_builder *b,
+                                    const void *key, size_t key_size,
+                                    const void *value, size_t value_size);
+// Writes the image to path. Fails with CDC_STATUS_UNKNOWN_ERROR if the file
+// cannot be written or a key was added twice.
+enum cdc_stat cc_frozen_builder_write(struct cc_frozen_builder *b,
+                                      const char *path);
+
+// Base
+// Maps the image at path. Fails with CDC_STATUS_UNKNOWN_ERROR if the file
+// cannot be mapped or is not a valid image.
+enum cdc_stat cc_frozen_cache_ctor(struct cc_frozen_cache **c,
+                                   const char *path);
+void cc_frozen_cache_dtor(struct cc_frozen_cache *c);
+
+// Lookup
+// Points value into the mapping, which stays valid until the dtor.
+enum cdc_stat cc_frozen_cache_get(struct cc_frozen_cache *c, const void *key,
+                                  size_t key_size, const void **value,
+                                  size_t *value_size);
+bool cc_frozen_cache_contains(struct cc_frozen_cache *c, const void *key,
+                              size_t key_size);
+
+// Capacity
+static inline size_t cc_frozen_cache_size(struct cc_frozen_cache *c)
+{
+  assert(c != NULL);
+
+  return c->size;
+}
+
+static inline bool cc_frozen_cache_empty(struct cc_frozen_cache *c)
+{
+  assert(c != NULL);
+
+  return c->size == 0;
+}
+
+// Short names
+#ifdef CDC_USE_SHORT_NAMES
+typedef struct cc_frozen_builder frozen_builder_t;
+typedef struct cc_frozen_cache frozen_cache_t;
+
+// Builder
+#define frozen_builder_ctor(...) cc_frozen_builder_ctor(__VA_ARGS__)
+#define frozen_builder_dtor(...) cc_frozen_builder_dtor(__VA_ARGS__)
+#define frozen_builder_add(...) cc_frozen_builder_add(__VA_ARGS__)
+#define frozen_builder_write(...) cc_frozen_builder_write(__VA_ARGS__)
+
+// Base
+#define frozen_cache_ctor(...) cc_frozen_cache_ctor(__VA_ARGS__)
+#define frozen_cache_dtor(...) cc_frozen_cache_dtor(__VA_ARGS__)
+
+// Lookup
+#define frozen_cache_get(...) cc_frozen_cache_get(__VA_ARGS__)
+#define frozen_cache_contains(...) cc_frozen_cache_contains(__VA_ARGS__)
+
+// Capacity
+#define frozen_cache_size(...) cc_frozen_cache_size(__VA_ARGS__)
+#define frozen_cache_empty(...) cc_frozen_cache_empty(__VA_ARGS__)
+#endif
+#endif  // CCACHE_INCLUDE_CCACHE_FROZEN_H
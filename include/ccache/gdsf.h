@@ -0,0 +1,132 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_INCLUDE_CCACHE_GDSF_H
+#define CCACHE_INCLUDE_CCACHE_GDSF_H
+#include <cdcontainers/common.h>
+#include <cdcontainers/status.h>
+
+#include <ccache/memory.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct cc_gdsf_entry;
+struct cdc_hash_table;
+struct cdc_data_info;
+
+// Returns the cost of fetching the value again, e.g. its latency.
+typedef double (*cc_cost_fn_t)(void *key, void *value);
+
+// GreedyDual-Size-Frequency. Every entry gets the priority
+// clock + frequency * cost / size and the entry with the lowest priority is
+// evicted first. Each eviction raises the clock to the priority of the
+// evicted entry, so that entries which are not used age relative to new
+// ones. The capacity is measured in the units of the size callback.
+struct cc_gdsf_cache {
+  size_t max_bytes;
+  size_t bytes;
+  // A binary min-heap of priorities. Entries know their index in it.
+  struct cc_gdsf_entry **heap;
+  size_t heap_size;
+  size_t heap_capacity;
+  // Stores pairs of key and entry.
+  struct cdc_hash_table *table;
+  struct cdc_data_info *dinfo;
+  cc_size_fn_t size;
+  cc_cost_fn_t cost;
+  double clock;
+};
+
+// Base
+// size is required. Without cost every entry costs 1, which favors small
+// entries and maximizes the hit ratio per entry.
+enum cdc_stat cc_gdsf_cache_ctor(struct cc_gdsf_cache **c, size_t max_bytes,
+                                 struct cdc_data_info *info, cc_size_fn_t size,
+                                 cc_cost_fn_t cost);
+void cc_gdsf_cache_dtor(struct cc_gdsf_cache *c);
+
+// Lookup
+enum cdc_stat cc_gdsf_cache_get(struct cc_gdsf_cache *c, void *key,
+                                void **value);
+// Does not count as a use of the entry.
+bool cc_gdsf_cache_contains(struct cc_gdsf_cache *c, void *key);
+
+// Capacity
+static inline size_t cc_gdsf_cache_max_bytes(struct cc_gdsf_cache *c)
+{
+  assert(c != NULL);
+
+  return c->max_bytes;
+}
+
+static inline size_t cc_gdsf_cache_bytes(struct cc_gdsf_cache *c)
+{
+  assert(c != NULL);
+
+  return c->bytes;
+}
+
+size_t cc_gdsf_cache_size(struct cc_gdsf_cache *c);
+bool cc_gdsf_cache_empty(struct cc_gdsf_cache *c);
+
+// Modifiers
+// An entry larger than max_bytes is not stored: the functions return
+// CDC_STATUS_OUT_OF_RANGE and the caller keeps the ownership of the pair.
+// insert_or_assign then removes the old entry of the key.
+enum cdc_stat cc_gdsf_cache_insert(struct cc_gdsf_cache *c, void *key,
+                                   void *value, bool *inserted);
+enum cdc_stat cc_gdsf_cache_insert_or_assign(struct cc_gdsf_cache *c,
+                                             void *key, void *value,
+                                             bool *inserted);
+
+void cc_gdsf_cache_erase(struct cc_gdsf_cache *c, void *key);
+void cc_gdsf_cache_take(struct cc_gdsf_cache *c, void *key,
+                        struct cdc_pair *kv);
+void cc_gdsf_cache_clear(struct cc_gdsf_cache *c);
+
+// Short names
+#ifdef CDC_USE_SHORT_NAMES
+typedef struct cc_gdsf_cache gdsf_cache_t;
+
+// Base
+#define gdsf_cache_ctor(...) cc_gdsf_cache_ctor(__VA_ARGS__)
+#define gdsf_cache_dtor(...) cc_gdsf_cache_dtor(__VA_ARGS__)
+
+// Lookup
+#define gdsf_cache_get(...) cc_gdsf_cache_get(__VA_ARGS__)
+#define gdsf_cache_contains(...) cc_gdsf_cache_contains(__VA_ARGS__)
+
+// Capacity
+#define gdsf_cache_max_bytes(...) cc_gdsf_cache_max_bytes(__VA_ARGS__)
+#define gdsf_cache_bytes(...) cc_gdsf_cache_bytes(__VA_ARGS__)
+#define gdsf_cache_size(...) cc_gdsf_cache_size(__VA_ARGS__)
+#define gdsf_cache_empty(...) cc_gdsf_cache_empty(__VA_ARGS__)
+
+// Modifiers
+#define gdsf_cache_insert(...) cc_gdsf_cache_insert(__VA_ARGS__)
+#define gdsf_cache_insert_or_assign(...) \
+  cc_gdsf_cache_insert_or_assign(__VA_ARGS__)
+#define gdsf_cache_erase(...) cc_gdsf_cache_erase(__VA_ARGS__)
+#define gdsf_cache_take(...) cc_gdsf_cache_take(__VA_ARGS__)
+#define gdsf_cache_clear(...) cc_gdsf_cache_clear(__VA_ARGS__)
+#endif
+#endif  // CCACHE_INCLUDE_CCACHE_GDSF_H
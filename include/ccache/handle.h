@@ -0,0 +1,84 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_INCLUDE_CCACHE_HANDLE_H
+#define CCACHE_INCLUDE_CCACHE_HANDLE_H
+#include <cdcontainers/common.h>
+#include <cdcontainers/status.h>
+
+#include <assert.h>
+#include <stddef.h>
+
+// A counted reference to a cached pair. The cache holds one reference while
+// the entry is cached and every acquire adds one. When the entry leaves the
+// cache, the handle takes over the part of the pair the cache would have
+// freed and the last release passes it to dfree. Releasing is thread safe
+// and needs no lock of the cache.
+struct cc_handle {
+  struct cdc_pair kv;
+  // The part of kv that the last release frees.
+  struct cdc_pair owned;
+  cdc_free_fn_t dfree;
+  size_t refs;
+};
+
+// Creates a handle referenced by the cache and by one acquirer.
+struct cc_handle *cc_handle_new(struct cdc_pair kv, cdc_free_fn_t dfree);
+
+// Adds the reference of another acquirer.
+static inline void cc_handle_retain(struct cc_handle *h)
+{
+  assert(h != NULL);
+
+  __atomic_add_fetch(&h->refs, 1, __ATOMIC_RELAXED);
+}
+
+// Drops the reference of the cache when the entry leaves it. owned is the
+// part of the pair that the cache would have freed.
+void cc_handle_detach(struct cc_handle *h, struct cdc_pair owned);
+
+static inline void *cc_handle_key(struct cc_handle *h)
+{
+  assert(h != NULL);
+
+  return h->kv.first;
+}
+
+// Stays valid until the handle is released, even if the entry is evicted or
+// its value is replaced in the meantime. A cache does not let an acquired
+// entry be taken.
+static inline void *cc_handle_value(struct cc_handle *h)
+{
+  assert(h != NULL);
+
+  return h->kv.second;
+}
+
+void cc_handle_release(struct cc_handle *h);
+
+// Short names
+#ifdef CDC_USE_SHORT_NAMES
+typedef struct cc_handle handle_t;
+
+#define handle_key(...) cc_handle_key(__VA_ARGS__)
+#define handle_value(...) cc_handle_value(__VA_ARGS__)
+#define handle_release(...) cc_handle_release(__VA_ARGS__)
+#endif
+#endif  // CCACHE_INCLUDE_CCACHE_HANDLE_H
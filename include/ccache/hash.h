@@ -0,0 +1,122 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_INCLUDE_CCACHE_HASH_H
+#define CCACHE_INCLUDE_CCACHE_HASH_H
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct cdc_data_info;
+
+#define CC_HASH_P0 0x2d358dccaa6c78a5ull
+#define CC_HASH_P1 0x8bb84b93962eacc9ull
+
+// Multiplies a and b into the 128 bit value hi:lo.
+static inline void cc_hash_mul128(uint64_t a, uint64_t b, uint64_t *lo,
+                                  uint64_t *hi)
+{
+#ifdef __SIZEOF_INT128__
+  __extension__ typedef unsigned __int128 u128;
+  u128 r = (u128)a * b;
+  *lo = (uint64_t)r;
+  *hi = (uint64_t)(r >> 64);
+#else
+  uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t)a, lb = (uint32_t)b;
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  uint64_t t = rl + (rm0 << 32);
+  uint64_t c = t < rl;
+  *lo = t + (rm1 << 32);
+  c += *lo < t;
+  *hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+// Folds the 128 bit product of a and b into 64 bits.
+static inline uint64_t cc_hash_mum(uint64_t a, uint64_t b)
+{
+  uint64_t lo, hi;
+  cc_hash_mul128(a, b, &lo, &hi);
+  return lo ^ hi;
+}
+
+// Hashes an integer. One multiplication, in the style of wyhash.
+static inline uint64_t cc_hash_u64(uint64_t x)
+{
+  return cc_hash_mum(x ^ CC_HASH_P0, CC_HASH_P1);
+}
+
+// Hashes size bytes. Keys up to 16 bytes take a few loads and one
+// multiplication, keys up to 512 bytes go through three independent wyhash
+// lanes and longer keys through eight lanes of 32 bit multiplications, which
+// use SSE2 where it is available.
+uint64_t cc_hash_bytes(const void *data, size_t size, uint64_t seed);
+
+// Adapters for cdc_data_info.
+// Hashes the key pointer itself, e.g. keys made with CDC_FROM_INT.
+size_t cc_hash_int_key(const void *key);
+// Hashes a NUL terminated string.
+size_t cc_hash_cstr_key(const void *key);
+int cc_eq_cstr_key(const void *l, const void *r);
+
+// A byte string key which carries its hash. Keys made with
+// cc_string_key_new keep their bytes in the same allocation right after the
+// header, so a comparison touches one block of memory. Equality compares the
+// hashes and the sizes before the bytes.
+struct cc_string_key {
+  uint64_t hash;
+  size_t size;
+  const char *data;
+};
+
+// Copies size bytes into a new key. Returns NULL if out of memory. Free the
+// key with free().
+struct cc_string_key *cc_string_key_new(const void *data, size_t size);
+
+// Makes a key that refers to data without copying it, for lookups.
+static inline struct cc_string_key cc_string_key_view(const void *data,
+                                                      size_t size)
+{
+  assert(data != NULL || size == 0);
+
+  struct cc_string_key key;
+  key.hash = cc_hash_bytes(data, size, 0);
+  key.size = size;
+  key.data = (const char *)data;
+  return key;
+}
+
+size_t cc_string_key_hash(const void *key);
+int cc_string_key_eq(const void *l, const void *r);
+// Sets the hash and eq of info for struct cc_string_key keys.
+void cc_string_key_info(struct cdc_data_info *info);
+
+// Short names
+#ifdef CDC_USE_SHORT_NAMES
+typedef struct cc_string_key string_key_t;
+
+#define hash_bytes(...) cc_hash_bytes(__VA_ARGS__)
+#define hash_u64(...) cc_hash_u64(__VA_ARGS__)
+#define string_key_new(...) cc_string_key_new(__VA_ARGS__)
+#define string_key_view(...) cc_string_key_view(__VA_ARGS__)
+#define string_key_info(...) cc_string_key_info(__VA_ARGS__)
+#endif
+#endif  // CCACHE_INCLUDE_CCACHE_HASH_H
@@ -0,0 +1,114 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_INCLUDE_CCACHE_LFU_H
+#define CCACHE_INCLUDE_CCACHE_LFU_H
+#include <cdcontainers/common.h>
+#include <cdcontainers/status.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct cc_lfu_bucket;
+struct cdc_hash_table;
+struct cdc_data_info;
+
+// Evicts the least frequently used entry, and the least recently used one
+// among entries with the same frequency. Entries are kept in a list of
+// frequency buckets, so that every operation is O(1).
+struct cc_lfu_cache {
+  size_t max_size;
+  // Buckets in ascending order of frequency.
+  struct cc_lfu_bucket *head;
+  struct cc_lfu_bucket *tail;
+  struct cdc_data_info *dinfo;
+  // Stores pairs of key and list node.
+  struct cdc_hash_table *table;
+  // Frequencies are halved every decay_period gets and inserts.
+  size_t decay_period;
+  size_t ops;
+};
+
+// Base
+enum cdc_stat cc_lfu_cache_ctor(struct cc_lfu_cache **c, size_t max_size,
+                                struct cdc_data_info *info);
+void cc_lfu_cache_dtor(struct cc_lfu_cache *c);
+
+// Lookup
+enum cdc_stat cc_lfu_cache_get(struct cc_lfu_cache *c, void *key, void **value);
+// Does not count as a use of the entry.
+bool cc_lfu_cache_contains(struct cc_lfu_cache *c, void *key);
+// Returns the use count of the entry or 0 if there is no such entry.
+size_t cc_lfu_cache_frequency(struct cc_lfu_cache *c, void *key);
+
+// Capacity
+static inline size_t cc_lfu_cache_max_size(struct cc_lfu_cache *c)
+{
+  assert(c != NULL);
+
+  return c->max_size;
+}
+
+size_t cc_lfu_cache_size(struct cc_lfu_cache *c);
+bool cc_lfu_cache_empty(struct cc_lfu_cache *c);
+
+// Modifiers
+enum cdc_stat cc_lfu_cache_insert(struct cc_lfu_cache *c, void *key,
+                                  void *value, bool *inserted);
+enum cdc_stat cc_lfu_cache_insert_or_assign(struct cc_lfu_cache *c, void *key,
+                                            void *value, bool *inserted);
+
+void cc_lfu_cache_erase(struct cc_lfu_cache *c, void *key);
+void cc_lfu_cache_take(struct cc_lfu_cache *c, void *key, struct cdc_pair *kv);
+void cc_lfu_cache_clear(struct cc_lfu_cache *c);
+
+// Halves all frequencies every period gets and inserts, so that old
+// popularity ages out. Zero disables the decay.
+void cc_lfu_cache_set_decay(struct cc_lfu_cache *c, size_t period);
+
+// Short names
+#ifdef CDC_USE_SHORT_NAMES
+typedef struct cc_lfu_cache lfu_cache_t;
+
+// Base
+#define lfu_cache_ctor(...) cc_lfu_cache_ctor(__VA_ARGS__)
+#define lfu_cache_dtor(...) cc_lfu_cache_dtor(__VA_ARGS__)
+
+// Lookup
+#define lfu_cache_get(...) cc_lfu_cache_get(__VA_ARGS__)
+#define lfu_cache_contains(...) cc_lfu_cache_contains(__VA_ARGS__)
+#define lfu_cache_frequency(...) cc_lfu_cache_frequency(__VA_ARGS__)
+
+// Capacity
+#define lfu_cache_max_size(...) cc_lfu_cache_max_size(__VA_ARGS__)
+#define lfu_cache_size(...) cc_lfu_cache_size(__VA_ARGS__)
+#define lfu_cache_empty(...) cc_lfu_cache_empty(__VA_ARGS__)
+
+// Modifiers
+#define lfu_cache_insert(...) cc_lfu_cache_insert(__VA_ARGS__)
+#define lfu_cache_insert_or_assign(...) \
+  cc_lfu_cache_insert_or_assign(__VA_ARGS__)
+#define lfu_cache_erase(...) cc_lfu_cache_erase(__VA_ARGS__)
+#define lfu_cache_take(...) cc_lfu_cache_take(__VA_ARGS__)
+#define lfu_cache_clear(...) cc_lfu_cache_clear(__VA_ARGS__)
+#define lfu_cache_set_decay(...) cc_lfu_cache_set_decay(__VA_ARGS__)
+#endif
+#endif  // CCACHE_INCLUDE_CCACHE_LFU_H
@@ -0,0 +1,36 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_INCLUDE_CCACHE_MEMORY_H
+#define CCACHE_INCLUDE_CCACHE_MEMORY_H
+#include <stddef.h>
+
+// Returns the number of bytes that a pair occupies outside of the cache.
+typedef size_t (*cc_size_fn_t)(void *key, void *value);
+
+struct cc_memory_usage {
+  // Bytes used by the cache itself: list nodes, index entries, the bucket
+  // array and allocator overhead.
+  size_t metadata;
+  // Bytes reported by the payload size callback of the cache.
+  size_t payload;
+};
+
+#endif  // CCACHE_INCLUDE_CCACHE_MEMORY_H
@@ -0,0 +1,153 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_INCLUDE_CCACHE_NEAR_H
+#define CCACHE_INCLUDE_CCACHE_NEAR_H
+#include <cdcontainers/common.h>
+#include <cdcontainers/status.h>
+
+#include <ccache/cache.h>
+#include <ccache/epoch.h>
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A cache of any policy shared by threads which read it through near caches
+// of their own. Calls to the cache are serialized by a mutex. Every write,
+// erase and eviction of a key bumps the stamp of the key's slot, which tells
+// the near caches that their copy is stale, and removed pairs go to the
+// epoch based reclamation instead of dfree, so that a copy stays valid
+// until its reader leaves the critical section. A value freed without its
+// key, e.g. by a 2q demotion, cannot be traced to a slot and bumps the
+// generation instead, which makes all copies stale.
+struct cc_shared_cache {
+  struct cc_cache *cache;
+  cdc_free_fn_t dfree;
+  cdc_hash_fn_t hash;
+  cdc_binary_pred_fn_t eq;
+  uint64_t *stamps;
+  size_t stamp_mask;
+  uint64_t generation;
+  struct cc_epoch *epoch;
+  pthread_mutex_t mutex;
+};
+
+struct cc_near_way {
+  void *key;
+  void *value;
+  size_t hash;
+  // The stamp of the key's slot and the generation when the copy was made.
+  uint64_t stamp;
+  uint64_t generation;
+  bool used;
+};
+
+// A small 2-way set associative cache used by one thread only. A hit takes
+// no lock and writes no shared memory: it reads the stamp of the key's slot
+// and compares it with the stamp of the copy.
+struct cc_near_cache {
+  struct cc_shared_cache *shared;
+  struct cc_epoch_record *record;
+  // Pairs of ways, the more recently used one first.
+  struct cc_near_way *ways;
+  size_t set_mask;
+  size_t hits;
+  size_t misses;
+};
+
+// Shared cache
+// Creates the cache from config, which must provide hash and eq.
+enum cdc_stat cc_shared_cache_ctor(struct cc_shared_cache **s,
+                                   const struct cc_cache_config *config);
+// All near caches must be destroyed before.
+void cc_shared_cache_dtor(struct cc_shared_cache *s);
+
+// Base
+// Rounds sets up to a power of two.
+enum cdc_stat cc_near_cache_ctor(struct cc_near_cache **c,
+                                 struct cc_shared_cache *s, size_t sets);
+void cc_near_cache_dtor(struct cc_near_cache *c);
+
+// Readers
+// Lookups must be made between cc_near_cache_enter and cc_near_cache_leave.
+// Values returned by cc_near_cache_get stay valid until cc_near_cache_leave
+// even if they are removed from the shared cache meanwhile.
+static inline void cc_near_cache_enter(struct cc_near_cache *c)
+{
+  assert(c != NULL);
+
+  cc_epoch_enter(c->record);
+}
+
+static inline void cc_near_cache_leave(struct cc_near_cache *c)
+{
+  assert(c != NULL);
+
+  cc_epoch_leave(c->record);
+}
+
+// Lookup
+// A miss in the near cache locks the shared cache and copies the entry. The
+// copy refers to key, which must stay valid as long as the near cache.
+enum cdc_stat cc_near_cache_get(struct cc_near_cache *c, void *key,
+                                void **value);
+
+// Modifiers
+// Write through to the shared cache and invalidate the copies of the key in
+// all near caches.
+enum cdc_stat cc_near_cache_insert(struct cc_near_cache *c, void *key,
+                                   void *value, bool *inserted);
+enum cdc_stat cc_near_cache_insert_or_assign(struct cc_near_cache *c,
+                                             void *key, void *value,
+                                             bool *inserted);
+void cc_near_cache_erase(struct cc_near_cache *c, void *key);
+void cc_near_cache_clear(struct cc_near_cache *c);
+
+// Short names
+#ifdef CDC_USE_SHORT_NAMES
+typedef struct cc_shared_cache shared_cache_t;
+typedef struct cc_near_cache near_cache_t;
+
+// Shared cache
+#define shared_cache_ctor(...) cc_shared_cache_ctor(__VA_ARGS__)
+#define shared_cache_dtor(...) cc_shared_cache_dtor(__VA_ARGS__)
+
+// Base
+#define near_cache_ctor(...) cc_near_cache_ctor(__VA_ARGS__)
+#define near_cache_dtor(...) cc_near_cache_dtor(__VA_ARGS__)
+
+// Readers
+#define near_cache_enter(...) cc_near_cache_enter(__VA_ARGS__)
+#define near_cache_leave(...) cc_near_cache_leave(__VA_ARGS__)
+
+// Lookup
+#define near_cache_get(...) cc_near_cache_get(__VA_ARGS__)
+
+// Modifiers
+#define near_cache_insert(...) cc_near_cache_insert(__VA_ARGS__)
+#define near_cache_insert_or_assign(...) \
+  cc_near_cache_insert_or_assign(__VA_ARGS__)
+#define near_cache_erase(...) cc_near_cache_erase(__VA_ARGS__)
+#define near_cache_clear(...) cc_near_cache_clear(__VA_ARGS__)
+#endif
+#endif  // CCACHE_INCLUDE_CCACHE_NEAR_H
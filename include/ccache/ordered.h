@@ -0,0 +1,132 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_INCLUDE_CCACHE_ORDERED_H
+#define CCACHE_INCLUDE_CCACHE_ORDERED_H
+#include <cdcontainers/common.h>
+#include <cdcontainers/status.h>
+
+#include <ccache/common.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct cc_list;
+struct cc_ordered_node;
+struct cdc_data_info;
+
+// An lru cache indexed by a B+ tree instead of a hash table, so that the
+// entries can also be looked up by key range. The nodes of the tree keep up
+// to 32 keys in a sorted array and the leaves are linked in key order, so a
+// range is read leaf by leaf without going back to the root.
+struct cc_ordered_cache {
+  size_t max_size;
+  size_t size;
+  // Stores pairs of key and value from the most to the least recently used.
+  struct cc_list *list;
+  // Leaves map the keys to the list nodes.
+  struct cc_ordered_node *root;
+  cdc_binary_pred_fn_t lt;
+};
+
+// Base
+// Orders the keys by info->lt.
+enum cdc_stat cc_ordered_cache_ctor(struct cc_ordered_cache **c,
+                                    size_t max_size,
+                                    struct cdc_data_info *info);
+void cc_ordered_cache_dtor(struct cc_ordered_cache *c);
+
+// Lookup
+enum cdc_stat cc_ordered_cache_get(struct cc_ordered_cache *c, void *key,
+                                   void **value);
+bool cc_ordered_cache_contains(struct cc_ordered_cache *c, void *key);
+// Finds the entry with the least key that is not less than key.
+enum cdc_stat cc_ordered_cache_lower_bound(struct cc_ordered_cache *c,
+                                           void *key, struct cdc_pair *kv);
+// Visits the entries with lo <= key < hi in key order until fn returns false.
+// Every visited entry counts as used. The cache must not be modified by fn.
+// Returns the number of visited entries.
+size_t cc_ordered_cache_range_scan(struct cc_ordered_cache *c, void *lo,
+                                   void *hi, cc_visit_fn_t fn, void *ctx);
+
+// Capacity
+static inline size_t cc_ordered_cache_max_size(struct cc_ordered_cache *c)
+{
+  assert(c != NULL);
+
+  return c->max_size;
+}
+
+static inline size_t cc_ordered_cache_size(struct cc_ordered_cache *c)
+{
+  assert(c != NULL);
+
+  return c->size;
+}
+
+static inline bool cc_ordered_cache_empty(struct cc_ordered_cache *c)
+{
+  assert(c != NULL);
+
+  return c->size == 0;
+}
+
+// Modifiers
+enum cdc_stat cc_ordered_cache_insert(struct cc_ordered_cache *c, void *key,
+                                      void *value, bool *inserted);
+enum cdc_stat cc_ordered_cache_insert_or_assign(struct cc_ordered_cache *c,
+                                                void *key, void *value,
+                                                bool *inserted);
+
+void cc_ordered_cache_erase(struct cc_ordered_cache *c, void *key);
+void cc_ordered_cache_take(struct cc_ordered_cache *c, void *key,
+                           struct cdc_pair *kv);
+void cc_ordered_cache_clear(struct cc_ordered_cache *c);
+
+// Short names
+#ifdef CDC_USE_SHORT_NAMES
+typedef struct cc_ordered_cache ordered_cache_t;
+
+// Base
+#define ordered_cache_ctor(...) cc_ordered_cache_ctor(__VA_ARGS__)
+#define ordered_cache_dtor(...) cc_ordered_cache_dtor(__VA_ARGS__)
+
+// Lookup
+#define ordered_cache_get(...) cc_ordered_cache_get(__VA_ARGS__)
+#define ordered_cache_contains(...) cc_ordered_cache_contains(__VA_ARGS__)
+#define ordered_cache_lower_bound(...) \
+  cc_ordered_cache_lower_bound(__VA_ARGS__)
+#define ordered_cache_range_scan(...) cc_ordered_cache_range_scan(__VA_ARGS__)
+
+// Capacity
+#define ordered_cache_max_size(...) cc_ordered_cache_max_size(__VA_ARGS__)
+#define ordered_cache_size(...) cc_ordered_cache_size(__VA_ARGS__)
+#define ordered_cache_empty(...) cc_ordered_cache_empty(__VA_ARGS__)
+
+// Modifiers
+#define ordered_cache_insert(...) cc_ordered_cache_insert(__VA_ARGS__)
+#define ordered_cache_insert_or_assign(...) \
+  cc_ordered_cache_insert_or_assign(__VA_ARGS__)
+#define ordered_cache_erase(...) cc_ordered_cache_erase(__VA_ARGS__)
+#define ordered_cache_take(...) cc_ordered_cache_take(__VA_ARGS__)
+#define ordered_cache_clear(...) cc_ordered_cache_clear(__VA_ARGS__)
+#endif
+#endif  // CCACHE_INCLUDE_CCACHE_ORDERED_H
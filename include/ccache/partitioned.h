@@ -0,0 +1,195 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_INCLUDE_CCACHE_PARTITIONED_H
+#define CCACHE_INCLUDE_CCACHE_PARTITIONED_H
+#include <cdcontainers/common.h>
+#include <cdcontainers/status.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct cc_list;
+struct cdc_hash_table;
+struct cdc_data_info;
+
+struct cc_partition_stats {
+  size_t size;
+  // Entries below min_size are never evicted for another partition and the
+  // partition never holds more than max_size entries.
+  size_t min_size;
+  size_t max_size;
+  size_t hits;
+  size_t misses;
+  size_t evictions;
+};
+
+struct cc_partition_group;
+
+struct cc_partition {
+  // Stores pairs of key and value from the most to the least recently used.
+  struct cc_list *list;
+  struct cc_partition_stats stats;
+  // The partitions are kept in groups of equal size - min_size.
+  struct cc_partition_group *group;
+  struct cc_partition *prev;
+  struct cc_partition *next;
+};
+
+struct cc_partition_group {
+  int64_t excess;
+  struct cc_partition *head;
+  struct cc_partition_group *prev;
+  struct cc_partition_group *next;
+};
+
+// A cache shared by several partitions, e.g. tenants. Every entry belongs to
+// one partition and every partition is an lru of its own. When the cache is
+// full, an insert evicts from the partition with the most entries above its
+// guaranteed minimum, so that the spare capacity is shared equally among
+// the partitions that use it. The partitions are kept in a list of groups
+// ordered by that excess and every insert or removal moves one partition to
+// a neighbouring group, so picking the victim takes O(1).
+struct cc_partitioned_cache {
+  size_t max_size;
+  size_t size;
+  struct cc_partition *partitions;
+  size_t partition_count;
+  // Groups from the lowest to the highest excess and the unused ones.
+  struct cc_partition_group *groups;
+  struct cc_partition_group *lowest;
+  struct cc_partition_group *highest;
+  struct cc_partition_group *free_groups;
+  // Stores pairs of key and list node.
+  struct cdc_hash_table *table;
+};
+
+// Base
+// Every partition starts with no guarantee and may take the whole cache.
+enum cdc_stat cc_partitioned_cache_ctor(struct cc_partitioned_cache **c,
+                                        size_t max_size,
+                                        size_t partition_count,
+                                        struct cdc_data_info *info);
+void cc_partitioned_cache_dtor(struct cc_partitioned_cache *c);
+
+// Lookup
+// Counts a hit or a miss for the partition. An entry of another partition is
+// not found.
+enum cdc_stat cc_partitioned_cache_get(struct cc_partitioned_cache *c,
+                                       size_t partition, void *key,
+                                       void **value);
+// Does not count as a hit.
+bool cc_partitioned_cache_contains(struct cc_partitioned_cache *c, void *key);
+
+// Capacity
+static inline size_t cc_partitioned_cache_max_size(
+    struct cc_partitioned_cache *c)
+{
+  assert(c != NULL);
+
+  return c->max_size;
+}
+
+static inline size_t cc_partitioned_cache_size(struct cc_partitioned_cache *c)
+{
+  assert(c != NULL);
+
+  return c->size;
+}
+
+static inline bool cc_partitioned_cache_empty(struct cc_partitioned_cache *c)
+{
+  assert(c != NULL);
+
+  return c->size == 0;
+}
+
+// Sets the guaranteed minimum and the cap of a partition. Fails with
+// CDC_STATUS_OUT_OF_RANGE if the minimums would add up to more than
+// max_size. Entries above the new cap are evicted.
+enum cdc_stat cc_partitioned_cache_set_limits(struct cc_partitioned_cache *c,
+                                              size_t partition,
+                                              size_t min_size,
+                                              size_t max_size);
+
+// Statistics
+static inline void cc_partitioned_cache_stats(struct cc_partitioned_cache *c,
+                                              size_t partition,
+                                              struct cc_partition_stats *stats)
+{
+  assert(c != NULL);
+  assert(partition < c->partition_count);
+  assert(stats != NULL);
+
+  *stats = c->partitions[partition].stats;
+}
+
+// Modifiers
+// Keys are unique across the partitions. If the cache is full and every
+// partition is at its minimum, a partition without entries cannot take one:
+// inserted is set to false and the caller keeps the ownership of the pair.
+enum cdc_stat cc_partitioned_cache_insert(struct cc_partitioned_cache *c,
+                                          size_t partition, void *key,
+                                          void *value, bool *inserted);
+// An entry of another partition is moved to this one.
+enum cdc_stat cc_partitioned_cache_insert_or_assign(
+    struct cc_partitioned_cache *c, size_t partition, void *key, void *value,
+    bool *inserted);
+
+void cc_partitioned_cache_erase(struct cc_partitioned_cache *c, void *key);
+void cc_partitioned_cache_take(struct cc_partitioned_cache *c, void *key,
+                               struct cdc_pair *kv);
+void cc_partitioned_cache_clear(struct cc_partitioned_cache *c);
+
+// Short names
+#ifdef CDC_USE_SHORT_NAMES
+typedef struct cc_partitioned_cache partitioned_cache_t;
+
+// Base
+#define partitioned_cache_ctor(...) cc_partitioned_cache_ctor(__VA_ARGS__)
+#define partitioned_cache_dtor(...) cc_partitioned_cache_dtor(__VA_ARGS__)
+
+// Lookup
+#define partitioned_cache_get(...) cc_partitioned_cache_get(__VA_ARGS__)
+#define partitioned_cache_contains(...) \
+  cc_partitioned_cache_contains(__VA_ARGS__)
+
+// Capacity
+#define partitioned_cache_max_size(...) \
+  cc_partitioned_cache_max_size(__VA_ARGS__)
+#define partitioned_cache_size(...) cc_partitioned_cache_size(__VA_ARGS__)
+#define partitioned_cache_empty(...) cc_partitioned_cache_empty(__VA_ARGS__)
+#define partitioned_cache_set_limits(...) \
+  cc_partitioned_cache_set_limits(__VA_ARGS__)
+
+// Statistics
+#define partitioned_cache_stats(...) cc_partitioned_cache_stats(__VA_ARGS__)
+
+// Modifiers
+#define partitioned_cache_insert(...) cc_partitioned_cache_insert(__VA_ARGS__)
+#define partitioned_cache_insert_or_assign(...) \
+  cc_partitioned_cache_insert_or_assign(__VA_ARGS__)
+#define partitioned_cache_erase(...) cc_partitioned_cache_erase(__VA_ARGS__)
+#define partitioned_cache_take(...) cc_partitioned_cache_take(__VA_ARGS__)
+#define partitioned_cache_clear(...) cc_partitioned_cache_clear(__VA_ARGS__)
+#endif
+#endif  // CCACHE_INCLUDE_CCACHE_PARTITIONED_H
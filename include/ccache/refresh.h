@@ -0,0 +1,191 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_INCLUDE_CCACHE_REFRESH_H
+#define CCACHE_INCLUDE_CCACHE_REFRESH_H
+#include <cdcontainers/common.h>
+#include <cdcontainers/status.h>
+
+#include <ccache/epoch.h>
+#include <ccache/executor.h>
+#include <ccache/lru.h>
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct cdc_data_info;
+
+typedef uint64_t (*cc_clock_fn_t)(void *ctx);
+typedef enum cdc_stat (*cc_load_fn_t)(void *ctx, void *key, void **value);
+
+struct cc_refresh_policy {
+  // Lifetime of an entry in clock ticks. Zero means that entries never
+  // expire and are never refreshed.
+  uint64_t expire_after;
+  // Part of the lifetime after which a read queues a reload, in (0, 1].
+  double refresh_ratio;
+  // Loads a value on a miss and on a refresh. May be called from the
+  // executor threads.
+  cc_load_fn_t load;
+  void *load_ctx;
+  // Defaults to the monotonic clock in nanoseconds.
+  cc_clock_fn_t clock;
+  void *clock_ctx;
+  // Defaults to an internal pool of nthreads workers (one if zero).
+  struct cc_executor *executor;
+  size_t nthreads;
+};
+
+// An lru cache which returns entries that are close to expiring immediately
+// and reloads them in the background. Removed and replaced values are freed
+// through epoch based reclamation, because a reload may replace a value
+// which a reader still uses.
+struct cc_refresh_cache {
+  struct cc_lru_cache *lru;
+  struct cc_epoch *epoch;
+  struct cdc_data_info *dinfo;
+  struct cc_refresh_policy policy;
+  uint64_t refresh_after;
+  struct cc_thread_pool *pool;
+  struct cc_executor executor;
+  // Number of reloads that are queued or running.
+  size_t pending;
+  pthread_mutex_t mutex;
+  pthread_cond_t idle;
+};
+
+// Base
+enum cdc_stat cc_refresh_cache_ctor(struct cc_refresh_cache **c,
+                                    size_t max_size,
+                                    struct cdc_data_info *info,
+                                    struct cc_refresh_policy *policy);
+// Waits for the queued reloads to finish. All readers must be unregistered
+// before.
+void cc_refresh_cache_dtor(struct cc_refresh_cache *c);
+// Waits for the queued reloads to finish.
+void cc_refresh_cache_drain(struct cc_refresh_cache *c);
+
+// Readers
+// Every thread which calls cc_refresh_cache_get registers a record.
+static inline enum cdc_stat cc_refresh_cache_register(
+    struct cc_refresh_cache *c, struct cc_epoch_record **r)
+{
+  assert(c != NULL);
+
+  return cc_epoch_register(c->epoch, r);
+}
+
+static inline void cc_refresh_cache_unregister(struct cc_epoch_record *r)
+{
+  cc_epoch_unregister(r);
+}
+
+// Lookups must be made between cc_refresh_cache_enter and
+// cc_refresh_cache_leave. Values returned by cc_refresh_cache_get stay valid
+// until cc_refresh_cache_leave even if they are reloaded, replaced or
+// removed meanwhile.
+static inline void cc_refresh_cache_enter(struct cc_epoch_record *r)
+{
+  cc_epoch_enter(r);
+}
+
+static inline void cc_refresh_cache_leave(struct cc_epoch_record *r)
+{
+  cc_epoch_leave(r);
+}
+
+// Lookup
+// On a miss the value is loaded synchronously and the key is stored in the
+// cache as if it was passed to cc_refresh_cache_insert.
+enum cdc_stat cc_refresh_cache_get(struct cc_refresh_cache *c,
+                                   struct cc_epoch_record *r, void *key,
+                                   void **value);
+bool cc_refresh_cache_contains(struct cc_refresh_cache *c, void *key);
+
+// Capacity
+static inline size_t cc_refresh_cache_max_size(struct cc_refresh_cache *c)
+{
+  assert(c != NULL);
+
+  return cc_lru_cache_max_size(c->lru);
+}
+
+// Expired entries are counted until they are read or evicted.
+size_t cc_refresh_cache_size(struct cc_refresh_cache *c);
+bool cc_refresh_cache_empty(struct cc_refresh_cache *c);
+
+// See cc_lru_cache_set_max_size.
+void cc_refresh_cache_set_max_size(struct cc_refresh_cache *c,
+                                   size_t max_size);
+size_t cc_refresh_cache_trim(struct cc_refresh_cache *c, size_t budget);
+
+// Modifiers
+enum cdc_stat cc_refresh_cache_insert(struct cc_refresh_cache *c, void *key,
+                                      void *value, bool *inserted);
+enum cdc_stat cc_refresh_cache_insert_or_assign(struct cc_refresh_cache *c,
+                                                void *key, void *value,
+                                                bool *inserted);
+
+void cc_refresh_cache_erase(struct cc_refresh_cache *c, void *key);
+// Readers may still use the taken value until they leave.
+void cc_refresh_cache_take(struct cc_refresh_cache *c, void *key,
+                           struct cdc_pair *kv);
+void cc_refresh_cache_clear(struct cc_refresh_cache *c);
+
+// Short names
+#ifdef CDC_USE_SHORT_NAMES
+typedef struct cc_refresh_cache refresh_cache_t;
+
+// Base
+#define refresh_cache_ctor(...) cc_refresh_cache_ctor(__VA_ARGS__)
+#define refresh_cache_dtor(...) cc_refresh_cache_dtor(__VA_ARGS__)
+#define refresh_cache_drain(...) cc_refresh_cache_drain(__VA_ARGS__)
+
+// Readers
+#define refresh_cache_register(...) cc_refresh_cache_register(__VA_ARGS__)
+#define refresh_cache_unregister(...) \
+  cc_refresh_cache_unregister(__VA_ARGS__)
+#define refresh_cache_enter(...) cc_refresh_cache_enter(__VA_ARGS__)
+#define refresh_cache_leave(...) cc_refresh_cache_leave(__VA_ARGS__)
+
+// Lookup
+#define refresh_cache_get(...) cc_refresh_cache_get(__VA_ARGS__)
+#define refresh_cache_contains(...) cc_refresh_cache_contains(__VA_ARGS__)
+
+// Capacity
+#define refresh_cache_max_size(...) cc_refresh_cache_max_size(__VA_ARGS__)
+#define refresh_cache_size(...) cc_refresh_cache_size(__VA_ARGS__)
+#define refresh_cache_empty(...) cc_refresh_cache_empty(__VA_ARGS__)
+#define refresh_cache_set_max_size(...) \
+  cc_refresh_cache_set_max_size(__VA_ARGS__)
+#define refresh_cache_trim(...) cc_refresh_cache_trim(__VA_ARGS__)
+
+// Modifiers
+#define refresh_cache_insert(...) cc_refresh_cache_insert(__VA_ARGS__)
+#define refresh_cache_insert_or_assign(...) \
+  cc_refresh_cache_insert_or_assign(__VA_ARGS__)
+#define refresh_cache_erase(...) cc_refresh_cache_erase(__VA_ARGS__)
+#define refresh_cache_take(...) cc_refresh_cache_take(__VA_ARGS__)
+#define refresh_cache_clear(...) cc_refresh_cache_clear(__VA_ARGS__)
+#endif
+#endif  // CCACHE_INCLUDE_CCACHE_REFRESH_H
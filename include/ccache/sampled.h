@@ -0,0 +1,150 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_INCLUDE_CCACHE_SAMPLED_H
+#define CCACHE_INCLUDE_CCACHE_SAMPLED_H
+#include <cdcontainers/common.h>
+#include <cdcontainers/status.h>
+
+#include <ccache/memory.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CC_SAMPLED_DEFAULT_SAMPLES 5
+#define CC_SAMPLED_POOL_SIZE 16
+
+struct cdc_hash_table;
+struct cdc_data_info;
+
+struct cc_sampled_entry {
+  void *key;
+  void *value;
+  // Clock value of the last access; zero marks a free slot.
+  uint32_t access;
+};
+
+struct cc_sampled_candidate {
+  struct cc_sampled_entry *entry;
+  uint32_t access;
+};
+
+// An approximated lru cache in the style of Redis. Entries live in a flat
+// array of max_size slots and carry the time of their last access instead of
+// a position in a recency list, so a hit writes one word and no pointers. To
+// evict, the cache samples a few random entries, merges them into a small
+// pool of the oldest candidates seen so far and evicts the oldest candidate
+// of the pool.
+struct cc_sampled_cache {
+  struct cc_sampled_entry *entries;
+  size_t max_size;
+  size_t size;
+  // Head of the free slots, linked through their values.
+  size_t free;
+  // Stores pairs of key and entry.
+  struct cdc_hash_table *table;
+  struct cdc_data_info *dinfo;
+  // Logical clock which advances on every access and skips zero.
+  uint32_t clock;
+  uint64_t seed;
+  size_t samples;
+  // Candidates from the oldest to the youngest.
+  struct cc_sampled_candidate pool[CC_SAMPLED_POOL_SIZE];
+  size_t pool_size;
+};
+
+// Base
+// Allocates all max_size slots up front.
+enum cdc_stat cc_sampled_cache_ctor(struct cc_sampled_cache **c,
+                                    size_t max_size,
+                                    struct cdc_data_info *info);
+void cc_sampled_cache_dtor(struct cc_sampled_cache *c);
+
+// Lookup
+enum cdc_stat cc_sampled_cache_get(struct cc_sampled_cache *c, void *key,
+                                   void **value);
+// Does not count as an access.
+bool cc_sampled_cache_contains(struct cc_sampled_cache *c, void *key);
+
+// Capacity
+static inline size_t cc_sampled_cache_max_size(struct cc_sampled_cache *c)
+{
+  assert(c != NULL);
+
+  return c->max_size;
+}
+
+size_t cc_sampled_cache_size(struct cc_sampled_cache *c);
+bool cc_sampled_cache_empty(struct cc_sampled_cache *c);
+
+// Sets the number of entries sampled per eviction, CC_SAMPLED_DEFAULT_SAMPLES
+// by default. More samples approximate lru better and evict slower.
+void cc_sampled_cache_set_samples(struct cc_sampled_cache *c, size_t samples);
+
+// Modifiers
+enum cdc_stat cc_sampled_cache_insert(struct cc_sampled_cache *c, void *key,
+                                      void *value, bool *inserted);
+enum cdc_stat cc_sampled_cache_insert_or_assign(struct cc_sampled_cache *c,
+                                                void *key, void *value,
+                                                bool *inserted);
+
+void cc_sampled_cache_erase(struct cc_sampled_cache *c, void *key);
+void cc_sampled_cache_take(struct cc_sampled_cache *c, void *key,
+                           struct cdc_pair *kv);
+void cc_sampled_cache_clear(struct cc_sampled_cache *c);
+
+// Memory
+struct cc_memory_usage cc_sampled_cache_memory_usage(
+    struct cc_sampled_cache *c);
+
+// Short names
+#ifdef CDC_USE_SHORT_NAMES
+typedef struct cc_sampled_cache sampled_cache_t;
+
+// Base
+#define sampled_cache_ctor(...) cc_sampled_cache_ctor(__VA_ARGS__)
+#define sampled_cache_dtor(...) cc_sampled_cache_dtor(__VA_ARGS__)
+
+// Lookup
+#define sampled_cache_get(...) cc_sampled_cache_get(__VA_ARGS__)
+#define sampled_cache_contains(...) cc_sampled_cache_contains(__VA_ARGS__)
+
+// Capacity
+#define sampled_cache_max_size(...) cc_sampled_cache_max_size(__VA_ARGS__)
+#define sampled_cache_size(...) cc_sampled_cache_size(__VA_ARGS__)
+#define sampled_cache_empty(...) cc_sampled_cache_empty(__VA_ARGS__)
+#define sampled_cache_set_samples(...) \
+  cc_sampled_cache_set_samples(__VA_ARGS__)
+
+// Modifiers
+#define sampled_cache_insert(...) cc_sampled_cache_insert(__VA_ARGS__)
+#define sampled_cache_insert_or_assign(...) \
+  cc_sampled_cache_insert_or_assign(__VA_ARGS__)
+#define sampled_cache_erase(...) cc_sampled_cache_erase(__VA_ARGS__)
+#define sampled_cache_take(...) cc_sampled_cache_take(__VA_ARGS__)
+#define sampled_cache_clear(...) cc_sampled_cache_clear(__VA_ARGS__)
+
+// Memory
+#define sampled_cache_memory_usage(...) \
+  cc_sampled_cache_memory_usage(__VA_ARGS__)
+#endif
+#endif  // CCACHE_INCLUDE_CCACHE_SAMPLED_H
@@ -0,0 +1,94 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_INCLUDE_CCACHE_SHARDS_H
+#define CCACHE_INCLUDE_CCACHE_SHARDS_H
+#include <cdcontainers/common.h>
+#include <cdcontainers/status.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct cdc_hash_table;
+struct cdc_data_info;
+struct cc_shards_node;
+
+// Estimates the miss ratio curve of an lru cache from a spatially hashed
+// sample of the references (SHARDS). A key is sampled when its hash falls
+// below a threshold, so either all or none of its references are seen.
+struct cc_shards {
+  cdc_hash_fn_t hash;
+  // Sampled key hashes mapped to their tree nodes.
+  struct cdc_hash_table *table;
+  // Treap of the sampled keys ordered by their last access time.
+  struct cc_shards_node *root;
+  uint64_t threshold;
+  uint64_t time;
+  size_t max_samples;
+  size_t bucket_size;
+  size_t nbuckets;
+  // Reuse distances of the sampled references; the last bucket also counts
+  // the distances beyond the histogram.
+  uint64_t *histogram;
+  uint64_t cold_misses;
+  uint64_t references;
+};
+
+// Base
+// Samples about rate of the keys and tracks at most max_samples of them,
+// lowering the rate when there are more. The histogram resolves reuse
+// distances up to max_distance.
+enum cdc_stat cc_shards_ctor(struct cc_shards **s, double rate,
+                             size_t max_samples, size_t max_distance,
+                             struct cdc_data_info *info);
+void cc_shards_dtor(struct cc_shards *s);
+
+// Modifiers
+void cc_shards_access(struct cc_shards *s, void *key);
+void cc_shards_clear(struct cc_shards *s);
+
+// Lookup
+double cc_shards_rate(struct cc_shards *s);
+// Returns the estimated miss ratio of an lru cache of cache_size entries.
+double cc_shards_miss_ratio(struct cc_shards *s, size_t cache_size);
+// Fills ratios[i] with the estimated miss ratio for sizes[i].
+void cc_shards_miss_ratio_curve(struct cc_shards *s, const size_t *sizes,
+                                double *ratios, size_t n);
+
+// Short names
+#ifdef CDC_USE_SHORT_NAMES
+typedef struct cc_shards shards_t;
+
+// Base
+#define shards_ctor(...) cc_shards_ctor(__VA_ARGS__)
+#define shards_dtor(...) cc_shards_dtor(__VA_ARGS__)
+
+// Modifiers
+#define shards_access(...) cc_shards_access(__VA_ARGS__)
+#define shards_clear(...) cc_shards_clear(__VA_ARGS__)
+
+// Lookup
+#define shards_rate(...) cc_shards_rate(__VA_ARGS__)
+#define shards_miss_ratio(...) cc_shards_miss_ratio(__VA_ARGS__)
+#define shards_miss_ratio_curve(...) cc_shards_miss_ratio_curve(__VA_ARGS__)
+#endif
+#endif  // CCACHE_INCLUDE_CCACHE_SHARDS_H
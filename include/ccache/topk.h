@@ -0,0 +1,89 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_INCLUDE_CCACHE_TOPK_H
+#define CCACHE_INCLUDE_CCACHE_TOPK_H
+#include <cdcontainers/common.h>
+#include <cdcontainers/status.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct cdc_hash_table;
+struct cdc_data_info;
+struct cc_top_keys_counter;
+struct cc_top_keys_bucket;
+
+// Tracks the most frequent keys of a stream with the space-saving algorithm.
+// The counters live in a stream summary: a list of buckets of equal counts
+// ordered by count, so that every update is O(1). At most capacity keys
+// are tracked; a new key replaces a key with the minimum count and inherits
+// that count as its error.
+struct cc_top_keys {
+  struct cdc_data_info *dinfo;
+  // Stores pairs of key and counter.
+  struct cdc_hash_table *table;
+  struct cc_top_keys_counter *counters;
+  struct cc_top_keys_bucket *buckets;
+  struct cc_top_keys_bucket *free_buckets;
+  // The buckets with the minimum and the maximum count.
+  struct cc_top_keys_bucket *min;
+  struct cc_top_keys_bucket *max;
+  size_t capacity;
+  size_t size;
+};
+
+// Base
+// info->hash and info->eq are required. If info->cp is set, the tracker
+// stores copies of the keys and frees them with info->dfree, which gets a
+// pair of the key and NULL.
+enum cdc_stat cc_top_keys_ctor(struct cc_top_keys **t, size_t capacity,
+                               struct cdc_data_info *info);
+void cc_top_keys_dtor(struct cc_top_keys *t);
+
+// Modifiers
+void cc_top_keys_add(struct cc_top_keys *t, void *key);
+void cc_top_keys_clear(struct cc_top_keys *t);
+
+// Lookup
+// Writes up to k most frequent keys in descending order of their counts to
+// keys and their estimated counts to counts (if not NULL). Returns the
+// number of written keys. A count overestimates the real one by at most the
+// minimum tracked count.
+size_t cc_top_keys_get(struct cc_top_keys *t, size_t k, void **keys,
+                       size_t *counts);
+
+// Short names
+#ifdef CDC_USE_SHORT_NAMES
+typedef struct cc_top_keys top_keys_t;
+
+// Base
+#define top_keys_ctor(...) cc_top_keys_ctor(__VA_ARGS__)
+#define top_keys_dtor(...) cc_top_keys_dtor(__VA_ARGS__)
+
+// Modifiers
+#define top_keys_add(...) cc_top_keys_add(__VA_ARGS__)
+#define top_keys_clear(...) cc_top_keys_clear(__VA_ARGS__)
+
+// Lookup
+#define top_keys_get(...) cc_top_keys_get(__VA_ARGS__)
+#endif
+#endif  // CCACHE_INCLUDE_CCACHE_TOPK_H
@@ -19,3 +19,251 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 #include "ccache/2q.h"
+
+#include "list.h"
+
+#include <cdcontainers/data-info.h>
+#include <cdcontainers/hash-table.h>
+
+#include <stdlib.h>
+
+// Shares of max_size recommended by the authors of 2Q.
+#define CC_2Q_IN_SHARE 4
+#define CC_2Q_OUT_SHARE 2
+
+static void free_value(struct cc_2q_cache *c, void *value)
+{
+  if (CDC_HAS_DFREE(c->dinfo)) {
+    struct cdc_pair kv = {NULL, value};
+    c->dinfo->dfree(&kv);
+  }
+}
+
+static void free_key(struct cc_2q_cache *c, void *key)
+{
+  if (CDC_HAS_DFREE(c->dinfo)) {
+    struct cdc_pair kv = {key, NULL};
+    c->dinfo->dfree(&kv);
+  }
+}
+
+// Unlike cc_lru_cache_contains does not touch the entry.
+static bool in_am(struct cc_2q_cache *c, void *key)
+{
+  return cdc_hash_table_count(c->am->table, key) != 0;
+}
+
+// Moves the oldest entry of a1_in to a1_out. Its value is dropped.
+static void demote(struct cc_2q_cache *c)
+{
+  struct cdc_pair kv = {NULL, NULL};
+  cc_fifo_cache_take(c->a1_in, c->a1_in->list->tail->kv.first, &kv);
+  free_value(c, kv.second);
+  if (cc_fifo_cache_insert(c->a1_out, kv.first, NULL, NULL /* inserted */) !=
+      CDC_STATUS_OK) {
+    free_key(c, kv.first);
+  }
+}
+
+static void make_room(struct cc_2q_cache *c)
+{
+  if (cc_2q_cache_size(c) < c->max_size) {
+    return;
+  }
+
+  if (cc_fifo_cache_size(c->a1_in) > c->in_max_size ||
+      cc_lru_cache_empty(c->am)) {
+    demote(c);
+  } else {
+    cc_lru_cache_erase(c->am, c->am->list->tail->kv.first);
+  }
+}
+
+static enum cdc_stat insert_new(struct cc_2q_cache *c, void *key, void *value)
+{
+  make_room(c);
+  if (cc_fifo_cache_contains(c->a1_out, key)) {
+    cc_fifo_cache_erase(c->a1_out, key);
+    return cc_lru_cache_insert(c->am, key, value, NULL /* inserted */);
+  }
+
+  return cc_fifo_cache_insert(c->a1_in, key, value, NULL /* inserted */);
+}
+
+enum cdc_stat cc_2q_cache_ctor(struct cc_2q_cache **c, size_t max_size,
+                               struct cdc_data_info *info)
+{
+  assert(c != NULL);
+  assert(info != NULL);
+  assert(max_size > 0);
+
+  struct cc_2q_cache *tmp =
+      (struct cc_2q_cache *)calloc(sizeof(struct cc_2q_cache), 1);
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  enum cdc_stat stat = CDC_STATUS_BAD_ALLOC;
+  if (CDC_HAS_DFREE(info)) {
+    struct cdc_data_info free_info = CDC_INIT_STRUCT;
+    free_info.dfree = info->dfree;
+    tmp->dinfo = cdc_di_shared_ctorc(&free_info);
+    if (!tmp->dinfo) {
+      goto free_cache;
+    }
+  }
+
+  size_t out_max_size = max_size / CC_2Q_OUT_SHARE;
+  if (out_max_size == 0) {
+    out_max_size = 1;
+  }
+
+  stat = cc_fifo_cache_ctor(&tmp->a1_out, out_max_size, info);
+  if (stat != CDC_STATUS_OK) {
+    goto free_info;
+  }
+
+  // a1_in and am never evict on their own: the total of both is kept at
+  // max_size by make_room.
+  stat = cc_fifo_cache_ctor(&tmp->a1_in, max_size, info);
+  if (stat != CDC_STATUS_OK) {
+    goto free_out;
+  }
+
+  stat = cc_lru_cache_ctor(&tmp->am, max_size, info);
+  if (stat != CDC_STATUS_OK) {
+    goto free_in;
+  }
+
+  tmp->max_size = max_size;
+  tmp->in_max_size = max_size / CC_2Q_IN_SHARE;
+  *c = tmp;
+  return CDC_STATUS_OK;
+
+free_in:
+  cc_fifo_cache_dtor(tmp->a1_in);
+free_out:
+  cc_fifo_cache_dtor(tmp->a1_out);
+free_info:
+  cdc_di_shared_dtor(tmp->dinfo);
+free_cache:
+  free(tmp);
+  return stat;
+}
+
+void cc_2q_cache_dtor(struct cc_2q_cache *c)
+{
+  assert(c != NULL);
+
+  cc_lru_cache_dtor(c->am);
+  cc_fifo_cache_dtor(c->a1_in);
+  cc_fifo_cache_dtor(c->a1_out);
+  cdc_di_shared_dtor(c->dinfo);
+  free(c);
+}
+
+enum cdc_stat cc_2q_cache_get(struct cc_2q_cache *c, void *key, void **value)
+{
+  assert(c != NULL);
+  assert(value != NULL);
+
+  if (cc_lru_cache_get(c->am, key, value) == CDC_STATUS_OK) {
+    return CDC_STATUS_OK;
+  }
+
+  // A hit in a1_in does not change anything: correlated references right
+  // after the first one should not make an entry look hot.
+  return cc_fifo_cache_get(c->a1_in, key, value);
+}
+
+bool cc_2q_cache_contains(struct cc_2q_cache *c, void *key)
+{
+  assert(c != NULL);
+
+  return cc_fifo_cache_contains(c->a1_in, key) || in_am(c, key);
+}
+
+size_t cc_2q_cache_size(struct cc_2q_cache *c)
+{
+  assert(c != NULL);
+
+  return cc_fifo_cache_size(c->a1_in) + cc_lru_cache_size(c->am);
+}
+
+bool cc_2q_cache_empty(struct cc_2q_cache *c)
+{
+  assert(c != NULL);
+
+  return cc_2q_cache_size(c) == 0;
+}
+
+enum cdc_stat cc_2q_cache_insert(struct cc_2q_cache *c, void *key, void *value,
+                                 bool *inserted)
+{
+  assert(c != NULL);
+
+  if (cc_2q_cache_contains(c, key)) {
+    if (inserted) {
+      *inserted = false;
+    }
+
+    return CDC_STATUS_OK;
+  }
+
+  enum cdc_stat stat = insert_new(c, key, value);
+  if (stat == CDC_STATUS_OK && inserted) {
+    *inserted = true;
+  }
+
+  return stat;
+}
+
+enum cdc_stat cc_2q_cache_insert_or_assign(struct cc_2q_cache *c, void *key,
+                                           void *value, bool *inserted)
+{
+  assert(c != NULL);
+
+  if (cc_fifo_cache_contains(c->a1_in, key)) {
+    return cc_fifo_cache_insert_or_assign(c->a1_in, key, value, inserted);
+  }
+
+  if (in_am(c, key)) {
+    return cc_lru_cache_insert_or_assign(c->am, key, value, inserted);
+  }
+
+  enum cdc_stat stat = insert_new(c, key, value);
+  if (stat == CDC_STATUS_OK && inserted) {
+    *inserted = true;
+  }
+
+  return stat;
+}
+
+void cc_2q_cache_erase(struct cc_2q_cache *c, void *key)
+{
+  assert(c != NULL);
+
+  cc_fifo_cache_erase(c->a1_in, key);
+  cc_fifo_cache_erase(c->a1_out, key);
+  cc_lru_cache_erase(c->am, key);
+}
+
+void cc_2q_cache_take(struct cc_2q_cache *c, void *key, struct cdc_pair *kv)
+{
+  assert(c != NULL);
+
+  if (cc_fifo_cache_contains(c->a1_in, key)) {
+    cc_fifo_cache_take(c->a1_in, key, kv);
+  } else {
+    cc_lru_cache_take(c->am, key, kv);
+  }
+}
+
+void cc_2q_cache_clear(struct cc_2q_cache *c)
+{
+  assert(c != NULL);
+
+  cc_fifo_cache_clear(c->a1_in);
+  cc_fifo_cache_clear(c->a1_out);
+  cc_lru_cache_clear(c->am);
+}
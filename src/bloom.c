@@ -0,0 +1,157 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "ccache/bloom.h"
+
+#include "mix.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CC_BLOOM_BLOCK_WORDS 8
+#define CC_BLOOM_BLOCK_BYTES (CC_BLOOM_BLOCK_WORDS * sizeof(uint64_t))
+#define CC_BLOOM_COUNTERS_PER_WORD 16
+#define CC_BLOOM_COUNTER_MAX 0xfull
+#define CC_BLOOM_PROBES 6
+// Counters per key. With six probes per block this gives about 1% false
+// positives.
+#define CC_BLOOM_COUNTERS_PER_KEY 12
+
+struct probe {
+  uint64_t *block;
+  uint64_t positions;
+};
+
+static struct probe probe(struct cc_bloom_filter *f, void *key)
+{
+  uint64_t h = cc_mix64(f->hash(key));
+  struct probe p;
+  p.block = f->blocks + (h & (f->block_count - 1)) * CC_BLOOM_BLOCK_WORDS;
+  // Seven bits address one of 128 counters of the block.
+  p.positions = cc_mix64(h + 1);
+  return p;
+}
+
+static uint64_t *counter_word(struct probe *p, unsigned *shift)
+{
+  unsigned pos = (unsigned)(p->positions & 127);
+  p->positions >>= 7;
+  *shift = (pos % CC_BLOOM_COUNTERS_PER_WORD) * 4;
+  return &p->block[pos / CC_BLOOM_COUNTERS_PER_WORD];
+}
+
+static size_t block_count(size_t capacity)
+{
+  size_t per_block = CC_BLOOM_BLOCK_WORDS * CC_BLOOM_COUNTERS_PER_WORD;
+  size_t need =
+      (capacity * CC_BLOOM_COUNTERS_PER_KEY + per_block - 1) / per_block;
+  size_t count = 1;
+  while (count < need) {
+    count <<= 1;
+  }
+
+  return count;
+}
+
+enum cdc_stat cc_bloom_filter_ctor(struct cc_bloom_filter **f, size_t capacity,
+                                   cdc_hash_fn_t hash)
+{
+  assert(f != NULL);
+  assert(hash != NULL);
+
+  struct cc_bloom_filter *tmp =
+      (struct cc_bloom_filter *)malloc(sizeof(struct cc_bloom_filter));
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  tmp->block_count = block_count(capacity);
+  void *blocks = NULL;
+  if (posix_memalign(&blocks, CC_BLOOM_BLOCK_BYTES,
+                     tmp->block_count * CC_BLOOM_BLOCK_BYTES) != 0) {
+    free(tmp);
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  tmp->blocks = (uint64_t *)blocks;
+  tmp->hash = hash;
+  cc_bloom_filter_clear(tmp);
+  *f = tmp;
+  return CDC_STATUS_OK;
+}
+
+void cc_bloom_filter_dtor(struct cc_bloom_filter *f)
+{
+  assert(f != NULL);
+
+  free(f->blocks);
+  free(f);
+}
+
+bool cc_bloom_filter_may_contain(struct cc_bloom_filter *f, void *key)
+{
+  assert(f != NULL);
+
+  struct probe p = probe(f, key);
+  uint64_t missing = 0;
+  for (int i = 0; i < CC_BLOOM_PROBES; ++i) {
+    unsigned shift;
+    uint64_t *word = counter_word(&p, &shift);
+    missing |= ((*word >> shift) & CC_BLOOM_COUNTER_MAX) == 0;
+  }
+
+  return !missing;
+}
+
+void cc_bloom_filter_add(struct cc_bloom_filter *f, void *key)
+{
+  assert(f != NULL);
+
+  struct probe p = probe(f, key);
+  for (int i = 0; i < CC_BLOOM_PROBES; ++i) {
+    unsigned shift;
+    uint64_t *word = counter_word(&p, &shift);
+    if (((*word >> shift) & CC_BLOOM_COUNTER_MAX) != CC_BLOOM_COUNTER_MAX) {
+      *word += (uint64_t)1 << shift;
+    }
+  }
+}
+
+void cc_bloom_filter_remove(struct cc_bloom_filter *f, void *key)
+{
+  assert(f != NULL);
+
+  struct probe p = probe(f, key);
+  for (int i = 0; i < CC_BLOOM_PROBES; ++i) {
+    unsigned shift;
+    uint64_t *word = counter_word(&p, &shift);
+    uint64_t counter = (*word >> shift) & CC_BLOOM_COUNTER_MAX;
+    if (counter != 0 && counter != CC_BLOOM_COUNTER_MAX) {
+      *word -= (uint64_t)1 << shift;
+    }
+  }
+}
+
+void cc_bloom_filter_clear(struct cc_bloom_filter *f)
+{
+  assert(f != NULL);
+
+  memset(f->blocks, 0, f->block_count * CC_BLOOM_BLOCK_BYTES);
+}
@@ -0,0 +1,191 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "ccache/cache.h"
+
+#include "ccache/2q.h"
+#include "ccache/fifo.h"
+#include "ccache/lfu.h"
+#include "ccache/lru.h"
+#include "ccache/sampled.h"
+#include "ccache/slru.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum cdc_stat (*ctor_fn_t)(void **impl, size_t max_size,
+                                   struct cdc_data_info *info);
+
+// Defines the adapters from void * to the cache type of a policy and its
+// table of operations.
+#define CC_CACHE_OPS(policy)                                                   \
+  static enum cdc_stat ops_##policy##_ctor(void **impl, size_t max_size,       \
+                                           struct cdc_data_info *info)         \
+  {                                                                            \
+    struct cc_##policy##_cache *cache = NULL;                                  \
+    enum cdc_stat stat = cc_##policy##_cache_ctor(&cache, max_size, info);     \
+    *impl = cache;                                                             \
+    return stat;                                                               \
+  }                                                                            \
+                                                                               \
+  static void ops_##policy##_dtor(void *impl)                                  \
+  {                                                                            \
+    cc_##policy##_cache_dtor((struct cc_##policy##_cache *)impl);              \
+  }                                                                            \
+                                                                               \
+  static enum cdc_stat ops_##policy##_get(void *impl, void *key, void **value) \
+  {                                                                            \
+    return cc_##policy##_cache_get((struct cc_##policy##_cache *)impl, key,    \
+                                   value);                                     \
+  }                                                                            \
+                                                                               \
+  static bool ops_##policy##_contains(void *impl, void *key)                   \
+  {                                                                            \
+    return cc_##policy##_cache_contains((struct cc_##policy##_cache *)impl,    \
+                                        key);                                  \
+  }                                                                            \
+                                                                               \
+  static size_t ops_##policy##_max_size(void *impl)                            \
+  {                                                                            \
+    return cc_##policy##_cache_max_size((struct cc_##policy##_cache *)impl);   \
+  }                                                                            \
+                                                                               \
+  static size_t ops_##policy##_size(void *impl)                                \
+  {                                                                            \
+    return cc_##policy##_cache_size((struct cc_##policy##_cache *)impl);       \
+  }                                                                            \
+                                                                               \
+  static enum cdc_stat ops_##policy##_insert(void *impl, void *key,            \
+                                             void *value, bool *inserted)      \
+  {                                                                            \
+    return cc_##policy##_cache_insert((struct cc_##policy##_cache *)impl, key, \
+                                      value, inserted);                        \
+  }                                                                            \
+                                                                               \
+  static enum cdc_stat ops_##policy##_insert_or_assign(                        \
+      void *impl, void *key, void *value, bool *inserted)                      \
+  {                                                                            \
+    return cc_##policy##_cache_insert_or_assign(                               \
+        (struct cc_##policy##_cache *)impl, key, value, inserted);             \
+  }                                                                            \
+                                                                               \
+  static void ops_##policy##_erase(void *impl, void *key)                      \
+  {                                                                            \
+    cc_##policy##_cache_erase((struct cc_##policy##_cache *)impl, key);        \
+  }                                                                            \
+                                                                               \
+  static void ops_##policy##_take(void *impl, void *key, struct cdc_pair *kv)  \
+  {                                                                            \
+    cc_##policy##_cache_take((struct cc_##policy##_cache *)impl, key, kv);     \
+  }                                                                            \
+                                                                               \
+  static void ops_##policy##_clear(void *impl)                                 \
+  {                                                                            \
+    cc_##policy##_cache_clear((struct cc_##policy##_cache *)impl);             \
+  }                                                                            \
+                                                                               \
+  static const struct cc_cache_ops ops_##policy = {                            \
+      #policy,                                                                 \
+      ops_##policy##_dtor,                                                     \
+      ops_##policy##_get,                                                      \
+      ops_##policy##_contains,                                                 \
+      ops_##policy##_max_size,                                                 \
+      ops_##policy##_size,                                                     \
+      ops_##policy##_insert,                                                   \
+      ops_##policy##_insert_or_assign,                                         \
+      ops_##policy##_erase,                                                    \
+      ops_##policy##_take,                                                     \
+      ops_##policy##_clear,                                                    \
+  };
+
+CC_CACHE_OPS(lru)
+CC_CACHE_OPS(fifo)
+CC_CACHE_OPS(2q)
+CC_CACHE_OPS(lfu)
+CC_CACHE_OPS(slru)
+CC_CACHE_OPS(sampled)
+
+struct policy_entry {
+  const struct cc_cache_ops *ops;
+  ctor_fn_t ctor;
+};
+
+// Indexed by enum cc_policy.
+static const struct policy_entry policies[] = {
+    {&ops_lru, ops_lru_ctor},   {&ops_fifo, ops_fifo_ctor},
+    {&ops_2q, ops_2q_ctor},     {&ops_lfu, ops_lfu_ctor},
+    {&ops_slru, ops_slru_ctor}, {&ops_sampled, ops_sampled_ctor},
+};
+
+#define CC_POLICY_COUNT (sizeof(policies) / sizeof(policies[0]))
+
+enum cdc_stat cc_policy_from_name(const char *name, enum cc_policy *policy)
+{
+  assert(name != NULL);
+  assert(policy != NULL);
+
+  for (size_t i = 0; i < CC_POLICY_COUNT; ++i) {
+    if (strcmp(policies[i].ops->name, name) == 0) {
+      *policy = (enum cc_policy)i;
+      return CDC_STATUS_OK;
+    }
+  }
+
+  return CDC_STATUS_NOT_FOUND;
+}
+
+const char *cc_policy_name(enum cc_policy policy)
+{
+  assert((size_t)policy < CC_POLICY_COUNT);
+
+  return policies[policy].ops->name;
+}
+
+enum cdc_stat cc_cache_ctor(struct cc_cache **c,
+                            const struct cc_cache_config *config)
+{
+  assert(c != NULL);
+  assert(config != NULL);
+  assert((size_t)config->policy < CC_POLICY_COUNT);
+
+  struct cc_cache *tmp = (struct cc_cache *)malloc(sizeof(struct cc_cache));
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  const struct policy_entry *entry = &policies[config->policy];
+  enum cdc_stat stat = entry->ctor(&tmp->impl, config->max_size, config->info);
+  if (stat != CDC_STATUS_OK) {
+    free(tmp);
+    return stat;
+  }
+
+  tmp->ops = entry->ops;
+  *c = tmp;
+  return CDC_STATUS_OK;
+}
+
+void cc_cache_dtor(struct cc_cache *c)
+{
+  assert(c != NULL);
+
+  c->ops->dtor(c->impl);
+  free(c);
+}
@@ -0,0 +1,416 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "ccache/cfifo.h"
+
+#include "mix.h"
+
+#include <cdcontainers/data-info.h>
+
+#include <stdlib.h>
+
+struct cc_cfifo_node {
+  struct cc_epoch_entry retired;
+  // Next node of the bucket. Readers follow it without locks.
+  struct cc_cfifo_node *next;
+  struct cc_cfifo_node *newer;
+  struct cc_cfifo_node *older;
+  uint64_t hash;
+  struct cdc_pair kv;
+  // A node replaced by cc_cfifo_cache_insert_or_assign passes the key on to
+  // its successor and frees only the value.
+  bool owns_key;
+};
+
+static uint64_t hash_key(struct cc_cfifo_cache *c, void *key)
+{
+  return cc_mix64(c->dinfo->hash(key));
+}
+
+static struct cc_cfifo_node **bucket(struct cc_cfifo_cache *c, uint64_t hash)
+{
+  return &c->buckets[hash & c->bucket_mask];
+}
+
+static struct cc_cfifo_node *find(struct cc_cfifo_cache *c, void *key,
+                                  uint64_t hash)
+{
+  // Sequentially consistent loads pair with the stores of the writers and the
+  // announcement of the reader, so a reader that a writer did not see as
+  // active cannot find a node the writer has already unlinked.
+  struct cc_cfifo_node *node =
+      __atomic_load_n(bucket(c, hash), __ATOMIC_SEQ_CST);
+  while (node) {
+    if (node->hash == hash && c->dinfo->eq(node->kv.first, key)) {
+      return node;
+    }
+
+    node = __atomic_load_n(&node->next, __ATOMIC_SEQ_CST);
+  }
+
+  return NULL;
+}
+
+static void free_node(struct cc_epoch_entry *entry, void *ctx)
+{
+  struct cc_cfifo_cache *c = (struct cc_cfifo_cache *)ctx;
+  struct cc_cfifo_node *node = (struct cc_cfifo_node *)entry;
+  if (CDC_HAS_DFREE(c->dinfo)) {
+    struct cdc_pair kv = {node->owns_key ? node->kv.first : NULL,
+                          node->kv.second};
+    c->dinfo->dfree(&kv);
+  }
+
+  free(node);
+}
+
+static void set_size(struct cc_cfifo_cache *c, size_t size)
+{
+  __atomic_store_n(&c->size, size, __ATOMIC_RELAXED);
+}
+
+static struct cc_cfifo_node **prev_link(struct cc_cfifo_cache *c,
+                                        struct cc_cfifo_node *node)
+{
+  struct cc_cfifo_node **link = bucket(c, node->hash);
+  while (*link != node) {
+    link = &(*link)->next;
+  }
+
+  return link;
+}
+
+static void unlink_order(struct cc_cfifo_cache *c, struct cc_cfifo_node *node)
+{
+  if (node->newer) {
+    node->newer->older = node->older;
+  } else {
+    c->head = node->older;
+  }
+
+  if (node->older) {
+    node->older->newer = node->newer;
+  } else {
+    c->tail = node->newer;
+  }
+}
+
+static void remove_node(struct cc_cfifo_cache *c, struct cc_cfifo_node *node)
+{
+  // The node keeps its next pointer, so that readers standing on it can go
+  // on walking the bucket.
+  __atomic_store_n(prev_link(c, node), node->next, __ATOMIC_SEQ_CST);
+  unlink_order(c, node);
+  set_size(c, c->size - 1);
+  cc_epoch_retire(c->epoch, &node->retired, free_node, c);
+}
+
+static struct cc_cfifo_node *new_node(void *key, void *value, uint64_t hash)
+{
+  struct cc_cfifo_node *node =
+      (struct cc_cfifo_node *)malloc(sizeof(struct cc_cfifo_node));
+  if (!node) {
+    return NULL;
+  }
+
+  node->newer = NULL;
+  node->older = NULL;
+  node->hash = hash;
+  node->kv.first = key;
+  node->kv.second = value;
+  node->owns_key = true;
+  return node;
+}
+
+static enum cdc_stat insert_new(struct cc_cfifo_cache *c, void *key,
+                                void *value, uint64_t hash)
+{
+  struct cc_cfifo_node *node = new_node(key, value, hash);
+  if (!node) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  while (c->size >= c->max_size) {
+    remove_node(c, c->tail);
+  }
+
+  struct cc_cfifo_node **link = bucket(c, hash);
+  node->next = *link;
+  // Publishes the initialized node.
+  __atomic_store_n(link, node, __ATOMIC_SEQ_CST);
+  node->older = c->head;
+  if (c->head) {
+    c->head->newer = node;
+  } else {
+    c->tail = node;
+  }
+
+  c->head = node;
+  set_size(c, c->size + 1);
+  return CDC_STATUS_OK;
+}
+
+static enum cdc_stat assign(struct cc_cfifo_cache *c,
+                            struct cc_cfifo_node *node, void *value)
+{
+  // Readers may still use the old value, so the node is replaced as a whole
+  // and retired.
+  struct cc_cfifo_node *tmp = new_node(node->kv.first, value, node->hash);
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  tmp->owns_key = node->owns_key;
+  tmp->next = node->next;
+  tmp->newer = node->newer;
+  tmp->older = node->older;
+  __atomic_store_n(prev_link(c, node), tmp, __ATOMIC_SEQ_CST);
+  if (tmp->newer) {
+    tmp->newer->older = tmp;
+  } else {
+    c->head = tmp;
+  }
+
+  if (tmp->older) {
+    tmp->older->newer = tmp;
+  } else {
+    c->tail = tmp;
+  }
+
+  node->owns_key = false;
+  cc_epoch_retire(c->epoch, &node->retired, free_node, c);
+  return CDC_STATUS_OK;
+}
+
+enum cdc_stat cc_cfifo_cache_ctor(struct cc_cfifo_cache **c, size_t max_size,
+                                  struct cdc_data_info *info)
+{
+  assert(c != NULL);
+  assert(info != NULL);
+  assert(info->hash != NULL);
+  assert(info->eq != NULL);
+  assert(max_size > 0);
+
+  struct cc_cfifo_cache *tmp =
+      (struct cc_cfifo_cache *)malloc(sizeof(struct cc_cfifo_cache));
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  size_t bucket_count = 1;
+  while (bucket_count < max_size) {
+    bucket_count <<= 1;
+  }
+
+  tmp->buckets = (struct cc_cfifo_node **)calloc(
+      bucket_count, sizeof(struct cc_cfifo_node *));
+  if (!tmp->buckets) {
+    goto free_cache;
+  }
+
+  tmp->dinfo = cdc_di_shared_ctorc(info);
+  if (!tmp->dinfo) {
+    goto free_buckets;
+  }
+
+  if (cc_epoch_ctor(&tmp->epoch) != CDC_STATUS_OK) {
+    goto free_info;
+  }
+
+  if (pthread_mutex_init(&tmp->mutex, NULL) != 0) {
+    goto free_epoch;
+  }
+
+  tmp->max_size = max_size;
+  tmp->size = 0;
+  tmp->bucket_mask = bucket_count - 1;
+  tmp->head = NULL;
+  tmp->tail = NULL;
+  *c = tmp;
+  return CDC_STATUS_OK;
+
+free_epoch:
+  cc_epoch_dtor(tmp->epoch);
+free_info:
+  cdc_di_shared_dtor(tmp->dinfo);
+free_buckets:
+  free(tmp->buckets);
+free_cache:
+  free(tmp);
+  return CDC_STATUS_BAD_ALLOC;
+}
+
+void cc_cfifo_cache_dtor(struct cc_cfifo_cache *c)
+{
+  assert(c != NULL);
+
+  cc_epoch_dtor(c->epoch);
+  struct cc_cfifo_node *node = c->head;
+  while (node) {
+    struct cc_cfifo_node *older = node->older;
+    free_node(&node->retired, c);
+    node = older;
+  }
+
+  pthread_mutex_destroy(&c->mutex);
+  cdc_di_shared_dtor(c->dinfo);
+  free(c->buckets);
+  free(c);
+}
+
+enum cdc_stat cc_cfifo_cache_get(struct cc_cfifo_cache *c,
+                                 struct cc_epoch_record *r, void *key,
+                                 void **value)
+{
+  assert(c != NULL);
+  assert(value != NULL);
+  assert(cc_epoch_active(r));
+  CDC_UNUSED(r);
+
+  struct cc_cfifo_node *node = find(c, key, hash_key(c, key));
+  if (!node) {
+    return CDC_STATUS_NOT_FOUND;
+  }
+
+  *value = node->kv.second;
+  return CDC_STATUS_OK;
+}
+
+bool cc_cfifo_cache_contains(struct cc_cfifo_cache *c,
+                             struct cc_epoch_record *r, void *key)
+{
+  assert(c != NULL);
+  assert(cc_epoch_active(r));
+  CDC_UNUSED(r);
+
+  return find(c, key, hash_key(c, key)) != NULL;
+}
+
+size_t cc_cfifo_cache_size(struct cc_cfifo_cache *c)
+{
+  assert(c != NULL);
+
+  return __atomic_load_n(&c->size, __ATOMIC_RELAXED);
+}
+
+bool cc_cfifo_cache_empty(struct cc_cfifo_cache *c)
+{
+  assert(c != NULL);
+
+  return cc_cfifo_cache_size(c) == 0;
+}
+
+enum cdc_stat cc_cfifo_cache_insert(struct cc_cfifo_cache *c, void *key,
+                                    void *value, bool *inserted)
+{
+  assert(c != NULL);
+
+  uint64_t hash = hash_key(c, key);
+  enum cdc_stat stat = CDC_STATUS_OK;
+  bool is_new = false;
+  pthread_mutex_lock(&c->mutex);
+  if (!find(c, key, hash)) {
+    stat = insert_new(c, key, value, hash);
+    is_new = stat == CDC_STATUS_OK;
+  }
+
+  cc_epoch_collect(c->epoch);
+  pthread_mutex_unlock(&c->mutex);
+  if (inserted) {
+    *inserted = is_new;
+  }
+
+  return stat;
+}
+
+enum cdc_stat cc_cfifo_cache_insert_or_assign(struct cc_cfifo_cache *c,
+                                              void *key, void *value,
+                                              bool *inserted)
+{
+  assert(c != NULL);
+
+  uint64_t hash = hash_key(c, key);
+  enum cdc_stat stat = CDC_STATUS_OK;
+  bool is_new = false;
+  pthread_mutex_lock(&c->mutex);
+  struct cc_cfifo_node *node = find(c, key, hash);
+  if (node) {
+    stat = assign(c, node, value);
+  } else {
+    stat = insert_new(c, key, value, hash);
+    is_new = stat == CDC_STATUS_OK;
+  }
+
+  cc_epoch_collect(c->epoch);
+  pthread_mutex_unlock(&c->mutex);
+  if (inserted) {
+    *inserted = is_new;
+  }
+
+  return stat;
+}
+
+void cc_cfifo_cache_erase(struct cc_cfifo_cache *c, void *key)
+{
+  assert(c != NULL);
+
+  uint64_t hash = hash_key(c, key);
+  pthread_mutex_lock(&c->mutex);
+  struct cc_cfifo_node *node = find(c, key, hash);
+  if (node) {
+    remove_node(c, node);
+  }
+
+  cc_epoch_collect(c->epoch);
+  pthread_mutex_unlock(&c->mutex);
+}
+
+void cc_cfifo_cache_clear(struct cc_cfifo_cache *c)
+{
+  assert(c != NULL);
+
+  pthread_mutex_lock(&c->mutex);
+  for (size_t i = 0; i <= c->bucket_mask; ++i) {
+    __atomic_store_n(&c->buckets[i], NULL, __ATOMIC_SEQ_CST);
+  }
+
+  struct cc_cfifo_node *node = c->head;
+  while (node) {
+    struct cc_cfifo_node *older = node->older;
+    cc_epoch_retire(c->epoch, &node->retired, free_node, c);
+    node = older;
+  }
+
+  c->head = NULL;
+  c->tail = NULL;
+  set_size(c, 0);
+  cc_epoch_collect(c->epoch);
+  pthread_mutex_unlock(&c->mutex);
+}
+
+size_t cc_cfifo_cache_collect(struct cc_cfifo_cache *c)
+{
+  assert(c != NULL);
+
+  pthread_mutex_lock(&c->mutex);
+  size_t count = cc_epoch_collect(c->epoch);
+  pthread_mutex_unlock(&c->mutex);
+  return count;
+}
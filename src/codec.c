@@ -0,0 +1,234 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "ccache/codec.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define HASH_BITS 12
+#define MIN_MATCH 4
+#define MAX_OFFSET 65535
+// Lengths of 15 and more continue in extra bytes.
+#define LENGTH_MASK 15
+
+const struct cc_codec cc_lz_codec = {"lz", cc_lz_compress, cc_lz_decompress,
+                                     NULL};
+
+static uint32_t read32(const unsigned char *p)
+{
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static size_t hash32(uint32_t v)
+{
+  return (size_t)((v * 2654435761u) >> (32 - HASH_BITS));
+}
+
+static unsigned char *put_length(unsigned char *op, unsigned char *end,
+                                 size_t len)
+{
+  for (; len >= 255; len -= 255) {
+    if (op == end) {
+      return NULL;
+    }
+
+    *op++ = 255;
+  }
+
+  if (op == end) {
+    return NULL;
+  }
+
+  *op++ = (unsigned char)len;
+  return op;
+}
+
+// Writes the literals and the match. The last sequence has no match and is
+// written with offset 0.
+static unsigned char *put_sequence(unsigned char *op, unsigned char *end,
+                                   const unsigned char *literals,
+                                   size_t literal_size, size_t offset,
+                                   size_t match_size)
+{
+  if (op == end) {
+    return NULL;
+  }
+
+  size_t match = offset ? match_size - MIN_MATCH : 0;
+  size_t literal_nibble =
+      literal_size < LENGTH_MASK ? literal_size : LENGTH_MASK;
+  size_t match_nibble = match < LENGTH_MASK ? match : LENGTH_MASK;
+  *op++ = (unsigned char)(literal_nibble << 4 | match_nibble);
+  if (literal_size >= LENGTH_MASK) {
+    op = put_length(op, end, literal_size - LENGTH_MASK);
+    if (!op) {
+      return NULL;
+    }
+  }
+
+  if ((size_t)(end - op) < literal_size) {
+    return NULL;
+  }
+
+  memcpy(op, literals, literal_size);
+  op += literal_size;
+  if (!offset) {
+    return op;
+  }
+
+  if (end - op < 2) {
+    return NULL;
+  }
+
+  *op++ = (unsigned char)(offset & 0xff);
+  *op++ = (unsigned char)(offset >> 8);
+  if (match >= LENGTH_MASK) {
+    op = put_length(op, end, match - LENGTH_MASK);
+  }
+
+  return op;
+}
+
+static bool get_length(const unsigned char **ip, const unsigned char *end,
+                       size_t *len)
+{
+  unsigned char byte = 0;
+  do {
+    if (*ip == end) {
+      return false;
+    }
+
+    byte = *(*ip)++;
+    *len += byte;
+  } while (byte == 255);
+  return true;
+}
+
+size_t cc_lz_compress(void *ctx, const void *src, size_t src_size, void *dst,
+                      size_t dst_capacity)
+{
+  (void)ctx;
+  const unsigned char *in = (const unsigned char *)src;
+  unsigned char *op = (unsigned char *)dst;
+  unsigned char *end = op + dst_capacity;
+  // Positions are truncated to 32 bits, a candidate is always verified.
+  uint32_t table[1 << HASH_BITS];
+  memset(table, 0, sizeof(table));
+
+  size_t anchor = 0;
+  size_t ip = 1;
+  while (ip + MIN_MATCH <= src_size) {
+    uint32_t sequence = read32(in + ip);
+    size_t h = hash32(sequence);
+    size_t ref = table[h];
+    table[h] = (uint32_t)ip;
+    if (ref >= ip || ip - ref > MAX_OFFSET || read32(in + ref) != sequence) {
+      ++ip;
+      continue;
+    }
+
+    size_t len = MIN_MATCH;
+    while (ip + len < src_size && in[ref + len] == in[ip + len]) {
+      ++len;
+    }
+
+    op = put_sequence(op, end, in + anchor, ip - anchor, ip - ref, len);
+    if (!op) {
+      return 0;
+    }
+
+    ip += len;
+    anchor = ip;
+  }
+
+  op = put_sequence(op, end, in + anchor, src_size - anchor, 0, 0);
+  if (!op) {
+    return 0;
+  }
+
+  return (size_t)(op - (unsigned char *)dst);
+}
+
+bool cc_lz_decompress(void *ctx, const void *src, size_t src_size, void *dst,
+                      size_t dst_size)
+{
+  (void)ctx;
+  const unsigned char *ip = (const unsigned char *)src;
+  const unsigned char *in_end = ip + src_size;
+  unsigned char *begin = (unsigned char *)dst;
+  unsigned char *op = begin;
+  unsigned char *end = begin + dst_size;
+  // The data ends with a sequence of literals only, which may be empty.
+  for (;;) {
+    if (ip == in_end) {
+      return false;
+    }
+
+    unsigned char token = *ip++;
+    size_t literal_size = token >> 4;
+    if (literal_size == LENGTH_MASK &&
+        !get_length(&ip, in_end, &literal_size)) {
+      return false;
+    }
+
+    if ((size_t)(in_end - ip) < literal_size ||
+        (size_t)(end - op) < literal_size) {
+      return false;
+    }
+
+    memcpy(op, ip, literal_size);
+    ip += literal_size;
+    op += literal_size;
+    if (ip == in_end) {
+      return op == end;
+    }
+
+    if (in_end - ip < 2) {
+      return false;
+    }
+
+    size_t offset = (size_t)ip[0] | (size_t)ip[1] << 8;
+    ip += 2;
+    size_t match_size = token & LENGTH_MASK;
+    if (match_size == LENGTH_MASK && !get_length(&ip, in_end, &match_size)) {
+      return false;
+    }
+
+    match_size += MIN_MATCH;
+    if (offset == 0 || offset > (size_t)(op - begin) ||
+        (size_t)(end - op) < match_size) {
+      return false;
+    }
+
+    const unsigned char *ref = op - offset;
+    if (offset >= match_size) {
+      memcpy(op, ref, match_size);
+      op += match_size;
+    } else {
+      // The match overlaps its own output, e.g. a run of one byte.
+      while (match_size--) {
+        *op++ = *ref++;
+      }
+    }
+  }
+}
@@ -0,0 +1,268 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "ccache/compressed.h"
+
+#include "ccache/hash.h"
+
+#include <cdcontainers/data-info.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+// The header of a stored value, followed by stored_size bytes. A value is
+// raw if stored_size equals size, compressed data is always smaller.
+struct cc_compressed_value {
+  size_t size;
+  size_t stored_size;
+};
+
+static unsigned char *value_data(struct cc_compressed_value *v)
+{
+  return (unsigned char *)(v + 1);
+}
+
+static void free_pair(void *data)
+{
+  struct cdc_pair *kv = (struct cdc_pair *)data;
+  free(kv->first);
+  free(kv->second);
+}
+
+static size_t stored_size(void *key, void *value)
+{
+  struct cc_string_key *k = (struct cc_string_key *)key;
+  struct cc_compressed_value *v = (struct cc_compressed_value *)value;
+  return sizeof(struct cc_string_key) + k->size + 1 +
+         sizeof(struct cc_compressed_value) + v->stored_size;
+}
+
+static struct cc_compressed_value *new_value(struct cc_compressed_cache *c,
+                                             const void *value,
+                                             size_t value_size)
+{
+  struct cc_compressed_value *v = (struct cc_compressed_value *)malloc(
+      sizeof(struct cc_compressed_value) + value_size);
+  if (!v) {
+    return NULL;
+  }
+
+  v->size = value_size;
+  v->stored_size = 0;
+  if (value_size >= c->threshold && value_size > 1) {
+    v->stored_size = c->codec->compress(c->codec->ctx, value, value_size,
+                                        value_data(v), value_size - 1);
+  }
+
+  if (v->stored_size == 0) {
+    if (value_size) {
+      memcpy(value_data(v), value, value_size);
+    }
+
+    v->stored_size = value_size;
+    return v;
+  }
+
+  c->compressed_in += value_size;
+  c->compressed_out += v->stored_size;
+  // Give back the tail which the compressed data does not use. Keep the
+  // block if the allocator cannot shrink it.
+  struct cc_compressed_value *shrunk = (struct cc_compressed_value *)realloc(
+      v, sizeof(struct cc_compressed_value) + v->stored_size);
+  return shrunk ? shrunk : v;
+}
+
+static enum cdc_stat put(struct cc_compressed_cache *c, const void *key,
+                         size_t key_size, const void *value,
+                         size_t value_size, bool assign, bool *inserted)
+{
+  struct cc_string_key *k = cc_string_key_new(key, key_size);
+  if (!k) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  struct cc_compressed_value *v = new_value(c, value, value_size);
+  if (!v) {
+    free(k);
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  enum cdc_stat stat = CDC_STATUS_OK;
+  bool is_new = false;
+  bool value_stored = false;
+  if (stored_size(k, v) > cc_gdsf_cache_max_bytes(c->cache)) {
+    if (assign) {
+      cc_compressed_cache_erase(c, key, key_size);
+    }
+  } else if (assign) {
+    stat = cc_gdsf_cache_insert_or_assign(c->cache, k, v, &is_new);
+    // An existing entry keeps its key and takes the new value.
+    value_stored = stat == CDC_STATUS_OK;
+  } else {
+    stat = cc_gdsf_cache_insert(c->cache, k, v, &is_new);
+    value_stored = is_new;
+  }
+
+  if (!is_new) {
+    free(k);
+  }
+
+  if (!value_stored) {
+    free(v);
+  }
+
+  if (inserted) {
+    *inserted = is_new;
+  }
+
+  return stat;
+}
+
+enum cdc_stat cc_compressed_cache_ctor(struct cc_compressed_cache **c,
+                                       size_t max_bytes,
+                                       const struct cc_codec *codec,
+                                       size_t threshold)
+{
+  assert(c != NULL);
+  assert(max_bytes > 0);
+
+  struct cc_compressed_cache *tmp = (struct cc_compressed_cache *)calloc(
+      sizeof(struct cc_compressed_cache), 1);
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  cc_string_key_info(&info);
+  info.dfree = free_pair;
+  enum cdc_stat stat = cc_gdsf_cache_ctor(&tmp->cache, max_bytes, &info,
+                                          stored_size, NULL /* cost */);
+  if (stat != CDC_STATUS_OK) {
+    free(tmp);
+    return stat;
+  }
+
+  tmp->codec = codec ? codec : &cc_lz_codec;
+  tmp->threshold = threshold;
+  *c = tmp;
+  return CDC_STATUS_OK;
+}
+
+void cc_compressed_cache_dtor(struct cc_compressed_cache *c)
+{
+  assert(c != NULL);
+
+  cc_gdsf_cache_dtor(c->cache);
+  free(c);
+}
+
+enum cdc_stat cc_compressed_cache_get(struct cc_compressed_cache *c,
+                                      const void *key, size_t key_size,
+                                      void *buf, size_t buf_size,
+                                      size_t *value_size)
+{
+  assert(c != NULL);
+  assert(buf != NULL || buf_size == 0);
+  assert(value_size != NULL);
+
+  struct cc_string_key view = cc_string_key_view(key, key_size);
+  struct cc_compressed_value *v = NULL;
+  enum cdc_stat stat = cc_gdsf_cache_get(c->cache, &view, (void **)&v);
+  if (stat != CDC_STATUS_OK) {
+    return stat;
+  }
+
+  *value_size = v->size;
+  if (buf_size < v->size) {
+    return CDC_STATUS_OUT_OF_RANGE;
+  }
+
+  if (v->stored_size == v->size) {
+    if (v->size) {
+      memcpy(buf, value_data(v), v->size);
+    }
+
+    return CDC_STATUS_OK;
+  }
+
+  if (!c->codec->decompress(c->codec->ctx, value_data(v), v->stored_size, buf,
+                            v->size)) {
+    return CDC_STATUS_UNKNOWN_ERROR;
+  }
+
+  return CDC_STATUS_OK;
+}
+
+bool cc_compressed_cache_contains(struct cc_compressed_cache *c,
+                                  const void *key, size_t key_size)
+{
+  assert(c != NULL);
+
+  struct cc_string_key view = cc_string_key_view(key, key_size);
+  return cc_gdsf_cache_contains(c->cache, &view);
+}
+
+enum cdc_stat cc_compressed_cache_insert(struct cc_compressed_cache *c,
+                                         const void *key, size_t key_size,
+                                         const void *value, size_t value_size,
+                                         bool *inserted)
+{
+  assert(c != NULL);
+  assert(value != NULL || value_size == 0);
+
+  // Skip the compression of a value which would not be stored.
+  if (cc_compressed_cache_contains(c, key, key_size)) {
+    if (inserted) {
+      *inserted = false;
+    }
+
+    return CDC_STATUS_OK;
+  }
+
+  return put(c, key, key_size, value, value_size, false /* assign */,
+             inserted);
+}
+
+enum cdc_stat cc_compressed_cache_insert_or_assign(
+    struct cc_compressed_cache *c, const void *key, size_t key_size,
+    const void *value, size_t value_size, bool *inserted)
+{
+  assert(c != NULL);
+  assert(value != NULL || value_size == 0);
+
+  return put(c, key, key_size, value, value_size, true /* assign */,
+             inserted);
+}
+
+void cc_compressed_cache_erase(struct cc_compressed_cache *c, const void *key,
+                               size_t key_size)
+{
+  assert(c != NULL);
+
+  struct cc_string_key view = cc_string_key_view(key, key_size);
+  cc_gdsf_cache_erase(c->cache, &view);
+}
+
+void cc_compressed_cache_clear(struct cc_compressed_cache *c)
+{
+  assert(c != NULL);
+
+  cc_gdsf_cache_clear(c->cache);
+}
@@ -0,0 +1,173 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "ccache/epoch.h"
+
+#include <stdlib.h>
+
+#define CC_EPOCH_CACHE_LINE 64
+
+static bool try_advance(struct cc_epoch *e)
+{
+  uint64_t global = e->global;
+  struct cc_epoch_record *r =
+      __atomic_load_n(&e->records, __ATOMIC_ACQUIRE);
+  for (; r; r = r->next) {
+    uint64_t state = __atomic_load_n(&r->state, __ATOMIC_SEQ_CST);
+    if ((state & 1) && (state >> 1) != global) {
+      return false;
+    }
+  }
+
+  __atomic_store_n(&e->global, global + 1, __ATOMIC_SEQ_CST);
+  return true;
+}
+
+static void free_entry(struct cc_epoch *e, struct cc_epoch_entry *entry)
+{
+  e->retired_head = entry->next;
+  if (!e->retired_head) {
+    e->retired_tail = NULL;
+  }
+
+  --e->retired_count;
+  entry->fn(entry, entry->ctx);
+}
+
+enum cdc_stat cc_epoch_ctor(struct cc_epoch **e)
+{
+  assert(e != NULL);
+
+  struct cc_epoch *tmp = (struct cc_epoch *)malloc(sizeof(struct cc_epoch));
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  tmp->global = 0;
+  tmp->records = NULL;
+  tmp->retired_head = NULL;
+  tmp->retired_tail = NULL;
+  tmp->retired_count = 0;
+  *e = tmp;
+  return CDC_STATUS_OK;
+}
+
+void cc_epoch_dtor(struct cc_epoch *e)
+{
+  assert(e != NULL);
+
+  while (e->retired_head) {
+    free_entry(e, e->retired_head);
+  }
+
+  struct cc_epoch_record *r = e->records;
+  while (r) {
+    struct cc_epoch_record *next = r->next;
+    free(r);
+    r = next;
+  }
+
+  free(e);
+}
+
+enum cdc_stat cc_epoch_register(struct cc_epoch *e, struct cc_epoch_record **r)
+{
+  assert(e != NULL);
+  assert(r != NULL);
+
+  struct cc_epoch_record *rec = __atomic_load_n(&e->records, __ATOMIC_ACQUIRE);
+  for (; rec; rec = rec->next) {
+    int expected = 0;
+    if (__atomic_compare_exchange_n(&rec->in_use, &expected, 1, false,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+      *r = rec;
+      return CDC_STATUS_OK;
+    }
+  }
+
+  // Every reader gets its own cache line, so that readers don't slow each
+  // other down.
+  void *mem = NULL;
+  size_t size = (sizeof(struct cc_epoch_record) + CC_EPOCH_CACHE_LINE - 1) &
+                ~(size_t)(CC_EPOCH_CACHE_LINE - 1);
+  if (posix_memalign(&mem, CC_EPOCH_CACHE_LINE, size) != 0) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  rec = (struct cc_epoch_record *)mem;
+  rec->epoch = e;
+  rec->state = 0;
+  rec->in_use = 1;
+  rec->next = __atomic_load_n(&e->records, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&e->records, &rec->next, rec, true,
+                                      __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+  }
+
+  *r = rec;
+  return CDC_STATUS_OK;
+}
+
+void cc_epoch_unregister(struct cc_epoch_record *r)
+{
+  assert(r != NULL);
+  assert(!(r->state & 1));
+
+  __atomic_store_n(&r->in_use, 0, __ATOMIC_RELEASE);
+}
+
+void cc_epoch_retire(struct cc_epoch *e, struct cc_epoch_entry *entry,
+                     cc_retire_fn_t fn, void *ctx)
+{
+  assert(e != NULL);
+  assert(entry != NULL);
+  assert(fn != NULL);
+
+  entry->next = NULL;
+  entry->epoch = e->global;
+  entry->fn = fn;
+  entry->ctx = ctx;
+  if (e->retired_tail) {
+    e->retired_tail->next = entry;
+  } else {
+    e->retired_head = entry;
+  }
+
+  e->retired_tail = entry;
+  ++e->retired_count;
+}
+
+size_t cc_epoch_collect(struct cc_epoch *e)
+{
+  assert(e != NULL);
+
+  if (!e->retired_head) {
+    return 0;
+  }
+
+  // Entries are retired in epoch order, so the list is sorted.
+  try_advance(e);
+  size_t count = 0;
+  while (e->retired_head && e->retired_head->epoch + 2 <= e->global) {
+    free_entry(e, e->retired_head);
+    ++count;
+  }
+
+  return count;
+}
@@ -0,0 +1,161 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "ccache/executor.h"
+
+#include <stdlib.h>
+
+struct cc_thread_pool_task {
+  struct cc_thread_pool_task *next;
+  cc_task_fn_t fn;
+  void *arg;
+};
+
+static void *worker(void *arg)
+{
+  struct cc_thread_pool *p = (struct cc_thread_pool *)arg;
+  pthread_mutex_lock(&p->mutex);
+  for (;;) {
+    while (!p->head && !p->stop) {
+      pthread_cond_wait(&p->cond, &p->mutex);
+    }
+
+    if (!p->head) {
+      break;
+    }
+
+    struct cc_thread_pool_task *task = p->head;
+    p->head = task->next;
+    if (!p->head) {
+      p->tail = NULL;
+    }
+
+    pthread_mutex_unlock(&p->mutex);
+    task->fn(task->arg);
+    free(task);
+    pthread_mutex_lock(&p->mutex);
+  }
+
+  pthread_mutex_unlock(&p->mutex);
+  return NULL;
+}
+
+static void stop_workers(struct cc_thread_pool *p, size_t count)
+{
+  pthread_mutex_lock(&p->mutex);
+  p->stop = true;
+  pthread_cond_broadcast(&p->cond);
+  pthread_mutex_unlock(&p->mutex);
+  for (size_t i = 0; i < count; ++i) {
+    pthread_join(p->threads[i], NULL);
+  }
+}
+
+void cc_executor_sync(void *ctx, cc_task_fn_t task, void *arg)
+{
+  CDC_UNUSED(ctx);
+
+  task(arg);
+}
+
+enum cdc_stat cc_thread_pool_ctor(struct cc_thread_pool **p, size_t nthreads)
+{
+  assert(p != NULL);
+  assert(nthreads > 0);
+
+  struct cc_thread_pool *tmp =
+      (struct cc_thread_pool *)calloc(sizeof(struct cc_thread_pool), 1);
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  tmp->threads = (pthread_t *)malloc(sizeof(pthread_t) * nthreads);
+  if (!tmp->threads) {
+    goto free_pool;
+  }
+
+  if (pthread_mutex_init(&tmp->mutex, NULL) != 0) {
+    goto free_threads;
+  }
+
+  if (pthread_cond_init(&tmp->cond, NULL) != 0) {
+    goto free_mutex;
+  }
+
+  for (tmp->nthreads = 0; tmp->nthreads < nthreads; ++tmp->nthreads) {
+    if (pthread_create(&tmp->threads[tmp->nthreads], NULL, worker, tmp) != 0) {
+      stop_workers(tmp, tmp->nthreads);
+      goto free_cond;
+    }
+  }
+
+  *p = tmp;
+  return CDC_STATUS_OK;
+
+free_cond:
+  pthread_cond_destroy(&tmp->cond);
+free_mutex:
+  pthread_mutex_destroy(&tmp->mutex);
+free_threads:
+  free(tmp->threads);
+free_pool:
+  free(tmp);
+  return CDC_STATUS_BAD_ALLOC;
+}
+
+void cc_thread_pool_dtor(struct cc_thread_pool *p)
+{
+  assert(p != NULL);
+
+  stop_workers(p, p->nthreads);
+  pthread_cond_destroy(&p->cond);
+  pthread_mutex_destroy(&p->mutex);
+  free(p->threads);
+  free(p);
+}
+
+void cc_thread_pool_execute(void *p, cc_task_fn_t fn, void *arg)
+{
+  assert(p != NULL);
+  assert(fn != NULL);
+
+  struct cc_thread_pool *pool = (struct cc_thread_pool *)p;
+  struct cc_thread_pool_task *task =
+      (struct cc_thread_pool_task *)malloc(sizeof(struct cc_thread_pool_task));
+  if (!task) {
+    // Running the task inline is slower but never loses it.
+    fn(arg);
+    return;
+  }
+
+  task->next = NULL;
+  task->fn = fn;
+  task->arg = arg;
+  pthread_mutex_lock(&pool->mutex);
+  if (pool->tail) {
+    pool->tail->next = task;
+  } else {
+    pool->head = task;
+  }
+
+  pool->tail = task;
+  pthread_cond_signal(&pool->cond);
+  pthread_mutex_unlock(&pool->mutex);
+}
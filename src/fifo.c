@@ -20,18 +20,93 @@
 // IN THE SOFTWARE.
 #include "ccache/fifo.h"
 
+#include "ccache/bloom.h"
+#include "ccache/common.h"
+#include "ccache/shards.h"
+#include "ccache/topk.h"
 #include "list.h"
+#include "memory.h"
+#include "probes.h"
+#include "reclaimer.h"
 
 #include <cdcontainers/data-info.h>
 #include <cdcontainers/hash-table.h>
 
+#include <stdlib.h>
+
+static size_t payload_size(struct cc_fifo_cache *c, void *key, void *value)
+{
+  return c->payload_size ? c->payload_size(key, value) : 0;
+}
+
+// Returns false if the filter rules the key out.
+static bool may_contain(struct cc_fifo_cache *c, void *key)
+{
+  return !c->filter || cc_bloom_filter_may_contain(c->filter, key);
+}
+
+static void remove_node(struct cc_fifo_cache *c, struct cc_list_node *node)
+{
+  void *key = node->kv.first;
+  if (c->filter) {
+    cc_bloom_filter_remove(c->filter, key);
+  }
+
+  c->payload_bytes -= payload_size(c, node->kv.first, node->kv.second);
+  cc_list_unlink_node(c->list, node);
+  cdc_hash_table_erase(c->table, key);
+  cc_list_free_node(c->list, node, true /* remove_data */);
+}
+
+static size_t evict(struct cc_fifo_cache *c, size_t max_size, size_t budget)
+{
+  size_t count = 0;
+  struct cc_list_node *node = c->list->tail;
+  while (count < budget && cc_fifo_cache_size(c) > max_size) {
+    struct cc_list_node *prev = node->prev;
+    // Loads the next victim while this one is unlinked and freed.
+    CC_PREFETCH(prev);
+    CC_PROBE_EVICT(c, node->kv.first, c->table->dinfo->hash);
+    remove_node(c, node);
+    node = prev;
+    ++count;
+  }
+
+  return count;
+}
+
+// Returns the size down to which an insert into a full cache evicts.
+static size_t low_watermark(struct cc_fifo_cache *c)
+{
+  size_t max_size = cc_fifo_cache_max_size(c);
+  if (c->high_watermark == 0 || c->low_watermark >= max_size) {
+    return max_size - 1;
+  }
+
+  return c->low_watermark;
+}
+
+// Returns the size at which an insert evicts.
+static size_t high_watermark(struct cc_fifo_cache *c)
+{
+  size_t max_size = cc_fifo_cache_max_size(c);
+  if (c->high_watermark == 0 || c->high_watermark > max_size) {
+    return max_size;
+  }
+
+  return c->high_watermark;
+}
+
 static enum cdc_stat insert_new(struct cc_fifo_cache *c, void *key, void *value)
 {
-  if (cc_fifo_cache_size(c) + 1 > cc_fifo_cache_max_size(c)) {
-    cc_fifo_cache_erase(c, c->list->tail->kv.first);
+  // After a shrink the cache may stay above max_size for a few inserts.
+  size_t high = high_watermark(c);
+  if (cc_fifo_cache_size(c) >= high) {
+    size_t low = low_watermark(c);
+    evict(c, low, high - low - 1 + CC_INSERT_EVICT_BUDGET);
   }
 
-  struct cc_list_node *node = cc_list_new_node(key, value);
+  struct cc_list_node *node = cc_list_alloc_node(c->list, key, value);
   if (!node) {
     return CDC_STATUS_BAD_ALLOC;
   }
@@ -44,6 +119,39 @@ static enum cdc_stat insert_new(struct cc_fifo_cache *c, void *key, void *value)
   }
 
   cc_list_push_front_node(c->list, node);
+  c->payload_bytes += payload_size(c, key, value);
+  CC_PROBE_INSERT(c, key);
+  if (c->filter) {
+    cc_bloom_filter_add(c->filter, key);
+  }
+
+  return CDC_STATUS_OK;
+}
+
+// Stores a pair without an eviction check. A key which is already cached is
+// skipped and its pair is left to the caller.
+static enum cdc_stat load(struct cc_fifo_cache *c, void *key, void *value,
+                          bool *inserted)
+{
+  struct cc_list_node *node = cc_list_alloc_node(c->list, key, value);
+  if (!node) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  enum cdc_stat stat =
+      cdc_hash_table_insert(c->table, key, node, NULL /* it */, inserted);
+  if (stat != CDC_STATUS_OK || !*inserted) {
+    cc_list_free_node(c->list, node, false /* remove_data */);
+    return stat;
+  }
+
+  cc_list_push_front_node(c->list, node);
+  c->payload_bytes += payload_size(c, key, value);
+  CC_PROBE_INSERT(c, key);
+  if (c->filter) {
+    cc_bloom_filter_add(c->filter, key);
+  }
+
   return CDC_STATUS_OK;
 }
 
@@ -82,6 +190,13 @@ enum cdc_stat cc_fifo_cache_ctor(struct cc_fifo_cache **c, size_t max_size,
   }
 
   tmp->max_size = max_size;
+  tmp->payload_size = NULL;
+  tmp->payload_bytes = 0;
+  tmp->shards = NULL;
+  tmp->top_keys = NULL;
+  tmp->filter = NULL;
+  tmp->low_watermark = 0;
+  tmp->high_watermark = 0;
   *c = tmp;
   return CDC_STATUS_OK;
 
@@ -92,10 +207,38 @@ free_cache:
   return stat;
 }
 
+enum cdc_stat cc_fifo_cache_ctor1(struct cc_fifo_cache **c, size_t max_size,
+                                  struct cdc_data_info *info, bool reserve)
+{
+  assert(c != NULL);
+
+  struct cc_fifo_cache *tmp = NULL;
+  enum cdc_stat stat = cc_fifo_cache_ctor(&tmp, max_size, info);
+  if (stat != CDC_STATUS_OK) {
+    return stat;
+  }
+
+  if (reserve) {
+    stat = cdc_hash_table_reserve(tmp->table, max_size);
+    if (stat == CDC_STATUS_OK) {
+      stat = cc_list_reserve(tmp->list, max_size);
+    }
+
+    if (stat != CDC_STATUS_OK) {
+      cc_fifo_cache_dtor(tmp);
+      return stat;
+    }
+  }
+
+  *c = tmp;
+  return CDC_STATUS_OK;
+}
+
 void cc_fifo_cache_dtor(struct cc_fifo_cache *c)
 {
   assert(c != NULL);
 
+  cc_fifo_cache_disable_filter(c);
   cdc_hash_table_dtor(c->table);
   cc_list_dtor(c->list);
   free(c);
@@ -107,12 +250,22 @@ enum cdc_stat cc_fifo_cache_get(struct cc_fifo_cache *c, void *key,
   assert(c != NULL);
   assert(value != NULL);
 
+  if (c->shards) {
+    cc_shards_access(c->shards, key);
+  }
+
+  if (c->top_keys) {
+    cc_top_keys_add(c->top_keys, key);
+  }
+
   struct cc_list_node *node = NULL;
-  enum cdc_stat stat = cdc_hash_table_get(c->table, key, (void **)&node);
-  if (stat != CDC_STATUS_OK) {
-    return stat;
+  if (!may_contain(c, key) ||
+      cdc_hash_table_get(c->table, key, (void **)&node) != CDC_STATUS_OK) {
+    CC_PROBE_GET_MISS(c, key);
+    return CDC_STATUS_NOT_FOUND;
   }
 
+  CC_PROBE_GET_HIT(c, key);
   *value = node->kv.second;
   return CDC_STATUS_OK;
 }
@@ -121,7 +274,118 @@ bool cc_fifo_cache_contains(struct cc_fifo_cache *c, void *key)
 {
   assert(c != NULL);
 
-  return cdc_hash_table_count(c->table, key) != 0;
+  return may_contain(c, key) && cdc_hash_table_count(c->table, key) != 0;
+}
+
+enum cdc_stat cc_fifo_cache_enable_filter(struct cc_fifo_cache *c)
+{
+  assert(c != NULL);
+
+  size_t capacity = cc_fifo_cache_max_size(c);
+  if (capacity < cc_fifo_cache_size(c)) {
+    capacity = cc_fifo_cache_size(c);
+  }
+
+  struct cc_bloom_filter *filter = NULL;
+  enum cdc_stat stat =
+      cc_bloom_filter_ctor(&filter, capacity, c->table->dinfo->hash);
+  if (stat != CDC_STATUS_OK) {
+    return stat;
+  }
+
+  for (struct cc_list_node *node = c->list->head; node; node = node->next) {
+    cc_bloom_filter_add(filter, node->kv.first);
+  }
+
+  cc_fifo_cache_disable_filter(c);
+  c->filter = filter;
+  return CDC_STATUS_OK;
+}
+
+void cc_fifo_cache_disable_filter(struct cc_fifo_cache *c)
+{
+  assert(c != NULL);
+
+  if (c->filter) {
+    cc_bloom_filter_dtor(c->filter);
+    c->filter = NULL;
+  }
+}
+
+enum cdc_stat cc_fifo_cache_enable_reclaimer(struct cc_fifo_cache *c,
+                                             bool background)
+{
+  assert(c != NULL);
+
+  struct cc_reclaimer *r = NULL;
+  enum cdc_stat stat = cc_reclaimer_ctor(&r, c->list->dinfo, background);
+  if (stat != CDC_STATUS_OK) {
+    return stat;
+  }
+
+  cc_list_set_reclaimer(c->list, r);
+  return CDC_STATUS_OK;
+}
+
+void cc_fifo_cache_disable_reclaimer(struct cc_fifo_cache *c)
+{
+  assert(c != NULL);
+
+  cc_list_set_reclaimer(c->list, NULL);
+}
+
+size_t cc_fifo_cache_reclaim(struct cc_fifo_cache *c, size_t budget)
+{
+  assert(c != NULL);
+
+  if (!c->list->reclaimer) {
+    return 0;
+  }
+
+  return cc_reclaimer_reclaim(c->list->reclaimer, budget);
+}
+
+void cc_fifo_cache_set_max_size(struct cc_fifo_cache *c, size_t max_size)
+{
+  assert(c != NULL);
+  assert(max_size > 0);
+
+  c->max_size = max_size;
+}
+
+size_t cc_fifo_cache_trim(struct cc_fifo_cache *c, size_t budget)
+{
+  assert(c != NULL);
+
+  return evict(c, cc_fifo_cache_max_size(c), budget);
+}
+
+void cc_fifo_cache_set_watermarks(struct cc_fifo_cache *c, size_t low,
+                                  size_t high)
+{
+  assert(c != NULL);
+  assert(high == 0 || (low < high && high <= cc_fifo_cache_max_size(c)));
+
+  c->low_watermark = low;
+  c->high_watermark = high;
+}
+
+size_t cc_fifo_cache_maintain(struct cc_fifo_cache *c)
+{
+  assert(c != NULL);
+
+  if (c->high_watermark == 0 || cc_fifo_cache_size(c) < c->high_watermark) {
+    return 0;
+  }
+
+  return evict(c, low_watermark(c), cc_fifo_cache_size(c));
+}
+
+enum cdc_stat cc_fifo_cache_reserve(struct cc_fifo_cache *c, size_t count)
+{
+  assert(c != NULL);
+
+  return cdc_hash_table_reserve(c->table, count);
 }
 
 size_t cc_fifo_cache_size(struct cc_fifo_cache *c)
@@ -143,7 +407,11 @@ enum cdc_stat cc_fifo_cache_insert(struct cc_fifo_cache *c, void *key,
 {
   assert(c != NULL);
 
-  if (cdc_hash_table_count(c->table, key) != 0) {
+  if (c->top_keys) {
+    cc_top_keys_add(c->top_keys, key);
+  }
+
+  if (may_contain(c, key) && cdc_hash_table_count(c->table, key) != 0) {
     if (inserted) {
       *inserted = false;
     }
@@ -162,13 +430,19 @@ enum cdc_stat cc_fifo_cache_insert(struct cc_fifo_cache *c, void *key,
 enum cdc_stat cc_fifo_cache_insert_or_assign(struct cc_fifo_cache *c, void *key,
                                              void *value, bool *inserted)
 {
+  assert(c != NULL);
+
+  if (c->top_keys) {
+    cc_top_keys_add(c->top_keys, key);
+  }
+
   struct cc_list_node *node = NULL;
-  if (cdc_hash_table_get(c->table, key, (void **)&node) == CDC_STATUS_OK) {
+  if (may_contain(c, key) &&
+      cdc_hash_table_get(c->table, key, (void **)&node) == CDC_STATUS_OK) {
+    c->payload_bytes -= payload_size(c, node->kv.first, node->kv.second);
+    c->payload_bytes += payload_size(c, node->kv.first, value);
     // Try to remove old value.
-    if (CDC_HAS_DFREE(c->list->dinfo)) {
-      struct cdc_pair kv = {NULL, node->kv.second};
-      c->list->dinfo->dfree(&kv);
-    }
+    cc_list_free_value(c->list, node->kv.second);
 
     node->kv.second = value;
     if (inserted) {
@@ -186,32 +460,72 @@ enum cdc_stat cc_fifo_cache_insert_or_assign(struct cc_fifo_cache *c, void *key,
   return stat;
 }
 
+enum cdc_stat cc_fifo_cache_bulk_load(struct cc_fifo_cache *c, void **keys,
+                                      void **values, size_t n, size_t *loaded)
+{
+  assert(c != NULL);
+  assert(n == 0 || (keys != NULL && values != NULL));
+
+  size_t size = cc_fifo_cache_size(c);
+  size_t max_size = cc_fifo_cache_max_size(c);
+  size_t room = size < max_size ? max_size - size : 0;
+  enum cdc_stat stat =
+      cdc_hash_table_reserve(c->table, size + (n < room ? n : room));
+  size_t count = 0;
+  for (size_t i = 0; stat == CDC_STATUS_OK && i < n; ++i) {
+    bool inserted = false;
+    stat = load(c, keys[i], values[i], &inserted);
+    // Nothing is evicted until the free capacity is used up.
+    if (inserted && ++count > room) {
+      evict(c, max_size, CC_INSERT_EVICT_BUDGET);
+    }
+  }
+
+  if (loaded) {
+    *loaded = count;
+  }
+
+  return stat;
+}
+
 void cc_fifo_cache_erase(struct cc_fifo_cache *c, void *key)
 {
   assert(c != NULL);
 
+  if (!may_contain(c, key)) {
+    return;
+  }
+
   struct cc_list_node *node = NULL;
   enum cdc_stat stat = cdc_hash_table_get(c->table, key, (void **)&node);
   if (stat != CDC_STATUS_OK) {
     return;
   }
 
-  cc_list_unlink_node(c->list, node);
-  cdc_hash_table_erase(c->table, key);
-  cc_list_free_node(c->list, node, true /* remove_data */);
+  CC_PROBE_ERASE(c, key);
+  remove_node(c, node);
 }
 
 void cc_fifo_cache_take(struct cc_fifo_cache *c, void *key, struct cdc_pair *kv)
 {
   assert(c != NULL);
 
+  if (!may_contain(c, key)) {
+    return;
+  }
+
   struct cc_list_node *node = NULL;
   enum cdc_stat stat = cdc_hash_table_get(c->table, key, (void **)&node);
   if (stat != CDC_STATUS_OK) {
     return;
   }
 
+  if (c->filter) {
+    cc_bloom_filter_remove(c->filter, key);
+  }
+
   *kv = node->kv;
+  c->payload_bytes -= payload_size(c, node->kv.first, node->kv.second);
   cc_list_unlink_node(c->list, node);
   cdc_hash_table_erase(c->table, key);
   cc_list_free_node(c->list, node, false /* remove_data */);
@@ -221,6 +535,130 @@ void cc_fifo_cache_clear(struct cc_fifo_cache *c)
 {
   assert(c != NULL);
 
+  CC_PROBE_CLEAR(c);
   cdc_hash_table_clear(c->table);
   cc_list_clear(c->list);
+  c->payload_bytes = 0;
+  if (c->filter) {
+    cc_bloom_filter_clear(c->filter);
+  }
+}
+
+void cc_fifo_cache_set_payload_size(struct cc_fifo_cache *c, cc_size_fn_t fn)
+{
+  assert(c != NULL);
+
+  c->payload_size = fn;
+  c->payload_bytes = 0;
+  for (struct cc_list_node *node = c->list->head; node; node = node->next) {
+    c->payload_bytes += payload_size(c, node->kv.first, node->kv.second);
+  }
+}
+
+struct cc_memory_usage cc_fifo_cache_memory_usage(struct cc_fifo_cache *c)
+{
+  assert(c != NULL);
+
+  struct cc_memory_usage usage;
+  usage.metadata = cc_alloc_size(sizeof(struct cc_fifo_cache)) +
+                   cc_list_memory_usage(c->list, cc_fifo_cache_size(c)) +
+                   cc_hash_table_memory_usage(c->table) +
+                   cc_bloom_filter_memory_usage(c->filter);
+  usage.payload = c->payload_bytes;
+  return usage;
+}
+
+size_t cc_fifo_cache_bytes_for(size_t max_size)
+{
+  return cc_alloc_size(sizeof(struct cc_fifo_cache)) +
+         cc_list_bytes_for(max_size) + cc_hash_table_bytes_for(max_size);
+}
+
+void cc_fifo_cache_set_shards(struct cc_fifo_cache *c, struct cc_shards *s)
+{
+  assert(c != NULL);
+
+  c->shards = s;
+}
+
+void cc_fifo_cache_begin(struct cc_fifo_cache *c,
+                         struct cc_fifo_cache_iter *it)
+{
+  assert(c != NULL);
+  assert(it != NULL);
+
+  it->current = c->list->head;
+}
+
+void cc_fifo_cache_rbegin(struct cc_fifo_cache *c,
+                          struct cc_fifo_cache_iter *it)
+{
+  assert(c != NULL);
+  assert(it != NULL);
+
+  it->current = c->list->tail;
+}
+
+void cc_fifo_cache_for_each(struct cc_fifo_cache *c, cc_visit_fn_t fn,
+                            void *ctx)
+{
+  assert(c != NULL);
+  assert(fn != NULL);
+
+  cc_list_for_each(c->list, fn, ctx);
+}
+
+void cc_fifo_cache_rfor_each(struct cc_fifo_cache *c, cc_visit_fn_t fn,
+                             void *ctx)
+{
+  assert(c != NULL);
+  assert(fn != NULL);
+
+  cc_list_rfor_each(c->list, fn, ctx);
+}
+
+void cc_fifo_cache_iter_next(struct cc_fifo_cache_iter *it)
+{
+  assert(it != NULL);
+  assert(it->current != NULL);
+
+  it->current = it->current->next;
+}
+
+void cc_fifo_cache_iter_prev(struct cc_fifo_cache_iter *it)
+{
+  assert(it != NULL);
+  assert(it->current != NULL);
+
+  it->current = it->current->prev;
+}
+
+void *cc_fifo_cache_iter_key(struct cc_fifo_cache_iter *it)
+{
+  assert(it != NULL);
+  assert(it->current != NULL);
+
+  return it->current->kv.first;
+}
+
+void *cc_fifo_cache_iter_value(struct cc_fifo_cache_iter *it)
+{
+  assert(it != NULL);
+  assert(it->current != NULL);
+
+  return it->current->kv.second;
+}
+
+void cc_fifo_cache_set_top_keys(struct cc_fifo_cache *c, struct cc_top_keys *t)
+{
+  assert(c != NULL);
+
+  c->top_keys = t;
+}
+
+size_t cc_fifo_cache_top_keys(struct cc_fifo_cache *c, size_t k, void **keys)
+{
+  assert(c != NULL);
+
+  return c->top_keys ? cc_top_keys_get(c->top_keys, k, keys, NULL) : 0;
 }
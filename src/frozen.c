@@ -0,0 +1,537 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "ccache/frozen.h"
+
+#include "ccache/hash.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CC_FROZEN_MAGIC "CCFROZEN"
+#define CC_FROZEN_VERSION 1
+// Bits per key in every level. More bits mean fewer collisions and levels.
+#define CC_FROZEN_GAMMA 2
+#define CC_FROZEN_MIN_CAPACITY 16
+
+struct cc_frozen_pair {
+  uint64_t hash;
+  // The key followed by the value.
+  unsigned char *bytes;
+  size_t key_size;
+  size_t value_size;
+};
+
+struct cc_frozen_record {
+  uint64_t offset;
+  uint32_t key_size;
+  uint32_t value_size;
+};
+
+// The image is the header followed by the bitmaps, the ranks, the
+// fingerprints padded to eight bytes, the records and the keys and values.
+struct cc_frozen_header {
+  char magic[8];
+  uint64_t version;
+  uint64_t size;
+  uint64_t levels;
+  uint64_t level_words[CC_FROZEN_MAX_LEVELS];
+  uint64_t data_size;
+};
+
+struct cc_frozen_layout {
+  size_t words;
+  size_t ranks;
+  size_t fingerprints;
+  size_t records;
+  size_t total;
+};
+
+static size_t popcount(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return (size_t)__builtin_popcountll(x);
+#else
+  x -= (x >> 1) & 0x5555555555555555ull;
+  x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+  x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+  return (size_t)((x * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+static uint16_t fingerprint(uint64_t hash) { return (uint16_t)(hash >> 48); }
+
+// Maps the hash to a bit of a level of size bits.
+static uint64_t position(uint64_t hash, size_t level, uint64_t bits)
+{
+  uint64_t lo, hi;
+  cc_hash_mul128(cc_hash_u64(hash + level * 0x9e3779b97f4a7c15ull), bits, &lo,
+                 &hi);
+  return hi;
+}
+
+static size_t align8(size_t size) { return (size + 7) & ~(size_t)7; }
+
+static void layout(struct cc_frozen_layout *l, size_t size, size_t words,
+                   size_t data_size)
+{
+  l->words = words;
+  l->ranks = (words + 7) / 8;
+  l->fingerprints = align8(size * sizeof(uint16_t));
+  l->records = size * sizeof(struct cc_frozen_record);
+  l->total = sizeof(struct cc_frozen_header) + words * sizeof(uint64_t) +
+             l->ranks * sizeof(uint64_t) + l->fingerprints + l->records +
+             data_size;
+}
+
+static size_t rank(struct cc_frozen_cache *c, size_t bit)
+{
+  size_t word = bit / 64;
+  size_t count = c->ranks[word / 8];
+  for (size_t i = word & ~(size_t)7; i < word; ++i) {
+    count += popcount(c->bits[i]);
+  }
+
+  uint64_t mask = ((uint64_t)1 << (bit % 64)) - 1;
+  return count + popcount(c->bits[word] & mask);
+}
+
+// Returns the index of the key with this hash, or SIZE_MAX if no level
+// claims it. An absent key may get the index of another key.
+static size_t find(struct cc_frozen_cache *c, uint64_t hash)
+{
+  size_t base = 0;
+  for (size_t level = 0; level < c->levels; ++level) {
+    size_t words = c->level_words[level];
+    size_t bit = base * 64 + position(hash, level, (uint64_t)words * 64);
+    if ((c->bits[bit / 64] >> (bit % 64)) & 1) {
+      return rank(c, bit);
+    }
+
+    base += words;
+  }
+
+  return SIZE_MAX;
+}
+
+// Fills the levels of view. The keys that collide in a level are moved to
+// the front of keys and go on to the next one.
+static enum cdc_stat build_levels(struct cc_frozen_builder *b,
+                                  struct cc_frozen_cache *view,
+                                  uint64_t **bits, size_t *total)
+{
+  enum cdc_stat stat = CDC_STATUS_BAD_ALLOC;
+  size_t *keys = (size_t *)malloc(b->size * sizeof(size_t) + 1);
+  if (!keys) {
+    return stat;
+  }
+
+  for (size_t i = 0; i < b->size; ++i) {
+    keys[i] = i;
+  }
+
+  uint64_t *collisions = NULL;
+  size_t remaining = b->size;
+  for (view->levels = 0; remaining > 0; ++view->levels) {
+    if (view->levels == CC_FROZEN_MAX_LEVELS) {
+      // Only equal keys keep colliding for this long.
+      stat = CDC_STATUS_UNKNOWN_ERROR;
+      goto free_keys;
+    }
+
+    size_t words = (remaining * CC_FROZEN_GAMMA + 63) / 64;
+    uint64_t *tmp =
+        (uint64_t *)realloc(*bits, (*total + words) * sizeof(uint64_t));
+    if (!tmp) {
+      goto free_keys;
+    }
+
+    *bits = tmp;
+    collisions = (uint64_t *)calloc(words, sizeof(uint64_t));
+    if (!collisions) {
+      goto free_keys;
+    }
+
+    uint64_t *seen = *bits + *total;
+    memset(seen, 0, words * sizeof(uint64_t));
+    for (size_t i = 0; i < remaining; ++i) {
+      uint64_t p = position(b->pairs[keys[i]].hash, view->levels, words * 64);
+      uint64_t bit = (uint64_t)1 << (p % 64);
+      if (seen[p / 64] & bit) {
+        collisions[p / 64] |= bit;
+      } else {
+        seen[p / 64] |= bit;
+      }
+    }
+
+    size_t next = 0;
+    for (size_t i = 0; i < remaining; ++i) {
+      uint64_t p = position(b->pairs[keys[i]].hash, view->levels, words * 64);
+      if ((collisions[p / 64] >> (p % 64)) & 1) {
+        keys[next++] = keys[i];
+      }
+    }
+
+    for (size_t i = 0; i < words; ++i) {
+      seen[i] &= ~collisions[i];
+    }
+
+    free(collisions);
+    collisions = NULL;
+    view->level_words[view->levels] = words;
+    *total += words;
+    remaining = next;
+  }
+
+  stat = CDC_STATUS_OK;
+free_keys:
+  free(collisions);
+  free(keys);
+  return stat;
+}
+
+static bool write_section(FILE *f, const void *data, size_t size)
+{
+  return size == 0 || fwrite(data, 1, size, f) == size;
+}
+
+static enum cdc_stat write_image(struct cc_frozen_builder *b, FILE *f,
+                                 struct cc_frozen_cache *view,
+                                 struct cc_frozen_layout *l,
+                                 uint64_t *ranks, size_t *order,
+                                 size_t data_size)
+{
+  struct cc_frozen_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, CC_FROZEN_MAGIC, sizeof(header.magic));
+  header.version = CC_FROZEN_VERSION;
+  header.size = b->size;
+  header.levels = view->levels;
+  for (size_t i = 0; i < view->levels; ++i) {
+    header.level_words[i] = view->level_words[i];
+  }
+
+  header.data_size = data_size;
+  bool ok = write_section(f, &header, sizeof(header)) &&
+            write_section(f, view->bits, l->words * sizeof(uint64_t)) &&
+            write_section(f, ranks, l->ranks * sizeof(uint64_t));
+  for (size_t i = 0; ok && i < b->size; ++i) {
+    uint16_t fp = fingerprint(b->pairs[order[i]].hash);
+    ok = write_section(f, &fp, sizeof(fp));
+  }
+
+  static const unsigned char padding[8];
+  ok = ok && write_section(f, padding,
+                           l->fingerprints - b->size * sizeof(uint16_t));
+  uint64_t offset = 0;
+  for (size_t i = 0; ok && i < b->size; ++i) {
+    struct cc_frozen_pair *pair = b->pairs + order[i];
+    struct cc_frozen_record record;
+    record.offset = offset;
+    record.key_size = (uint32_t)pair->key_size;
+    record.value_size = (uint32_t)pair->value_size;
+    ok = write_section(f, &record, sizeof(record));
+    offset += pair->key_size + pair->value_size;
+  }
+
+  for (size_t i = 0; ok && i < b->size; ++i) {
+    struct cc_frozen_pair *pair = b->pairs + order[i];
+    ok = write_section(f, pair->bytes, pair->key_size + pair->value_size);
+  }
+
+  return ok ? CDC_STATUS_OK : CDC_STATUS_UNKNOWN_ERROR;
+}
+
+enum cdc_stat cc_frozen_builder_ctor(struct cc_frozen_builder **b)
+{
+  assert(b != NULL);
+
+  struct cc_frozen_builder *tmp =
+      (struct cc_frozen_builder *)calloc(sizeof(struct cc_frozen_builder), 1);
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  *b = tmp;
+  return CDC_STATUS_OK;
+}
+
+void cc_frozen_builder_dtor(struct cc_frozen_builder *b)
+{
+  assert(b != NULL);
+
+  for (size_t i = 0; i < b->size; ++i) {
+    free(b->pairs[i].bytes);
+  }
+
+  free(b->pairs);
+  free(b);
+}
+
+enum cdc_stat cc_frozen_builder_add(struct cc_frozen_builder *b,
+                                    const void *key, size_t key_size,
+                                    const void *value, size_t value_size)
+{
+  assert(b != NULL);
+  assert(key != NULL || key_size == 0);
+  assert(value != NULL || value_size == 0);
+
+  if (key_size > UINT32_MAX || value_size > UINT32_MAX) {
+    return CDC_STATUS_OUT_OF_RANGE;
+  }
+
+  if (b->size == b->capacity) {
+    size_t capacity =
+        b->capacity ? b->capacity * 2 : CC_FROZEN_MIN_CAPACITY;
+    struct cc_frozen_pair *pairs = (struct cc_frozen_pair *)realloc(
+        b->pairs, capacity * sizeof(struct cc_frozen_pair));
+    if (!pairs) {
+      return CDC_STATUS_BAD_ALLOC;
+    }
+
+    b->pairs = pairs;
+    b->capacity = capacity;
+  }
+
+  struct cc_frozen_pair *pair = b->pairs + b->size;
+  pair->bytes = (unsigned char *)malloc(key_size + value_size + 1);
+  if (!pair->bytes) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  if (key_size) {
+    memcpy(pair->bytes, key, key_size);
+  }
+
+  if (value_size) {
+    memcpy(pair->bytes + key_size, value, value_size);
+  }
+
+  pair->hash = cc_hash_bytes(key, key_size, 0);
+  pair->key_size = key_size;
+  pair->value_size = value_size;
+  ++b->size;
+  return CDC_STATUS_OK;
+}
+
+enum cdc_stat cc_frozen_builder_write(struct cc_frozen_builder *b,
+                                      const char *path)
+{
+  assert(b != NULL);
+  assert(path != NULL);
+
+  struct cc_frozen_cache view;
+  memset(&view, 0, sizeof(view));
+  uint64_t *bits = NULL;
+  size_t words = 0;
+  enum cdc_stat stat = build_levels(b, &view, &bits, &words);
+  if (stat != CDC_STATUS_OK) {
+    free(bits);
+    return stat;
+  }
+
+  struct cc_frozen_layout l;
+  size_t data_size = 0;
+  for (size_t i = 0; i < b->size; ++i) {
+    data_size += b->pairs[i].key_size + b->pairs[i].value_size;
+  }
+
+  layout(&l, b->size, words, data_size);
+  uint64_t *ranks = (uint64_t *)malloc(l.ranks * sizeof(uint64_t) + 1);
+  size_t *order = (size_t *)malloc(b->size * sizeof(size_t) + 1);
+  stat = CDC_STATUS_BAD_ALLOC;
+  if (!ranks || !order) {
+    goto free_all;
+  }
+
+  size_t count = 0;
+  for (size_t i = 0; i < words; ++i) {
+    if (i % 8 == 0) {
+      ranks[i / 8] = count;
+    }
+
+    count += popcount(bits[i]);
+  }
+
+  view.bits = bits;
+  view.ranks = ranks;
+  for (size_t i = 0; i < b->size; ++i) {
+    order[find(&view, b->pairs[i].hash)] = i;
+  }
+
+  FILE *f = fopen(path, "wb");
+  stat = CDC_STATUS_UNKNOWN_ERROR;
+  if (f) {
+    stat = write_image(b, f, &view, &l, ranks, order, data_size);
+    if (fclose(f) != 0) {
+      stat = CDC_STATUS_UNKNOWN_ERROR;
+    }
+  }
+
+free_all:
+  free(order);
+  free(ranks);
+  free(bits);
+  return stat;
+}
+
+static bool map_image(struct cc_frozen_cache *c)
+{
+  const struct cc_frozen_header *header =
+      (const struct cc_frozen_header *)c->map;
+  if (c->map_size < sizeof(struct cc_frozen_header) ||
+      memcmp(header->magic, CC_FROZEN_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != CC_FROZEN_VERSION ||
+      header->levels > CC_FROZEN_MAX_LEVELS ||
+      header->size > c->map_size / sizeof(struct cc_frozen_record) ||
+      header->data_size > c->map_size) {
+    return false;
+  }
+
+  size_t words = 0;
+  for (size_t i = 0; i < header->levels; ++i) {
+    if (header->level_words[i] == 0 ||
+        header->level_words[i] > c->map_size / sizeof(uint64_t)) {
+      return false;
+    }
+
+    c->level_words[i] = header->level_words[i];
+    words += header->level_words[i];
+  }
+
+  struct cc_frozen_layout l;
+  layout(&l, header->size, words, header->data_size);
+  if (l.total != c->map_size) {
+    return false;
+  }
+
+  const unsigned char *p = (const unsigned char *)c->map + sizeof(*header);
+  c->size = header->size;
+  c->levels = header->levels;
+  c->bits = (const uint64_t *)p;
+  p += l.words * sizeof(uint64_t);
+  c->ranks = (const uint64_t *)p;
+  p += l.ranks * sizeof(uint64_t);
+  c->fingerprints = (const uint16_t *)p;
+  p += l.fingerprints;
+  c->records = (const struct cc_frozen_record *)p;
+  c->data = p + l.records;
+  c->data_size = header->data_size;
+  return true;
+}
+
+enum cdc_stat cc_frozen_cache_ctor(struct cc_frozen_cache **c,
+                                   const char *path)
+{
+  assert(c != NULL);
+  assert(path != NULL);
+
+  struct cc_frozen_cache *tmp =
+      (struct cc_frozen_cache *)calloc(sizeof(struct cc_frozen_cache), 1);
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    goto free_cache;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    goto close_file;
+  }
+
+  tmp->map_size = (size_t)st.st_size;
+  tmp->map = mmap(NULL, tmp->map_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (tmp->map == MAP_FAILED) {
+    goto close_file;
+  }
+
+  close(fd);
+  if (!map_image(tmp)) {
+    munmap(tmp->map, tmp->map_size);
+    goto free_cache;
+  }
+
+  *c = tmp;
+  return CDC_STATUS_OK;
+
+close_file:
+  close(fd);
+free_cache:
+  free(tmp);
+  return CDC_STATUS_UNKNOWN_ERROR;
+}
+
+void cc_frozen_cache_dtor(struct cc_frozen_cache *c)
+{
+  assert(c != NULL);
+
+  munmap(c->map, c->map_size);
+  free(c);
+}
+
+enum cdc_stat cc_frozen_cache_get(struct cc_frozen_cache *c, const void *key,
+                                  size_t key_size, const void **value,
+                                  size_t *value_size)
+{
+  assert(c != NULL);
+  assert(key != NULL || key_size == 0);
+  assert(value != NULL);
+
+  uint64_t hash = cc_hash_bytes(key, key_size, 0);
+  size_t index = find(c, hash);
+  if (index >= c->size || c->fingerprints[index] != fingerprint(hash)) {
+    return CDC_STATUS_NOT_FOUND;
+  }
+
+  // The bounds check keeps a damaged image from reading past the mapping.
+  const struct cc_frozen_record *record = c->records + index;
+  const unsigned char *bytes = c->data + record->offset;
+  if (record->key_size != key_size || record->offset > c->data_size ||
+      c->data_size - record->offset <
+          (uint64_t)record->key_size + record->value_size ||
+      (key_size && memcmp(bytes, key, key_size) != 0)) {
+    return CDC_STATUS_NOT_FOUND;
+  }
+
+  *value = bytes + key_size;
+  if (value_size) {
+    *value_size = record->value_size;
+  }
+
+  return CDC_STATUS_OK;
+}
+
+bool cc_frozen_cache_contains(struct cc_frozen_cache *c, const void *key,
+                              size_t key_size)
+{
+  assert(c != NULL);
+
+  const void *value = NULL;
+  return cc_frozen_cache_get(c, key, key_size, &value, NULL) ==
+         CDC_STATUS_OK;
+}
@@ -0,0 +1,412 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "ccache/gdsf.h"
+
+#include "probes.h"
+
+#include <cdcontainers/data-info.h>
+#include <cdcontainers/hash-table.h>
+
+#include <stdlib.h>
+
+#define CC_GDSF_MIN_HEAP_CAPACITY 16
+
+struct cc_gdsf_entry {
+  struct cdc_pair kv;
+  size_t size;
+  double cost;
+  size_t frequency;
+  double priority;
+  size_t index;
+};
+
+static void set_priority(struct cc_gdsf_cache *c, struct cc_gdsf_entry *entry)
+{
+  double size = entry->size ? (double)entry->size : 1.0;
+  entry->priority = c->clock + (double)entry->frequency * entry->cost / size;
+}
+
+static void heap_set(struct cc_gdsf_cache *c, size_t i,
+                     struct cc_gdsf_entry *entry)
+{
+  c->heap[i] = entry;
+  entry->index = i;
+}
+
+static void sift_up(struct cc_gdsf_cache *c, size_t i)
+{
+  struct cc_gdsf_entry *entry = c->heap[i];
+  while (i > 0) {
+    size_t parent = (i - 1) / 2;
+    if (c->heap[parent]->priority <= entry->priority) {
+      break;
+    }
+
+    heap_set(c, i, c->heap[parent]);
+    i = parent;
+  }
+
+  heap_set(c, i, entry);
+}
+
+static void sift_down(struct cc_gdsf_cache *c, size_t i)
+{
+  struct cc_gdsf_entry *entry = c->heap[i];
+  for (;;) {
+    size_t child = 2 * i + 1;
+    if (child >= c->heap_size) {
+      break;
+    }
+
+    if (child + 1 < c->heap_size &&
+        c->heap[child + 1]->priority < c->heap[child]->priority) {
+      ++child;
+    }
+
+    if (entry->priority <= c->heap[child]->priority) {
+      break;
+    }
+
+    heap_set(c, i, c->heap[child]);
+    i = child;
+  }
+
+  heap_set(c, i, entry);
+}
+
+static enum cdc_stat heap_reserve(struct cc_gdsf_cache *c, size_t count)
+{
+  if (count <= c->heap_capacity) {
+    return CDC_STATUS_OK;
+  }
+
+  size_t capacity = c->heap_capacity ? c->heap_capacity * 2
+                                     : CC_GDSF_MIN_HEAP_CAPACITY;
+  struct cc_gdsf_entry **heap = (struct cc_gdsf_entry **)realloc(
+      c->heap, capacity * sizeof(struct cc_gdsf_entry *));
+  if (!heap) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  c->heap = heap;
+  c->heap_capacity = capacity;
+  return CDC_STATUS_OK;
+}
+
+static void heap_push(struct cc_gdsf_cache *c, struct cc_gdsf_entry *entry)
+{
+  heap_set(c, c->heap_size++, entry);
+  sift_up(c, entry->index);
+}
+
+static void heap_remove(struct cc_gdsf_cache *c, struct cc_gdsf_entry *entry)
+{
+  size_t i = entry->index;
+  struct cc_gdsf_entry *last = c->heap[--c->heap_size];
+  if (last == entry) {
+    return;
+  }
+
+  heap_set(c, i, last);
+  sift_up(c, i);
+  sift_down(c, last->index);
+}
+
+static void free_entry(struct cc_gdsf_cache *c, struct cc_gdsf_entry *entry,
+                       bool remove_data)
+{
+  if (remove_data && CDC_HAS_DFREE(c->dinfo)) {
+    c->dinfo->dfree(&entry->kv);
+  }
+
+  free(entry);
+}
+
+// Unlinks the entry from the heap and the table.
+static void detach(struct cc_gdsf_cache *c, struct cc_gdsf_entry *entry)
+{
+  heap_remove(c, entry);
+  cdc_hash_table_erase(c->table, entry->kv.first);
+  c->bytes -= entry->size;
+}
+
+static void make_room(struct cc_gdsf_cache *c, size_t size)
+{
+  while (c->heap_size > 0 && c->bytes + size > c->max_bytes) {
+    struct cc_gdsf_entry *victim = c->heap[0];
+    c->clock = victim->priority;
+    CC_PROBE_EVICT(c, victim->kv.first, c->table->dinfo->hash);
+    detach(c, victim);
+    free_entry(c, victim, true /* remove_data */);
+  }
+}
+
+static enum cdc_stat insert_new(struct cc_gdsf_cache *c, void *key,
+                                void *value, bool *inserted)
+{
+  struct cc_gdsf_entry *entry =
+      (struct cc_gdsf_entry *)malloc(sizeof(struct cc_gdsf_entry));
+  if (!entry) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  entry->kv.first = key;
+  entry->kv.second = value;
+  entry->size = c->size(key, value);
+  entry->cost = c->cost ? c->cost(key, value) : 1.0;
+  if (entry->size > c->max_bytes) {
+    free(entry);
+    *inserted = false;
+    return CDC_STATUS_OUT_OF_RANGE;
+  }
+
+  enum cdc_stat stat = heap_reserve(c, c->heap_size + 1);
+  if (stat != CDC_STATUS_OK) {
+    free(entry);
+    return stat;
+  }
+
+  stat = cdc_hash_table_insert(c->table, key, entry, NULL /* it */,
+                               NULL /* inserted */);
+  if (stat != CDC_STATUS_OK) {
+    free(entry);
+    return stat;
+  }
+
+  // The new entry is not in the heap yet, so it cannot evict itself.
+  make_room(c, entry->size);
+  entry->frequency = 1;
+  set_priority(c, entry);
+  heap_push(c, entry);
+  c->bytes += entry->size;
+  CC_PROBE_INSERT(c, key);
+  *inserted = true;
+  return CDC_STATUS_OK;
+}
+
+enum cdc_stat cc_gdsf_cache_ctor(struct cc_gdsf_cache **c, size_t max_bytes,
+                                 struct cdc_data_info *info, cc_size_fn_t size,
+                                 cc_cost_fn_t cost)
+{
+  assert(c != NULL);
+  assert(info != NULL);
+  assert(size != NULL);
+  assert(max_bytes > 0);
+
+  struct cc_gdsf_cache *tmp =
+      (struct cc_gdsf_cache *)calloc(sizeof(struct cc_gdsf_cache), 1);
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  if (CDC_HAS_DFREE(info)) {
+    struct cdc_data_info entry_info = CDC_INIT_STRUCT;
+    entry_info.dfree = info->dfree;
+    tmp->dinfo = cdc_di_shared_ctorc(&entry_info);
+    if (!tmp->dinfo) {
+      free(tmp);
+      return CDC_STATUS_BAD_ALLOC;
+    }
+  }
+
+  struct cdc_data_info ht_info = CDC_INIT_STRUCT;
+  ht_info.hash = info->hash;
+  ht_info.eq = info->eq;
+  enum cdc_stat stat = cdc_hash_table_ctor(&tmp->table, &ht_info);
+  if (stat != CDC_STATUS_OK) {
+    cdc_di_shared_dtor(tmp->dinfo);
+    free(tmp);
+    return stat;
+  }
+
+  tmp->max_bytes = max_bytes;
+  tmp->size = size;
+  tmp->cost = cost;
+  *c = tmp;
+  return CDC_STATUS_OK;
+}
+
+void cc_gdsf_cache_dtor(struct cc_gdsf_cache *c)
+{
+  assert(c != NULL);
+
+  cc_gdsf_cache_clear(c);
+  cdc_hash_table_dtor(c->table);
+  cdc_di_shared_dtor(c->dinfo);
+  free(c->heap);
+  free(c);
+}
+
+enum cdc_stat cc_gdsf_cache_get(struct cc_gdsf_cache *c, void *key,
+                                void **value)
+{
+  assert(c != NULL);
+  assert(value != NULL);
+
+  struct cc_gdsf_entry *entry = NULL;
+  enum cdc_stat stat = cdc_hash_table_get(c->table, key, (void **)&entry);
+  if (stat != CDC_STATUS_OK) {
+    CC_PROBE_GET_MISS(c, key);
+    return stat;
+  }
+
+  CC_PROBE_GET_HIT(c, key);
+  ++entry->frequency;
+  set_priority(c, entry);
+  sift_down(c, entry->index);
+  *value = entry->kv.second;
+  return CDC_STATUS_OK;
+}
+
+bool cc_gdsf_cache_contains(struct cc_gdsf_cache *c, void *key)
+{
+  assert(c != NULL);
+
+  return cdc_hash_table_count(c->table, key) != 0;
+}
+
+size_t cc_gdsf_cache_size(struct cc_gdsf_cache *c)
+{
+  assert(c != NULL);
+
+  return c->heap_size;
+}
+
+bool cc_gdsf_cache_empty(struct cc_gdsf_cache *c)
+{
+  assert(c != NULL);
+
+  return c->heap_size == 0;
+}
+
+enum cdc_stat cc_gdsf_cache_insert(struct cc_gdsf_cache *c, void *key,
+                                   void *value, bool *inserted)
+{
+  assert(c != NULL);
+
+  bool is_new = false;
+  enum cdc_stat stat = CDC_STATUS_OK;
+  if (cdc_hash_table_count(c->table, key) == 0) {
+    stat = insert_new(c, key, value, &is_new);
+  }
+
+  if (inserted) {
+    *inserted = is_new;
+  }
+
+  return stat;
+}
+
+enum cdc_stat cc_gdsf_cache_insert_or_assign(struct cc_gdsf_cache *c,
+                                             void *key, void *value,
+                                             bool *inserted)
+{
+  assert(c != NULL);
+
+  struct cc_gdsf_entry *entry = NULL;
+  if (cdc_hash_table_get(c->table, key, (void **)&entry) != CDC_STATUS_OK) {
+    bool is_new = false;
+    enum cdc_stat stat = insert_new(c, key, value, &is_new);
+    if (inserted) {
+      *inserted = is_new;
+    }
+
+    return stat;
+  }
+
+  size_t size = c->size(entry->kv.first, value);
+  if (size > c->max_bytes) {
+    // The new value does not fit, so the old entry goes away.
+    detach(c, entry);
+    free_entry(c, entry, true /* remove_data */);
+    if (inserted) {
+      *inserted = false;
+    }
+
+    return CDC_STATUS_OUT_OF_RANGE;
+  }
+
+  // Try to remove old value.
+  if (CDC_HAS_DFREE(c->dinfo)) {
+    struct cdc_pair kv = {NULL, entry->kv.second};
+    c->dinfo->dfree(&kv);
+  }
+
+  // The entry keeps its frequency but has to make room for its new size.
+  heap_remove(c, entry);
+  c->bytes -= entry->size;
+  entry->kv.second = value;
+  entry->size = size;
+  entry->cost = c->cost ? c->cost(entry->kv.first, value) : 1.0;
+  make_room(c, entry->size);
+  set_priority(c, entry);
+  heap_push(c, entry);
+  c->bytes += entry->size;
+  if (inserted) {
+    *inserted = false;
+  }
+
+  return CDC_STATUS_OK;
+}
+
+void cc_gdsf_cache_erase(struct cc_gdsf_cache *c, void *key)
+{
+  assert(c != NULL);
+
+  struct cc_gdsf_entry *entry = NULL;
+  if (cdc_hash_table_get(c->table, key, (void **)&entry) != CDC_STATUS_OK) {
+    return;
+  }
+
+  CC_PROBE_ERASE(c, key);
+  detach(c, entry);
+  free_entry(c, entry, true /* remove_data */);
+}
+
+void cc_gdsf_cache_take(struct cc_gdsf_cache *c, void *key,
+                        struct cdc_pair *kv)
+{
+  assert(c != NULL);
+
+  struct cc_gdsf_entry *entry = NULL;
+  if (cdc_hash_table_get(c->table, key, (void **)&entry) != CDC_STATUS_OK) {
+    return;
+  }
+
+  *kv = entry->kv;
+  detach(c, entry);
+  free_entry(c, entry, false /* remove_data */);
+}
+
+void cc_gdsf_cache_clear(struct cc_gdsf_cache *c)
+{
+  assert(c != NULL);
+
+  CC_PROBE_CLEAR(c);
+  cdc_hash_table_clear(c->table);
+  for (size_t i = 0; i < c->heap_size; ++i) {
+    free_entry(c, c->heap[i], true /* remove_data */);
+  }
+
+  c->heap_size = 0;
+  c->bytes = 0;
+  c->clock = 0;
+}
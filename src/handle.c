@@ -0,0 +1,61 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "ccache/handle.h"
+
+#include <stdlib.h>
+
+struct cc_handle *cc_handle_new(struct cdc_pair kv, cdc_free_fn_t dfree)
+{
+  struct cc_handle *h = (struct cc_handle *)malloc(sizeof(struct cc_handle));
+  if (h) {
+    h->kv = kv;
+    h->owned.first = NULL;
+    h->owned.second = NULL;
+    h->dfree = dfree;
+    h->refs = 2;
+  }
+
+  return h;
+}
+
+void cc_handle_detach(struct cc_handle *h, struct cdc_pair owned)
+{
+  assert(h != NULL);
+
+  h->owned = owned;
+  cc_handle_release(h);
+}
+
+void cc_handle_release(struct cc_handle *h)
+{
+  assert(h != NULL);
+
+  // The last owner must see owned as written by detach.
+  if (__atomic_sub_fetch(&h->refs, 1, __ATOMIC_ACQ_REL) != 0) {
+    return;
+  }
+
+  if (h->dfree && (h->owned.first || h->owned.second)) {
+    h->dfree(&h->owned);
+  }
+
+  free(h);
+}
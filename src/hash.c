@@ -0,0 +1,261 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "ccache/hash.h"
+
+#include <cdcontainers/common.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) && !defined(CC_HASH_NO_SIMD)
+#include <emmintrin.h>
+#define CC_HASH_SSE2
+#endif
+
+#define P2 0x4b33a62ed433d4a3ull
+#define P3 0x4d5a2da51de1aa47ull
+
+// Keys longer than this go through the striped loop.
+#define LONG_KEY 512
+#define STRIPE 64
+#define LANES 8
+// Stripes between two scrambles of the accumulators.
+#define BLOCK 16
+
+static const uint64_t secret[LANES] = {
+    0xbe4ba423396cfeb8ull, 0x1cad21f72c81017cull, 0xdb979083e96dd4deull,
+    0x1f67b3b7a4a44072ull, 0x78e5c0cc4ee679cbull, 0x2172ffcc7dd05a82ull,
+    0x8e2443f7744608b8ull, 0x4c263a81e69035e0ull};
+
+static uint64_t read64(const unsigned char *p)
+{
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static uint64_t read32(const unsigned char *p)
+{
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static uint64_t read_small(const unsigned char *p, size_t size)
+{
+  return ((uint64_t)p[0] << 16) | ((uint64_t)p[size >> 1] << 8) | p[size - 1];
+}
+
+// wyhash.
+static uint64_t hash_short(const unsigned char *p, size_t size, uint64_t seed)
+{
+  uint64_t a, b;
+  seed ^= cc_hash_mum(seed ^ CC_HASH_P0, CC_HASH_P1);
+  if (size <= 16) {
+    if (size >= 4) {
+      size_t off = (size >> 3) << 2;
+      a = (read32(p) << 32) | read32(p + off);
+      b = (read32(p + size - 4) << 32) | read32(p + size - 4 - off);
+    } else if (size > 0) {
+      a = read_small(p, size);
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    size_t i = size;
+    if (i > 48) {
+      uint64_t see1 = seed, see2 = seed;
+      do {
+        seed = cc_hash_mum(read64(p) ^ CC_HASH_P1, read64(p + 8) ^ seed);
+        see1 = cc_hash_mum(read64(p + 16) ^ P2, read64(p + 24) ^ see1);
+        see2 = cc_hash_mum(read64(p + 32) ^ P3, read64(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      seed ^= see1 ^ see2;
+    }
+
+    while (i > 16) {
+      seed = cc_hash_mum(read64(p) ^ CC_HASH_P1, read64(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+
+    a = read64(p + i - 16);
+    b = read64(p + i - 8);
+  }
+
+  cc_hash_mul128(a ^ CC_HASH_P1, b ^ seed, &a, &b);
+  return cc_hash_mum(a ^ CC_HASH_P0 ^ size, b ^ CC_HASH_P1);
+}
+
+// Every lane adds the product of the low and the high half of its word mixed
+// with the secret, and the word itself to the neighbour lane, as in xxh3.
+#ifdef CC_HASH_SSE2
+static void accumulate(uint64_t *acc, const unsigned char *p, size_t stripes)
+{
+  __m128i a[LANES / 2];
+  for (size_t i = 0; i < LANES / 2; ++i) {
+    a[i] = _mm_loadu_si128((const __m128i *)(acc + 2 * i));
+  }
+
+  for (size_t s = 0; s < stripes; ++s, p += STRIPE) {
+    for (size_t i = 0; i < LANES / 2; ++i) {
+      __m128i d = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+      __m128i k = _mm_xor_si128(
+          d, _mm_loadu_si128((const __m128i *)(secret + 2 * i)));
+      __m128i hi = _mm_shuffle_epi32(k, _MM_SHUFFLE(0, 3, 0, 1));
+      __m128i swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+      a[i] = _mm_add_epi64(a[i], _mm_mul_epu32(k, hi));
+      a[i] = _mm_add_epi64(a[i], swapped);
+    }
+  }
+
+  for (size_t i = 0; i < LANES / 2; ++i) {
+    _mm_storeu_si128((__m128i *)(acc + 2 * i), a[i]);
+  }
+}
+#else
+static void accumulate(uint64_t *acc, const unsigned char *p, size_t stripes)
+{
+  for (size_t s = 0; s < stripes; ++s, p += STRIPE) {
+    for (size_t i = 0; i < LANES; ++i) {
+      uint64_t d = read64(p + 8 * i);
+      uint64_t k = d ^ secret[i];
+      acc[i ^ 1] += d;
+      acc[i] += (k & 0xffffffffull) * (k >> 32);
+    }
+  }
+}
+#endif
+
+static void scramble(uint64_t *acc)
+{
+  for (size_t i = 0; i < LANES; ++i) {
+    acc[i] = (acc[i] ^ (acc[i] >> 47) ^ secret[i]) * 0x9e3779b1ull;
+  }
+}
+
+static uint64_t hash_long(const unsigned char *p, size_t size, uint64_t seed)
+{
+  uint64_t acc[LANES];
+  for (size_t i = 0; i < LANES; ++i) {
+    acc[i] = secret[i] ^ seed;
+  }
+
+  // At least one byte is left for the tail.
+  size_t stripes = (size - 1) / STRIPE;
+  size_t tail = size - stripes * STRIPE;
+  for (; stripes >= BLOCK; stripes -= BLOCK, p += BLOCK * STRIPE) {
+    accumulate(acc, p, BLOCK);
+    scramble(acc);
+  }
+
+  accumulate(acc, p, stripes);
+  p += stripes * STRIPE;
+  uint64_t h = size * CC_HASH_P1;
+  for (size_t i = 0; i < LANES; i += 2) {
+    h = cc_hash_mum(h ^ acc[i], acc[i + 1] ^ CC_HASH_P0);
+  }
+
+  return hash_short(p, tail, h);
+}
+
+uint64_t cc_hash_bytes(const void *data, size_t size, uint64_t seed)
+{
+  assert(data != NULL || size == 0);
+
+  const unsigned char *p = (const unsigned char *)data;
+  if (size > LONG_KEY) {
+    return hash_long(p, size, seed);
+  }
+
+  return hash_short(p, size, seed);
+}
+
+size_t cc_hash_int_key(const void *key)
+{
+  return (size_t)cc_hash_u64((uint64_t)(uintptr_t)key);
+}
+
+size_t cc_hash_cstr_key(const void *key)
+{
+  assert(key != NULL);
+
+  return (size_t)cc_hash_bytes(key, strlen((const char *)key), 0);
+}
+
+int cc_eq_cstr_key(const void *l, const void *r)
+{
+  assert(l != NULL);
+  assert(r != NULL);
+
+  return strcmp((const char *)l, (const char *)r) == 0;
+}
+
+struct cc_string_key *cc_string_key_new(const void *data, size_t size)
+{
+  assert(data != NULL || size == 0);
+
+  struct cc_string_key *key =
+      (struct cc_string_key *)malloc(sizeof(struct cc_string_key) + size + 1);
+  if (!key) {
+    return NULL;
+  }
+
+  char *bytes = (char *)(key + 1);
+  if (size) {
+    memcpy(bytes, data, size);
+  }
+
+  bytes[size] = '\0';
+  key->hash = cc_hash_bytes(bytes, size, 0);
+  key->size = size;
+  key->data = bytes;
+  return key;
+}
+
+size_t cc_string_key_hash(const void *key)
+{
+  assert(key != NULL);
+
+  return (size_t)((const struct cc_string_key *)key)->hash;
+}
+
+int cc_string_key_eq(const void *l, const void *r)
+{
+  assert(l != NULL);
+  assert(r != NULL);
+
+  const struct cc_string_key *a = (const struct cc_string_key *)l;
+  const struct cc_string_key *b = (const struct cc_string_key *)r;
+  return a->hash == b->hash && a->size == b->size &&
+         (a->data == b->data || memcmp(a->data, b->data, a->size) == 0);
+}
+
+void cc_string_key_info(struct cdc_data_info *info)
+{
+  assert(info != NULL);
+
+  info->hash = cc_string_key_hash;
+  info->eq = cc_string_key_eq;
+}
@@ -0,0 +1,423 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "ccache/lfu.h"
+
+#include "list.h"
+#include "probes.h"
+
+#include <cdcontainers/data-info.h>
+#include <cdcontainers/hash-table.h>
+
+#include <stdlib.h>
+
+struct cc_lfu_bucket {
+  // The next bucket has a higher frequency.
+  struct cc_lfu_bucket *next;
+  struct cc_lfu_bucket *prev;
+  // The most recently used node is at the head.
+  struct cc_list items;
+  size_t frequency;
+};
+
+struct cc_lfu_node {
+  struct cc_list_node base;
+  struct cc_lfu_bucket *bucket;
+};
+
+// Links a new bucket after prev (or first if NULL).
+static struct cc_lfu_bucket *new_bucket(struct cc_lfu_cache *c,
+                                        struct cc_lfu_bucket *prev,
+                                        size_t frequency)
+{
+  struct cc_lfu_bucket *b =
+      (struct cc_lfu_bucket *)malloc(sizeof(struct cc_lfu_bucket));
+  if (!b) {
+    return NULL;
+  }
+
+  cc_list_init(&b->items, c->dinfo);
+  b->frequency = frequency;
+  b->prev = prev;
+  b->next = prev ? prev->next : c->head;
+  if (b->next) {
+    b->next->prev = b;
+  } else {
+    c->tail = b;
+  }
+
+  if (prev) {
+    prev->next = b;
+  } else {
+    c->head = b;
+  }
+
+  return b;
+}
+
+static void free_bucket(struct cc_lfu_cache *c, struct cc_lfu_bucket *b)
+{
+  if (b->prev) {
+    b->prev->next = b->next;
+  } else {
+    c->head = b->next;
+  }
+
+  if (b->next) {
+    b->next->prev = b->prev;
+  } else {
+    c->tail = b->prev;
+  }
+
+  free(b);
+}
+
+static void free_node(struct cc_lfu_cache *c, struct cc_lfu_node *node,
+                      bool remove_data)
+{
+  if (remove_data && CDC_HAS_DFREE(c->dinfo)) {
+    c->dinfo->dfree(&node->base.kv);
+  }
+
+  free(node);
+}
+
+static void unlink_node(struct cc_lfu_cache *c, struct cc_lfu_node *node)
+{
+  struct cc_lfu_bucket *b = node->bucket;
+  cc_list_unlink_node(&b->items, &node->base);
+  if (!b->items.head) {
+    free_bucket(c, b);
+  }
+}
+
+static void decay(struct cc_lfu_cache *c)
+{
+  struct cc_lfu_bucket *prev = NULL;
+  struct cc_lfu_bucket *b = c->head;
+  while (b) {
+    struct cc_lfu_bucket *next = b->next;
+    size_t frequency = b->frequency > 1 ? b->frequency / 2 : 1;
+    if (prev && prev->frequency == frequency) {
+      // Entries of the more frequent bucket go before the others.
+      for (struct cc_list_node *node = b->items.head; node;
+           node = node->next) {
+        ((struct cc_lfu_node *)node)->bucket = prev;
+      }
+
+      cc_list_splice_front(&prev->items, &b->items);
+      free_bucket(c, b);
+    } else {
+      b->frequency = frequency;
+      prev = b;
+    }
+
+    b = next;
+  }
+}
+
+static void count_op(struct cc_lfu_cache *c)
+{
+  if (c->decay_period != 0 && ++c->ops >= c->decay_period) {
+    c->ops = 0;
+    decay(c);
+  }
+}
+
+static void touch(struct cc_lfu_cache *c, struct cc_lfu_node *node)
+{
+  struct cc_lfu_bucket *b = node->bucket;
+  size_t frequency = b->frequency + 1;
+  struct cc_lfu_bucket *next = b->next;
+  if (!next || next->frequency != frequency) {
+    if (b->items.head == b->items.tail) {
+      // The node is alone, so the bucket can be reused.
+      b->frequency = frequency;
+      return;
+    }
+
+    next = new_bucket(c, b, frequency);
+    if (!next) {
+      // Keep the frequency and only update the recency.
+      cc_list_unlink_node(&b->items, &node->base);
+      cc_list_push_front_node(&b->items, &node->base);
+      return;
+    }
+  }
+
+  cc_list_unlink_node(&b->items, &node->base);
+  if (!b->items.head) {
+    free_bucket(c, b);
+  }
+
+  cc_list_push_front_node(&next->items, &node->base);
+  node->bucket = next;
+}
+
+static enum cdc_stat insert_new(struct cc_lfu_cache *c, void *key, void *value)
+{
+  if (cc_lfu_cache_size(c) + 1 > cc_lfu_cache_max_size(c)) {
+    struct cc_lfu_node *victim = (struct cc_lfu_node *)c->head->items.tail;
+    CC_PROBE_EVICT(c, victim->base.kv.first, c->table->dinfo->hash);
+    unlink_node(c, victim);
+    cdc_hash_table_erase(c->table, victim->base.kv.first);
+    free_node(c, victim, true /* remove_data */);
+  }
+
+  struct cc_lfu_node *node =
+      (struct cc_lfu_node *)malloc(sizeof(struct cc_lfu_node));
+  if (!node) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  node->base.kv.first = key;
+  node->base.kv.second = value;
+  struct cc_lfu_bucket *b = c->head;
+  if (!b || b->frequency != 1) {
+    b = new_bucket(c, NULL /* prev */, 1);
+    if (!b) {
+      free(node);
+      return CDC_STATUS_BAD_ALLOC;
+    }
+  }
+
+  enum cdc_stat stat = cdc_hash_table_insert(c->table, key, node, NULL /* it */,
+                                             NULL /* inserted */);
+  if (stat != CDC_STATUS_OK) {
+    if (!b->items.head) {
+      free_bucket(c, b);
+    }
+
+    free_node(c, node, true /* remove_data */);
+    return stat;
+  }
+
+  cc_list_push_front_node(&b->items, &node->base);
+  node->bucket = b;
+  CC_PROBE_INSERT(c, key);
+  return CDC_STATUS_OK;
+}
+
+enum cdc_stat cc_lfu_cache_ctor(struct cc_lfu_cache **c, size_t max_size,
+                                struct cdc_data_info *info)
+{
+  assert(c != NULL);
+  assert(info != NULL);
+  assert(max_size > 0);
+
+  struct cc_lfu_cache *tmp =
+      (struct cc_lfu_cache *)calloc(sizeof(struct cc_lfu_cache), 1);
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  if (CDC_HAS_DFREE(info)) {
+    struct cdc_data_info list_info = CDC_INIT_STRUCT;
+    list_info.dfree = info->dfree;
+    tmp->dinfo = cdc_di_shared_ctorc(&list_info);
+    if (!tmp->dinfo) {
+      free(tmp);
+      return CDC_STATUS_BAD_ALLOC;
+    }
+  }
+
+  struct cdc_data_info ht_info = CDC_INIT_STRUCT;
+  ht_info.hash = info->hash;
+  ht_info.eq = info->eq;
+  enum cdc_stat stat = cdc_hash_table_ctor(&tmp->table, &ht_info);
+  if (stat != CDC_STATUS_OK) {
+    cdc_di_shared_dtor(tmp->dinfo);
+    free(tmp);
+    return stat;
+  }
+
+  tmp->max_size = max_size;
+  *c = tmp;
+  return CDC_STATUS_OK;
+}
+
+void cc_lfu_cache_dtor(struct cc_lfu_cache *c)
+{
+  assert(c != NULL);
+
+  cc_lfu_cache_clear(c);
+  cdc_hash_table_dtor(c->table);
+  cdc_di_shared_dtor(c->dinfo);
+  free(c);
+}
+
+enum cdc_stat cc_lfu_cache_get(struct cc_lfu_cache *c, void *key, void **value)
+{
+  assert(c != NULL);
+  assert(value != NULL);
+
+  count_op(c);
+  struct cc_lfu_node *node = NULL;
+  enum cdc_stat stat = cdc_hash_table_get(c->table, key, (void **)&node);
+  if (stat != CDC_STATUS_OK) {
+    CC_PROBE_GET_MISS(c, key);
+    return stat;
+  }
+
+  CC_PROBE_GET_HIT(c, key);
+  touch(c, node);
+  *value = node->base.kv.second;
+  return CDC_STATUS_OK;
+}
+
+bool cc_lfu_cache_contains(struct cc_lfu_cache *c, void *key)
+{
+  assert(c != NULL);
+
+  return cdc_hash_table_count(c->table, key) != 0;
+}
+
+size_t cc_lfu_cache_frequency(struct cc_lfu_cache *c, void *key)
+{
+  assert(c != NULL);
+
+  struct cc_lfu_node *node = NULL;
+  if (cdc_hash_table_get(c->table, key, (void **)&node) != CDC_STATUS_OK) {
+    return 0;
+  }
+
+  return node->bucket->frequency;
+}
+
+size_t cc_lfu_cache_size(struct cc_lfu_cache *c)
+{
+  assert(c != NULL);
+
+  return cdc_hash_table_size(c->table);
+}
+
+bool cc_lfu_cache_empty(struct cc_lfu_cache *c)
+{
+  assert(c != NULL);
+
+  return cdc_hash_table_empty(c->table);
+}
+
+enum cdc_stat cc_lfu_cache_insert(struct cc_lfu_cache *c, void *key,
+                                  void *value, bool *inserted)
+{
+  assert(c != NULL);
+
+  count_op(c);
+  if (cdc_hash_table_count(c->table, key) != 0) {
+    if (inserted) {
+      *inserted = false;
+    }
+
+    return CDC_STATUS_OK;
+  }
+
+  enum cdc_stat stat = insert_new(c, key, value);
+  if (stat == CDC_STATUS_OK && inserted) {
+    *inserted = true;
+  }
+
+  return stat;
+}
+
+enum cdc_stat cc_lfu_cache_insert_or_assign(struct cc_lfu_cache *c, void *key,
+                                            void *value, bool *inserted)
+{
+  assert(c != NULL);
+
+  count_op(c);
+  struct cc_lfu_node *node = NULL;
+  if (cdc_hash_table_get(c->table, key, (void **)&node) == CDC_STATUS_OK) {
+    // Try to remove old value.
+    if (CDC_HAS_DFREE(c->dinfo)) {
+      struct cdc_pair kv = {NULL, node->base.kv.second};
+      c->dinfo->dfree(&kv);
+    }
+
+    node->base.kv.second = value;
+    touch(c, node);
+    if (inserted) {
+      *inserted = false;
+    }
+
+    return CDC_STATUS_OK;
+  }
+
+  enum cdc_stat stat = insert_new(c, key, value);
+  if (stat == CDC_STATUS_OK && inserted) {
+    *inserted = true;
+  }
+
+  return stat;
+}
+
+void cc_lfu_cache_erase(struct cc_lfu_cache *c, void *key)
+{
+  assert(c != NULL);
+
+  struct cc_lfu_node *node = NULL;
+  enum cdc_stat stat = cdc_hash_table_get(c->table, key, (void **)&node);
+  if (stat != CDC_STATUS_OK) {
+    return;
+  }
+
+  CC_PROBE_ERASE(c, key);
+  unlink_node(c, node);
+  cdc_hash_table_erase(c->table, key);
+  free_node(c, node, true /* remove_data */);
+}
+
+void cc_lfu_cache_take(struct cc_lfu_cache *c, void *key, struct cdc_pair *kv)
+{
+  assert(c != NULL);
+
+  struct cc_lfu_node *node = NULL;
+  enum cdc_stat stat = cdc_hash_table_get(c->table, key, (void **)&node);
+  if (stat != CDC_STATUS_OK) {
+    return;
+  }
+
+  *kv = node->base.kv;
+  unlink_node(c, node);
+  cdc_hash_table_erase(c->table, key);
+  free_node(c, node, false /* remove_data */);
+}
+
+void cc_lfu_cache_clear(struct cc_lfu_cache *c)
+{
+  assert(c != NULL);
+
+  CC_PROBE_CLEAR(c);
+  cdc_hash_table_clear(c->table);
+  while (c->head) {
+    cc_list_clear(&c->head->items);
+    free_bucket(c, c->head);
+  }
+
+  c->ops = 0;
+}
+
+void cc_lfu_cache_set_decay(struct cc_lfu_cache *c, size_t period)
+{
+  assert(c != NULL);
+
+  c->decay_period = period;
+  c->ops = 0;
+}
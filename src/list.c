@@ -20,8 +20,12 @@
 // IN THE SOFTWARE.
 #include "list.h"
 
+#include "memory.h"
+#include "reclaimer.h"
+
 #include <cdcontainers/data-info.h>
 
+#include <assert.h>
 #include <stdlib.h>
 
 static void cc_list_free_items(struct cc_list *l)
@@ -46,14 +50,70 @@ struct cc_list_node *cc_list_new_node(void *key, void *value)
   return node;
 }
 
+static bool is_reserved(struct cc_list *l, struct cc_list_node *node)
+{
+  return l->pool && node >= l->pool && node < l->pool + l->pool_size;
+}
+
+struct cc_list_node *cc_list_alloc_node(struct cc_list *l, void *key,
+                                        void *value)
+{
+  struct cc_list_node *node = l->free_nodes;
+  if (!node) {
+    return cc_list_new_node(key, value);
+  }
+
+  l->free_nodes = node->next;
+  node->kv.first = key;
+  node->kv.second = value;
+  return node;
+}
+
 void cc_list_free_node(struct cc_list *l, struct cc_list_node *node,
                        bool remove_data)
 {
+  bool reserved = is_reserved(l, node);
   if (remove_data && CDC_HAS_DFREE(l->dinfo)) {
-    l->dinfo->dfree(&node->kv);
+    struct cc_list_node *retired = node;
+    if (l->reclaimer && reserved) {
+      // The reclaimer frees its nodes, so it gets a copy of a reserved one.
+      retired = cc_list_new_node(node->kv.first, node->kv.second);
+    }
+
+    if (l->reclaimer && retired) {
+      cc_reclaimer_push(l->reclaimer, retired, retired);
+      if (!reserved) {
+        return;
+      }
+    } else {
+      l->dinfo->dfree(&node->kv);
+    }
+  }
+
+  if (reserved) {
+    node->next = l->free_nodes;
+    l->free_nodes = node;
+  } else {
+    free(node);
+  }
+}
+
+void cc_list_free_value(struct cc_list *l, void *value)
+{
+  if (!CDC_HAS_DFREE(l->dinfo)) {
+    return;
+  }
+
+  if (l->reclaimer) {
+    struct cc_list_node *node = cc_list_new_node(NULL, value);
+    if (node) {
+      cc_reclaimer_push(l->reclaimer, node, node);
+      return;
+    }
   }
 
-  free(node);
+  struct cdc_pair kv = {NULL, value};
+  l->dinfo->dfree(&kv);
 }
 
 enum cdc_stat cc_list_ctor(struct cc_list **l, struct cdc_data_info *info)
@@ -75,10 +135,54 @@ enum cdc_stat cc_list_ctor(struct cc_list **l, struct cdc_data_info *info)
   return CDC_STATUS_OK;
 }
 
+void cc_list_init(struct cc_list *l, struct cdc_data_info *dinfo)
+{
+  l->head = NULL;
+  l->tail = NULL;
+  l->dinfo = dinfo;
+  l->reclaimer = NULL;
+  l->pool = NULL;
+  l->pool_size = 0;
+  l->free_nodes = NULL;
+}
+
 void cc_list_dtor(struct cc_list *l)
 {
+  cc_list_set_reclaimer(l, NULL);
   cc_list_free_items(l);
   cdc_di_shared_dtor(l->dinfo);
+  free(l->pool);
+  free(l);
+}
+
+enum cdc_stat cc_list_reserve(struct cc_list *l, size_t count)
+{
+  assert(l->pool == NULL);
+  assert(l->head == NULL);
+
+  struct cc_list_node *pool =
+      (struct cc_list_node *)malloc(count * sizeof(struct cc_list_node));
+  if (!pool) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  for (size_t i = count; i > 0; --i) {
+    pool[i - 1].next = l->free_nodes;
+    l->free_nodes = pool + i - 1;
+  }
+
+  l->pool = pool;
+  l->pool_size = count;
+  return CDC_STATUS_OK;
+}
+
+void cc_list_set_reclaimer(struct cc_list *l, struct cc_reclaimer *r)
+{
+  if (l->reclaimer) {
+    cc_reclaimer_dtor(l->reclaimer);
+  }
+
+  l->reclaimer = r;
 }
 
 void cc_list_push_front_node(struct cc_list *l, struct cc_list_node *node)
@@ -123,7 +227,76 @@ void cc_list_unlink_node(struct cc_list *l, struct cc_list_node *node)
 
 void cc_list_clear(struct cc_list *l)
 {
+  if (l->reclaimer && l->head && !l->pool && CDC_HAS_DFREE(l->dinfo)) {
+    // Hands the whole list over at once.
+    cc_reclaimer_push(l->reclaimer, l->head, l->tail);
+    l->head = NULL;
+  }
+
   cc_list_free_items(l);
   l->head = NULL;
   l->tail = NULL;
 }
+
+void cc_list_splice_front(struct cc_list *dst, struct cc_list *src)
+{
+  if (!src->head) {
+    return;
+  }
+
+  if (dst->head) {
+    src->tail->next = dst->head;
+    dst->head->prev = src->tail;
+  } else {
+    dst->tail = src->tail;
+  }
+
+  dst->head = src->head;
+  src->head = NULL;
+  src->tail = NULL;
+}
+
+void cc_list_for_each(struct cc_list *l, cc_visit_fn_t fn, void *ctx)
+{
+  for (struct cc_list_node *node = l->head; node; node = node->next) {
+    if (node->next) {
+      CC_PREFETCH(node->next->next);
+    }
+
+    if (!fn(node->kv.first, node->kv.second, ctx)) {
+      return;
+    }
+  }
+}
+
+void cc_list_rfor_each(struct cc_list *l, cc_visit_fn_t fn, void *ctx)
+{
+  for (struct cc_list_node *node = l->tail; node; node = node->prev) {
+    if (node->prev) {
+      CC_PREFETCH(node->prev->prev);
+    }
+
+    if (!fn(node->kv.first, node->kv.second, ctx)) {
+      return;
+    }
+  }
+}
+
+size_t cc_list_memory_usage(struct cc_list *l, size_t count)
+{
+  size_t dinfo = l->dinfo ? cc_alloc_size(sizeof(struct cdc_data_info)) : 0;
+  if (!l->pool) {
+    return dinfo + cc_list_bytes_for(count);
+  }
+
+  // Counts the nodes beyond the reserved ones as allocated one by one.
+  size_t extra = count > l->pool_size ? count - l->pool_size : 0;
+  return dinfo + cc_list_bytes_for(extra) +
+         cc_alloc_size(l->pool_size * sizeof(struct cc_list_node));
+}
+
+size_t cc_list_bytes_for(size_t count)
+{
+  return cc_alloc_size(sizeof(struct cc_list)) +
+         cc_alloc_size(sizeof(struct cc_list_node)) * count;
+}
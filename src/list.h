@@ -23,28 +23,69 @@
 #include <cdcontainers/common.h>
 #include <cdcontainers/status.h>
 
+#include <ccache/common.h>
+
+// Maximum number of entries evicted by one insert after the cache was shrunk.
+#define CC_INSERT_EVICT_BUDGET 4
+
 struct cc_list_node {
   struct cc_list_node *next;
   struct cc_list_node *prev;
   struct cdc_pair kv;
 };
 
+struct cc_reclaimer;
+
 struct cc_list {
   struct cc_list_node *head;
   struct cc_list_node *tail;
   struct cdc_data_info *dinfo;
+  // If set, freed nodes are queued there instead of being passed to dfree.
+  struct cc_reclaimer *reclaimer;
+  // Nodes reserved in one block and the unused ones among them.
+  struct cc_list_node *pool;
+  size_t pool_size;
+  struct cc_list_node *free_nodes;
 };
 
 struct cc_list_node *cc_list_new_node(void *key, void *value);
+// Takes a node from the reserved ones or allocates a new one.
+struct cc_list_node *cc_list_alloc_node(struct cc_list *l, void *key,
+                                        void *value);
 void cc_list_free_node(struct cc_list *l, struct cc_list_node *node,
                        bool remove_data);
+// Frees a value that was replaced in a node.
+void cc_list_free_value(struct cc_list *l, void *value);
 
 enum cdc_stat cc_list_ctor(struct cc_list **l, struct cdc_data_info *info);
+// Makes l an empty list that is not owned by itself, e.g. one embedded in
+// another struct. The list borrows dinfo and must not be passed to
+// cc_list_dtor.
+void cc_list_init(struct cc_list *l, struct cdc_data_info *dinfo);
 
 void cc_list_dtor(struct cc_list *l);
 
+// Allocates count nodes in one block, which cc_list_alloc_node hands out
+// before it falls back to malloc. May be called once, on an empty list.
+enum cdc_stat cc_list_reserve(struct cc_list *l, size_t count);
+
+// Replaces the reclaimer of the list. The old one is drained and destroyed.
+// The list owns r; pass NULL to free nodes inline again.
+void cc_list_set_reclaimer(struct cc_list *l, struct cc_reclaimer *r);
+
 void cc_list_push_front_node(struct cc_list *l, struct cc_list_node *node);
 void cc_list_unlink_node(struct cc_list *l, struct cc_list_node *node);
 void cc_list_clear(struct cc_list *l);
+// Moves all nodes of src to the front of dst.
+void cc_list_splice_front(struct cc_list *dst, struct cc_list *src);
+
+// Visit the nodes from head to tail and from tail to head. The list must not
+// be modified by fn.
+void cc_list_for_each(struct cc_list *l, cc_visit_fn_t fn, void *ctx);
+void cc_list_rfor_each(struct cc_list *l, cc_visit_fn_t fn, void *ctx);
+
+// Returns the number of bytes used by the list with count nodes.
+size_t cc_list_memory_usage(struct cc_list *l, size_t count);
+size_t cc_list_bytes_for(size_t count);
 
 #endif  // CCACHE_SRC_LRU_H
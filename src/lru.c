@@ -20,24 +20,166 @@
 // IN THE SOFTWARE.
 #include "ccache/lru.h"
 
+#include "ccache/bloom.h"
+#include "ccache/common.h"
+#include "ccache/handle.h"
+#include "ccache/shards.h"
+#include "ccache/topk.h"
 #include "list.h"
+#include "memory.h"
+#include "probes.h"
+#include "reclaimer.h"
+#include "tags.h"
 
 #include <cdcontainers/data-info.h>
 #include <cdcontainers/hash-table.h>
 
+#include <stdlib.h>
+
 static void update_position(struct cc_lru_cache *c, struct cc_list_node *node)
 {
   cc_list_unlink_node(c->list, node);
   cc_list_push_front_node(c->list, node);
 }
 
+static size_t payload_size(struct cc_lru_cache *c, void *key, void *value)
+{
+  return c->payload_size ? c->payload_size(key, value) : 0;
+}
+
+// Returns false if the filter rules the key out.
+static bool may_contain(struct cc_lru_cache *c, void *key)
+{
+  return !c->filter || cc_bloom_filter_may_contain(c->filter, key);
+}
+
+// Hands the part of the pair which the cache would free over to the handle
+// of the key, if it has one. Returns false if the key has no handle.
+static bool detach_handle(struct cc_lru_cache *c, void *key,
+                          struct cdc_pair owned)
+{
+  struct cc_handle *h = NULL;
+  if (!c->handles || cdc_hash_table_empty(c->handles) ||
+      cdc_hash_table_get(c->handles, key, (void **)&h) != CDC_STATUS_OK) {
+    return false;
+  }
+
+  cdc_hash_table_erase(c->handles, key);
+  cc_handle_detach(h, owned);
+  return true;
+}
+
+// Returns true if a handle of the key is held by an acquirer. The cache
+// holds one reference of the handle itself.
+static bool is_acquired(struct cc_lru_cache *c, void *key)
+{
+  struct cc_handle *h = NULL;
+  if (!c->handles || cdc_hash_table_empty(c->handles) ||
+      cdc_hash_table_get(c->handles, key, (void **)&h) != CDC_STATUS_OK) {
+    return false;
+  }
+
+  return __atomic_load_n(&h->refs, __ATOMIC_ACQUIRE) > 1;
+}
+
+// Frees the nodes of the pinned entries, whose pairs go to the handles.
+static void detach_handles(struct cc_lru_cache *c)
+{
+  if (!c->handles || cdc_hash_table_empty(c->handles)) {
+    return;
+  }
+
+  struct cc_list_node *node = c->list->head;
+  while (node) {
+    struct cc_list_node *next = node->next;
+    if (detach_handle(c, node->kv.first, node->kv)) {
+      cc_list_unlink_node(c->list, node);
+      cc_list_free_node(c->list, node, false /* remove_data */);
+    }
+
+    node = next;
+  }
+}
+
+static void remove_node(struct cc_lru_cache *c, struct cc_list_node *node)
+{
+  void *key = node->kv.first;
+  if (c->filter) {
+    cc_bloom_filter_remove(c->filter, key);
+  }
+
+  c->payload_bytes -= payload_size(c, node->kv.first, node->kv.second);
+  cc_list_unlink_node(c->list, node);
+  cdc_hash_table_erase(c->table, key);
+  if (c->tags) {
+    cc_tag_index_remove(c->tags, key);
+  }
+
+  cc_list_free_node(c->list, node, !detach_handle(c, key, node->kv));
+}
+
+// Erases the entry of key if its tag expired after it was inserted. Returns
+// true if it did.
+static bool erase_stale(struct cc_lru_cache *c, void *key,
+                        struct cc_list_node *node)
+{
+  if (!c->tags || !cc_tag_index_is_stale(c->tags, key)) {
+    return false;
+  }
+
+  remove_node(c, node);
+  return true;
+}
+
+static size_t evict(struct cc_lru_cache *c, size_t max_size, size_t budget)
+{
+  size_t count = 0;
+  struct cc_list_node *node = c->list->tail;
+  while (count < budget && cc_lru_cache_size(c) > max_size) {
+    struct cc_list_node *prev = node->prev;
+    // Loads the next victim while this one is unlinked and freed.
+    CC_PREFETCH(prev);
+    CC_PROBE_EVICT(c, node->kv.first, c->table->dinfo->hash);
+    remove_node(c, node);
+    node = prev;
+    ++count;
+  }
+
+  return count;
+}
+
+// Returns the size down to which an insert into a full cache evicts.
+static size_t low_watermark(struct cc_lru_cache *c)
+{
+  size_t max_size = cc_lru_cache_max_size(c);
+  if (c->high_watermark == 0 || c->low_watermark >= max_size) {
+    return max_size - 1;
+  }
+
+  return c->low_watermark;
+}
+
+// Returns the size at which an insert evicts.
+static size_t high_watermark(struct cc_lru_cache *c)
+{
+  size_t max_size = cc_lru_cache_max_size(c);
+  if (c->high_watermark == 0 || c->high_watermark > max_size) {
+    return max_size;
+  }
+
+  return c->high_watermark;
+}
+
 static enum cdc_stat insert_new(struct cc_lru_cache *c, void *key, void *value)
 {
-  if (cc_lru_cache_size(c) + 1 > cc_lru_cache_max_size(c)) {
-    cc_lru_cache_erase(c, c->list->tail->kv.first);
+  // After a shrink the cache may stay above max_size for a few inserts.
+  size_t high = high_watermark(c);
+  if (cc_lru_cache_size(c) >= high) {
+    size_t low = low_watermark(c);
+    evict(c, low, high - low - 1 + CC_INSERT_EVICT_BUDGET);
   }
 
-  struct cc_list_node *node = cc_list_new_node(key, value);
+  struct cc_list_node *node = cc_list_alloc_node(c->list, key, value);
   if (!node) {
     return CDC_STATUS_BAD_ALLOC;
   }
@@ -50,6 +192,45 @@ static enum cdc_stat insert_new(struct cc_lru_cache *c, void *key, void *value)
   }
 
   cc_list_push_front_node(c->list, node);
+  c->payload_bytes += payload_size(c, key, value);
+  CC_PROBE_INSERT(c, key);
+  if (c->filter) {
+    cc_bloom_filter_add(c->filter, key);
+  }
+
+  return CDC_STATUS_OK;
+}
+
+// Stores a pair without an eviction check. A key which is already cached is
+// skipped and its pair is left to the caller, unless its entry is stale.
+static enum cdc_stat load(struct cc_lru_cache *c, void *key, void *value,
+                          bool *inserted)
+{
+  struct cc_list_node *node = NULL;
+  if (c->tags &&
+      cdc_hash_table_get(c->table, key, (void **)&node) == CDC_STATUS_OK) {
+    erase_stale(c, key, node);
+  }
+
+  node = cc_list_alloc_node(c->list, key, value);
+  if (!node) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  enum cdc_stat stat =
+      cdc_hash_table_insert(c->table, key, node, NULL /* it */, inserted);
+  if (stat != CDC_STATUS_OK || !*inserted) {
+    cc_list_free_node(c->list, node, false /* remove_data */);
+    return stat;
+  }
+
+  cc_list_push_front_node(c->list, node);
+  c->payload_bytes += payload_size(c, key, value);
+  CC_PROBE_INSERT(c, key);
+  if (c->filter) {
+    cc_bloom_filter_add(c->filter, key);
+  }
+
   return CDC_STATUS_OK;
 }
 
@@ -88,6 +269,15 @@ enum cdc_stat cc_lru_cache_ctor(struct cc_lru_cache **c, size_t max_size,
   }
 
   tmp->max_size = max_size;
+  tmp->payload_size = NULL;
+  tmp->payload_bytes = 0;
+  tmp->shards = NULL;
+  tmp->top_keys = NULL;
+  tmp->filter = NULL;
+  tmp->low_watermark = 0;
+  tmp->high_watermark = 0;
+  tmp->handles = NULL;
+  tmp->tags = NULL;
   *c = tmp;
   return CDC_STATUS_OK;
 
@@ -98,10 +288,47 @@ free_cache:
   return stat;
 }
 
+enum cdc_stat cc_lru_cache_ctor1(struct cc_lru_cache **c, size_t max_size,
+                                 struct cdc_data_info *info, bool reserve)
+{
+  assert(c != NULL);
+
+  struct cc_lru_cache *tmp = NULL;
+  enum cdc_stat stat = cc_lru_cache_ctor(&tmp, max_size, info);
+  if (stat != CDC_STATUS_OK) {
+    return stat;
+  }
+
+  if (reserve) {
+    stat = cdc_hash_table_reserve(tmp->table, max_size);
+    if (stat == CDC_STATUS_OK) {
+      stat = cc_list_reserve(tmp->list, max_size);
+    }
+
+    if (stat != CDC_STATUS_OK) {
+      cc_lru_cache_dtor(tmp);
+      return stat;
+    }
+  }
+
+  *c = tmp;
+  return CDC_STATUS_OK;
+}
+
 void cc_lru_cache_dtor(struct cc_lru_cache *c)
 {
   assert(c != NULL);
 
+  cc_lru_cache_disable_filter(c);
+  detach_handles(c);
+  if (c->handles) {
+    cdc_hash_table_dtor(c->handles);
+  }
+
+  if (c->tags) {
+    cc_tag_index_dtor(c->tags);
+  }
+
   cdc_hash_table_dtor(c->table);
   cc_list_dtor(c->list);
   free(c);
@@ -112,12 +339,23 @@ enum cdc_stat cc_lru_cache_get(struct cc_lru_cache *c, void *key, void **value)
   assert(c != NULL);
   assert(value != NULL);
 
+  if (c->shards) {
+    cc_shards_access(c->shards, key);
+  }
+
+  if (c->top_keys) {
+    cc_top_keys_add(c->top_keys, key);
+  }
+
   struct cc_list_node *node = NULL;
-  enum cdc_stat stat = cdc_hash_table_get(c->table, key, (void **)&node);
-  if (stat != CDC_STATUS_OK) {
-    return stat;
+  if (!may_contain(c, key) ||
+      cdc_hash_table_get(c->table, key, (void **)&node) != CDC_STATUS_OK ||
+      erase_stale(c, key, node)) {
+    CC_PROBE_GET_MISS(c, key);
+    return CDC_STATUS_NOT_FOUND;
   }
 
+  CC_PROBE_GET_HIT(c, key);
   update_position(c, node);
   *value = node->kv.second;
   return CDC_STATUS_OK;
@@ -127,9 +365,13 @@ bool cc_lru_cache_contains(struct cc_lru_cache *c, void *key)
 {
   assert(c != NULL);
 
+  if (!may_contain(c, key)) {
+    return false;
+  }
+
   struct cc_list_node *node = NULL;
   enum cdc_stat stat = cdc_hash_table_get(c->table, key, (void **)&node);
-  if (stat == CDC_STATUS_NOT_FOUND) {
+  if (stat == CDC_STATUS_NOT_FOUND || erase_stale(c, key, node)) {
     return false;
   }
 
@@ -137,6 +379,165 @@ bool cc_lru_cache_contains(struct cc_lru_cache *c, void *key)
   return true;
 }
 
+enum cdc_stat cc_lru_cache_acquire(struct cc_lru_cache *c, void *key,
+                                   struct cc_handle **h)
+{
+  assert(c != NULL);
+  assert(h != NULL);
+
+  void *value = NULL;
+  enum cdc_stat stat = cc_lru_cache_get(c, key, &value);
+  if (stat != CDC_STATUS_OK) {
+    return stat;
+  }
+
+  // A hit moves the node to the front.
+  struct cc_list_node *node = c->list->head;
+  if (!c->handles) {
+    struct cdc_data_info info = CDC_INIT_STRUCT;
+    info.hash = c->table->dinfo->hash;
+    info.eq = c->table->dinfo->eq;
+    stat = cdc_hash_table_ctor(&c->handles, &info);
+    if (stat != CDC_STATUS_OK) {
+      c->handles = NULL;
+      return stat;
+    }
+  }
+
+  struct cc_handle *tmp = NULL;
+  if (cdc_hash_table_get(c->handles, key, (void **)&tmp) == CDC_STATUS_OK) {
+    cc_handle_retain(tmp);
+    *h = tmp;
+    return CDC_STATUS_OK;
+  }
+
+  tmp = cc_handle_new(node->kv, c->list->dinfo ? c->list->dinfo->dfree : NULL);
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  stat = cdc_hash_table_insert(c->handles, key, tmp, NULL /* it */,
+                               NULL /* inserted */);
+  if (stat != CDC_STATUS_OK) {
+    free(tmp);
+    return stat;
+  }
+
+  *h = tmp;
+  return CDC_STATUS_OK;
+}
+
+enum cdc_stat cc_lru_cache_enable_filter(struct cc_lru_cache *c)
+{
+  assert(c != NULL);
+
+  size_t capacity = cc_lru_cache_max_size(c);
+  if (capacity < cc_lru_cache_size(c)) {
+    capacity = cc_lru_cache_size(c);
+  }
+
+  struct cc_bloom_filter *filter = NULL;
+  enum cdc_stat stat =
+      cc_bloom_filter_ctor(&filter, capacity, c->table->dinfo->hash);
+  if (stat != CDC_STATUS_OK) {
+    return stat;
+  }
+
+  for (struct cc_list_node *node = c->list->head; node; node = node->next) {
+    cc_bloom_filter_add(filter, node->kv.first);
+  }
+
+  cc_lru_cache_disable_filter(c);
+  c->filter = filter;
+  return CDC_STATUS_OK;
+}
+
+void cc_lru_cache_disable_filter(struct cc_lru_cache *c)
+{
+  assert(c != NULL);
+
+  if (c->filter) {
+    cc_bloom_filter_dtor(c->filter);
+    c->filter = NULL;
+  }
+}
+
+enum cdc_stat cc_lru_cache_enable_reclaimer(struct cc_lru_cache *c,
+                                            bool background)
+{
+  assert(c != NULL);
+
+  struct cc_reclaimer *r = NULL;
+  enum cdc_stat stat = cc_reclaimer_ctor(&r, c->list->dinfo, background);
+  if (stat != CDC_STATUS_OK) {
+    return stat;
+  }
+
+  cc_list_set_reclaimer(c->list, r);
+  return CDC_STATUS_OK;
+}
+
+void cc_lru_cache_disable_reclaimer(struct cc_lru_cache *c)
+{
+  assert(c != NULL);
+
+  cc_list_set_reclaimer(c->list, NULL);
+}
+
+size_t cc_lru_cache_reclaim(struct cc_lru_cache *c, size_t budget)
+{
+  assert(c != NULL);
+
+  if (!c->list->reclaimer) {
+    return 0;
+  }
+
+  return cc_reclaimer_reclaim(c->list->reclaimer, budget);
+}
+
+void cc_lru_cache_set_max_size(struct cc_lru_cache *c, size_t max_size)
+{
+  assert(c != NULL);
+  assert(max_size > 0);
+
+  c->max_size = max_size;
+}
+
+size_t cc_lru_cache_trim(struct cc_lru_cache *c, size_t budget)
+{
+  assert(c != NULL);
+
+  return evict(c, cc_lru_cache_max_size(c), budget);
+}
+
+void cc_lru_cache_set_watermarks(struct cc_lru_cache *c, size_t low,
+                                 size_t high)
+{
+  assert(c != NULL);
+  assert(high == 0 || (low < high && high <= cc_lru_cache_max_size(c)));
+
+  c->low_watermark = low;
+  c->high_watermark = high;
+}
+
+size_t cc_lru_cache_maintain(struct cc_lru_cache *c)
+{
+  assert(c != NULL);
+
+  if (c->high_watermark == 0 || cc_lru_cache_size(c) < c->high_watermark) {
+    return 0;
+  }
+
+  return evict(c, low_watermark(c), cc_lru_cache_size(c));
+}
+
+enum cdc_stat cc_lru_cache_reserve(struct cc_lru_cache *c, size_t count)
+{
+  assert(c != NULL);
+
+  return cdc_hash_table_reserve(c->table, count);
+}
+
 size_t cc_lru_cache_size(struct cc_lru_cache *c)
 {
   assert(c != NULL);
@@ -156,7 +557,14 @@ enum cdc_stat cc_lru_cache_insert(struct cc_lru_cache *c, void *key,
 {
   assert(c != NULL);
 
-  if (cdc_hash_table_count(c->table, key) != 0) {
+  if (c->top_keys) {
+    cc_top_keys_add(c->top_keys, key);
+  }
+
+  struct cc_list_node *node = NULL;
+  if (may_contain(c, key) &&
+      cdc_hash_table_get(c->table, key, (void **)&node) == CDC_STATUS_OK &&
+      !erase_stale(c, key, node)) {
     if (inserted) {
       *inserted = false;
     }
@@ -175,12 +583,22 @@ enum cdc_stat cc_lru_cache_insert(struct cc_lru_cache *c, void *key,
 enum cdc_stat cc_lru_cache_insert_or_assign(struct cc_lru_cache *c, void *key,
                                             void *value, bool *inserted)
 {
+  assert(c != NULL);
+
+  if (c->top_keys) {
+    cc_top_keys_add(c->top_keys, key);
+  }
+
   struct cc_list_node *node = NULL;
-  if (cdc_hash_table_get(c->table, key, (void **)&node) == CDC_STATUS_OK) {
-    // Try to remove old value.
-    if (CDC_HAS_DFREE(c->list->dinfo)) {
-      struct cdc_pair kv = {NULL, node->kv.second};
-      c->list->dinfo->dfree(&kv);
+  if (may_contain(c, key) &&
+      cdc_hash_table_get(c->table, key, (void **)&node) == CDC_STATUS_OK &&
+      !erase_stale(c, key, node)) {
+    c->payload_bytes -= payload_size(c, node->kv.first, node->kv.second);
+    c->payload_bytes += payload_size(c, node->kv.first, value);
+    struct cdc_pair old = {NULL, node->kv.second};
+    if (!detach_handle(c, key, old)) {
+      // Try to remove old value.
+      cc_list_free_value(c->list, node->kv.second);
     }
 
     node->kv.second = value;
@@ -200,32 +618,138 @@ enum cdc_stat cc_lru_cache_insert_or_assign(struct cc_lru_cache *c, void *key,
   return stat;
 }
 
+enum cdc_stat cc_lru_cache_bulk_load(struct cc_lru_cache *c, void **keys,
+                                     void **values, size_t n, size_t *loaded)
+{
+  assert(c != NULL);
+  assert(n == 0 || (keys != NULL && values != NULL));
+
+  size_t size = cc_lru_cache_size(c);
+  size_t max_size = cc_lru_cache_max_size(c);
+  size_t room = size < max_size ? max_size - size : 0;
+  enum cdc_stat stat =
+      cdc_hash_table_reserve(c->table, size + (n < room ? n : room));
+  size_t count = 0;
+  for (size_t i = 0; stat == CDC_STATUS_OK && i < n; ++i) {
+    bool inserted = false;
+    stat = load(c, keys[i], values[i], &inserted);
+    // Nothing is evicted until the free capacity is used up.
+    if (inserted && ++count > room) {
+      evict(c, max_size, CC_INSERT_EVICT_BUDGET);
+    }
+  }
+
+  if (loaded) {
+    *loaded = count;
+  }
+
+  return stat;
+}
+
+enum cdc_stat cc_lru_cache_insert_tagged(struct cc_lru_cache *c, void *key,
+                                         void *value, void *tag,
+                                         bool *inserted)
+{
+  assert(c != NULL);
+
+  if (!c->tags) {
+    enum cdc_stat stat = cc_tag_index_ctor(&c->tags, c->table->dinfo);
+    if (stat != CDC_STATUS_OK) {
+      c->tags = NULL;
+      return stat;
+    }
+  }
+
+  bool is_inserted = false;
+  enum cdc_stat stat = cc_lru_cache_insert(c, key, value, &is_inserted);
+  if (stat == CDC_STATUS_OK && is_inserted) {
+    stat = cc_tag_index_add(c->tags, key, tag);
+    if (stat != CDC_STATUS_OK) {
+      struct cdc_pair kv;
+      cc_lru_cache_take(c, key, &kv);
+      is_inserted = false;
+    }
+  }
+
+  if (inserted) {
+    *inserted = is_inserted;
+  }
+
+  return stat;
+}
+
+size_t cc_lru_cache_invalidate_tag(struct cc_lru_cache *c, void *tag)
+{
+  assert(c != NULL);
+
+  if (!c->tags) {
+    return 0;
+  }
+
+  // Every erase drops one key of the tag and the last one drops the tag.
+  size_t count = cc_tag_index_count(c->tags, tag);
+  for (size_t i = 0; i < count; ++i) {
+    cc_lru_cache_erase(c, cc_tag_index_any(c->tags, tag));
+  }
+
+  return count;
+}
+
+void cc_lru_cache_expire_tag(struct cc_lru_cache *c, void *tag)
+{
+  assert(c != NULL);
+
+  if (c->tags) {
+    cc_tag_index_expire(c->tags, tag);
+  }
+}
+
 void cc_lru_cache_erase(struct cc_lru_cache *c, void *key)
 {
   assert(c != NULL);
 
+  if (!may_contain(c, key)) {
+    return;
+  }
+
   struct cc_list_node *node = NULL;
   enum cdc_stat stat = cdc_hash_table_get(c->table, key, (void **)&node);
   if (stat != CDC_STATUS_OK) {
     return;
   }
 
-  cc_list_unlink_node(c->list, node);
-  cdc_hash_table_erase(c->table, key);
-  cc_list_free_node(c->list, node, true /* remove_data */);
+  CC_PROBE_ERASE(c, key);
+  remove_node(c, node);
 }
 
 void cc_lru_cache_take(struct cc_lru_cache *c, void *key, struct cdc_pair *kv)
 {
   assert(c != NULL);
 
+  if (!may_contain(c, key)) {
+    return;
+  }
+
   struct cc_list_node *node = NULL;
   enum cdc_stat stat = cdc_hash_table_get(c->table, key, (void **)&node);
-  if (stat != CDC_STATUS_OK) {
+  // The taker could free the value under the acquirers of the entry.
+  if (stat != CDC_STATUS_OK || erase_stale(c, key, node) ||
+      is_acquired(c, key)) {
     return;
   }
 
+  if (c->filter) {
+    cc_bloom_filter_remove(c->filter, key);
+  }
+
   *kv = node->kv;
+  struct cdc_pair none = {NULL, NULL};
+  detach_handle(c, key, none);
+  if (c->tags) {
+    cc_tag_index_remove(c->tags, key);
+  }
+
+  c->payload_bytes -= payload_size(c, node->kv.first, node->kv.second);
   cc_list_unlink_node(c->list, node);
   cdc_hash_table_erase(c->table, key);
   cc_list_free_node(c->list, node, false /* remove_data */);
@@ -235,6 +759,139 @@ void cc_lru_cache_clear(struct cc_lru_cache *c)
 {
   assert(c != NULL);
 
+  CC_PROBE_CLEAR(c);
+  detach_handles(c);
+  if (c->tags) {
+    cc_tag_index_clear(c->tags);
+  }
+
   cdc_hash_table_clear(c->table);
   cc_list_clear(c->list);
+  c->payload_bytes = 0;
+  if (c->filter) {
+    cc_bloom_filter_clear(c->filter);
+  }
+}
+
+void cc_lru_cache_set_payload_size(struct cc_lru_cache *c, cc_size_fn_t fn)
+{
+  assert(c != NULL);
+
+  c->payload_size = fn;
+  c->payload_bytes = 0;
+  for (struct cc_list_node *node = c->list->head; node; node = node->next) {
+    c->payload_bytes += payload_size(c, node->kv.first, node->kv.second);
+  }
+}
+
+struct cc_memory_usage cc_lru_cache_memory_usage(struct cc_lru_cache *c)
+{
+  assert(c != NULL);
+
+  struct cc_memory_usage usage;
+  usage.metadata = cc_alloc_size(sizeof(struct cc_lru_cache)) +
+                   cc_list_memory_usage(c->list, cc_lru_cache_size(c)) +
+                   cc_hash_table_memory_usage(c->table) +
+                   cc_bloom_filter_memory_usage(c->filter) +
+                   cc_tag_index_memory_usage(c->tags);
+  if (c->handles) {
+    usage.metadata += cc_hash_table_memory_usage(c->handles) +
+                      cc_alloc_size(sizeof(struct cc_handle)) *
+                          cdc_hash_table_size(c->handles);
+  }
+
+  usage.payload = c->payload_bytes;
+  return usage;
+}
+
+size_t cc_lru_cache_bytes_for(size_t max_size)
+{
+  return cc_alloc_size(sizeof(struct cc_lru_cache)) +
+         cc_list_bytes_for(max_size) + cc_hash_table_bytes_for(max_size);
+}
+
+void cc_lru_cache_set_shards(struct cc_lru_cache *c, struct cc_shards *s)
+{
+  assert(c != NULL);
+
+  c->shards = s;
+}
+
+void cc_lru_cache_begin(struct cc_lru_cache *c, struct cc_lru_cache_iter *it)
+{
+  assert(c != NULL);
+  assert(it != NULL);
+
+  it->current = c->list->head;
+}
+
+void cc_lru_cache_rbegin(struct cc_lru_cache *c, struct cc_lru_cache_iter *it)
+{
+  assert(c != NULL);
+  assert(it != NULL);
+
+  it->current = c->list->tail;
+}
+
+void cc_lru_cache_for_each(struct cc_lru_cache *c, cc_visit_fn_t fn, void *ctx)
+{
+  assert(c != NULL);
+  assert(fn != NULL);
+
+  cc_list_for_each(c->list, fn, ctx);
+}
+
+void cc_lru_cache_rfor_each(struct cc_lru_cache *c, cc_visit_fn_t fn,
+                           void *ctx)
+{
+  assert(c != NULL);
+  assert(fn != NULL);
+
+  cc_list_rfor_each(c->list, fn, ctx);
+}
+
+void cc_lru_cache_iter_next(struct cc_lru_cache_iter *it)
+{
+  assert(it != NULL);
+  assert(it->current != NULL);
+
+  it->current = it->current->next;
+}
+
+void cc_lru_cache_iter_prev(struct cc_lru_cache_iter *it)
+{
+  assert(it != NULL);
+  assert(it->current != NULL);
+
+  it->current = it->current->prev;
+}
+
+void *cc_lru_cache_iter_key(struct cc_lru_cache_iter *it)
+{
+  assert(it != NULL);
+  assert(it->current != NULL);
+
+  return it->current->kv.first;
+}
+
+void *cc_lru_cache_iter_value(struct cc_lru_cache_iter *it)
+{
+  assert(it != NULL);
+  assert(it->current != NULL);
+
+  return it->current->kv.second;
+}
+
+void cc_lru_cache_set_top_keys(struct cc_lru_cache *c, struct cc_top_keys *t)
+{
+  assert(c != NULL);
+
+  c->top_keys = t;
+}
+
+size_t cc_lru_cache_top_keys(struct cc_lru_cache *c, size_t k, void **keys)
+{
+  assert(c != NULL);
+
+  return c->top_keys ? cc_top_keys_get(c->top_keys, k, keys, NULL) : 0;
 }
@@ -0,0 +1,81 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "memory.h"
+
+#include "ccache/bloom.h"
+#include "tags.h"
+
+#include <cdcontainers/data-info.h>
+#include <cdcontainers/hash-table.h>
+
+#define CC_ALLOC_ALIGNMENT 16
+#define CC_ALLOC_MIN_CHUNK 32
+
+size_t cc_alloc_size(size_t size)
+{
+  size_t chunk = (size + sizeof(size_t) + CC_ALLOC_ALIGNMENT - 1) &
+                 ~(size_t)(CC_ALLOC_ALIGNMENT - 1);
+  return chunk < CC_ALLOC_MIN_CHUNK ? CC_ALLOC_MIN_CHUNK : chunk;
+}
+
+size_t cc_hash_table_memory_usage(struct cdc_hash_table *t)
+{
+  return cc_alloc_size(sizeof(struct cdc_hash_table)) +
+         cc_alloc_size(sizeof(struct cdc_data_info)) +
+         cc_alloc_size(sizeof(struct cdc_hash_table_entry *) *
+                       cdc_hash_table_bucket_count(t)) +
+         cc_alloc_size(sizeof(struct cdc_hash_table_entry)) *
+             cdc_hash_table_size(t);
+}
+
+size_t cc_hash_table_bytes_for(size_t count)
+{
+  // The table keeps the load factor at or below one.
+  return cc_alloc_size(sizeof(struct cdc_hash_table)) +
+         cc_alloc_size(sizeof(struct cdc_data_info)) +
+         cc_alloc_size(sizeof(struct cdc_hash_table_entry *) * count) +
+         cc_alloc_size(sizeof(struct cdc_hash_table_entry)) * count;
+}
+
+size_t cc_bloom_filter_memory_usage(struct cc_bloom_filter *f)
+{
+  if (!f) {
+    return 0;
+  }
+
+  // The blocks are aligned to a cache line, which may cost up to one more.
+  return cc_alloc_size(sizeof(struct cc_bloom_filter)) +
+         cc_alloc_size(f->block_count * 8 * sizeof(uint64_t) + 64);
+}
+
+size_t cc_tag_index_memory_usage(struct cc_tag_index *t)
+{
+  if (!t) {
+    return 0;
+  }
+
+  return cc_alloc_size(sizeof(struct cc_tag_index)) +
+         cc_hash_table_memory_usage(t->tags) +
+         cc_alloc_size(sizeof(struct cc_tag)) * cdc_hash_table_size(t->tags) +
+         cc_hash_table_memory_usage(t->links) +
+         cc_alloc_size(sizeof(struct cc_tag_link)) *
+             cdc_hash_table_size(t->links);
+}
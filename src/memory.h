@@ -0,0 +1,44 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_SRC_MEMORY_H
+#define CCACHE_SRC_MEMORY_H
+#include <stddef.h>
+
+struct cc_bloom_filter;
+struct cc_tag_index;
+struct cdc_hash_table;
+
+// Returns the number of bytes malloc reserves for a request of size bytes.
+// The model follows glibc: a size_t header, 16 byte alignment and a 32 byte
+// minimum chunk.
+size_t cc_alloc_size(size_t size);
+
+// Returns the number of bytes used by the hash table and its entries.
+size_t cc_hash_table_memory_usage(struct cdc_hash_table *t);
+// Returns the number of bytes a hash table with count entries needs.
+size_t cc_hash_table_bytes_for(size_t count);
+// Returns the number of bytes used by the filter or zero if f is NULL.
+size_t cc_bloom_filter_memory_usage(struct cc_bloom_filter *f);
+// Returns the number of bytes used by the index, its tags and links or zero
+// if t is NULL.
+size_t cc_tag_index_memory_usage(struct cc_tag_index *t);
+
+#endif  // CCACHE_SRC_MEMORY_H
@@ -0,0 +1,337 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "ccache/near.h"
+
+#include "mix.h"
+
+#include <cdcontainers/data-info.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+// A pair removed from the shared cache, waiting for the readers to leave.
+struct cc_shared_retired {
+  struct cc_epoch_entry entry;
+  struct cdc_pair kv;
+};
+
+// The shared cache whose mutex the thread holds. The dfree of the wrapped
+// cache has no context of its own, and it is only called under the mutex.
+static __thread struct cc_shared_cache *locked_cache;
+// Set while cc_near_cache_insert_or_assign replaces the value of a cached
+// key. The old value comes without its key and the writer bumps the stamp.
+static __thread bool replacing;
+
+static uint64_t *stamp_of(struct cc_shared_cache *s, size_t hash)
+{
+  return s->stamps + (hash & s->stamp_mask);
+}
+
+static void bump(struct cc_shared_cache *s, void *key)
+{
+  __atomic_add_fetch(stamp_of(s, s->hash(key)), 1, __ATOMIC_RELEASE);
+}
+
+static void free_retired(struct cc_epoch_entry *entry, void *ctx)
+{
+  struct cc_shared_cache *s = (struct cc_shared_cache *)ctx;
+  struct cc_shared_retired *r = (struct cc_shared_retired *)entry;
+  s->dfree(&r->kv);
+  free(r);
+}
+
+static void bump_all(struct cc_shared_cache *s)
+{
+  __atomic_add_fetch(&s->generation, 1, __ATOMIC_RELEASE);
+}
+
+static void retire(void *data)
+{
+  struct cc_shared_cache *s = locked_cache;
+  struct cdc_pair *kv = (struct cdc_pair *)data;
+  // A NULL key may be a key itself, e.g. CDC_FROM_INT(0), so it tells
+  // nothing about the kind of the removal.
+  if (replacing && !kv->first) {
+    replacing = false;
+  } else if (kv->first) {
+    bump(s, kv->first);
+  } else {
+    bump_all(s);
+  }
+
+  if (!s->dfree) {
+    return;
+  }
+
+  struct cc_shared_retired *r =
+      (struct cc_shared_retired *)malloc(sizeof(struct cc_shared_retired));
+  if (!r) {
+    // Leaking the pair is better than freeing it under a reader.
+    return;
+  }
+
+  r->kv = *kv;
+  cc_epoch_retire(s->epoch, &r->entry, free_retired, s);
+}
+
+static void lock(struct cc_shared_cache *s)
+{
+  pthread_mutex_lock(&s->mutex);
+  locked_cache = s;
+}
+
+static void unlock(struct cc_shared_cache *s)
+{
+  cc_epoch_collect(s->epoch);
+  locked_cache = NULL;
+  pthread_mutex_unlock(&s->mutex);
+}
+
+enum cdc_stat cc_shared_cache_ctor(struct cc_shared_cache **s,
+                                   const struct cc_cache_config *config)
+{
+  assert(s != NULL);
+  assert(config != NULL);
+  assert(config->info != NULL);
+  assert(config->info->hash != NULL);
+  assert(config->info->eq != NULL);
+
+  struct cc_shared_cache *tmp =
+      (struct cc_shared_cache *)calloc(sizeof(struct cc_shared_cache), 1);
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  size_t stamp_count = 64;
+  while (stamp_count < config->max_size) {
+    stamp_count <<= 1;
+  }
+
+  enum cdc_stat stat = CDC_STATUS_BAD_ALLOC;
+  tmp->stamps = (uint64_t *)calloc(stamp_count, sizeof(uint64_t));
+  if (!tmp->stamps) {
+    goto free_cache;
+  }
+
+  stat = cc_epoch_ctor(&tmp->epoch);
+  if (stat != CDC_STATUS_OK) {
+    goto free_stamps;
+  }
+
+  if (pthread_mutex_init(&tmp->mutex, NULL) != 0) {
+    stat = CDC_STATUS_UNKNOWN_ERROR;
+    goto free_epoch;
+  }
+
+  // The hook is installed even without dfree, as it also invalidates the
+  // near copies.
+  struct cdc_data_info info = *config->info;
+  info.dfree = retire;
+
+  struct cc_cache_config shared_config = *config;
+  shared_config.info = &info;
+  stat = cc_cache_ctor(&tmp->cache, &shared_config);
+  if (stat != CDC_STATUS_OK) {
+    goto free_mutex;
+  }
+
+  tmp->dfree = config->info->dfree;
+  tmp->hash = config->info->hash;
+  tmp->eq = config->info->eq;
+  tmp->stamp_mask = stamp_count - 1;
+  *s = tmp;
+  return CDC_STATUS_OK;
+
+free_mutex:
+  pthread_mutex_destroy(&tmp->mutex);
+free_epoch:
+  cc_epoch_dtor(tmp->epoch);
+free_stamps:
+  free(tmp->stamps);
+free_cache:
+  free(tmp);
+  return stat;
+}
+
+void cc_shared_cache_dtor(struct cc_shared_cache *s)
+{
+  assert(s != NULL);
+
+  lock(s);
+  cc_cache_dtor(s->cache);
+  unlock(s);
+  // Frees the pairs retired by the cache.
+  cc_epoch_dtor(s->epoch);
+  pthread_mutex_destroy(&s->mutex);
+  free(s->stamps);
+  free(s);
+}
+
+enum cdc_stat cc_near_cache_ctor(struct cc_near_cache **c,
+                                 struct cc_shared_cache *s, size_t sets)
+{
+  assert(c != NULL);
+  assert(s != NULL);
+  assert(sets > 0);
+
+  struct cc_near_cache *tmp =
+      (struct cc_near_cache *)calloc(sizeof(struct cc_near_cache), 1);
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  size_t set_count = 1;
+  while (set_count < sets) {
+    set_count <<= 1;
+  }
+
+  tmp->ways =
+      (struct cc_near_way *)calloc(2 * set_count, sizeof(struct cc_near_way));
+  if (!tmp->ways) {
+    free(tmp);
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  enum cdc_stat stat = cc_epoch_register(s->epoch, &tmp->record);
+  if (stat != CDC_STATUS_OK) {
+    free(tmp->ways);
+    free(tmp);
+    return stat;
+  }
+
+  tmp->shared = s;
+  tmp->set_mask = set_count - 1;
+  *c = tmp;
+  return CDC_STATUS_OK;
+}
+
+void cc_near_cache_dtor(struct cc_near_cache *c)
+{
+  assert(c != NULL);
+
+  cc_epoch_unregister(c->record);
+  free(c->ways);
+  free(c);
+}
+
+enum cdc_stat cc_near_cache_get(struct cc_near_cache *c, void *key,
+                                void **value)
+{
+  assert(c != NULL);
+  assert(value != NULL);
+  assert(cc_epoch_active(c->record));
+
+  struct cc_shared_cache *s = c->shared;
+  size_t hash = s->hash(key);
+  struct cc_near_way *set =
+      c->ways + 2 * ((size_t)cc_mix64(hash) & c->set_mask);
+  uint64_t generation = __atomic_load_n(&s->generation, __ATOMIC_ACQUIRE);
+  uint64_t stamp = __atomic_load_n(stamp_of(s, hash), __ATOMIC_ACQUIRE);
+  for (size_t i = 0; i < 2; ++i) {
+    struct cc_near_way *way = set + i;
+    // A copy with the current stamp was not removed before the reader
+    // entered, so its key may still be compared.
+    if (way->used && way->hash == hash && way->stamp == stamp &&
+        way->generation == generation && s->eq(way->key, key)) {
+      if (i == 1) {
+        struct cc_near_way tmp = set[0];
+        set[0] = set[1];
+        set[1] = tmp;
+      }
+
+      ++c->hits;
+      *value = set[0].value;
+      return CDC_STATUS_OK;
+    }
+  }
+
+  ++c->misses;
+  lock(s);
+  enum cdc_stat stat = cc_cache_get(s->cache, key, value);
+  generation = s->generation;
+  stamp = *stamp_of(s, hash);
+  unlock(s);
+  if (stat != CDC_STATUS_OK) {
+    return stat;
+  }
+
+  set[1] = set[0];
+  set[0].key = key;
+  set[0].value = *value;
+  set[0].hash = hash;
+  set[0].stamp = stamp;
+  set[0].generation = generation;
+  set[0].used = true;
+  return CDC_STATUS_OK;
+}
+
+enum cdc_stat cc_near_cache_insert(struct cc_near_cache *c, void *key,
+                                   void *value, bool *inserted)
+{
+  assert(c != NULL);
+
+  struct cc_shared_cache *s = c->shared;
+  lock(s);
+  enum cdc_stat stat = cc_cache_insert(s->cache, key, value, inserted);
+  unlock(s);
+  return stat;
+}
+
+enum cdc_stat cc_near_cache_insert_or_assign(struct cc_near_cache *c,
+                                             void *key, void *value,
+                                             bool *inserted)
+{
+  assert(c != NULL);
+
+  struct cc_shared_cache *s = c->shared;
+  lock(s);
+  // Policies do not evict when they replace a value.
+  replacing = cc_cache_contains(s->cache, key);
+  enum cdc_stat stat =
+      cc_cache_insert_or_assign(s->cache, key, value, inserted);
+  replacing = false;
+  bump(s, key);
+  unlock(s);
+  return stat;
+}
+
+void cc_near_cache_erase(struct cc_near_cache *c, void *key)
+{
+  assert(c != NULL);
+
+  struct cc_shared_cache *s = c->shared;
+  lock(s);
+  bump(s, key);
+  cc_cache_erase(s->cache, key);
+  unlock(s);
+}
+
+void cc_near_cache_clear(struct cc_near_cache *c)
+{
+  assert(c != NULL);
+
+  struct cc_shared_cache *s = c->shared;
+  memset(c->ways, 0, 2 * (c->set_mask + 1) * sizeof(struct cc_near_way));
+  lock(s);
+  cc_cache_clear(s->cache);
+  bump_all(s);
+  unlock(s);
+}
@@ -0,0 +1,622 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "ccache/ordered.h"
+
+#include "list.h"
+
+#include <cdcontainers/data-info.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+// Maximum number of keys of a node. Every node but the root holds at least
+// CC_ORDERED_MIN_KEYS keys.
+#define CC_ORDERED_FANOUT 32
+#define CC_ORDERED_MIN_KEYS (CC_ORDERED_FANOUT / 2 - 1)
+
+struct cc_ordered_node {
+  size_t size;
+  bool leaf;
+  // The next leaf in key order.
+  struct cc_ordered_node *next;
+  void *keys[CC_ORDERED_FANOUT];
+  union {
+    // keys[i] is the least key of children[i + 1].
+    struct cc_ordered_node *children[CC_ORDERED_FANOUT + 1];
+    struct cc_list_node *entries[CC_ORDERED_FANOUT];
+  } slots;
+};
+
+static struct cc_ordered_node *new_node(bool leaf)
+{
+  struct cc_ordered_node *n =
+      (struct cc_ordered_node *)malloc(sizeof(struct cc_ordered_node));
+  if (n) {
+    n->size = 0;
+    n->leaf = leaf;
+    n->next = NULL;
+  }
+
+  return n;
+}
+
+static void free_tree(struct cc_ordered_node *n)
+{
+  if (!n->leaf) {
+    for (size_t i = 0; i <= n->size; ++i) {
+      free_tree(n->slots.children[i]);
+    }
+  }
+
+  free(n);
+}
+
+// Returns the index of the first key of n that is not less than key.
+static size_t lower_index(struct cc_ordered_cache *c,
+                          struct cc_ordered_node *n, void *key)
+{
+  size_t lo = 0;
+  size_t hi = n->size;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (c->lt(n->keys[mid], key)) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return lo;
+}
+
+// Returns the index of the child of n which may hold key.
+static size_t child_index(struct cc_ordered_cache *c,
+                          struct cc_ordered_node *n, void *key)
+{
+  size_t lo = 0;
+  size_t hi = n->size;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (c->lt(key, n->keys[mid])) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+
+  return lo;
+}
+
+static struct cc_ordered_node *find_leaf(struct cc_ordered_cache *c,
+                                         void *key)
+{
+  struct cc_ordered_node *n = c->root;
+  while (!n->leaf) {
+    n = n->slots.children[child_index(c, n, key)];
+  }
+
+  return n;
+}
+
+static struct cc_list_node *find(struct cc_ordered_cache *c, void *key)
+{
+  struct cc_ordered_node *leaf = find_leaf(c, key);
+  size_t i = lower_index(c, leaf, key);
+  if (i == leaf->size || c->lt(key, leaf->keys[i])) {
+    return NULL;
+  }
+
+  return leaf->slots.entries[i];
+}
+
+static void *min_key(struct cc_ordered_node *n)
+{
+  while (!n->leaf) {
+    n = n->slots.children[0];
+  }
+
+  return n->keys[0];
+}
+
+// Splits the full child i of parent in two halves. The parent must not be
+// full.
+static enum cdc_stat split_child(struct cc_ordered_node *parent, size_t i)
+{
+  struct cc_ordered_node *left = parent->slots.children[i];
+  struct cc_ordered_node *right = new_node(left->leaf);
+  if (!right) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  size_t half = CC_ORDERED_FANOUT / 2;
+  void *separator = left->keys[half];
+  if (left->leaf) {
+    right->size = CC_ORDERED_FANOUT - half;
+    memcpy(right->keys, left->keys + half, right->size * sizeof(void *));
+    memcpy(right->slots.entries, left->slots.entries + half,
+           right->size * sizeof(struct cc_list_node *));
+    right->next = left->next;
+    left->next = right;
+  } else {
+    // The separator moves up to the parent.
+    right->size = CC_ORDERED_FANOUT - half - 1;
+    memcpy(right->keys, left->keys + half + 1, right->size * sizeof(void *));
+    memcpy(right->slots.children, left->slots.children + half + 1,
+           (right->size + 1) * sizeof(struct cc_ordered_node *));
+  }
+
+  left->size = half;
+  memmove(parent->keys + i + 1, parent->keys + i,
+          (parent->size - i) * sizeof(void *));
+  memmove(parent->slots.children + i + 2, parent->slots.children + i + 1,
+          (parent->size - i) * sizeof(struct cc_ordered_node *));
+  parent->keys[i] = separator;
+  parent->slots.children[i + 1] = right;
+  ++parent->size;
+  return CDC_STATUS_OK;
+}
+
+// Full nodes are split on the way down, so the tree stays valid if an
+// allocation fails half way.
+static enum cdc_stat tree_insert(struct cc_ordered_cache *c, void *key,
+                                 struct cc_list_node *entry)
+{
+  if (c->root->size == CC_ORDERED_FANOUT) {
+    struct cc_ordered_node *root = new_node(false /* leaf */);
+    if (!root) {
+      return CDC_STATUS_BAD_ALLOC;
+    }
+
+    root->slots.children[0] = c->root;
+    if (split_child(root, 0) != CDC_STATUS_OK) {
+      free(root);
+      return CDC_STATUS_BAD_ALLOC;
+    }
+
+    c->root = root;
+  }
+
+  struct cc_ordered_node *n = c->root;
+  while (!n->leaf) {
+    size_t i = child_index(c, n, key);
+    if (n->slots.children[i]->size == CC_ORDERED_FANOUT) {
+      enum cdc_stat stat = split_child(n, i);
+      if (stat != CDC_STATUS_OK) {
+        return stat;
+      }
+
+      if (!c->lt(key, n->keys[i])) {
+        ++i;
+      }
+    }
+
+    n = n->slots.children[i];
+  }
+
+  size_t i = lower_index(c, n, key);
+  memmove(n->keys + i + 1, n->keys + i, (n->size - i) * sizeof(void *));
+  memmove(n->slots.entries + i + 1, n->slots.entries + i,
+          (n->size - i) * sizeof(struct cc_list_node *));
+  n->keys[i] = key;
+  n->slots.entries[i] = entry;
+  ++n->size;
+  return CDC_STATUS_OK;
+}
+
+// Moves the last key of child i - 1 to the front of child i.
+static void borrow_from_left(struct cc_ordered_node *parent, size_t i)
+{
+  struct cc_ordered_node *left = parent->slots.children[i - 1];
+  struct cc_ordered_node *child = parent->slots.children[i];
+  memmove(child->keys + 1, child->keys, child->size * sizeof(void *));
+  if (child->leaf) {
+    memmove(child->slots.entries + 1, child->slots.entries,
+            child->size * sizeof(struct cc_list_node *));
+    child->keys[0] = left->keys[left->size - 1];
+    child->slots.entries[0] = left->slots.entries[left->size - 1];
+    parent->keys[i - 1] = child->keys[0];
+  } else {
+    memmove(child->slots.children + 1, child->slots.children,
+            (child->size + 1) * sizeof(struct cc_ordered_node *));
+    child->keys[0] = parent->keys[i - 1];
+    child->slots.children[0] = left->slots.children[left->size];
+    parent->keys[i - 1] = left->keys[left->size - 1];
+  }
+
+  --left->size;
+  ++child->size;
+}
+
+// Moves the first key of child i + 1 to the back of child i.
+static void borrow_from_right(struct cc_ordered_node *parent, size_t i)
+{
+  struct cc_ordered_node *child = parent->slots.children[i];
+  struct cc_ordered_node *right = parent->slots.children[i + 1];
+  if (child->leaf) {
+    child->keys[child->size] = right->keys[0];
+    child->slots.entries[child->size] = right->slots.entries[0];
+    memmove(right->slots.entries, right->slots.entries + 1,
+            (right->size - 1) * sizeof(struct cc_list_node *));
+    parent->keys[i] = right->keys[1];
+  } else {
+    child->keys[child->size] = parent->keys[i];
+    child->slots.children[child->size + 1] = right->slots.children[0];
+    memmove(right->slots.children, right->slots.children + 1,
+            right->size * sizeof(struct cc_ordered_node *));
+    parent->keys[i] = right->keys[0];
+  }
+
+  memmove(right->keys, right->keys + 1, (right->size - 1) * sizeof(void *));
+  --right->size;
+  ++child->size;
+}
+
+// Appends child i + 1 to child i and frees it.
+static void merge(struct cc_ordered_node *parent, size_t i)
+{
+  struct cc_ordered_node *left = parent->slots.children[i];
+  struct cc_ordered_node *right = parent->slots.children[i + 1];
+  if (left->leaf) {
+    memcpy(left->keys + left->size, right->keys, right->size * sizeof(void *));
+    memcpy(left->slots.entries + left->size, right->slots.entries,
+           right->size * sizeof(struct cc_list_node *));
+    left->size += right->size;
+    left->next = right->next;
+  } else {
+    left->keys[left->size] = parent->keys[i];
+    memcpy(left->keys + left->size + 1, right->keys,
+           right->size * sizeof(void *));
+    memcpy(left->slots.children + left->size + 1, right->slots.children,
+           (right->size + 1) * sizeof(struct cc_ordered_node *));
+    left->size += right->size + 1;
+  }
+
+  memmove(parent->keys + i, parent->keys + i + 1,
+          (parent->size - i - 1) * sizeof(void *));
+  memmove(parent->slots.children + i + 1, parent->slots.children + i + 2,
+          (parent->size - i - 1) * sizeof(struct cc_ordered_node *));
+  --parent->size;
+  free(right);
+}
+
+// Refills child i of parent, which has one key less than the minimum.
+static void rebalance(struct cc_ordered_node *parent, size_t i)
+{
+  if (i > 0 && parent->slots.children[i - 1]->size > CC_ORDERED_MIN_KEYS) {
+    borrow_from_left(parent, i);
+  } else if (i < parent->size &&
+             parent->slots.children[i + 1]->size > CC_ORDERED_MIN_KEYS) {
+    borrow_from_right(parent, i);
+  } else if (i > 0) {
+    merge(parent, i - 1);
+  } else {
+    merge(parent, i);
+  }
+}
+
+// Removes key from the subtree of n. Returns its entry or NULL.
+static struct cc_list_node *remove_key(struct cc_ordered_cache *c,
+                                       struct cc_ordered_node *n, void *key)
+{
+  if (n->leaf) {
+    size_t i = lower_index(c, n, key);
+    if (i == n->size || c->lt(key, n->keys[i])) {
+      return NULL;
+    }
+
+    struct cc_list_node *entry = n->slots.entries[i];
+    memmove(n->keys + i, n->keys + i + 1, (n->size - i - 1) * sizeof(void *));
+    memmove(n->slots.entries + i, n->slots.entries + i + 1,
+            (n->size - i - 1) * sizeof(struct cc_list_node *));
+    --n->size;
+    return entry;
+  }
+
+  size_t i = child_index(c, n, key);
+  struct cc_ordered_node *child = n->slots.children[i];
+  struct cc_list_node *entry = remove_key(c, child, key);
+  if (!entry) {
+    return NULL;
+  }
+
+  // The separator must not point to the removed key, which may be freed.
+  if (i > 0 && !c->lt(n->keys[i - 1], key)) {
+    n->keys[i - 1] = min_key(child);
+  }
+
+  if (child->size < CC_ORDERED_MIN_KEYS) {
+    rebalance(n, i);
+  }
+
+  return entry;
+}
+
+static struct cc_list_node *tree_remove(struct cc_ordered_cache *c, void *key)
+{
+  struct cc_list_node *entry = remove_key(c, c->root, key);
+  if (!c->root->leaf && c->root->size == 0) {
+    struct cc_ordered_node *root = c->root;
+    c->root = root->slots.children[0];
+    free(root);
+  }
+
+  return entry;
+}
+
+static void touch(struct cc_ordered_cache *c, struct cc_list_node *entry)
+{
+  cc_list_unlink_node(c->list, entry);
+  cc_list_push_front_node(c->list, entry);
+}
+
+static void free_entry(struct cc_ordered_cache *c, struct cc_list_node *entry,
+                       bool remove_data)
+{
+  cc_list_unlink_node(c->list, entry);
+  cc_list_free_node(c->list, entry, remove_data);
+  --c->size;
+}
+
+static enum cdc_stat insert_new(struct cc_ordered_cache *c, void *key,
+                                void *value)
+{
+  if (c->size >= c->max_size) {
+    struct cc_list_node *victim = c->list->tail;
+    tree_remove(c, victim->kv.first);
+    free_entry(c, victim, true /* remove_data */);
+  }
+
+  struct cc_list_node *entry = cc_list_alloc_node(c->list, key, value);
+  if (!entry) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  enum cdc_stat stat = tree_insert(c, key, entry);
+  if (stat != CDC_STATUS_OK) {
+    cc_list_free_node(c->list, entry, true /* remove_data */);
+    return stat;
+  }
+
+  cc_list_push_front_node(c->list, entry);
+  ++c->size;
+  return CDC_STATUS_OK;
+}
+
+enum cdc_stat cc_ordered_cache_ctor(struct cc_ordered_cache **c,
+                                    size_t max_size,
+                                    struct cdc_data_info *info)
+{
+  assert(c != NULL);
+  assert(info != NULL);
+  assert(CDC_HAS_LT(info));
+  assert(max_size > 0);
+
+  struct cc_ordered_cache *tmp =
+      (struct cc_ordered_cache *)calloc(sizeof(struct cc_ordered_cache), 1);
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  enum cdc_stat stat = CDC_STATUS_OK;
+  if (CDC_HAS_DFREE(info)) {
+    struct cdc_data_info list_info = CDC_INIT_STRUCT;
+    list_info.dfree = info->dfree;
+    stat = cc_list_ctor(&tmp->list, &list_info);
+  } else {
+    stat = cc_list_ctor(&tmp->list, NULL);
+  }
+
+  if (stat != CDC_STATUS_OK) {
+    goto free_cache;
+  }
+
+  tmp->root = new_node(true /* leaf */);
+  if (!tmp->root) {
+    stat = CDC_STATUS_BAD_ALLOC;
+    goto free_list;
+  }
+
+  tmp->max_size = max_size;
+  tmp->lt = info->lt;
+  *c = tmp;
+  return CDC_STATUS_OK;
+
+free_list:
+  cc_list_dtor(tmp->list);
+free_cache:
+  free(tmp);
+  return stat;
+}
+
+void cc_ordered_cache_dtor(struct cc_ordered_cache *c)
+{
+  assert(c != NULL);
+
+  free_tree(c->root);
+  cc_list_dtor(c->list);
+  free(c);
+}
+
+enum cdc_stat cc_ordered_cache_get(struct cc_ordered_cache *c, void *key,
+                                   void **value)
+{
+  assert(c != NULL);
+  assert(value != NULL);
+
+  struct cc_list_node *entry = find(c, key);
+  if (!entry) {
+    return CDC_STATUS_NOT_FOUND;
+  }
+
+  touch(c, entry);
+  *value = entry->kv.second;
+  return CDC_STATUS_OK;
+}
+
+bool cc_ordered_cache_contains(struct cc_ordered_cache *c, void *key)
+{
+  assert(c != NULL);
+
+  return find(c, key) != NULL;
+}
+
+enum cdc_stat cc_ordered_cache_lower_bound(struct cc_ordered_cache *c,
+                                           void *key, struct cdc_pair *kv)
+{
+  assert(c != NULL);
+  assert(kv != NULL);
+
+  struct cc_ordered_node *leaf = find_leaf(c, key);
+  size_t i = lower_index(c, leaf, key);
+  // All keys of the leaf are less, the next leaf starts with a greater one.
+  if (i == leaf->size) {
+    leaf = leaf->next;
+    i = 0;
+  }
+
+  if (!leaf || leaf->size == 0) {
+    return CDC_STATUS_NOT_FOUND;
+  }
+
+  struct cc_list_node *entry = leaf->slots.entries[i];
+  touch(c, entry);
+  *kv = entry->kv;
+  return CDC_STATUS_OK;
+}
+
+size_t cc_ordered_cache_range_scan(struct cc_ordered_cache *c, void *lo,
+                                   void *hi, cc_visit_fn_t fn, void *ctx)
+{
+  assert(c != NULL);
+  assert(fn != NULL);
+
+  if (!c->lt(lo, hi)) {
+    return 0;
+  }
+
+  struct cc_ordered_node *leaf = find_leaf(c, lo);
+  size_t i = lower_index(c, leaf, lo);
+  size_t count = 0;
+  for (; leaf; leaf = leaf->next, i = 0) {
+    for (; i < leaf->size; ++i) {
+      if (!c->lt(leaf->keys[i], hi)) {
+        return count;
+      }
+
+      struct cc_list_node *entry = leaf->slots.entries[i];
+      touch(c, entry);
+      ++count;
+      if (!fn(entry->kv.first, entry->kv.second, ctx)) {
+        return count;
+      }
+    }
+  }
+
+  return count;
+}
+
+enum cdc_stat cc_ordered_cache_insert(struct cc_ordered_cache *c, void *key,
+                                      void *value, bool *inserted)
+{
+  assert(c != NULL);
+
+  if (find(c, key)) {
+    if (inserted) {
+      *inserted = false;
+    }
+
+    return CDC_STATUS_OK;
+  }
+
+  enum cdc_stat stat = insert_new(c, key, value);
+  if (stat == CDC_STATUS_OK && inserted) {
+    *inserted = true;
+  }
+
+  return stat;
+}
+
+enum cdc_stat cc_ordered_cache_insert_or_assign(struct cc_ordered_cache *c,
+                                                void *key, void *value,
+                                                bool *inserted)
+{
+  assert(c != NULL);
+
+  struct cc_list_node *entry = find(c, key);
+  if (entry) {
+    cc_list_free_value(c->list, entry->kv.second);
+    entry->kv.second = value;
+    touch(c, entry);
+    if (inserted) {
+      *inserted = false;
+    }
+
+    return CDC_STATUS_OK;
+  }
+
+  enum cdc_stat stat = insert_new(c, key, value);
+  if (stat == CDC_STATUS_OK && inserted) {
+    *inserted = true;
+  }
+
+  return stat;
+}
+
+void cc_ordered_cache_erase(struct cc_ordered_cache *c, void *key)
+{
+  assert(c != NULL);
+
+  struct cc_list_node *entry = tree_remove(c, key);
+  if (entry) {
+    free_entry(c, entry, true /* remove_data */);
+  }
+}
+
+void cc_ordered_cache_take(struct cc_ordered_cache *c, void *key,
+                           struct cdc_pair *kv)
+{
+  assert(c != NULL);
+  assert(kv != NULL);
+
+  struct cc_list_node *entry = tree_remove(c, key);
+  if (entry) {
+    *kv = entry->kv;
+    free_entry(c, entry, false /* remove_data */);
+  }
+}
+
+void cc_ordered_cache_clear(struct cc_ordered_cache *c)
+{
+  assert(c != NULL);
+
+  struct cc_ordered_node *root = c->root;
+  if (!root->leaf) {
+    for (size_t i = 0; i <= root->size; ++i) {
+      free_tree(root->slots.children[i]);
+    }
+
+    root->leaf = true;
+  }
+
+  root->size = 0;
+  cc_list_clear(c->list);
+  c->size = 0;
+}
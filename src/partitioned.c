@@ -0,0 +1,485 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "ccache/partitioned.h"
+
+#include "list.h"
+#include "probes.h"
+
+#include <cdcontainers/data-info.h>
+#include <cdcontainers/hash-table.h>
+
+#include <stdlib.h>
+
+struct cc_partitioned_node {
+  struct cc_list_node base;
+  size_t partition;
+};
+
+static int64_t excess(struct cc_partition *p)
+{
+  return (int64_t)p->stats.size - (int64_t)p->stats.min_size;
+}
+
+// Takes an unused group and links it between prev and next.
+static struct cc_partition_group *new_group(struct cc_partitioned_cache *c,
+                                            int64_t value,
+                                            struct cc_partition_group *prev,
+                                            struct cc_partition_group *next)
+{
+  struct cc_partition_group *g = c->free_groups;
+  c->free_groups = g->next;
+  g->excess = value;
+  g->head = NULL;
+  g->prev = prev;
+  g->next = next;
+  if (prev) {
+    prev->next = g;
+  } else {
+    c->lowest = g;
+  }
+
+  if (next) {
+    next->prev = g;
+  } else {
+    c->highest = g;
+  }
+
+  return g;
+}
+
+static void link_partition(struct cc_partition_group *g, struct cc_partition *p)
+{
+  p->group = g;
+  p->prev = NULL;
+  p->next = g->head;
+  if (g->head) {
+    g->head->prev = p;
+  }
+
+  g->head = p;
+}
+
+// Removes p from its group and releases the group if it becomes empty.
+static void unlink_partition(struct cc_partitioned_cache *c,
+                             struct cc_partition *p)
+{
+  struct cc_partition_group *g = p->group;
+  if (p->prev) {
+    p->prev->next = p->next;
+  } else {
+    g->head = p->next;
+  }
+
+  if (p->next) {
+    p->next->prev = p->prev;
+  }
+
+  p->group = NULL;
+  if (g->head) {
+    return;
+  }
+
+  if (g->prev) {
+    g->prev->next = g->next;
+  } else {
+    c->lowest = g->next;
+  }
+
+  if (g->next) {
+    g->next->prev = g->prev;
+  } else {
+    c->highest = g->prev;
+  }
+
+  g->next = c->free_groups;
+  c->free_groups = g;
+}
+
+// Puts p into the group of its excess. Walks the groups, so it is only used
+// when the limits change.
+static void place(struct cc_partitioned_cache *c, struct cc_partition *p)
+{
+  if (p->group) {
+    unlink_partition(c, p);
+  }
+
+  int64_t value = excess(p);
+  struct cc_partition_group *g = c->lowest;
+  while (g && g->excess < value) {
+    g = g->next;
+  }
+
+  if (!g || g->excess != value) {
+    g = new_group(c, value, g ? g->prev : c->highest, g);
+  }
+
+  link_partition(g, p);
+}
+
+// Moves p to the neighbouring group after its size changed by one.
+static void shift(struct cc_partitioned_cache *c, struct cc_partition *p,
+                  bool grew)
+{
+  struct cc_partition_group *g = p->group;
+  int64_t value = excess(p);
+  struct cc_partition_group *target = grew ? g->next : g->prev;
+  if (!target || target->excess != value) {
+    target = grew ? new_group(c, value, g, g->next)
+                  : new_group(c, value, g->prev, g);
+  }
+
+  unlink_partition(c, p);
+  link_partition(target, p);
+}
+
+static void remove_node(struct cc_partitioned_cache *c,
+                        struct cc_partitioned_node *node, bool remove_data)
+{
+  struct cc_partition *p = c->partitions + node->partition;
+  cc_list_unlink_node(p->list, &node->base);
+  cdc_hash_table_erase(c->table, node->base.kv.first);
+  cc_list_free_node(p->list, &node->base, remove_data);
+  --p->stats.size;
+  --c->size;
+  shift(c, p, false /* grew */);
+}
+
+static void evict(struct cc_partitioned_cache *c, struct cc_partition *p)
+{
+  ++p->stats.evictions;
+  CC_PROBE_EVICT(c, p->list->tail->kv.first, c->table->dinfo->hash);
+  remove_node(c, (struct cc_partitioned_node *)p->list->tail,
+              true /* remove_data */);
+}
+
+// Makes room for one more entry of p. Returns false if there is none.
+static bool make_room(struct cc_partitioned_cache *c, struct cc_partition *p)
+{
+  if (p->stats.size >= p->stats.max_size) {
+    evict(c, p);
+    return true;
+  }
+
+  if (c->size < c->max_size) {
+    return true;
+  }
+
+  struct cc_partition *victim = c->highest->excess > 0 ? c->highest->head : p;
+  if (victim->stats.size == 0) {
+    return false;
+  }
+
+  evict(c, victim);
+  return true;
+}
+
+static void touch(struct cc_partition *p, struct cc_partitioned_node *node)
+{
+  cc_list_unlink_node(p->list, &node->base);
+  cc_list_push_front_node(p->list, &node->base);
+}
+
+static enum cdc_stat insert_new(struct cc_partitioned_cache *c,
+                                size_t partition, void *key, void *value,
+                                bool *inserted)
+{
+  struct cc_partition *p = c->partitions + partition;
+  if (!make_room(c, p)) {
+    if (inserted) {
+      *inserted = false;
+    }
+
+    return CDC_STATUS_OK;
+  }
+
+  struct cc_partitioned_node *node = (struct cc_partitioned_node *)malloc(
+      sizeof(struct cc_partitioned_node));
+  if (!node) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  node->base.kv.first = key;
+  node->base.kv.second = value;
+  node->partition = partition;
+  enum cdc_stat stat = cdc_hash_table_insert(c->table, key, node, NULL /* it */,
+                                             NULL /* inserted */);
+  if (stat != CDC_STATUS_OK) {
+    cc_list_free_node(p->list, &node->base, true /* remove_data */);
+    return stat;
+  }
+
+  cc_list_push_front_node(p->list, &node->base);
+  ++p->stats.size;
+  ++c->size;
+  shift(c, p, true /* grew */);
+  CC_PROBE_INSERT(c, key);
+  if (inserted) {
+    *inserted = true;
+  }
+
+  return CDC_STATUS_OK;
+}
+
+enum cdc_stat cc_partitioned_cache_ctor(struct cc_partitioned_cache **c,
+                                        size_t max_size,
+                                        size_t partition_count,
+                                        struct cdc_data_info *info)
+{
+  assert(c != NULL);
+  assert(info != NULL);
+  assert(max_size > 0);
+  assert(partition_count > 0);
+
+  struct cc_partitioned_cache *tmp = (struct cc_partitioned_cache *)calloc(
+      sizeof(struct cc_partitioned_cache), 1);
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  enum cdc_stat stat = CDC_STATUS_BAD_ALLOC;
+  tmp->partitions = (struct cc_partition *)calloc(sizeof(struct cc_partition),
+                                                  partition_count);
+  // A shift links the new group before it releases the old one.
+  tmp->groups = (struct cc_partition_group *)malloc(
+      sizeof(struct cc_partition_group) * (partition_count + 1));
+  if (!tmp->partitions || !tmp->groups) {
+    goto free_cache;
+  }
+
+  struct cdc_data_info list_info = CDC_INIT_STRUCT;
+  list_info.dfree = info->dfree;
+  struct cdc_data_info *linfo = CDC_HAS_DFREE(info) ? &list_info : NULL;
+  for (; tmp->partition_count < partition_count; ++tmp->partition_count) {
+    struct cc_partition *p = tmp->partitions + tmp->partition_count;
+    stat = cc_list_ctor(&p->list, linfo);
+    if (stat != CDC_STATUS_OK) {
+      goto free_lists;
+    }
+
+    p->stats.max_size = max_size;
+  }
+
+  struct cdc_data_info ht_info = CDC_INIT_STRUCT;
+  ht_info.hash = info->hash;
+  ht_info.eq = info->eq;
+  stat = cdc_hash_table_ctor(&tmp->table, &ht_info);
+  if (stat != CDC_STATUS_OK) {
+    goto free_lists;
+  }
+
+  for (size_t i = 0; i <= partition_count; ++i) {
+    tmp->groups[i].next = tmp->free_groups;
+    tmp->free_groups = tmp->groups + i;
+  }
+
+  for (size_t i = 0; i < partition_count; ++i) {
+    place(tmp, tmp->partitions + i);
+  }
+
+  tmp->max_size = max_size;
+  *c = tmp;
+  return CDC_STATUS_OK;
+
+free_lists:
+  for (size_t i = 0; i < tmp->partition_count; ++i) {
+    cc_list_dtor(tmp->partitions[i].list);
+  }
+free_cache:
+  free(tmp->groups);
+  free(tmp->partitions);
+  free(tmp);
+  return stat;
+}
+
+void cc_partitioned_cache_dtor(struct cc_partitioned_cache *c)
+{
+  assert(c != NULL);
+
+  for (size_t i = 0; i < c->partition_count; ++i) {
+    cc_list_dtor(c->partitions[i].list);
+  }
+
+  cdc_hash_table_dtor(c->table);
+  free(c->groups);
+  free(c->partitions);
+  free(c);
+}
+
+enum cdc_stat cc_partitioned_cache_get(struct cc_partitioned_cache *c,
+                                       size_t partition, void *key,
+                                       void **value)
+{
+  assert(c != NULL);
+  assert(partition < c->partition_count);
+  assert(value != NULL);
+
+  struct cc_partition *p = c->partitions + partition;
+  struct cc_partitioned_node *node = NULL;
+  if (cdc_hash_table_get(c->table, key, (void **)&node) != CDC_STATUS_OK ||
+      node->partition != partition) {
+    ++p->stats.misses;
+    CC_PROBE_GET_MISS(c, key);
+    return CDC_STATUS_NOT_FOUND;
+  }
+
+  ++p->stats.hits;
+  CC_PROBE_GET_HIT(c, key);
+  touch(p, node);
+  *value = node->base.kv.second;
+  return CDC_STATUS_OK;
+}
+
+bool cc_partitioned_cache_contains(struct cc_partitioned_cache *c, void *key)
+{
+  assert(c != NULL);
+
+  return cdc_hash_table_count(c->table, key) != 0;
+}
+
+enum cdc_stat cc_partitioned_cache_set_limits(struct cc_partitioned_cache *c,
+                                              size_t partition,
+                                              size_t min_size,
+                                              size_t max_size)
+{
+  assert(c != NULL);
+  assert(partition < c->partition_count);
+  assert(min_size <= max_size);
+  assert(max_size > 0);
+
+  struct cc_partition *p = c->partitions + partition;
+  size_t reserved = min_size;
+  for (size_t i = 0; i < c->partition_count; ++i) {
+    if (i != partition) {
+      reserved += c->partitions[i].stats.min_size;
+    }
+  }
+
+  if (reserved > c->max_size) {
+    return CDC_STATUS_OUT_OF_RANGE;
+  }
+
+  p->stats.min_size = min_size;
+  p->stats.max_size = max_size;
+  place(c, p);
+  while (p->stats.size > max_size) {
+    evict(c, p);
+  }
+
+  return CDC_STATUS_OK;
+}
+
+enum cdc_stat cc_partitioned_cache_insert(struct cc_partitioned_cache *c,
+                                          size_t partition, void *key,
+                                          void *value, bool *inserted)
+{
+  assert(c != NULL);
+  assert(partition < c->partition_count);
+
+  if (cdc_hash_table_count(c->table, key) != 0) {
+    if (inserted) {
+      *inserted = false;
+    }
+
+    return CDC_STATUS_OK;
+  }
+
+  return insert_new(c, partition, key, value, inserted);
+}
+
+enum cdc_stat cc_partitioned_cache_insert_or_assign(
+    struct cc_partitioned_cache *c, size_t partition, void *key, void *value,
+    bool *inserted)
+{
+  assert(c != NULL);
+  assert(partition < c->partition_count);
+
+  struct cc_partitioned_node *node = NULL;
+  if (cdc_hash_table_get(c->table, key, (void **)&node) != CDC_STATUS_OK) {
+    return insert_new(c, partition, key, value, inserted);
+  }
+
+  struct cc_partition *p = c->partitions + partition;
+  struct cc_partition *old = c->partitions + node->partition;
+  if (old != p) {
+    // The node leaves old first, so that the cap of p cannot evict it and
+    // the cache has room for it.
+    cc_list_unlink_node(old->list, &node->base);
+    --old->stats.size;
+    --c->size;
+    shift(c, old, false /* grew */);
+    make_room(c, p);
+
+    node->partition = partition;
+    cc_list_push_front_node(p->list, &node->base);
+    ++p->stats.size;
+    ++c->size;
+    shift(c, p, true /* grew */);
+  }
+
+  cc_list_free_value(p->list, node->base.kv.second);
+  node->base.kv.second = value;
+  touch(p, node);
+  if (inserted) {
+    *inserted = false;
+  }
+
+  return CDC_STATUS_OK;
+}
+
+void cc_partitioned_cache_erase(struct cc_partitioned_cache *c, void *key)
+{
+  assert(c != NULL);
+
+  struct cc_partitioned_node *node = NULL;
+  if (cdc_hash_table_get(c->table, key, (void **)&node) == CDC_STATUS_OK) {
+    CC_PROBE_ERASE(c, key);
+    remove_node(c, node, true /* remove_data */);
+  }
+}
+
+void cc_partitioned_cache_take(struct cc_partitioned_cache *c, void *key,
+                               struct cdc_pair *kv)
+{
+  assert(c != NULL);
+  assert(kv != NULL);
+
+  struct cc_partitioned_node *node = NULL;
+  if (cdc_hash_table_get(c->table, key, (void **)&node) == CDC_STATUS_OK) {
+    *kv = node->base.kv;
+    remove_node(c, node, false /* remove_data */);
+  }
+}
+
+void cc_partitioned_cache_clear(struct cc_partitioned_cache *c)
+{
+  assert(c != NULL);
+
+  CC_PROBE_CLEAR(c);
+  cdc_hash_table_clear(c->table);
+  for (size_t i = 0; i < c->partition_count; ++i) {
+    struct cc_partition *p = c->partitions + i;
+    cc_list_clear(p->list);
+    p->stats.size = 0;
+    place(c, p);
+  }
+
+  c->size = 0;
+}
@@ -0,0 +1,60 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_SRC_PROBES_H
+#define CCACHE_SRC_PROBES_H
+#include "ccache/common.h"
+
+// Static tracepoints of the caches for bpftrace and perf, built with the
+// CCACHE_USDT option. The first argument of every probe is the cache, so
+// that a script can tell caches apart. A probe which is not attached is a
+// nop; the key hash of evict is computed only while evict is attached.
+#ifdef CC_USDT
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+// Counted by the tracer while a probe is attached.
+extern volatile unsigned short ccache_get_hit_semaphore;
+extern volatile unsigned short ccache_get_miss_semaphore;
+extern volatile unsigned short ccache_insert_semaphore;
+extern volatile unsigned short ccache_evict_semaphore;
+extern volatile unsigned short ccache_erase_semaphore;
+extern volatile unsigned short ccache_clear_semaphore;
+
+#define CC_PROBE_GET_HIT(c, key) DTRACE_PROBE2(ccache, get_hit, c, key)
+#define CC_PROBE_GET_MISS(c, key) DTRACE_PROBE2(ccache, get_miss, c, key)
+#define CC_PROBE_INSERT(c, key) DTRACE_PROBE2(ccache, insert, c, key)
+#define CC_PROBE_EVICT(c, key, hash)                   \
+  do {                                                 \
+    if (CC_UNLIKELY(ccache_evict_semaphore != 0)) {    \
+      DTRACE_PROBE3(ccache, evict, c, key, hash(key)); \
+    }                                                  \
+  } while (0)
+#define CC_PROBE_ERASE(c, key) DTRACE_PROBE2(ccache, erase, c, key)
+#define CC_PROBE_CLEAR(c) DTRACE_PROBE1(ccache, clear, c)
+#else
+#define CC_PROBE_GET_HIT(c, key) ((void)0)
+#define CC_PROBE_GET_MISS(c, key) ((void)0)
+#define CC_PROBE_INSERT(c, key) ((void)0)
+#define CC_PROBE_EVICT(c, key, hash) ((void)0)
+#define CC_PROBE_ERASE(c, key) ((void)0)
+#define CC_PROBE_CLEAR(c) ((void)0)
+#endif
+#endif  // CCACHE_SRC_PROBES_H
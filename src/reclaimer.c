@@ -0,0 +1,193 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "reclaimer.h"
+
+#include "list.h"
+
+#include <cdcontainers/data-info.h>
+
+#include <assert.h>
+#include <stdlib.h>
+
+static void free_chain(struct cc_reclaimer *r, struct cc_list_node *node)
+{
+  while (node) {
+    struct cc_list_node *next = node->next;
+    if (CDC_HAS_DFREE(r->dinfo)) {
+      r->dinfo->dfree(&node->kv);
+    }
+
+    free(node);
+    node = next;
+  }
+}
+
+// Detaches up to budget nodes from the queue. The detach functions must be
+// called under the lock.
+static struct cc_list_node *detach(struct cc_reclaimer *r, size_t budget,
+                                   size_t *count)
+{
+  struct cc_list_node *head = r->head;
+  struct cc_list_node *last = NULL;
+  struct cc_list_node *node = r->head;
+  size_t n = 0;
+  for (; node && n < budget; node = node->next) {
+    last = node;
+    ++n;
+  }
+
+  if (last) {
+    last->next = NULL;
+  }
+
+  r->head = node;
+  if (!node) {
+    r->tail = NULL;
+  }
+
+  *count = n;
+  return n ? head : NULL;
+}
+
+static struct cc_list_node *detach_all(struct cc_reclaimer *r)
+{
+  struct cc_list_node *head = r->head;
+  r->head = NULL;
+  r->tail = NULL;
+  return head;
+}
+
+static void *reclaim_loop(void *arg)
+{
+  struct cc_reclaimer *r = (struct cc_reclaimer *)arg;
+  pthread_mutex_lock(&r->mutex);
+  for (;;) {
+    while (!r->head && !r->stop) {
+      pthread_cond_wait(&r->cond, &r->mutex);
+    }
+
+    if (!r->head) {
+      break;
+    }
+
+    struct cc_list_node *chain = detach_all(r);
+    pthread_mutex_unlock(&r->mutex);
+    free_chain(r, chain);
+    pthread_mutex_lock(&r->mutex);
+  }
+
+  pthread_mutex_unlock(&r->mutex);
+  return NULL;
+}
+
+enum cdc_stat cc_reclaimer_ctor(struct cc_reclaimer **r,
+                                struct cdc_data_info *info, bool background)
+{
+  assert(r != NULL);
+
+  struct cc_reclaimer *tmp =
+      (struct cc_reclaimer *)malloc(sizeof(struct cc_reclaimer));
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  tmp->head = NULL;
+  tmp->tail = NULL;
+  tmp->dinfo = info;
+  tmp->background = background;
+  tmp->stop = false;
+  if (pthread_mutex_init(&tmp->mutex, NULL) != 0) {
+    goto free_reclaimer;
+  }
+
+  if (pthread_cond_init(&tmp->cond, NULL) != 0) {
+    goto free_mutex;
+  }
+
+  if (background &&
+      pthread_create(&tmp->thread, NULL, reclaim_loop, tmp) != 0) {
+    goto free_cond;
+  }
+
+  *r = tmp;
+  return CDC_STATUS_OK;
+
+free_cond:
+  pthread_cond_destroy(&tmp->cond);
+free_mutex:
+  pthread_mutex_destroy(&tmp->mutex);
+free_reclaimer:
+  free(tmp);
+  return CDC_STATUS_BAD_ALLOC;
+}
+
+void cc_reclaimer_dtor(struct cc_reclaimer *r)
+{
+  assert(r != NULL);
+
+  if (r->background) {
+    pthread_mutex_lock(&r->mutex);
+    r->stop = true;
+    pthread_cond_signal(&r->cond);
+    pthread_mutex_unlock(&r->mutex);
+    pthread_join(r->thread, NULL);
+  }
+
+  free_chain(r, r->head);
+  pthread_cond_destroy(&r->cond);
+  pthread_mutex_destroy(&r->mutex);
+  free(r);
+}
+
+void cc_reclaimer_push(struct cc_reclaimer *r, struct cc_list_node *head,
+                       struct cc_list_node *tail)
+{
+  assert(r != NULL);
+  assert(head != NULL);
+  assert(tail != NULL);
+
+  tail->next = NULL;
+  pthread_mutex_lock(&r->mutex);
+  if (r->tail) {
+    r->tail->next = head;
+  } else {
+    r->head = head;
+  }
+
+  r->tail = tail;
+  if (r->background) {
+    pthread_cond_signal(&r->cond);
+  }
+
+  pthread_mutex_unlock(&r->mutex);
+}
+
+size_t cc_reclaimer_reclaim(struct cc_reclaimer *r, size_t budget)
+{
+  assert(r != NULL);
+
+  size_t count = 0;
+  pthread_mutex_lock(&r->mutex);
+  struct cc_list_node *chain = detach(r, budget, &count);
+  pthread_mutex_unlock(&r->mutex);
+  free_chain(r, chain);
+  return count;
+}
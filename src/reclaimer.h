@@ -0,0 +1,59 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_SRC_RECLAIMER_H
+#define CCACHE_SRC_RECLAIMER_H
+#include <cdcontainers/status.h>
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct cc_list_node;
+struct cdc_data_info;
+
+// A queue of list nodes whose pairs still have to be passed to dfree. It is
+// drained by cc_reclaimer_reclaim or by a background thread, so that the
+// cost of destroying values leaves the insert and clear paths.
+struct cc_reclaimer {
+  // Nodes linked through their next pointers.
+  struct cc_list_node *head;
+  struct cc_list_node *tail;
+  // Not owned.
+  struct cdc_data_info *dinfo;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  pthread_t thread;
+  bool background;
+  bool stop;
+};
+
+enum cdc_stat cc_reclaimer_ctor(struct cc_reclaimer **r,
+                                struct cdc_data_info *info, bool background);
+// Stops the background thread and frees the remaining nodes.
+void cc_reclaimer_dtor(struct cc_reclaimer *r);
+
+// Queues a chain of nodes from head to tail.
+void cc_reclaimer_push(struct cc_reclaimer *r, struct cc_list_node *head,
+                       struct cc_list_node *tail);
+// Frees up to budget nodes. Returns their number.
+size_t cc_reclaimer_reclaim(struct cc_reclaimer *r, size_t budget);
+
+#endif  // CCACHE_SRC_RECLAIMER_H
@@ -0,0 +1,563 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "ccache/refresh.h"
+
+#include <cdcontainers/data-info.h>
+
+#include <stdlib.h>
+#include <time.h>
+
+struct cc_refresh_entry {
+  // Used to free the pair once no reader can see it.
+  struct cc_epoch_entry retired;
+  struct cc_refresh_cache *owner;
+  void *key;
+  void *value;
+  uint64_t write_time;
+  // Write time seen by the running reload.
+  uint64_t refresh_base;
+  // One for the lru cache and one for a running reload.
+  unsigned refs;
+  bool live;
+  bool taken;
+  bool refreshing;
+};
+
+// A replaced value waiting for the readers to leave.
+struct cc_refresh_retired {
+  struct cc_epoch_entry entry;
+  void *value;
+};
+
+static uint64_t monotonic_clock(void *ctx)
+{
+  CDC_UNUSED(ctx);
+
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t now(struct cc_refresh_cache *c)
+{
+  return c->policy.clock(c->policy.clock_ctx);
+}
+
+static void free_value(struct cc_refresh_cache *c, void *value)
+{
+  if (CDC_HAS_DFREE(c->dinfo)) {
+    struct cdc_pair kv = {NULL, value};
+    c->dinfo->dfree(&kv);
+  }
+}
+
+static void free_retired_entry(struct cc_epoch_entry *retired, void *ctx)
+{
+  struct cc_refresh_cache *c = (struct cc_refresh_cache *)ctx;
+  struct cc_refresh_entry *entry = (struct cc_refresh_entry *)retired;
+  struct cdc_pair kv = {entry->key, entry->value};
+  c->dinfo->dfree(&kv);
+  free(entry);
+}
+
+static void free_retired_value(struct cc_epoch_entry *retired, void *ctx)
+{
+  struct cc_refresh_cache *c = (struct cc_refresh_cache *)ctx;
+  struct cc_refresh_retired *r = (struct cc_refresh_retired *)retired;
+  free_value(c, r->value);
+  free(r);
+}
+
+// Returns NULL without dfree, as there is nothing to retire then.
+static struct cc_refresh_retired *new_retired(struct cc_refresh_cache *c)
+{
+  if (!CDC_HAS_DFREE(c->dinfo)) {
+    return NULL;
+  }
+
+  return (struct cc_refresh_retired *)malloc(
+      sizeof(struct cc_refresh_retired));
+}
+
+// Must be called with the mutex held. r comes from new_retired.
+static void replace_value(struct cc_refresh_cache *c,
+                          struct cc_refresh_entry *entry, void *value,
+                          struct cc_refresh_retired *r)
+{
+  if (r) {
+    r->value = entry->value;
+    cc_epoch_retire(c->epoch, &r->entry, free_retired_value, c);
+  }
+
+  entry->value = value;
+}
+
+// Must be called with the mutex held.
+static void unref_entry(struct cc_refresh_entry *entry)
+{
+  if (--entry->refs != 0) {
+    return;
+  }
+
+  struct cc_refresh_cache *c = entry->owner;
+  if (!entry->taken && CDC_HAS_DFREE(c->dinfo)) {
+    cc_epoch_retire(c->epoch, &entry->retired, free_retired_entry, c);
+    return;
+  }
+
+  free(entry);
+}
+
+static void unlock(struct cc_refresh_cache *c)
+{
+  cc_epoch_collect(c->epoch);
+  pthread_mutex_unlock(&c->mutex);
+}
+
+// Called by the lru cache when an entry is evicted, erased or cleared.
+static void free_entry(void *data)
+{
+  struct cdc_pair *kv = (struct cdc_pair *)data;
+  struct cc_refresh_entry *entry = (struct cc_refresh_entry *)kv->second;
+  entry->live = false;
+  unref_entry(entry);
+}
+
+static bool is_expired(struct cc_refresh_cache *c,
+                       struct cc_refresh_entry *entry, uint64_t time)
+{
+  return c->policy.expire_after != 0 &&
+         time - entry->write_time >= c->policy.expire_after;
+}
+
+static bool should_refresh(struct cc_refresh_cache *c,
+                           struct cc_refresh_entry *entry, uint64_t time)
+{
+  return c->policy.expire_after != 0 && c->policy.load &&
+         !entry->refreshing && time - entry->write_time >= c->refresh_after;
+}
+
+static void refresh_task(void *arg)
+{
+  struct cc_refresh_entry *entry = (struct cc_refresh_entry *)arg;
+  struct cc_refresh_cache *c = entry->owner;
+  void *value = NULL;
+  // The key stays valid while the task holds a reference to the entry.
+  enum cdc_stat stat = c->policy.load(c->policy.load_ctx, entry->key, &value);
+  struct cc_refresh_retired *r = NULL;
+  if (stat == CDC_STATUS_OK) {
+    r = new_retired(c);
+    if (CDC_HAS_DFREE(c->dinfo) && !r) {
+      // The old value cannot be retired, so it stays.
+      free_value(c, value);
+      stat = CDC_STATUS_BAD_ALLOC;
+    }
+  }
+
+  pthread_mutex_lock(&c->mutex);
+  entry->refreshing = false;
+  if (stat == CDC_STATUS_OK) {
+    // Drop the result if the entry was removed or written in the meantime.
+    if (entry->live && entry->write_time == entry->refresh_base) {
+      replace_value(c, entry, value, r);
+      entry->write_time = now(c);
+    } else {
+      // Nobody has seen the new value yet.
+      free_value(c, value);
+      free(r);
+    }
+  }
+
+  unref_entry(entry);
+  if (--c->pending == 0) {
+    pthread_cond_broadcast(&c->idle);
+  }
+
+  unlock(c);
+}
+
+// Must be called with the mutex held.
+static struct cc_refresh_entry *find_entry(struct cc_refresh_cache *c,
+                                           void *key, uint64_t time)
+{
+  struct cc_refresh_entry *entry = NULL;
+  if (cc_lru_cache_get(c->lru, key, (void **)&entry) != CDC_STATUS_OK) {
+    return NULL;
+  }
+
+  if (is_expired(c, entry, time)) {
+    cc_lru_cache_erase(c->lru, key);
+    return NULL;
+  }
+
+  return entry;
+}
+
+// Must be called with the mutex held.
+static enum cdc_stat insert_new(struct cc_refresh_cache *c, void *key,
+                                void *value, uint64_t time)
+{
+  struct cc_refresh_entry *entry =
+      (struct cc_refresh_entry *)malloc(sizeof(struct cc_refresh_entry));
+  if (!entry) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  entry->owner = c;
+  entry->key = key;
+  entry->value = value;
+  entry->write_time = time;
+  entry->refresh_base = time;
+  // Keep the entry alive until we know whether the lru cache freed it.
+  entry->refs = 2;
+  entry->live = true;
+  entry->taken = false;
+  entry->refreshing = false;
+  enum cdc_stat stat =
+      cc_lru_cache_insert(c->lru, key, entry, NULL /* inserted */);
+  if (stat != CDC_STATUS_OK && entry->live) {
+    // The lru cache has not taken the ownership of the data.
+    free(entry);
+    return stat;
+  }
+
+  unref_entry(entry);
+  return stat;
+}
+
+static enum cdc_stat load(struct cc_refresh_cache *c, void *key, void **value)
+{
+  void *loaded = NULL;
+  enum cdc_stat stat = c->policy.load(c->policy.load_ctx, key, &loaded);
+  if (stat != CDC_STATUS_OK) {
+    return stat;
+  }
+
+  pthread_mutex_lock(&c->mutex);
+  uint64_t time = now(c);
+  struct cc_refresh_entry *entry = find_entry(c, key, time);
+  if (entry) {
+    // Another thread has loaded the value first.
+    free_value(c, loaded);
+    *value = entry->value;
+  } else {
+    stat = insert_new(c, key, loaded, time);
+    if (stat == CDC_STATUS_OK) {
+      *value = loaded;
+    }
+  }
+
+  unlock(c);
+  return stat;
+}
+
+enum cdc_stat cc_refresh_cache_ctor(struct cc_refresh_cache **c,
+                                    size_t max_size,
+                                    struct cdc_data_info *info,
+                                    struct cc_refresh_policy *policy)
+{
+  assert(c != NULL);
+  assert(info != NULL);
+  assert(policy != NULL);
+  assert(max_size > 0);
+  assert(policy->expire_after == 0 ||
+         (policy->refresh_ratio > 0.0 && policy->refresh_ratio <= 1.0));
+
+  struct cc_refresh_cache *tmp =
+      (struct cc_refresh_cache *)calloc(sizeof(struct cc_refresh_cache), 1);
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  enum cdc_stat stat = CDC_STATUS_BAD_ALLOC;
+  tmp->dinfo = cdc_di_shared_ctorc(info);
+  if (!tmp->dinfo) {
+    goto free_cache;
+  }
+
+  stat = cc_epoch_ctor(&tmp->epoch);
+  if (stat != CDC_STATUS_OK) {
+    goto free_info;
+  }
+
+  struct cdc_data_info lru_info = CDC_INIT_STRUCT;
+  lru_info.hash = info->hash;
+  lru_info.eq = info->eq;
+  lru_info.dfree = free_entry;
+  stat = cc_lru_cache_ctor(&tmp->lru, max_size, &lru_info);
+  if (stat != CDC_STATUS_OK) {
+    goto free_epoch;
+  }
+
+  tmp->policy = *policy;
+  if (!tmp->policy.clock) {
+    tmp->policy.clock = monotonic_clock;
+  }
+
+  tmp->refresh_after =
+      (uint64_t)((double)policy->expire_after * policy->refresh_ratio);
+  if (policy->executor) {
+    tmp->executor = *policy->executor;
+  } else if (policy->load && policy->expire_after != 0) {
+    size_t nthreads = policy->nthreads != 0 ? policy->nthreads : 1;
+    stat = cc_thread_pool_ctor(&tmp->pool, nthreads);
+    if (stat != CDC_STATUS_OK) {
+      goto free_lru;
+    }
+
+    tmp->executor = cc_thread_pool_executor(tmp->pool);
+  }
+
+  stat = CDC_STATUS_UNKNOWN_ERROR;
+  if (pthread_mutex_init(&tmp->mutex, NULL) != 0) {
+    goto free_pool;
+  }
+
+  if (pthread_cond_init(&tmp->idle, NULL) != 0) {
+    goto free_mutex;
+  }
+
+  *c = tmp;
+  return CDC_STATUS_OK;
+
+free_mutex:
+  pthread_mutex_destroy(&tmp->mutex);
+free_pool:
+  if (tmp->pool) {
+    cc_thread_pool_dtor(tmp->pool);
+  }
+free_lru:
+  cc_lru_cache_dtor(tmp->lru);
+free_epoch:
+  cc_epoch_dtor(tmp->epoch);
+free_info:
+  cdc_di_shared_dtor(tmp->dinfo);
+free_cache:
+  free(tmp);
+  return stat;
+}
+
+void cc_refresh_cache_dtor(struct cc_refresh_cache *c)
+{
+  assert(c != NULL);
+
+  cc_refresh_cache_drain(c);
+  if (c->pool) {
+    cc_thread_pool_dtor(c->pool);
+  }
+
+  cc_lru_cache_dtor(c->lru);
+  // Frees the pairs retired by the lru cache.
+  cc_epoch_dtor(c->epoch);
+  pthread_cond_destroy(&c->idle);
+  pthread_mutex_destroy(&c->mutex);
+  cdc_di_shared_dtor(c->dinfo);
+  free(c);
+}
+
+void cc_refresh_cache_drain(struct cc_refresh_cache *c)
+{
+  assert(c != NULL);
+
+  pthread_mutex_lock(&c->mutex);
+  while (c->pending != 0) {
+    pthread_cond_wait(&c->idle, &c->mutex);
+  }
+
+  pthread_mutex_unlock(&c->mutex);
+}
+
+enum cdc_stat cc_refresh_cache_get(struct cc_refresh_cache *c,
+                                   struct cc_epoch_record *r, void *key,
+                                   void **value)
+{
+  assert(c != NULL);
+  assert(value != NULL);
+  assert(cc_epoch_active(r));
+  CDC_UNUSED(r);
+
+  pthread_mutex_lock(&c->mutex);
+  uint64_t time = now(c);
+  struct cc_refresh_entry *entry = find_entry(c, key, time);
+  if (entry) {
+    bool refresh = should_refresh(c, entry, time);
+    if (refresh) {
+      entry->refreshing = true;
+      entry->refresh_base = entry->write_time;
+      ++entry->refs;
+      ++c->pending;
+    }
+
+    *value = entry->value;
+    unlock(c);
+    // The executor may run the task inline, so the mutex must be released.
+    if (refresh) {
+      cc_executor_execute(&c->executor, refresh_task, entry);
+    }
+
+    return CDC_STATUS_OK;
+  }
+
+  unlock(c);
+  if (!c->policy.load) {
+    return CDC_STATUS_NOT_FOUND;
+  }
+
+  return load(c, key, value);
+}
+
+bool cc_refresh_cache_contains(struct cc_refresh_cache *c, void *key)
+{
+  assert(c != NULL);
+
+  pthread_mutex_lock(&c->mutex);
+  bool found = find_entry(c, key, now(c)) != NULL;
+  unlock(c);
+  return found;
+}
+
+size_t cc_refresh_cache_size(struct cc_refresh_cache *c)
+{
+  assert(c != NULL);
+
+  pthread_mutex_lock(&c->mutex);
+  size_t size = cc_lru_cache_size(c->lru);
+  unlock(c);
+  return size;
+}
+
+bool cc_refresh_cache_empty(struct cc_refresh_cache *c)
+{
+  assert(c != NULL);
+
+  return cc_refresh_cache_size(c) == 0;
+}
+
+void cc_refresh_cache_set_max_size(struct cc_refresh_cache *c,
+                                   size_t max_size)
+{
+  assert(c != NULL);
+
+  pthread_mutex_lock(&c->mutex);
+  cc_lru_cache_set_max_size(c->lru, max_size);
+  unlock(c);
+}
+
+size_t cc_refresh_cache_trim(struct cc_refresh_cache *c, size_t budget)
+{
+  assert(c != NULL);
+
+  pthread_mutex_lock(&c->mutex);
+  size_t count = cc_lru_cache_trim(c->lru, budget);
+  unlock(c);
+  return count;
+}
+
+enum cdc_stat cc_refresh_cache_insert(struct cc_refresh_cache *c, void *key,
+                                      void *value, bool *inserted)
+{
+  assert(c != NULL);
+
+  pthread_mutex_lock(&c->mutex);
+  uint64_t time = now(c);
+  enum cdc_stat stat = CDC_STATUS_OK;
+  bool is_new = find_entry(c, key, time) == NULL;
+  if (is_new) {
+    stat = insert_new(c, key, value, time);
+  }
+
+  unlock(c);
+  if (stat == CDC_STATUS_OK && inserted) {
+    *inserted = is_new;
+  }
+
+  return stat;
+}
+
+enum cdc_stat cc_refresh_cache_insert_or_assign(struct cc_refresh_cache *c,
+                                                void *key, void *value,
+                                                bool *inserted)
+{
+  assert(c != NULL);
+
+  // Allocated up front, so that a failure leaves the cache unchanged.
+  struct cc_refresh_retired *r = new_retired(c);
+  if (CDC_HAS_DFREE(c->dinfo) && !r) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  pthread_mutex_lock(&c->mutex);
+  uint64_t time = now(c);
+  enum cdc_stat stat = CDC_STATUS_OK;
+  struct cc_refresh_entry *entry = find_entry(c, key, time);
+  if (entry) {
+    replace_value(c, entry, value, r);
+    entry->write_time = time;
+  } else {
+    free(r);
+    stat = insert_new(c, key, value, time);
+  }
+
+  unlock(c);
+  if (stat == CDC_STATUS_OK && inserted) {
+    *inserted = entry == NULL;
+  }
+
+  return stat;
+}
+
+void cc_refresh_cache_erase(struct cc_refresh_cache *c, void *key)
+{
+  assert(c != NULL);
+
+  pthread_mutex_lock(&c->mutex);
+  cc_lru_cache_erase(c->lru, key);
+  unlock(c);
+}
+
+void cc_refresh_cache_take(struct cc_refresh_cache *c, void *key,
+                           struct cdc_pair *kv)
+{
+  assert(c != NULL);
+
+  pthread_mutex_lock(&c->mutex);
+  struct cdc_pair tmp = {NULL, NULL};
+  cc_lru_cache_take(c->lru, key, &tmp);
+  struct cc_refresh_entry *entry = (struct cc_refresh_entry *)tmp.second;
+  if (entry) {
+    kv->first = entry->key;
+    kv->second = entry->value;
+    entry->live = false;
+    entry->taken = true;
+    unref_entry(entry);
+  }
+
+  unlock(c);
+}
+
+void cc_refresh_cache_clear(struct cc_refresh_cache *c)
+{
+  assert(c != NULL);
+
+  pthread_mutex_lock(&c->mutex);
+  cc_lru_cache_clear(c->lru);
+  unlock(c);
+}
@@ -0,0 +1,391 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "ccache/sampled.h"
+
+#include "memory.h"
+#include "mix.h"
+#include "probes.h"
+
+#include <cdcontainers/data-info.h>
+#include <cdcontainers/hash-table.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t tick(struct cc_sampled_cache *c)
+{
+  if (++c->clock == 0) {
+    c->clock = 1;
+  }
+
+  return c->clock;
+}
+
+static size_t random_slot(struct cc_sampled_cache *c)
+{
+  c->seed += 0x9e3779b97f4a7c15ull;
+  return (size_t)(cc_mix64(c->seed) % c->max_size);
+}
+
+static void push_free(struct cc_sampled_cache *c,
+                      struct cc_sampled_entry *entry)
+{
+  entry->key = NULL;
+  entry->value = (void *)(uintptr_t)c->free;
+  entry->access = 0;
+  c->free = (size_t)(entry - c->entries);
+}
+
+static struct cc_sampled_entry *pop_free(struct cc_sampled_cache *c)
+{
+  struct cc_sampled_entry *entry = c->entries + c->free;
+  c->free = (size_t)(uintptr_t)entry->value;
+  return entry;
+}
+
+static void reset_slots(struct cc_sampled_cache *c)
+{
+  c->free = c->max_size;
+  for (size_t i = c->max_size; i > 0; --i) {
+    push_free(c, c->entries + i - 1);
+  }
+
+  c->size = 0;
+  c->pool_size = 0;
+}
+
+static void free_entry(struct cc_sampled_cache *c,
+                       struct cc_sampled_entry *entry, bool remove_data)
+{
+  cdc_hash_table_erase(c->table, entry->key);
+  if (remove_data && CDC_HAS_DFREE(c->dinfo)) {
+    struct cdc_pair kv = {entry->key, entry->value};
+    c->dinfo->dfree(&kv);
+  }
+
+  push_free(c, entry);
+  --c->size;
+}
+
+// Keeps the candidates ordered by age. The pool holds the oldest entries seen
+// in the previous samples, so an old entry which was sampled once is not lost
+// when the next sample misses it.
+static void pool_add(struct cc_sampled_cache *c,
+                     struct cc_sampled_entry *entry)
+{
+  uint32_t age = c->clock - entry->access;
+  size_t pos = c->pool_size;
+  for (size_t i = 0; i < c->pool_size; ++i) {
+    struct cc_sampled_candidate *candidate = c->pool + i;
+    if (candidate->entry == entry && candidate->access == entry->access) {
+      return;
+    }
+
+    if (pos == c->pool_size &&
+        (uint32_t)(c->clock - candidate->access) < age) {
+      pos = i;
+    }
+  }
+
+  if (c->pool_size == CC_SAMPLED_POOL_SIZE) {
+    if (pos == c->pool_size) {
+      return;
+    }
+
+    --c->pool_size;
+  }
+
+  memmove(c->pool + pos + 1, c->pool + pos,
+          (c->pool_size - pos) * sizeof(struct cc_sampled_candidate));
+  c->pool[pos].entry = entry;
+  c->pool[pos].access = entry->access;
+  ++c->pool_size;
+}
+
+static void evict(struct cc_sampled_cache *c)
+{
+  for (;;) {
+    for (size_t i = 0; i < c->samples; ++i) {
+      struct cc_sampled_entry *entry = c->entries + random_slot(c);
+      if (entry->access) {
+        pool_add(c, entry);
+      }
+    }
+
+    while (c->pool_size > 0) {
+      struct cc_sampled_candidate candidate = c->pool[0];
+      --c->pool_size;
+      memmove(c->pool, c->pool + 1,
+              c->pool_size * sizeof(struct cc_sampled_candidate));
+      // Entries that were used, erased or replaced since they were sampled
+      // are dropped.
+      if (candidate.entry->access == candidate.access) {
+        CC_PROBE_EVICT(c, candidate.entry->key, c->table->dinfo->hash);
+        free_entry(c, candidate.entry, true /* remove_data */);
+        return;
+      }
+    }
+  }
+}
+
+static enum cdc_stat insert_new(struct cc_sampled_cache *c, void *key,
+                                void *value)
+{
+  if (c->size == c->max_size) {
+    evict(c);
+  }
+
+  struct cc_sampled_entry *entry = pop_free(c);
+  enum cdc_stat stat = cdc_hash_table_insert(
+      c->table, key, entry, NULL /* it */, NULL /* inserted */);
+  if (stat != CDC_STATUS_OK) {
+    push_free(c, entry);
+    return stat;
+  }
+
+  entry->key = key;
+  entry->value = value;
+  entry->access = tick(c);
+  ++c->size;
+  CC_PROBE_INSERT(c, key);
+  return CDC_STATUS_OK;
+}
+
+enum cdc_stat cc_sampled_cache_ctor(struct cc_sampled_cache **c,
+                                    size_t max_size,
+                                    struct cdc_data_info *info)
+{
+  assert(c != NULL);
+  assert(info != NULL);
+  assert(max_size > 0);
+
+  struct cc_sampled_cache *tmp =
+      (struct cc_sampled_cache *)calloc(sizeof(struct cc_sampled_cache), 1);
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  enum cdc_stat stat = CDC_STATUS_BAD_ALLOC;
+  tmp->entries = (struct cc_sampled_entry *)malloc(
+      max_size * sizeof(struct cc_sampled_entry));
+  if (!tmp->entries) {
+    goto free_cache;
+  }
+
+  if (CDC_HAS_DFREE(info)) {
+    struct cdc_data_info entry_info = CDC_INIT_STRUCT;
+    entry_info.dfree = info->dfree;
+    tmp->dinfo = cdc_di_shared_ctorc(&entry_info);
+    if (!tmp->dinfo) {
+      goto free_entries;
+    }
+  }
+
+  struct cdc_data_info ht_info = CDC_INIT_STRUCT;
+  ht_info.hash = info->hash;
+  ht_info.eq = info->eq;
+  stat = cdc_hash_table_ctor(&tmp->table, &ht_info);
+  if (stat != CDC_STATUS_OK) {
+    goto free_dinfo;
+  }
+
+  tmp->max_size = max_size;
+  tmp->samples = CC_SAMPLED_DEFAULT_SAMPLES;
+  reset_slots(tmp);
+  *c = tmp;
+  return CDC_STATUS_OK;
+
+free_dinfo:
+  cdc_di_shared_dtor(tmp->dinfo);
+free_entries:
+  free(tmp->entries);
+free_cache:
+  free(tmp);
+  return stat;
+}
+
+void cc_sampled_cache_dtor(struct cc_sampled_cache *c)
+{
+  assert(c != NULL);
+
+  cc_sampled_cache_clear(c);
+  cdc_hash_table_dtor(c->table);
+  cdc_di_shared_dtor(c->dinfo);
+  free(c->entries);
+  free(c);
+}
+
+enum cdc_stat cc_sampled_cache_get(struct cc_sampled_cache *c, void *key,
+                                   void **value)
+{
+  assert(c != NULL);
+  assert(value != NULL);
+
+  struct cc_sampled_entry *entry = NULL;
+  enum cdc_stat stat = cdc_hash_table_get(c->table, key, (void **)&entry);
+  if (stat != CDC_STATUS_OK) {
+    CC_PROBE_GET_MISS(c, key);
+    return stat;
+  }
+
+  CC_PROBE_GET_HIT(c, key);
+  entry->access = tick(c);
+  *value = entry->value;
+  return CDC_STATUS_OK;
+}
+
+bool cc_sampled_cache_contains(struct cc_sampled_cache *c, void *key)
+{
+  assert(c != NULL);
+
+  return cdc_hash_table_count(c->table, key) != 0;
+}
+
+size_t cc_sampled_cache_size(struct cc_sampled_cache *c)
+{
+  assert(c != NULL);
+
+  return c->size;
+}
+
+bool cc_sampled_cache_empty(struct cc_sampled_cache *c)
+{
+  assert(c != NULL);
+
+  return c->size == 0;
+}
+
+void cc_sampled_cache_set_samples(struct cc_sampled_cache *c, size_t samples)
+{
+  assert(c != NULL);
+  assert(samples > 0);
+
+  c->samples = samples;
+}
+
+enum cdc_stat cc_sampled_cache_insert(struct cc_sampled_cache *c, void *key,
+                                      void *value, bool *inserted)
+{
+  assert(c != NULL);
+
+  if (cdc_hash_table_count(c->table, key) != 0) {
+    if (inserted) {
+      *inserted = false;
+    }
+
+    return CDC_STATUS_OK;
+  }
+
+  enum cdc_stat stat = insert_new(c, key, value);
+  if (stat == CDC_STATUS_OK && inserted) {
+    *inserted = true;
+  }
+
+  return stat;
+}
+
+enum cdc_stat cc_sampled_cache_insert_or_assign(struct cc_sampled_cache *c,
+                                                void *key, void *value,
+                                                bool *inserted)
+{
+  assert(c != NULL);
+
+  struct cc_sampled_entry *entry = NULL;
+  if (cdc_hash_table_get(c->table, key, (void **)&entry) == CDC_STATUS_OK) {
+    if (CDC_HAS_DFREE(c->dinfo)) {
+      struct cdc_pair kv = {NULL, entry->value};
+      c->dinfo->dfree(&kv);
+    }
+
+    entry->value = value;
+    entry->access = tick(c);
+    if (inserted) {
+      *inserted = false;
+    }
+
+    return CDC_STATUS_OK;
+  }
+
+  enum cdc_stat stat = insert_new(c, key, value);
+  if (stat == CDC_STATUS_OK && inserted) {
+    *inserted = true;
+  }
+
+  return stat;
+}
+
+void cc_sampled_cache_erase(struct cc_sampled_cache *c, void *key)
+{
+  assert(c != NULL);
+
+  struct cc_sampled_entry *entry = NULL;
+  if (cdc_hash_table_get(c->table, key, (void **)&entry) == CDC_STATUS_OK) {
+    CC_PROBE_ERASE(c, key);
+    free_entry(c, entry, true /* remove_data */);
+  }
+}
+
+void cc_sampled_cache_take(struct cc_sampled_cache *c, void *key,
+                           struct cdc_pair *kv)
+{
+  assert(c != NULL);
+  assert(kv != NULL);
+
+  struct cc_sampled_entry *entry = NULL;
+  if (cdc_hash_table_get(c->table, key, (void **)&entry) == CDC_STATUS_OK) {
+    kv->first = entry->key;
+    kv->second = entry->value;
+    free_entry(c, entry, false /* remove_data */);
+  }
+}
+
+void cc_sampled_cache_clear(struct cc_sampled_cache *c)
+{
+  assert(c != NULL);
+
+  CC_PROBE_CLEAR(c);
+  if (CDC_HAS_DFREE(c->dinfo)) {
+    for (size_t i = 0; i < c->max_size; ++i) {
+      struct cc_sampled_entry *entry = c->entries + i;
+      if (entry->access) {
+        struct cdc_pair kv = {entry->key, entry->value};
+        c->dinfo->dfree(&kv);
+      }
+    }
+  }
+
+  cdc_hash_table_clear(c->table);
+  reset_slots(c);
+}
+
+struct cc_memory_usage cc_sampled_cache_memory_usage(
+    struct cc_sampled_cache *c)
+{
+  assert(c != NULL);
+
+  struct cc_memory_usage usage;
+  usage.metadata =
+      cc_alloc_size(sizeof(struct cc_sampled_cache)) +
+      cc_alloc_size(c->max_size * sizeof(struct cc_sampled_entry)) +
+      cc_hash_table_memory_usage(c->table);
+  usage.payload = 0;
+  return usage;
+}
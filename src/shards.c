@@ -0,0 +1,345 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "ccache/shards.h"
+
+#include "mix.h"
+
+#include <cdcontainers/data-info.h>
+#include <cdcontainers/hash-table.h>
+
+#include <stdlib.h>
+
+#define CC_SHARDS_MODULUS ((uint64_t)1 << 24)
+#define CC_SHARDS_BUCKETS 1024
+
+struct cc_shards_node {
+  struct cc_shards_node *left;
+  struct cc_shards_node *right;
+  uint64_t time;
+  uint64_t key;
+  uint64_t priority;
+  size_t size;
+};
+
+static int key_eq(const void *l, const void *r) { return l == r; }
+
+static size_t key_hash(const void *key) { return (size_t)(uintptr_t)key; }
+
+static void *to_key(uint64_t key) { return (void *)(uintptr_t)key; }
+
+static size_t size(struct cc_shards_node *node)
+{
+  return node ? node->size : 0;
+}
+
+static void update(struct cc_shards_node *node)
+{
+  node->size = 1 + size(node->left) + size(node->right);
+}
+
+static struct cc_shards_node *merge(struct cc_shards_node *l,
+                                    struct cc_shards_node *r)
+{
+  if (!l || !r) {
+    return l ? l : r;
+  }
+
+  if (l->priority > r->priority) {
+    l->right = merge(l->right, r);
+    update(l);
+    return l;
+  }
+
+  r->left = merge(l, r->left);
+  update(r);
+  return r;
+}
+
+// Times grow monotonically, so a new node is always the rightmost one.
+static struct cc_shards_node *insert_last(struct cc_shards_node *root,
+                                          struct cc_shards_node *node)
+{
+  if (!root) {
+    return node;
+  }
+
+  if (node->priority > root->priority) {
+    node->left = root;
+    update(node);
+    return node;
+  }
+
+  root->right = insert_last(root->right, node);
+  update(root);
+  return root;
+}
+
+static struct cc_shards_node *unlink_node(struct cc_shards_node *root,
+                                          uint64_t time)
+{
+  if (root->time == time) {
+    return merge(root->left, root->right);
+  }
+
+  if (time < root->time) {
+    root->left = unlink_node(root->left, time);
+  } else {
+    root->right = unlink_node(root->right, time);
+  }
+
+  update(root);
+  return root;
+}
+
+// Returns the number of keys accessed after time.
+static size_t count_after(struct cc_shards_node *root, uint64_t time)
+{
+  size_t count = 0;
+  while (root) {
+    if (root->time > time) {
+      count += 1 + size(root->right);
+      root = root->left;
+    } else {
+      root = root->right;
+    }
+  }
+
+  return count;
+}
+
+static void free_tree(struct cc_shards_node *root)
+{
+  if (root) {
+    free_tree(root->left);
+    free_tree(root->right);
+    free(root);
+  }
+}
+
+static bool is_sampled(struct cc_shards *s, uint64_t key)
+{
+  return (key & (CC_SHARDS_MODULUS - 1)) < s->threshold;
+}
+
+static void add_distance(struct cc_shards *s, size_t count)
+{
+  uint64_t distance =
+      (uint64_t)((double)count * CC_SHARDS_MODULUS / (double)s->threshold);
+  uint64_t bucket = distance / s->bucket_size;
+  ++s->histogram[bucket < s->nbuckets ? bucket : s->nbuckets];
+}
+
+static size_t collect(struct cc_shards_node *root,
+                      struct cc_shards_node **nodes, size_t count)
+{
+  if (root) {
+    count = collect(root->left, nodes, count);
+    nodes[count++] = root;
+    count = collect(root->right, nodes, count);
+  }
+
+  return count;
+}
+
+// Halves the sampling rate and drops the keys that are no longer sampled.
+static void lower_rate(struct cc_shards *s)
+{
+  size_t count = size(s->root);
+  struct cc_shards_node **nodes =
+      (struct cc_shards_node **)malloc(sizeof(struct cc_shards_node *) * count);
+  if (!nodes) {
+    return;
+  }
+
+  if (s->threshold > 1) {
+    s->threshold /= 2;
+  }
+
+  collect(s->root, nodes, 0);
+  s->root = NULL;
+  for (size_t i = 0; i < count; ++i) {
+    struct cc_shards_node *node = nodes[i];
+    if (is_sampled(s, node->key)) {
+      node->left = NULL;
+      node->right = NULL;
+      node->size = 1;
+      s->root = insert_last(s->root, node);
+    } else {
+      cdc_hash_table_erase(s->table, to_key(node->key));
+      free(node);
+    }
+  }
+
+  free(nodes);
+}
+
+enum cdc_stat cc_shards_ctor(struct cc_shards **s, double rate,
+                             size_t max_samples, size_t max_distance,
+                             struct cdc_data_info *info)
+{
+  assert(s != NULL);
+  assert(info != NULL);
+  assert(rate > 0.0 && rate <= 1.0);
+  assert(max_samples > 0);
+  assert(max_distance > 0);
+
+  struct cc_shards *tmp =
+      (struct cc_shards *)calloc(sizeof(struct cc_shards), 1);
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  tmp->nbuckets =
+      max_distance < CC_SHARDS_BUCKETS ? max_distance : CC_SHARDS_BUCKETS;
+  tmp->bucket_size = (max_distance + tmp->nbuckets - 1) / tmp->nbuckets;
+  tmp->histogram = (uint64_t *)calloc(sizeof(uint64_t), tmp->nbuckets + 1);
+  if (!tmp->histogram) {
+    free(tmp);
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  struct cdc_data_info ht_info = CDC_INIT_STRUCT;
+  ht_info.hash = key_hash;
+  ht_info.eq = key_eq;
+  enum cdc_stat stat = cdc_hash_table_ctor(&tmp->table, &ht_info);
+  if (stat != CDC_STATUS_OK) {
+    free(tmp->histogram);
+    free(tmp);
+    return stat;
+  }
+
+  tmp->hash = info->hash;
+  tmp->threshold = (uint64_t)(rate * (double)CC_SHARDS_MODULUS);
+  if (tmp->threshold == 0) {
+    tmp->threshold = 1;
+  }
+
+  tmp->max_samples = max_samples;
+  *s = tmp;
+  return CDC_STATUS_OK;
+}
+
+void cc_shards_dtor(struct cc_shards *s)
+{
+  assert(s != NULL);
+
+  free_tree(s->root);
+  cdc_hash_table_dtor(s->table);
+  free(s->histogram);
+  free(s);
+}
+
+void cc_shards_access(struct cc_shards *s, void *key)
+{
+  assert(s != NULL);
+
+  uint64_t k = cc_mix64(s->hash(key));
+  if (!is_sampled(s, k)) {
+    return;
+  }
+
+  ++s->references;
+  struct cc_shards_node *node = NULL;
+  if (cdc_hash_table_get(s->table, to_key(k), (void **)&node) ==
+      CDC_STATUS_OK) {
+    add_distance(s, count_after(s->root, node->time));
+    s->root = unlink_node(s->root, node->time);
+  } else {
+    node = (struct cc_shards_node *)malloc(sizeof(struct cc_shards_node));
+    if (!node) {
+      return;
+    }
+
+    if (cdc_hash_table_insert(s->table, to_key(k), node, NULL /* it */,
+                              NULL /* inserted */) != CDC_STATUS_OK) {
+      free(node);
+      return;
+    }
+
+    node->key = k;
+    ++s->cold_misses;
+  }
+
+  node->left = NULL;
+  node->right = NULL;
+  node->size = 1;
+  node->time = ++s->time;
+  node->priority = cc_mix64(node->time ^ k);
+  s->root = insert_last(s->root, node);
+  if (size(s->root) > s->max_samples) {
+    lower_rate(s);
+  }
+}
+
+void cc_shards_clear(struct cc_shards *s)
+{
+  assert(s != NULL);
+
+  free_tree(s->root);
+  s->root = NULL;
+  cdc_hash_table_clear(s->table);
+  for (size_t i = 0; i <= s->nbuckets; ++i) {
+    s->histogram[i] = 0;
+  }
+
+  s->cold_misses = 0;
+  s->references = 0;
+}
+
+double cc_shards_rate(struct cc_shards *s)
+{
+  assert(s != NULL);
+
+  return (double)s->threshold / (double)CC_SHARDS_MODULUS;
+}
+
+double cc_shards_miss_ratio(struct cc_shards *s, size_t cache_size)
+{
+  assert(s != NULL);
+
+  if (s->references == 0) {
+    return 1.0;
+  }
+
+  // A reference hits if its reuse distance is below the cache size.
+  double hits = 0.0;
+  size_t full = cache_size / s->bucket_size;
+  for (size_t i = 0; i < full && i < s->nbuckets; ++i) {
+    hits += (double)s->histogram[i];
+  }
+
+  if (full < s->nbuckets) {
+    size_t rest = cache_size % s->bucket_size;
+    hits += (double)s->histogram[full] * (double)rest / (double)s->bucket_size;
+  }
+
+  return 1.0 - hits / (double)s->references;
+}
+
+void cc_shards_miss_ratio_curve(struct cc_shards *s, const size_t *sizes,
+                                double *ratios, size_t n)
+{
+  assert(s != NULL);
+
+  for (size_t i = 0; i < n; ++i) {
+    ratios[i] = cc_shards_miss_ratio(s, sizes[i]);
+  }
+}
@@ -0,0 +1,298 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "ccache/slru.h"
+
+#include "list.h"
+#include "probes.h"
+
+#include <cdcontainers/data-info.h>
+#include <cdcontainers/hash-table.h>
+
+#include <stdlib.h>
+
+#define CC_SLRU_PROTECTED_SHARE 0.8
+
+struct cc_slru_node {
+  struct cc_list_node base;
+  bool is_protected;
+};
+
+static struct cc_list *segment(struct cc_slru_cache *c,
+                               struct cc_slru_node *node)
+{
+  return node->is_protected ? c->protected_list : c->probation;
+}
+
+static void demote_overflow(struct cc_slru_cache *c)
+{
+  while (c->protected_size > c->protected_max_size) {
+    struct cc_slru_node *node = (struct cc_slru_node *)c->protected_list->tail;
+    cc_list_unlink_node(c->protected_list, &node->base);
+    cc_list_push_front_node(c->probation, &node->base);
+    node->is_protected = false;
+    --c->protected_size;
+  }
+}
+
+static void touch(struct cc_slru_cache *c, struct cc_slru_node *node)
+{
+  cc_list_unlink_node(segment(c, node), &node->base);
+  cc_list_push_front_node(c->protected_list, &node->base);
+  if (!node->is_protected) {
+    node->is_protected = true;
+    ++c->protected_size;
+    demote_overflow(c);
+  }
+}
+
+static void remove_node(struct cc_slru_cache *c, struct cc_slru_node *node,
+                        bool remove_data)
+{
+  struct cc_list *l = segment(c, node);
+  if (node->is_protected) {
+    --c->protected_size;
+  }
+
+  cc_list_unlink_node(l, &node->base);
+  cdc_hash_table_erase(c->table, node->base.kv.first);
+  cc_list_free_node(l, &node->base, remove_data);
+}
+
+static enum cdc_stat insert_new(struct cc_slru_cache *c, void *key,
+                                void *value)
+{
+  if (cc_slru_cache_size(c) >= c->max_size) {
+    struct cc_list_node *victim =
+        c->probation->tail ? c->probation->tail : c->protected_list->tail;
+    CC_PROBE_EVICT(c, victim->kv.first, c->table->dinfo->hash);
+    remove_node(c, (struct cc_slru_node *)victim, true /* remove_data */);
+  }
+
+  struct cc_slru_node *node =
+      (struct cc_slru_node *)malloc(sizeof(struct cc_slru_node));
+  if (!node) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  node->base.kv.first = key;
+  node->base.kv.second = value;
+  node->is_protected = false;
+  enum cdc_stat stat = cdc_hash_table_insert(c->table, key, node, NULL /* it */,
+                                             NULL /* inserted */);
+  if (stat != CDC_STATUS_OK) {
+    cc_list_free_node(c->probation, &node->base, true /* remove_data */);
+    return stat;
+  }
+
+  cc_list_push_front_node(c->probation, &node->base);
+  CC_PROBE_INSERT(c, key);
+  return CDC_STATUS_OK;
+}
+
+enum cdc_stat cc_slru_cache_ctor(struct cc_slru_cache **c, size_t max_size,
+                                 struct cdc_data_info *info)
+{
+  assert(c != NULL);
+  assert(info != NULL);
+  assert(max_size > 0);
+
+  struct cc_slru_cache *tmp =
+      (struct cc_slru_cache *)malloc(sizeof(struct cc_slru_cache));
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  struct cdc_data_info list_info = CDC_INIT_STRUCT;
+  list_info.dfree = info->dfree;
+  struct cdc_data_info *linfo = CDC_HAS_DFREE(info) ? &list_info : NULL;
+  enum cdc_stat stat = cc_list_ctor(&tmp->probation, linfo);
+  if (stat != CDC_STATUS_OK) {
+    goto free_cache;
+  }
+
+  stat = cc_list_ctor(&tmp->protected_list, linfo);
+  if (stat != CDC_STATUS_OK) {
+    goto free_probation;
+  }
+
+  struct cdc_data_info ht_info = CDC_INIT_STRUCT;
+  ht_info.hash = info->hash;
+  ht_info.eq = info->eq;
+  stat = cdc_hash_table_ctor(&tmp->table, &ht_info);
+  if (stat != CDC_STATUS_OK) {
+    goto free_protected;
+  }
+
+  tmp->max_size = max_size;
+  tmp->protected_max_size = (size_t)(max_size * CC_SLRU_PROTECTED_SHARE);
+  tmp->protected_size = 0;
+  *c = tmp;
+  return CDC_STATUS_OK;
+
+free_protected:
+  cc_list_dtor(tmp->protected_list);
+free_probation:
+  cc_list_dtor(tmp->probation);
+free_cache:
+  free(tmp);
+  return stat;
+}
+
+void cc_slru_cache_dtor(struct cc_slru_cache *c)
+{
+  assert(c != NULL);
+
+  cdc_hash_table_dtor(c->table);
+  cc_list_dtor(c->protected_list);
+  cc_list_dtor(c->probation);
+  free(c);
+}
+
+enum cdc_stat cc_slru_cache_get(struct cc_slru_cache *c, void *key,
+                                void **value)
+{
+  assert(c != NULL);
+  assert(value != NULL);
+
+  struct cc_slru_node *node = NULL;
+  enum cdc_stat stat = cdc_hash_table_get(c->table, key, (void **)&node);
+  if (stat != CDC_STATUS_OK) {
+    CC_PROBE_GET_MISS(c, key);
+    return stat;
+  }
+
+  CC_PROBE_GET_HIT(c, key);
+  touch(c, node);
+  *value = node->base.kv.second;
+  return CDC_STATUS_OK;
+}
+
+bool cc_slru_cache_contains(struct cc_slru_cache *c, void *key)
+{
+  assert(c != NULL);
+
+  return cdc_hash_table_count(c->table, key) != 0;
+}
+
+size_t cc_slru_cache_size(struct cc_slru_cache *c)
+{
+  assert(c != NULL);
+
+  return cdc_hash_table_size(c->table);
+}
+
+bool cc_slru_cache_empty(struct cc_slru_cache *c)
+{
+  assert(c != NULL);
+
+  return cdc_hash_table_empty(c->table);
+}
+
+void cc_slru_cache_set_protected_share(struct cc_slru_cache *c, double share)
+{
+  assert(c != NULL);
+  assert(share >= 0 && share <= 1);
+
+  c->protected_max_size = (size_t)(c->max_size * share);
+  demote_overflow(c);
+}
+
+enum cdc_stat cc_slru_cache_insert(struct cc_slru_cache *c, void *key,
+                                   void *value, bool *inserted)
+{
+  assert(c != NULL);
+
+  if (cdc_hash_table_count(c->table, key) != 0) {
+    if (inserted) {
+      *inserted = false;
+    }
+
+    return CDC_STATUS_OK;
+  }
+
+  enum cdc_stat stat = insert_new(c, key, value);
+  if (stat == CDC_STATUS_OK && inserted) {
+    *inserted = true;
+  }
+
+  return stat;
+}
+
+enum cdc_stat cc_slru_cache_insert_or_assign(struct cc_slru_cache *c,
+                                             void *key, void *value,
+                                             bool *inserted)
+{
+  assert(c != NULL);
+
+  struct cc_slru_node *node = NULL;
+  if (cdc_hash_table_get(c->table, key, (void **)&node) == CDC_STATUS_OK) {
+    // Try to remove old value.
+    cc_list_free_value(c->probation, node->base.kv.second);
+    node->base.kv.second = value;
+    touch(c, node);
+    if (inserted) {
+      *inserted = false;
+    }
+
+    return CDC_STATUS_OK;
+  }
+
+  enum cdc_stat stat = insert_new(c, key, value);
+  if (stat == CDC_STATUS_OK && inserted) {
+    *inserted = true;
+  }
+
+  return stat;
+}
+
+void cc_slru_cache_erase(struct cc_slru_cache *c, void *key)
+{
+  assert(c != NULL);
+
+  struct cc_slru_node *node = NULL;
+  if (cdc_hash_table_get(c->table, key, (void **)&node) == CDC_STATUS_OK) {
+    CC_PROBE_ERASE(c, key);
+    remove_node(c, node, true /* remove_data */);
+  }
+}
+
+void cc_slru_cache_take(struct cc_slru_cache *c, void *key,
+                        struct cdc_pair *kv)
+{
+  assert(c != NULL);
+
+  struct cc_slru_node *node = NULL;
+  if (cdc_hash_table_get(c->table, key, (void **)&node) == CDC_STATUS_OK) {
+    *kv = node->base.kv;
+    remove_node(c, node, false /* remove_data */);
+  }
+}
+
+void cc_slru_cache_clear(struct cc_slru_cache *c)
+{
+  assert(c != NULL);
+
+  CC_PROBE_CLEAR(c);
+  cdc_hash_table_clear(c->table);
+  cc_list_clear(c->protected_list);
+  cc_list_clear(c->probation);
+  c->protected_size = 0;
+}
@@ -0,0 +1,258 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "tags.h"
+
+#include "ccache/hash.h"
+
+#include <cdcontainers/common.h>
+#include <cdcontainers/data-info.h>
+#include <cdcontainers/hash-table.h>
+
+#include <assert.h>
+#include <stdlib.h>
+
+static int eq_tag(const void *l, const void *r) { return l == r; }
+
+static struct cc_tag *find_tag(struct cc_tag_index *t, void *tag)
+{
+  struct cc_tag *result = NULL;
+  if (cdc_hash_table_get(t->tags, tag, (void **)&result) != CDC_STATUS_OK) {
+    return NULL;
+  }
+
+  return result;
+}
+
+static struct cc_tag *new_tag(struct cc_tag_index *t, void *tag)
+{
+  struct cc_tag *result = (struct cc_tag *)calloc(sizeof(struct cc_tag), 1);
+  if (!result) {
+    return NULL;
+  }
+
+  if (cdc_hash_table_insert(t->tags, tag, result, NULL /* it */,
+                            NULL /* inserted */) != CDC_STATUS_OK) {
+    free(result);
+    return NULL;
+  }
+
+  result->tag = tag;
+  result->next = t->head;
+  if (t->head) {
+    t->head->prev = result;
+  }
+
+  t->head = result;
+  return result;
+}
+
+static void free_tag(struct cc_tag_index *t, struct cc_tag *tag)
+{
+  cdc_hash_table_erase(t->tags, tag->tag);
+  if (tag->prev) {
+    tag->prev->next = tag->next;
+  } else {
+    t->head = tag->next;
+  }
+
+  if (tag->next) {
+    tag->next->prev = tag->prev;
+  }
+
+  free(tag);
+}
+
+enum cdc_stat cc_tag_index_ctor(struct cc_tag_index **t,
+                                struct cdc_data_info *info)
+{
+  assert(t != NULL);
+  assert(info != NULL);
+
+  struct cc_tag_index *tmp =
+      (struct cc_tag_index *)calloc(sizeof(struct cc_tag_index), 1);
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  struct cdc_data_info tags_info = CDC_INIT_STRUCT;
+  tags_info.hash = cc_hash_int_key;
+  tags_info.eq = eq_tag;
+  enum cdc_stat stat = cdc_hash_table_ctor(&tmp->tags, &tags_info);
+  if (stat != CDC_STATUS_OK) {
+    goto free_index;
+  }
+
+  struct cdc_data_info links_info = CDC_INIT_STRUCT;
+  links_info.hash = info->hash;
+  links_info.eq = info->eq;
+  stat = cdc_hash_table_ctor(&tmp->links, &links_info);
+  if (stat != CDC_STATUS_OK) {
+    goto free_tags;
+  }
+
+  *t = tmp;
+  return CDC_STATUS_OK;
+
+free_tags:
+  cdc_hash_table_dtor(tmp->tags);
+free_index:
+  free(tmp);
+  return stat;
+}
+
+void cc_tag_index_dtor(struct cc_tag_index *t)
+{
+  assert(t != NULL);
+
+  cc_tag_index_clear(t);
+  cdc_hash_table_dtor(t->links);
+  cdc_hash_table_dtor(t->tags);
+  free(t);
+}
+
+enum cdc_stat cc_tag_index_add(struct cc_tag_index *t, void *key, void *tag)
+{
+  assert(t != NULL);
+
+  struct cc_tag *record = find_tag(t, tag);
+  if (!record) {
+    record = new_tag(t, tag);
+    if (!record) {
+      return CDC_STATUS_BAD_ALLOC;
+    }
+  }
+
+  struct cc_tag_link *link =
+      (struct cc_tag_link *)malloc(sizeof(struct cc_tag_link));
+  if (!link || cdc_hash_table_insert(t->links, key, link, NULL /* it */,
+                                     NULL /* inserted */) != CDC_STATUS_OK) {
+    free(link);
+    if (record->size == 0) {
+      free_tag(t, record);
+    }
+
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  link->key = key;
+  link->tag = record;
+  link->generation = record->generation;
+  link->prev = NULL;
+  link->next = record->head;
+  if (record->head) {
+    record->head->prev = link;
+  }
+
+  record->head = link;
+  ++record->size;
+  return CDC_STATUS_OK;
+}
+
+void cc_tag_index_remove(struct cc_tag_index *t, void *key)
+{
+  assert(t != NULL);
+
+  struct cc_tag_link *link = NULL;
+  if (cdc_hash_table_empty(t->links) ||
+      cdc_hash_table_get(t->links, key, (void **)&link) != CDC_STATUS_OK) {
+    return;
+  }
+
+  cdc_hash_table_erase(t->links, key);
+  struct cc_tag *tag = link->tag;
+  if (link->prev) {
+    link->prev->next = link->next;
+  } else {
+    tag->head = link->next;
+  }
+
+  if (link->next) {
+    link->next->prev = link->prev;
+  }
+
+  // A tag without keys has nothing left to expire.
+  if (--tag->size == 0) {
+    free_tag(t, tag);
+  }
+
+  free(link);
+}
+
+void cc_tag_index_clear(struct cc_tag_index *t)
+{
+  assert(t != NULL);
+
+  while (t->head) {
+    struct cc_tag *tag = t->head;
+    t->head = tag->next;
+    while (tag->head) {
+      struct cc_tag_link *link = tag->head;
+      tag->head = link->next;
+      free(link);
+    }
+
+    free(tag);
+  }
+
+  cdc_hash_table_clear(t->links);
+  cdc_hash_table_clear(t->tags);
+}
+
+void cc_tag_index_expire(struct cc_tag_index *t, void *tag)
+{
+  assert(t != NULL);
+
+  struct cc_tag *record = find_tag(t, tag);
+  if (record) {
+    ++record->generation;
+  }
+}
+
+bool cc_tag_index_is_stale(struct cc_tag_index *t, void *key)
+{
+  assert(t != NULL);
+
+  struct cc_tag_link *link = NULL;
+  if (cdc_hash_table_empty(t->links) ||
+      cdc_hash_table_get(t->links, key, (void **)&link) != CDC_STATUS_OK) {
+    return false;
+  }
+
+  return link->generation != link->tag->generation;
+}
+
+size_t cc_tag_index_count(struct cc_tag_index *t, void *tag)
+{
+  assert(t != NULL);
+
+  struct cc_tag *record = find_tag(t, tag);
+  return record ? record->size : 0;
+}
+
+void *cc_tag_index_any(struct cc_tag_index *t, void *tag)
+{
+  assert(t != NULL);
+
+  struct cc_tag *record = find_tag(t, tag);
+  assert(record != NULL);
+
+  return record->head->key;
+}
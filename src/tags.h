@@ -0,0 +1,82 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#ifndef CCACHE_SRC_TAGS_H
+#define CCACHE_SRC_TAGS_H
+#include <cdcontainers/status.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct cdc_data_info;
+struct cdc_hash_table;
+struct cc_tag_link;
+
+// The keys of one tag, linked through their links.
+struct cc_tag {
+  void *tag;
+  // Links made before the last cc_tag_index_expire are stale.
+  uint64_t generation;
+  size_t size;
+  struct cc_tag_link *head;
+  struct cc_tag *prev;
+  struct cc_tag *next;
+};
+
+struct cc_tag_link {
+  void *key;
+  struct cc_tag *tag;
+  uint64_t generation;
+  struct cc_tag_link *prev;
+  struct cc_tag_link *next;
+};
+
+// Maps the keys of a cache to their tags and every tag to its keys, so that
+// the keys of a tag are found without a scan of the cache. Tags are compared
+// by their pointers.
+struct cc_tag_index {
+  // Stores pairs of tag and struct cc_tag.
+  struct cdc_hash_table *tags;
+  // Stores pairs of key and struct cc_tag_link.
+  struct cdc_hash_table *links;
+  struct cc_tag *head;
+};
+
+// Hashes and compares the keys with info.
+enum cdc_stat cc_tag_index_ctor(struct cc_tag_index **t,
+                                struct cdc_data_info *info);
+void cc_tag_index_dtor(struct cc_tag_index *t);
+
+// The key must not have a tag yet.
+enum cdc_stat cc_tag_index_add(struct cc_tag_index *t, void *key, void *tag);
+// Does nothing if the key has no tag.
+void cc_tag_index_remove(struct cc_tag_index *t, void *key);
+void cc_tag_index_clear(struct cc_tag_index *t);
+
+// Makes the keys which have the tag now stale in O(1).
+void cc_tag_index_expire(struct cc_tag_index *t, void *tag);
+bool cc_tag_index_is_stale(struct cc_tag_index *t, void *key);
+
+size_t cc_tag_index_count(struct cc_tag_index *t, void *tag);
+// Returns one of the keys of the tag, which must have at least one.
+void *cc_tag_index_any(struct cc_tag_index *t, void *tag);
+
+#endif  // CCACHE_SRC_TAGS_H
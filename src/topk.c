@@ -0,0 +1,303 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "ccache/topk.h"
+
+#include <cdcontainers/data-info.h>
+#include <cdcontainers/hash-table.h>
+
+#include <stdlib.h>
+
+struct cc_top_keys_counter {
+  struct cc_top_keys_counter *next;
+  struct cc_top_keys_counter *prev;
+  struct cc_top_keys_bucket *bucket;
+  void *key;
+  size_t error;
+};
+
+struct cc_top_keys_bucket {
+  // The next bucket has a greater count.
+  struct cc_top_keys_bucket *next;
+  struct cc_top_keys_bucket *prev;
+  struct cc_top_keys_counter *head;
+  size_t count;
+};
+
+static void *copy_key(struct cc_top_keys *t, void *key)
+{
+  return t->dinfo->cp ? t->dinfo->cp(key) : key;
+}
+
+static void free_key(struct cc_top_keys *t, void *key)
+{
+  if (t->dinfo->cp && CDC_HAS_DFREE(t->dinfo)) {
+    struct cdc_pair kv = {key, NULL};
+    t->dinfo->dfree(&kv);
+  }
+}
+
+static void init_free_buckets(struct cc_top_keys *t)
+{
+  t->free_buckets = NULL;
+  for (size_t i = 0; i <= t->capacity; ++i) {
+    t->buckets[i].next = t->free_buckets;
+    t->free_buckets = &t->buckets[i];
+  }
+
+  t->min = NULL;
+  t->max = NULL;
+}
+
+// Links a new bucket with the given count after prev (or first if NULL).
+static struct cc_top_keys_bucket *new_bucket(struct cc_top_keys *t,
+                                             struct cc_top_keys_bucket *prev,
+                                             size_t count)
+{
+  struct cc_top_keys_bucket *b = t->free_buckets;
+  t->free_buckets = b->next;
+  b->count = count;
+  b->head = NULL;
+  b->prev = prev;
+  b->next = prev ? prev->next : t->min;
+  if (b->next) {
+    b->next->prev = b;
+  } else {
+    t->max = b;
+  }
+
+  if (prev) {
+    prev->next = b;
+  } else {
+    t->min = b;
+  }
+
+  return b;
+}
+
+static void free_bucket(struct cc_top_keys *t, struct cc_top_keys_bucket *b)
+{
+  if (b->prev) {
+    b->prev->next = b->next;
+  } else {
+    t->min = b->next;
+  }
+
+  if (b->next) {
+    b->next->prev = b->prev;
+  } else {
+    t->max = b->prev;
+  }
+
+  b->next = t->free_buckets;
+  t->free_buckets = b;
+}
+
+static void attach(struct cc_top_keys_bucket *b, struct cc_top_keys_counter *c)
+{
+  c->bucket = b;
+  c->prev = NULL;
+  c->next = b->head;
+  if (b->head) {
+    b->head->prev = c;
+  }
+
+  b->head = c;
+}
+
+static void detach(struct cc_top_keys_counter *c)
+{
+  if (c->prev) {
+    c->prev->next = c->next;
+  } else {
+    c->bucket->head = c->next;
+  }
+
+  if (c->next) {
+    c->next->prev = c->prev;
+  }
+}
+
+static void increment(struct cc_top_keys *t, struct cc_top_keys_counter *c)
+{
+  struct cc_top_keys_bucket *b = c->bucket;
+  size_t count = b->count + 1;
+  struct cc_top_keys_bucket *next = b->next;
+  bool alone = b->head == c && !c->next;
+  if (alone && (!next || next->count != count)) {
+    b->count = count;
+    return;
+  }
+
+  if (!next || next->count != count) {
+    next = new_bucket(t, b, count);
+  }
+
+  detach(c);
+  attach(next, c);
+  if (!b->head) {
+    free_bucket(t, b);
+  }
+}
+
+enum cdc_stat cc_top_keys_ctor(struct cc_top_keys **t, size_t capacity,
+                               struct cdc_data_info *info)
+{
+  assert(t != NULL);
+  assert(info != NULL);
+  assert(capacity > 0);
+
+  struct cc_top_keys *tmp =
+      (struct cc_top_keys *)calloc(sizeof(struct cc_top_keys), 1);
+  if (!tmp) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  enum cdc_stat stat = CDC_STATUS_BAD_ALLOC;
+  tmp->counters = (struct cc_top_keys_counter *)malloc(
+      sizeof(struct cc_top_keys_counter) * capacity);
+  if (!tmp->counters) {
+    goto free_top_keys;
+  }
+
+  // One spare bucket for the moment when a counter moves to a new bucket.
+  tmp->buckets = (struct cc_top_keys_bucket *)malloc(
+      sizeof(struct cc_top_keys_bucket) * (capacity + 1));
+  if (!tmp->buckets) {
+    goto free_counters;
+  }
+
+  tmp->dinfo = cdc_di_shared_ctorc(info);
+  if (!tmp->dinfo) {
+    goto free_buckets;
+  }
+
+  struct cdc_data_info ht_info = CDC_INIT_STRUCT;
+  ht_info.hash = info->hash;
+  ht_info.eq = info->eq;
+  stat = cdc_hash_table_ctor(&tmp->table, &ht_info);
+  if (stat != CDC_STATUS_OK) {
+    goto free_info;
+  }
+
+  tmp->capacity = capacity;
+  init_free_buckets(tmp);
+  *t = tmp;
+  return CDC_STATUS_OK;
+
+free_info:
+  cdc_di_shared_dtor(tmp->dinfo);
+free_buckets:
+  free(tmp->buckets);
+free_counters:
+  free(tmp->counters);
+free_top_keys:
+  free(tmp);
+  return stat;
+}
+
+void cc_top_keys_dtor(struct cc_top_keys *t)
+{
+  assert(t != NULL);
+
+  cc_top_keys_clear(t);
+  cdc_hash_table_dtor(t->table);
+  cdc_di_shared_dtor(t->dinfo);
+  free(t->buckets);
+  free(t->counters);
+  free(t);
+}
+
+void cc_top_keys_add(struct cc_top_keys *t, void *key)
+{
+  assert(t != NULL);
+
+  struct cc_top_keys_counter *c = NULL;
+  if (cdc_hash_table_get(t->table, key, (void **)&c) == CDC_STATUS_OK) {
+    increment(t, c);
+    return;
+  }
+
+  void *copy = copy_key(t, key);
+  if (!copy) {
+    return;
+  }
+
+  c = t->size < t->capacity ? &t->counters[t->size] : t->min->head;
+  if (cdc_hash_table_insert(t->table, copy, c, NULL /* it */,
+                            NULL /* inserted */) != CDC_STATUS_OK) {
+    free_key(t, copy);
+    return;
+  }
+
+  if (t->size < t->capacity) {
+    ++t->size;
+    c->key = copy;
+    c->error = 0;
+    struct cc_top_keys_bucket *b = t->min;
+    if (!b || b->count != 1) {
+      b = new_bucket(t, NULL /* prev */, 1);
+    }
+
+    attach(b, c);
+    return;
+  }
+
+  // Replace a key with the minimum count.
+  cdc_hash_table_erase(t->table, c->key);
+  free_key(t, c->key);
+  c->key = copy;
+  c->error = c->bucket->count;
+  increment(t, c);
+}
+
+void cc_top_keys_clear(struct cc_top_keys *t)
+{
+  assert(t != NULL);
+
+  cdc_hash_table_clear(t->table);
+  for (size_t i = 0; i < t->size; ++i) {
+    free_key(t, t->counters[i].key);
+  }
+
+  t->size = 0;
+  init_free_buckets(t);
+}
+
+size_t cc_top_keys_get(struct cc_top_keys *t, size_t k, void **keys,
+                       size_t *counts)
+{
+  assert(t != NULL);
+  assert(keys != NULL);
+
+  size_t n = 0;
+  for (struct cc_top_keys_bucket *b = t->max; b && n < k; b = b->prev) {
+    for (struct cc_top_keys_counter *c = b->head; c && n < k; c = c->next) {
+      keys[n] = c->key;
+      if (counts) {
+        counts[n] = b->count;
+      }
+
+      ++n;
+    }
+  }
+
+  return n;
+}
@@ -0,0 +1,129 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "test-common.h"
+
+#include "ccache/2q.h"
+
+#include <CUnit/Basic.h>
+#include <cdcontainers/cdc.h>
+
+#include <stdlib.h>
+
+static int eq(const void *l, const void *r)
+{
+  return CDC_TO_INT(l) == CDC_TO_INT(r);
+}
+
+static size_t hash(const void *val) { return cdc_hash_int(CDC_TO_INT(val)); }
+
+static void free_value(void *data)
+{
+  struct cdc_pair *kv = (struct cdc_pair *)data;
+  free(kv->second);
+}
+
+static void insert(struct cc_2q_cache *c, int key)
+{
+  int *value = (int *)malloc(sizeof(int));
+  *value = key;
+  CU_ASSERT_EQUAL(cc_2q_cache_insert_or_assign(c, CDC_FROM_INT(key), value,
+                                               NULL /* inserted */),
+                  CDC_STATUS_OK);
+}
+
+void test_2q_cache_scan()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+  info.dfree = free_value;
+
+  struct cc_2q_cache *c = NULL;
+  CU_ASSERT_EQUAL(cc_2q_cache_ctor(&c, 8 /* max_size */, &info),
+                  CDC_STATUS_OK);
+
+  for (int key = 1; key <= 9; ++key) {
+    insert(c, key);
+  }
+
+  // Key 1 was pushed out of a1_in, so it is remembered in a1_out only.
+  CU_ASSERT_EQUAL(cc_2q_cache_size(c), 8);
+  CU_ASSERT(!cc_2q_cache_contains(c, CDC_FROM_INT(1)));
+  CU_ASSERT(cc_fifo_cache_contains(c->a1_out, CDC_FROM_INT(1)));
+
+  // Coming back from a1_out puts it into am.
+  insert(c, 1);
+  CU_ASSERT_EQUAL(cc_lru_cache_size(c->am), 1);
+  CU_ASSERT(!cc_fifo_cache_contains(c->a1_out, CDC_FROM_INT(1)));
+
+  // A scan goes through a1_in and does not touch am.
+  for (int key = 100; key < 200; ++key) {
+    insert(c, key);
+  }
+
+  CU_ASSERT_EQUAL(cc_2q_cache_size(c), 8);
+  CU_ASSERT(cc_fifo_cache_size(c->a1_out) <= 4);
+  void *value = NULL;
+  CU_ASSERT_EQUAL(cc_2q_cache_get(c, CDC_FROM_INT(1), &value), CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(*(int *)value, 1);
+  CU_ASSERT_EQUAL(cc_2q_cache_get(c, CDC_FROM_INT(199), &value),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(*(int *)value, 199);
+  cc_2q_cache_dtor(c);
+}
+
+void test_2q_cache_modifiers()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+  info.dfree = free_value;
+
+  struct cc_2q_cache *c = NULL;
+  CU_ASSERT_EQUAL(cc_2q_cache_ctor(&c, 4 /* max_size */, &info),
+                  CDC_STATUS_OK);
+
+  bool inserted = true;
+  insert(c, 1);
+  int value = 5;
+  CU_ASSERT_EQUAL(
+      cc_2q_cache_insert(c, CDC_FROM_INT(1), &value, &inserted),
+      CDC_STATUS_OK);
+  CU_ASSERT(!inserted);
+  insert(c, 1);
+  insert(c, 2);
+
+  struct cdc_pair kv = {NULL, NULL};
+  cc_2q_cache_take(c, CDC_FROM_INT(1), &kv);
+  CU_ASSERT_EQUAL(*(int *)kv.second, 1);
+  free(kv.second);
+  cc_2q_cache_erase(c, CDC_FROM_INT(2));
+  CU_ASSERT(cc_2q_cache_empty(c));
+
+  for (int key = 1; key <= 6; ++key) {
+    insert(c, key);
+  }
+
+  cc_2q_cache_clear(c);
+  CU_ASSERT(cc_2q_cache_empty(c));
+  CU_ASSERT(cc_fifo_cache_empty(c->a1_out));
+  cc_2q_cache_dtor(c);
+}
@@ -0,0 +1,140 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "test-common.h"
+
+#include "ccache/bloom.h"
+#include "ccache/fifo.h"
+#include "ccache/lru.h"
+
+#include <CUnit/Basic.h>
+#include <cdcontainers/cdc.h>
+
+static int eq(const void *l, const void *r)
+{
+  return CDC_TO_INT(l) == CDC_TO_INT(r);
+}
+
+static size_t hash(const void *val) { return cdc_hash_int(CDC_TO_INT(val)); }
+
+void test_bloom_filter_add_remove()
+{
+  const int count = 1000;
+  struct cc_bloom_filter *f = NULL;
+  CU_ASSERT_EQUAL(cc_bloom_filter_ctor(&f, count, hash), CDC_STATUS_OK);
+
+  for (int i = 0; i < count; ++i) {
+    cc_bloom_filter_add(f, CDC_FROM_INT(i));
+  }
+
+  for (int i = 0; i < count; ++i) {
+    CU_ASSERT(cc_bloom_filter_may_contain(f, CDC_FROM_INT(i)));
+  }
+
+  int false_positives = 0;
+  for (int i = count; i < 11 * count; ++i) {
+    false_positives += cc_bloom_filter_may_contain(f, CDC_FROM_INT(i));
+  }
+
+  CU_ASSERT(false_positives < count / 5);
+
+  for (int i = 0; i < count; i += 2) {
+    cc_bloom_filter_remove(f, CDC_FROM_INT(i));
+  }
+
+  for (int i = 1; i < count; i += 2) {
+    CU_ASSERT(cc_bloom_filter_may_contain(f, CDC_FROM_INT(i)));
+  }
+
+  cc_bloom_filter_clear(f);
+  for (int i = 0; i < count; ++i) {
+    CU_ASSERT(!cc_bloom_filter_may_contain(f, CDC_FROM_INT(i)));
+  }
+
+  cc_bloom_filter_dtor(f);
+}
+
+void test_bloom_filter_cache()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+
+  struct cc_lru_cache *c = NULL;
+  CU_ASSERT_EQUAL(cc_lru_cache_ctor(&c, 3 /* max_size */, &info),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_lru_cache_insert(c, CDC_FROM_INT(1), CDC_FROM_INT(1),
+                                      NULL /* inserted */),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_lru_cache_enable_filter(c), CDC_STATUS_OK);
+  CU_ASSERT(cc_lru_cache_contains(c, CDC_FROM_INT(1)));
+
+  for (int i = 2; i <= 4; ++i) {
+    CU_ASSERT_EQUAL(cc_lru_cache_insert(c, CDC_FROM_INT(i), CDC_FROM_INT(i),
+                                        NULL /* inserted */),
+                    CDC_STATUS_OK);
+  }
+
+  // Key 1 is evicted.
+  void *value = NULL;
+  CU_ASSERT_EQUAL(cc_lru_cache_get(c, CDC_FROM_INT(1), &value),
+                  CDC_STATUS_NOT_FOUND);
+  CU_ASSERT_EQUAL(cc_lru_cache_get(c, CDC_FROM_INT(4), &value), CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(CDC_TO_INT(value), 4);
+
+  cc_lru_cache_erase(c, CDC_FROM_INT(2));
+  CU_ASSERT(!cc_lru_cache_contains(c, CDC_FROM_INT(2)));
+  struct cdc_pair kv = {NULL, NULL};
+  cc_lru_cache_take(c, CDC_FROM_INT(3), &kv);
+  CU_ASSERT_EQUAL(CDC_TO_INT(kv.first), 3);
+  CU_ASSERT(!cc_lru_cache_contains(c, CDC_FROM_INT(3)));
+  CU_ASSERT_EQUAL(cc_lru_cache_size(c), 1);
+
+  // Erased keys can be inserted again.
+  bool inserted = false;
+  CU_ASSERT_EQUAL(cc_lru_cache_insert_or_assign(c, CDC_FROM_INT(2),
+                                                CDC_FROM_INT(5), &inserted),
+                  CDC_STATUS_OK);
+  CU_ASSERT(inserted);
+  CU_ASSERT_EQUAL(cc_lru_cache_get(c, CDC_FROM_INT(2), &value), CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(CDC_TO_INT(value), 5);
+
+  cc_lru_cache_clear(c);
+  CU_ASSERT(!cc_lru_cache_contains(c, CDC_FROM_INT(4)));
+  size_t metadata = cc_lru_cache_memory_usage(c).metadata;
+  cc_lru_cache_disable_filter(c);
+  CU_ASSERT(cc_lru_cache_memory_usage(c).metadata < metadata);
+  cc_lru_cache_dtor(c);
+
+  struct cc_fifo_cache *f = NULL;
+  CU_ASSERT_EQUAL(cc_fifo_cache_ctor(&f, 2 /* max_size */, &info),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_fifo_cache_enable_filter(f), CDC_STATUS_OK);
+  for (int i = 1; i <= 3; ++i) {
+    CU_ASSERT_EQUAL(cc_fifo_cache_insert(f, CDC_FROM_INT(i), CDC_FROM_INT(i),
+                                         NULL /* inserted */),
+                    CDC_STATUS_OK);
+  }
+
+  CU_ASSERT(!cc_fifo_cache_contains(f, CDC_FROM_INT(1)));
+  CU_ASSERT(cc_fifo_cache_contains(f, CDC_FROM_INT(2)));
+  CU_ASSERT(cc_fifo_cache_contains(f, CDC_FROM_INT(3)));
+  cc_fifo_cache_dtor(f);
+}
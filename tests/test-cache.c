@@ -0,0 +1,89 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "test-common.h"
+
+#include "ccache/cache.h"
+
+#include <CUnit/Basic.h>
+#include <cdcontainers/cdc.h>
+
+static int eq(const void *l, const void *r)
+{
+  return CDC_TO_INT(l) == CDC_TO_INT(r);
+}
+
+static size_t hash(const void *val) { return cdc_hash_int(CDC_TO_INT(val)); }
+
+static const char *names[] = {"lru", "fifo", "2q", "lfu", "slru", "sampled"};
+
+void test_cache_policies()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+    struct cc_cache_config config;
+    CU_ASSERT_EQUAL(cc_policy_from_name(names[i], &config.policy),
+                    CDC_STATUS_OK);
+    CU_ASSERT_STRING_EQUAL(cc_policy_name(config.policy), names[i]);
+    config.max_size = 4;
+    config.info = &info;
+
+    struct cc_cache *c = NULL;
+    CU_ASSERT_EQUAL(cc_cache_ctor(&c, &config), CDC_STATUS_OK);
+    CU_ASSERT_STRING_EQUAL(cc_cache_policy(c), names[i]);
+    CU_ASSERT_EQUAL(cc_cache_max_size(c), 4);
+    CU_ASSERT(cc_cache_empty(c));
+
+    bool inserted = false;
+    for (int key = 0; key < 10; ++key) {
+      CU_ASSERT_EQUAL(cc_cache_insert(c, CDC_FROM_INT(key), CDC_FROM_INT(key),
+                                      &inserted),
+                      CDC_STATUS_OK);
+      CU_ASSERT(inserted);
+    }
+
+    // Every policy keeps the most recent insert.
+    CU_ASSERT_EQUAL(cc_cache_size(c), 4);
+    void *value = NULL;
+    CU_ASSERT_EQUAL(cc_cache_get(c, CDC_FROM_INT(9), &value), CDC_STATUS_OK);
+    CU_ASSERT_EQUAL(CDC_TO_INT(value), 9);
+    CU_ASSERT_EQUAL(cc_cache_insert_or_assign(c, CDC_FROM_INT(9),
+                                              CDC_FROM_INT(90), &inserted),
+                    CDC_STATUS_OK);
+    CU_ASSERT(!inserted);
+
+    struct cdc_pair kv = {NULL, NULL};
+    cc_cache_take(c, CDC_FROM_INT(9), &kv);
+    CU_ASSERT_EQUAL(CDC_TO_INT(kv.second), 90);
+    CU_ASSERT(!cc_cache_contains(c, CDC_FROM_INT(9)));
+    CU_ASSERT_EQUAL(cc_cache_size(c), 3);
+    cc_cache_erase(c, CDC_FROM_INT(8));
+    CU_ASSERT_EQUAL(cc_cache_size(c), 2);
+    cc_cache_clear(c);
+    CU_ASSERT(cc_cache_empty(c));
+    cc_cache_dtor(c);
+  }
+
+  enum cc_policy policy = CC_POLICY_LRU;
+  CU_ASSERT_EQUAL(cc_policy_from_name("mru", &policy), CDC_STATUS_NOT_FOUND);
+}
@@ -0,0 +1,207 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "test-common.h"
+
+#include "ccache/cfifo.h"
+
+#include <CUnit/Basic.h>
+#include <cdcontainers/cdc.h>
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#define STRESS_READERS 4
+#define STRESS_KEYS 64
+#define STRESS_WRITES 20000
+
+struct reader {
+  struct cc_cfifo_cache *cache;
+  int *stop;
+  size_t hits;
+  size_t errors;
+};
+
+static int eq(const void *l, const void *r)
+{
+  return CDC_TO_INT(l) == CDC_TO_INT(r);
+}
+
+static size_t hash(const void *val) { return cdc_hash_int(CDC_TO_INT(val)); }
+
+static void free_value(void *data)
+{
+  struct cdc_pair *kv = (struct cdc_pair *)data;
+  free(kv->second);
+}
+
+static int *new_value(int key)
+{
+  int *value = (int *)malloc(sizeof(int));
+  *value = key;
+  return value;
+}
+
+static void *read_loop(void *arg)
+{
+  struct reader *r = (struct reader *)arg;
+  struct cc_epoch_record *record = NULL;
+  if (cc_cfifo_cache_register(r->cache, &record) != CDC_STATUS_OK) {
+    ++r->errors;
+    return NULL;
+  }
+
+  unsigned seed = 1;
+  while (!__atomic_load_n(r->stop, __ATOMIC_ACQUIRE)) {
+    seed = seed * 1103515245 + 12345;
+    int key = (int)((seed >> 16) % STRESS_KEYS);
+    void *value = NULL;
+    cc_cfifo_cache_enter(record);
+    if (cc_cfifo_cache_get(r->cache, record, CDC_FROM_INT(key), &value) ==
+        CDC_STATUS_OK) {
+      ++r->hits;
+      // A freed value would be caught by the sanitizers.
+      if (*(int *)value != key) {
+        ++r->errors;
+      }
+    }
+
+    cc_cfifo_cache_leave(record);
+  }
+
+  cc_cfifo_cache_unregister(record);
+  return NULL;
+}
+
+void test_cfifo_cache_get()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+  info.dfree = free_value;
+
+  struct cc_cfifo_cache *c = NULL;
+  CU_ASSERT_EQUAL(cc_cfifo_cache_ctor(&c, 2 /* max_size */, &info),
+                  CDC_STATUS_OK);
+  struct cc_epoch_record *r = NULL;
+  CU_ASSERT_EQUAL(cc_cfifo_cache_register(c, &r), CDC_STATUS_OK);
+
+  bool inserted = false;
+  CU_ASSERT_EQUAL(
+      cc_cfifo_cache_insert(c, CDC_FROM_INT(1), new_value(1), &inserted),
+      CDC_STATUS_OK);
+  CU_ASSERT(inserted);
+  CU_ASSERT_EQUAL(cc_cfifo_cache_insert_or_assign(c, CDC_FROM_INT(1),
+                                                  new_value(10), &inserted),
+                  CDC_STATUS_OK);
+  CU_ASSERT(!inserted);
+  CU_ASSERT_EQUAL(
+      cc_cfifo_cache_insert(c, CDC_FROM_INT(2), new_value(2), &inserted),
+      CDC_STATUS_OK);
+
+  void *value = NULL;
+  cc_cfifo_cache_enter(r);
+  CU_ASSERT_EQUAL(cc_cfifo_cache_get(c, r, CDC_FROM_INT(1), &value),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(*(int *)value, 10);
+  // Evicts key 1, whose value stays valid until the reader leaves.
+  CU_ASSERT_EQUAL(
+      cc_cfifo_cache_insert(c, CDC_FROM_INT(3), new_value(3), &inserted),
+      CDC_STATUS_OK);
+  CU_ASSERT(!cc_cfifo_cache_contains(c, r, CDC_FROM_INT(1)));
+  CU_ASSERT_EQUAL(cc_cfifo_cache_collect(c), 0);
+  CU_ASSERT_EQUAL(*(int *)value, 10);
+  cc_cfifo_cache_leave(r);
+
+  CU_ASSERT_EQUAL(cc_cfifo_cache_size(c), 2);
+  cc_cfifo_cache_erase(c, CDC_FROM_INT(2));
+  cc_cfifo_cache_enter(r);
+  CU_ASSERT(!cc_cfifo_cache_contains(c, r, CDC_FROM_INT(2)));
+  CU_ASSERT(cc_cfifo_cache_contains(c, r, CDC_FROM_INT(3)));
+  cc_cfifo_cache_leave(r);
+
+  cc_cfifo_cache_clear(c);
+  CU_ASSERT(cc_cfifo_cache_empty(c));
+  cc_cfifo_cache_collect(c);
+  cc_cfifo_cache_collect(c);
+  CU_ASSERT_EQUAL(c->epoch->retired_count, 0);
+  cc_cfifo_cache_unregister(r);
+  cc_cfifo_cache_dtor(c);
+}
+
+void test_cfifo_cache_stress()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+  info.dfree = free_value;
+
+  struct cc_cfifo_cache *c = NULL;
+  CU_ASSERT_EQUAL(cc_cfifo_cache_ctor(&c, STRESS_KEYS / 2, &info),
+                  CDC_STATUS_OK);
+
+  int stop = 0;
+  pthread_t threads[STRESS_READERS];
+  struct reader readers[STRESS_READERS];
+  for (int i = 0; i < STRESS_READERS; ++i) {
+    readers[i].cache = c;
+    readers[i].stop = &stop;
+    readers[i].hits = 0;
+    readers[i].errors = 0;
+    CU_ASSERT_EQUAL(pthread_create(&threads[i], NULL, read_loop, &readers[i]),
+                    0);
+  }
+
+  unsigned seed = 7;
+  for (int i = 0; i < STRESS_WRITES; ++i) {
+    seed = seed * 1103515245 + 12345;
+    int key = (int)((seed >> 16) % STRESS_KEYS);
+    switch (i % 8) {
+      case 0:
+        cc_cfifo_cache_erase(c, CDC_FROM_INT(key));
+        break;
+      case 1:
+        cc_cfifo_cache_insert_or_assign(c, CDC_FROM_INT(key), new_value(key),
+                                        NULL /* inserted */);
+        break;
+      default: {
+        bool inserted = false;
+        int *value = new_value(key);
+        cc_cfifo_cache_insert(c, CDC_FROM_INT(key), value, &inserted);
+        if (!inserted) {
+          free(value);
+        }
+      }
+    }
+
+    if (i % 4096 == 0) {
+      cc_cfifo_cache_clear(c);
+    }
+  }
+
+  __atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+  for (int i = 0; i < STRESS_READERS; ++i) {
+    pthread_join(threads[i], NULL);
+    CU_ASSERT_EQUAL(readers[i].errors, 0);
+  }
+
+  CU_ASSERT(cc_cfifo_cache_size(c) <= STRESS_KEYS / 2);
+  cc_cfifo_cache_dtor(c);
+}
@@ -21,6 +21,13 @@
 #ifndef CCACHE_TESTS_TESTS_COMMON_H
 #define CCACHE_TESTS_TESTS_COMMON_H
 
+// Cache tests
+void test_cache_policies();
+
+// 2q cache tests
+void test_2q_cache_scan();
+void test_2q_cache_modifiers();
+
 // Lru cache tests
 void test_lru_cache_ctor();
 void test_lru_cache_get();
@@ -29,5 +36,86 @@ void test_lru_cache_capacity();
 void test_lru_cache_insert();
 void test_lru_cache_erase();
 void test_lru_cache_clear();
+void test_lru_cache_set_max_size();
+void test_lru_cache_memory_usage();
+void test_lru_cache_iterators();
+void test_lru_cache_reclaim();
+void test_lru_cache_bulk_load();
+void test_lru_cache_handles();
+void test_lru_cache_watermarks();
+void test_lru_cache_tags();
+
+// Bloom filter tests
+void test_bloom_filter_add_remove();
+void test_bloom_filter_cache();
+
+// Concurrent fifo cache tests
+void test_cfifo_cache_get();
+void test_cfifo_cache_stress();
+
+// Compressed cache tests
+void test_lz_codec();
+void test_compressed_cache_get();
+void test_compressed_cache_capacity();
+
+// Fifo cache tests
+void test_fifo_cache_set_max_size();
+void test_fifo_cache_watermarks();
+
+// Frozen cache tests
+void test_frozen_cache_get();
+void test_frozen_cache_invalid();
+
+// Gdsf cache tests
+void test_gdsf_cache_eviction();
+void test_gdsf_cache_cost();
+void test_gdsf_cache_oversized();
+
+// Hash tests
+void test_hash_bytes();
+void test_hash_long_keys();
+void test_hash_string_keys();
+
+// Lfu cache tests
+void test_lfu_cache_get();
+void test_lfu_cache_eviction();
+void test_lfu_cache_decay();
+
+// Near cache tests
+void test_near_cache_get();
+void test_near_cache_eviction();
+void test_near_cache_no_dfree();
+void test_near_cache_stress();
+
+// Ordered cache tests
+void test_ordered_cache_lookup();
+void test_ordered_cache_range();
+void test_ordered_cache_eviction();
+
+// Partitioned cache tests
+void test_partitioned_cache_sharing();
+void test_partitioned_cache_modifiers();
+
+// Refresh cache tests
+void test_refresh_cache_get();
+void test_refresh_cache_expire();
+void test_refresh_cache_take();
+void test_refresh_cache_reload_free();
+
+// Sampled cache tests
+void test_sampled_cache_eviction();
+void test_sampled_cache_modifiers();
+
+// Slru cache tests
+void test_slru_cache_scan();
+void test_slru_cache_modifiers();
+
+// Shards tests
+void test_shards_cyclic();
+void test_shards_sampling();
+
+// Top keys tests
+void test_top_keys_get();
+void test_top_keys_heavy_hitters();
 
 #endif  // CCACHE_TESTS_TESTS_COMMON_H
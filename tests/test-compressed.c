@@ -0,0 +1,181 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "test-common.h"
+
+#include "ccache/compressed.h"
+
+#include <CUnit/Basic.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define VALUE_SIZE 4096
+
+// Writes a JSON-like document, which compresses well.
+static size_t make_document(char *buf, size_t size, int id)
+{
+  size_t len = 0;
+  for (int i = 0; len + 64 < size; ++i) {
+    len += (size_t)sprintf(buf + len,
+                           "{\"id\":%d,\"item\":%d,\"name\":\"item-%d\"},", id,
+                           i, i % 7);
+  }
+
+  return len;
+}
+
+void test_lz_codec()
+{
+  static char src[VALUE_SIZE];
+  static char packed[VALUE_SIZE];
+  static char out[VALUE_SIZE];
+  size_t size = make_document(src, sizeof(src), 1);
+  size_t packed_size = cc_lz_compress(NULL /* ctx */, src, size, packed,
+                                      sizeof(packed));
+  CU_ASSERT(packed_size > 0);
+  CU_ASSERT(packed_size * 3 < size);
+  CU_ASSERT(cc_lz_decompress(NULL /* ctx */, packed, packed_size, out, size));
+  CU_ASSERT_EQUAL(memcmp(src, out, size), 0);
+  // Wrong sizes and truncated data are rejected.
+  CU_ASSERT(
+      !cc_lz_decompress(NULL /* ctx */, packed, packed_size, out, size - 1));
+  CU_ASSERT(
+      !cc_lz_decompress(NULL /* ctx */, packed, packed_size - 1, out, size));
+
+  // A run of one byte is a match which overlaps its output.
+  memset(src, 'a', 1000);
+  packed_size = cc_lz_compress(NULL /* ctx */, src, 1000, packed, 100);
+  CU_ASSERT(packed_size > 0);
+  CU_ASSERT(cc_lz_decompress(NULL /* ctx */, packed, packed_size, out, 1000));
+  CU_ASSERT_EQUAL(memcmp(src, out, 1000), 0);
+
+  // Data which does not shrink does not fit.
+  unsigned state = 1;
+  for (size_t i = 0; i < 256; ++i) {
+    state = state * 1103515245 + 12345;
+    src[i] = (char)(state >> 16);
+  }
+
+  CU_ASSERT_EQUAL(cc_lz_compress(NULL /* ctx */, src, 256, packed, 255), 0);
+}
+
+void test_compressed_cache_get()
+{
+  static char value[VALUE_SIZE];
+  static char buf[VALUE_SIZE];
+  struct cc_compressed_cache *c = NULL;
+  CU_ASSERT_EQUAL(cc_compressed_cache_ctor(&c, 1 << 20, NULL /* codec */,
+                                           64 /* threshold */),
+                  CDC_STATUS_OK);
+
+  bool inserted = false;
+  size_t size = make_document(value, sizeof(value), 1);
+  CU_ASSERT_EQUAL(
+      cc_compressed_cache_insert(c, "a", 1, value, size, &inserted),
+      CDC_STATUS_OK);
+  CU_ASSERT(inserted);
+  CU_ASSERT(cc_compressed_cache_bytes(c) * 3 < size);
+  CU_ASSERT(c->compressed_out * 3 < c->compressed_in);
+
+  size_t value_size = 0;
+  CU_ASSERT_EQUAL(cc_compressed_cache_get(c, "a", 1, buf, sizeof(buf),
+                                          &value_size),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(value_size, size);
+  CU_ASSERT_EQUAL(memcmp(buf, value, size), 0);
+  CU_ASSERT_EQUAL(cc_compressed_cache_get(c, "a", 1, buf, 16, &value_size),
+                  CDC_STATUS_OUT_OF_RANGE);
+  CU_ASSERT_EQUAL(value_size, size);
+  CU_ASSERT_EQUAL(cc_compressed_cache_get(c, "b", 1, buf, sizeof(buf),
+                                          &value_size),
+                  CDC_STATUS_NOT_FOUND);
+
+  // Values below the threshold are stored raw.
+  size_t in = c->compressed_in;
+  CU_ASSERT_EQUAL(cc_compressed_cache_insert(c, "b", 1, "aaaaaaaa", 8,
+                                             &inserted),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(c->compressed_in, in);
+  CU_ASSERT_EQUAL(cc_compressed_cache_get(c, "b", 1, buf, sizeof(buf),
+                                          &value_size),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(value_size, 8);
+  CU_ASSERT_EQUAL(memcmp(buf, "aaaaaaaa", 8), 0);
+
+  size = make_document(value, sizeof(value), 2);
+  CU_ASSERT_EQUAL(cc_compressed_cache_insert_or_assign(c, "a", 1, value, size,
+                                                       &inserted),
+                  CDC_STATUS_OK);
+  CU_ASSERT(!inserted);
+  CU_ASSERT_EQUAL(cc_compressed_cache_get(c, "a", 1, buf, sizeof(buf),
+                                          &value_size),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(memcmp(buf, value, size), 0);
+
+  CU_ASSERT_EQUAL(cc_compressed_cache_size(c), 2);
+  cc_compressed_cache_erase(c, "a", 1);
+  CU_ASSERT(!cc_compressed_cache_contains(c, "a", 1));
+  cc_compressed_cache_clear(c);
+  CU_ASSERT(cc_compressed_cache_empty(c));
+  CU_ASSERT_EQUAL(cc_compressed_cache_bytes(c), 0);
+  cc_compressed_cache_dtor(c);
+}
+
+void test_compressed_cache_capacity()
+{
+  static char value[VALUE_SIZE];
+  size_t size = make_document(value, sizeof(value), 1);
+  struct cc_compressed_cache *c = NULL;
+  // Room for two raw values.
+  CU_ASSERT_EQUAL(cc_compressed_cache_ctor(&c, 2 * VALUE_SIZE + 256,
+                                           NULL /* codec */,
+                                           64 /* threshold */),
+                  CDC_STATUS_OK);
+
+  char key[16];
+  for (int i = 0; i < 6; ++i) {
+    size_t key_size = (size_t)sprintf(key, "key-%d", i);
+    CU_ASSERT_EQUAL(cc_compressed_cache_insert(c, key, key_size, value, size,
+                                               NULL /* inserted */),
+                    CDC_STATUS_OK);
+  }
+
+  // Compressed, all of them fit.
+  CU_ASSERT_EQUAL(cc_compressed_cache_size(c), 6);
+  CU_ASSERT(cc_compressed_cache_bytes(c) <= cc_compressed_cache_max_bytes(c));
+  cc_compressed_cache_dtor(c);
+
+  // Stored raw, the budget holds two values.
+  CU_ASSERT_EQUAL(cc_compressed_cache_ctor(&c, 2 * VALUE_SIZE + 256,
+                                           NULL /* codec */,
+                                           VALUE_SIZE /* threshold */),
+                  CDC_STATUS_OK);
+  for (int i = 0; i < 6; ++i) {
+    size_t key_size = (size_t)sprintf(key, "key-%d", i);
+    CU_ASSERT_EQUAL(cc_compressed_cache_insert(c, key, key_size, value, size,
+                                               NULL /* inserted */),
+                    CDC_STATUS_OK);
+  }
+
+  CU_ASSERT_EQUAL(cc_compressed_cache_size(c), 2);
+  CU_ASSERT(cc_compressed_cache_bytes(c) <= cc_compressed_cache_max_bytes(c));
+  cc_compressed_cache_dtor(c);
+}
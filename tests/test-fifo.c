@@ -0,0 +1,135 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "test-common.h"
+
+#include "ccache/fifo.h"
+
+#include <CUnit/Basic.h>
+#include <cdcontainers/cdc.h>
+
+static int eq(const void *l, const void *r)
+{
+  return CDC_TO_INT(l) == CDC_TO_INT(r);
+}
+
+static size_t hash(const void *val) { return cdc_hash_int(CDC_TO_INT(val)); }
+
+static int freed_values = 0;
+
+static void count_free(void *data)
+{
+  CDC_UNUSED(data);
+
+  ++freed_values;
+}
+
+static void insert(struct cc_fifo_cache *cache, int key)
+{
+  CU_ASSERT_EQUAL(cc_fifo_cache_insert(cache, CDC_FROM_INT(key),
+                                       CDC_FROM_INT(key), NULL /* inserted */),
+                  CDC_STATUS_OK);
+}
+
+void test_fifo_cache_set_max_size()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+
+  struct cc_fifo_cache *cache = NULL;
+  CU_ASSERT_EQUAL(cc_fifo_cache_ctor(&cache, 8 /* max_size */, &info),
+                  CDC_STATUS_OK);
+  for (int i = 0; i < 8; ++i) {
+    insert(cache, i);
+  }
+
+  // Shrinking evicts nothing by itself.
+  cc_fifo_cache_set_max_size(cache, 2);
+  CU_ASSERT_EQUAL(cc_fifo_cache_max_size(cache), 2);
+  CU_ASSERT_EQUAL(cc_fifo_cache_size(cache), 8);
+
+  // An insert evicts a bounded number of the oldest entries.
+  insert(cache, 8);
+  CU_ASSERT_EQUAL(cc_fifo_cache_size(cache), 5);
+  CU_ASSERT(!cc_fifo_cache_contains(cache, CDC_FROM_INT(3)));
+  CU_ASSERT(cc_fifo_cache_contains(cache, CDC_FROM_INT(4)));
+  CU_ASSERT(cc_fifo_cache_contains(cache, CDC_FROM_INT(8)));
+
+  CU_ASSERT_EQUAL(cc_fifo_cache_trim(cache, 2 /* budget */), 2);
+  CU_ASSERT_EQUAL(cc_fifo_cache_size(cache), 3);
+  CU_ASSERT(!cc_fifo_cache_contains(cache, CDC_FROM_INT(5)));
+  CU_ASSERT(cc_fifo_cache_contains(cache, CDC_FROM_INT(6)));
+
+  CU_ASSERT_EQUAL(cc_fifo_cache_trim(cache, 10 /* budget */), 1);
+  CU_ASSERT_EQUAL(cc_fifo_cache_size(cache), 2);
+  CU_ASSERT(cc_fifo_cache_contains(cache, CDC_FROM_INT(7)));
+  CU_ASSERT(cc_fifo_cache_contains(cache, CDC_FROM_INT(8)));
+
+  cc_fifo_cache_set_max_size(cache, 3);
+  insert(cache, 0);
+  CU_ASSERT_EQUAL(cc_fifo_cache_size(cache), 3);
+  CU_ASSERT_EQUAL(cc_fifo_cache_trim(cache, 10 /* budget */), 0);
+  cc_fifo_cache_dtor(cache);
+}
+
+void test_fifo_cache_watermarks()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+  info.dfree = count_free;
+
+  struct cc_fifo_cache *cache = NULL;
+  freed_values = 0;
+  CU_ASSERT_EQUAL(cc_fifo_cache_ctor(&cache, 4 /* max_size */, &info),
+                  CDC_STATUS_OK);
+  cc_fifo_cache_set_watermarks(cache, 1 /* low */, 3 /* high */);
+  for (int i = 0; i < 3; ++i) {
+    insert(cache, i);
+  }
+
+  // The insert at the high watermark evicts down to the low one.
+  CU_ASSERT_EQUAL(freed_values, 0);
+  insert(cache, 3);
+  CU_ASSERT_EQUAL(cc_fifo_cache_size(cache), 2);
+  CU_ASSERT_EQUAL(freed_values, 2);
+  CU_ASSERT(cc_fifo_cache_contains(cache, CDC_FROM_INT(2)));
+  CU_ASSERT(cc_fifo_cache_contains(cache, CDC_FROM_INT(3)));
+
+  CU_ASSERT_EQUAL(cc_fifo_cache_maintain(cache), 0);
+  insert(cache, 4);
+  CU_ASSERT_EQUAL(cc_fifo_cache_maintain(cache), 2);
+  CU_ASSERT_EQUAL(cc_fifo_cache_size(cache), 1);
+  CU_ASSERT(cc_fifo_cache_contains(cache, CDC_FROM_INT(4)));
+  CU_ASSERT_EQUAL(freed_values, 4);
+
+  // Without watermarks a full cache evicts one entry per insert.
+  cc_fifo_cache_set_watermarks(cache, 0 /* low */, 0 /* high */);
+  for (int i = 0; i < 4; ++i) {
+    insert(cache, i);
+  }
+
+  CU_ASSERT_EQUAL(cc_fifo_cache_size(cache), 4);
+  CU_ASSERT(!cc_fifo_cache_contains(cache, CDC_FROM_INT(4)));
+  CU_ASSERT_EQUAL(cc_fifo_cache_maintain(cache), 0);
+  CU_ASSERT_EQUAL(freed_values, 5);
+  cc_fifo_cache_dtor(cache);
+}
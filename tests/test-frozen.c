@@ -0,0 +1,120 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "test-common.h"
+
+#include "ccache/frozen.h"
+
+#include <CUnit/Basic.h>
+#include <cdcontainers/cdc.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void temp_path(char *path)
+{
+  strcpy(path, "/tmp/ccache-frozen-XXXXXX");
+  int fd = mkstemp(path);
+  CU_ASSERT(fd >= 0);
+  close(fd);
+}
+
+void test_frozen_cache_get()
+{
+  const int count = 5000;
+  char path[32];
+  temp_path(path);
+
+  struct cc_frozen_builder *b = NULL;
+  CU_ASSERT_EQUAL(cc_frozen_builder_ctor(&b), CDC_STATUS_OK);
+  char key[32];
+  char value[32];
+  for (int i = 0; i < count; ++i) {
+    int key_size = snprintf(key, sizeof(key), "key-%d", i);
+    int value_size = snprintf(value, sizeof(value), "value-%d", i * 7);
+    CU_ASSERT_EQUAL(cc_frozen_builder_add(b, key, (size_t)key_size, value,
+                                          (size_t)value_size),
+                    CDC_STATUS_OK);
+  }
+
+  CU_ASSERT_EQUAL(cc_frozen_builder_add(b, "", 0, "empty", 5), CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_frozen_builder_write(b, path), CDC_STATUS_OK);
+  cc_frozen_builder_dtor(b);
+
+  struct cc_frozen_cache *c = NULL;
+  CU_ASSERT_EQUAL(cc_frozen_cache_ctor(&c, path), CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_frozen_cache_size(c), (size_t)count + 1);
+  const void *found = NULL;
+  size_t found_size = 0;
+  for (int i = 0; i < count; ++i) {
+    int key_size = snprintf(key, sizeof(key), "key-%d", i);
+    int value_size = snprintf(value, sizeof(value), "value-%d", i * 7);
+    CU_ASSERT_EQUAL(
+        cc_frozen_cache_get(c, key, (size_t)key_size, &found, &found_size),
+        CDC_STATUS_OK);
+    CU_ASSERT_EQUAL(found_size, (size_t)value_size);
+    CU_ASSERT(memcmp(found, value, found_size) == 0);
+  }
+
+  for (int i = count; i < 2 * count; ++i) {
+    int key_size = snprintf(key, sizeof(key), "key-%d", i);
+    CU_ASSERT(!cc_frozen_cache_contains(c, key, (size_t)key_size));
+  }
+
+  CU_ASSERT_EQUAL(cc_frozen_cache_get(c, "", 0, &found, &found_size),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(found_size, 5);
+  cc_frozen_cache_dtor(c);
+  unlink(path);
+}
+
+void test_frozen_cache_invalid()
+{
+  char path[32];
+  temp_path(path);
+
+  // An empty image is valid.
+  struct cc_frozen_builder *b = NULL;
+  CU_ASSERT_EQUAL(cc_frozen_builder_ctor(&b), CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_frozen_builder_write(b, path), CDC_STATUS_OK);
+
+  struct cc_frozen_cache *c = NULL;
+  CU_ASSERT_EQUAL(cc_frozen_cache_ctor(&c, path), CDC_STATUS_OK);
+  CU_ASSERT(cc_frozen_cache_empty(c));
+  CU_ASSERT(!cc_frozen_cache_contains(c, "a", 1));
+  cc_frozen_cache_dtor(c);
+
+  // Equal keys cannot be told apart by the hash.
+  CU_ASSERT_EQUAL(cc_frozen_builder_add(b, "a", 1, "1", 1), CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_frozen_builder_add(b, "a", 1, "2", 1), CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_frozen_builder_write(b, path),
+                  CDC_STATUS_UNKNOWN_ERROR);
+  cc_frozen_builder_dtor(b);
+
+  FILE *f = fopen(path, "wb");
+  CU_ASSERT_PTR_NOT_NULL(f);
+  fputs("not an image", f);
+  fclose(f);
+  CU_ASSERT_EQUAL(cc_frozen_cache_ctor(&c, path), CDC_STATUS_UNKNOWN_ERROR);
+  unlink(path);
+  CU_ASSERT_EQUAL(cc_frozen_cache_ctor(&c, path), CDC_STATUS_UNKNOWN_ERROR);
+}
@@ -0,0 +1,188 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "test-common.h"
+
+#include "ccache/gdsf.h"
+
+#include <CUnit/Basic.h>
+#include <cdcontainers/cdc.h>
+
+static int eq(const void *l, const void *r)
+{
+  return CDC_TO_INT(l) == CDC_TO_INT(r);
+}
+
+static size_t hash(const void *val) { return cdc_hash_int(CDC_TO_INT(val)); }
+
+// Values are their own sizes.
+static size_t value_size(void *key, void *value)
+{
+  CDC_UNUSED(key);
+
+  return (size_t)CDC_TO_INT(value);
+}
+
+static double key_cost(void *key, void *value)
+{
+  CDC_UNUSED(value);
+
+  return (double)CDC_TO_INT(key);
+}
+
+static int freed_values = 0;
+
+static void count_free(void *data)
+{
+  CDC_UNUSED(data);
+
+  ++freed_values;
+}
+
+static void insert(struct cc_gdsf_cache *c, int key, int size)
+{
+  CU_ASSERT_EQUAL(cc_gdsf_cache_insert_or_assign(c, CDC_FROM_INT(key),
+                                                 CDC_FROM_INT(size), NULL),
+                  CDC_STATUS_OK);
+}
+
+void test_gdsf_cache_eviction()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+
+  struct cc_gdsf_cache *c = NULL;
+  CU_ASSERT_EQUAL(cc_gdsf_cache_ctor(&c, 10 /* max_bytes */, &info,
+                                     value_size, NULL /* cost */),
+                  CDC_STATUS_OK);
+
+  insert(c, 1, 5);
+  insert(c, 2, 4);
+  CU_ASSERT_EQUAL(cc_gdsf_cache_bytes(c), 9);
+
+  // The largest entry has the lowest priority.
+  insert(c, 3, 2);
+  CU_ASSERT(!cc_gdsf_cache_contains(c, CDC_FROM_INT(1)));
+  CU_ASSERT_EQUAL(cc_gdsf_cache_bytes(c), 6);
+
+  void *value = NULL;
+  for (int i = 0; i < 3; ++i) {
+    CU_ASSERT_EQUAL(cc_gdsf_cache_get(c, CDC_FROM_INT(2), &value),
+                    CDC_STATUS_OK);
+    CU_ASSERT_EQUAL(CDC_TO_INT(value), 4);
+  }
+
+  // Key 2 is used often enough to outlive the smaller key 3.
+  insert(c, 4, 5);
+  CU_ASSERT(cc_gdsf_cache_contains(c, CDC_FROM_INT(2)));
+  CU_ASSERT(!cc_gdsf_cache_contains(c, CDC_FROM_INT(3)));
+  CU_ASSERT(cc_gdsf_cache_contains(c, CDC_FROM_INT(4)));
+  CU_ASSERT_EQUAL(cc_gdsf_cache_size(c), 2);
+  CU_ASSERT_EQUAL(cc_gdsf_cache_bytes(c), 9);
+
+  bool inserted = true;
+  CU_ASSERT_EQUAL(cc_gdsf_cache_insert(c, CDC_FROM_INT(5), CDC_FROM_INT(11),
+                                       &inserted),
+                  CDC_STATUS_OUT_OF_RANGE);
+  CU_ASSERT(!inserted);
+  CU_ASSERT_EQUAL(cc_gdsf_cache_size(c), 2);
+
+  // Growing key 4 pushes out key 2.
+  insert(c, 4, 8);
+  CU_ASSERT_EQUAL(cc_gdsf_cache_size(c), 1);
+  CU_ASSERT_EQUAL(cc_gdsf_cache_bytes(c), 8);
+
+  cc_gdsf_cache_clear(c);
+  CU_ASSERT(cc_gdsf_cache_empty(c));
+  CU_ASSERT_EQUAL(cc_gdsf_cache_bytes(c), 0);
+  cc_gdsf_cache_dtor(c);
+}
+
+void test_gdsf_cache_cost()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+
+  struct cc_gdsf_cache *c = NULL;
+  CU_ASSERT_EQUAL(cc_gdsf_cache_ctor(&c, 100 /* max_bytes */, &info,
+                                     value_size, key_cost),
+                  CDC_STATUS_OK);
+
+  // Equal sizes, so the cheapest entry goes first.
+  for (int key = 1; key <= 10; ++key) {
+    insert(c, key, 10);
+  }
+
+  insert(c, 20, 10);
+  CU_ASSERT(!cc_gdsf_cache_contains(c, CDC_FROM_INT(1)));
+  insert(c, 30, 10);
+  CU_ASSERT(!cc_gdsf_cache_contains(c, CDC_FROM_INT(2)));
+  CU_ASSERT(cc_gdsf_cache_contains(c, CDC_FROM_INT(3)));
+
+  struct cdc_pair kv = {NULL, NULL};
+  cc_gdsf_cache_take(c, CDC_FROM_INT(3), &kv);
+  CU_ASSERT_EQUAL(CDC_TO_INT(kv.second), 10);
+  cc_gdsf_cache_erase(c, CDC_FROM_INT(4));
+  CU_ASSERT_EQUAL(cc_gdsf_cache_size(c), 8);
+  CU_ASSERT_EQUAL(cc_gdsf_cache_bytes(c), 80);
+  cc_gdsf_cache_dtor(c);
+}
+
+void test_gdsf_cache_oversized()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+  info.dfree = count_free;
+
+  struct cc_gdsf_cache *c = NULL;
+  CU_ASSERT_EQUAL(cc_gdsf_cache_ctor(&c, 10 /* max_bytes */, &info,
+                                     value_size, NULL /* cost */),
+                  CDC_STATUS_OK);
+  freed_values = 0;
+  insert(c, 1, 5);
+
+  // The caller keeps the value, so it is not freed.
+  bool inserted = true;
+  CU_ASSERT_EQUAL(cc_gdsf_cache_insert_or_assign(c, CDC_FROM_INT(2),
+                                                 CDC_FROM_INT(11), &inserted),
+                  CDC_STATUS_OUT_OF_RANGE);
+  CU_ASSERT(!inserted);
+  CU_ASSERT_EQUAL(freed_values, 0);
+  CU_ASSERT_EQUAL(cc_gdsf_cache_size(c), 1);
+
+  // The old entry of the key goes away.
+  CU_ASSERT_EQUAL(cc_gdsf_cache_insert_or_assign(c, CDC_FROM_INT(1),
+                                                 CDC_FROM_INT(11), &inserted),
+                  CDC_STATUS_OUT_OF_RANGE);
+  CU_ASSERT(!inserted);
+  CU_ASSERT_EQUAL(freed_values, 1);
+  CU_ASSERT(cc_gdsf_cache_empty(c));
+  CU_ASSERT_EQUAL(cc_gdsf_cache_bytes(c), 0);
+
+  // A successful assign frees the old value only.
+  insert(c, 1, 5);
+  insert(c, 1, 6);
+  CU_ASSERT_EQUAL(freed_values, 2);
+  CU_ASSERT_EQUAL(cc_gdsf_cache_bytes(c), 6);
+  cc_gdsf_cache_dtor(c);
+}
@@ -0,0 +1,142 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "test-common.h"
+
+#include "ccache/hash.h"
+#include "ccache/lru.h"
+
+#include <CUnit/Basic.h>
+#include <cdcontainers/cdc.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void free_string_key(void *kv)
+{
+  struct cdc_pair *pair = (struct cdc_pair *)kv;
+  free(pair->first);
+}
+
+void test_hash_bytes()
+{
+  enum { SIZE = 2100 };
+  unsigned char data[SIZE];
+  for (size_t i = 0; i < SIZE; ++i) {
+    data[i] = (unsigned char)(i * 131 + 7);
+  }
+
+  // Every length covers a different path or tail.
+  uint64_t prev = cc_hash_bytes(data, 0, 0);
+  for (size_t size = 1; size <= SIZE; ++size) {
+    uint64_t h = cc_hash_bytes(data, size, 0);
+    CU_ASSERT_NOT_EQUAL(h, prev);
+    CU_ASSERT_EQUAL(h, cc_hash_bytes(data, size, 0));
+    CU_ASSERT_NOT_EQUAL(h, cc_hash_bytes(data, size, 1));
+    prev = h;
+  }
+
+  // Flipping one bit anywhere changes the hash of a long key.
+  uint64_t h = cc_hash_bytes(data, SIZE, 0);
+  for (size_t i = 0; i < SIZE; i += 7) {
+    data[i] ^= 0x10;
+    CU_ASSERT_NOT_EQUAL(cc_hash_bytes(data, SIZE, 0), h);
+    data[i] ^= 0x10;
+  }
+
+  CU_ASSERT_EQUAL(cc_hash_bytes(data, SIZE, 0), h);
+  CU_ASSERT_NOT_EQUAL(cc_hash_u64(1), cc_hash_u64(2));
+  CU_ASSERT_EQUAL(cc_hash_cstr_key("abc"), cc_hash_bytes("abc", 3, 0));
+  CU_ASSERT(cc_eq_cstr_key("abc", "abc"));
+  CU_ASSERT(!cc_eq_cstr_key("abc", "abd"));
+}
+
+void test_hash_long_keys()
+{
+  // Fixed outputs for keys that go through the striped loop, so that the
+  // SSE2 and the CC_HASH_NO_SIMD builds are both checked against them.
+  static const struct {
+    size_t size;
+    uint64_t seed;
+    uint64_t hash;
+  } vectors[] = {
+      {513, 0, 0xc3e6a7c4a5681443ull},
+      {576, 0, 0x0f70c04c2650bfbdull},
+      {1031, 0, 0x319dffa95d0cf44cull},
+      {2100, 0, 0x8eb202aa437e3481ull},
+      {4096, 0, 0x6a3dee5690b8b60eull},
+      {513, 0x9e3779b97f4a7c15ull, 0xafeeb82b0433617full},
+      {576, 0x9e3779b97f4a7c15ull, 0x12340364c3b4396bull},
+      {1031, 0x9e3779b97f4a7c15ull, 0xb7cb228764276f0full},
+      {2100, 0x9e3779b97f4a7c15ull, 0xd310d264f44b58cdull},
+      {4096, 0x9e3779b97f4a7c15ull, 0xbf216cf747a060e5ull},
+  };
+
+  enum { SIZE = 4096 };
+  unsigned char data[SIZE];
+  for (size_t i = 0; i < SIZE; ++i) {
+    data[i] = (unsigned char)(i * 131 + 7);
+  }
+
+  for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); ++i) {
+    CU_ASSERT_EQUAL(cc_hash_bytes(data, vectors[i].size, vectors[i].seed),
+                    vectors[i].hash);
+  }
+}
+
+void test_hash_string_keys()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  cc_string_key_info(&info);
+  info.dfree = free_string_key;
+
+  struct cc_lru_cache *c = NULL;
+  CU_ASSERT_EQUAL(cc_lru_cache_ctor(&c, 8 /* max_size */, &info),
+                  CDC_STATUS_OK);
+
+  char buf[64];
+  for (int i = 0; i < 10; ++i) {
+    int size = snprintf(buf, sizeof(buf), "key-%d", i);
+    struct cc_string_key *key = cc_string_key_new(buf, (size_t)size);
+    CU_ASSERT_PTR_NOT_NULL(key);
+    CU_ASSERT_STRING_EQUAL(key->data, buf);
+    CU_ASSERT_EQUAL(cc_lru_cache_insert(c, key, CDC_FROM_INT(i),
+                                        NULL /* inserted */),
+                    CDC_STATUS_OK);
+  }
+
+  // The first two keys are evicted and freed.
+  void *value = NULL;
+  struct cc_string_key key = cc_string_key_view("key-1", 5);
+  CU_ASSERT_EQUAL(cc_lru_cache_get(c, &key, &value), CDC_STATUS_NOT_FOUND);
+  key = cc_string_key_view("key-9", 5);
+  CU_ASSERT_EQUAL(cc_lru_cache_get(c, &key, &value), CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(CDC_TO_INT(value), 9);
+  key = cc_string_key_view("key-9x", 5);
+  CU_ASSERT_EQUAL(cc_lru_cache_get(c, &key, &value), CDC_STATUS_OK);
+  key = cc_string_key_view("key-", 4);
+  CU_ASSERT(!cc_lru_cache_contains(c, &key));
+  key = cc_string_key_view("key-5", 5);
+  cc_lru_cache_erase(c, &key);
+  CU_ASSERT(!cc_lru_cache_contains(c, &key));
+  CU_ASSERT_EQUAL(cc_lru_cache_size(c), 7);
+  cc_lru_cache_dtor(c);
+}
@@ -0,0 +1,147 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "test-common.h"
+
+#include "ccache/lfu.h"
+
+#include <CUnit/Basic.h>
+#include <cdcontainers/cdc.h>
+
+static int eq(const void *l, const void *r)
+{
+  return CDC_TO_INT(l) == CDC_TO_INT(r);
+}
+
+static size_t hash(const void *val) { return cdc_hash_int(CDC_TO_INT(val)); }
+
+static struct cc_lfu_cache *make_cache(size_t max_size)
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+
+  struct cc_lfu_cache *cache = NULL;
+  CU_ASSERT_EQUAL(cc_lfu_cache_ctor(&cache, max_size, &info), CDC_STATUS_OK);
+  return cache;
+}
+
+static void insert(struct cc_lfu_cache *cache, int key)
+{
+  CU_ASSERT_EQUAL(cc_lfu_cache_insert(cache, CDC_FROM_INT(key),
+                                      CDC_FROM_INT(key), NULL /* inserted */),
+                  CDC_STATUS_OK);
+}
+
+static void get(struct cc_lfu_cache *cache, int key)
+{
+  void *value = NULL;
+  CU_ASSERT_EQUAL(cc_lfu_cache_get(cache, CDC_FROM_INT(key), &value),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(CDC_TO_INT(value), key);
+}
+
+void test_lfu_cache_get()
+{
+  struct cc_lfu_cache *cache = make_cache(2);
+  insert(cache, 1);
+  insert(cache, 2);
+  get(cache, 1);
+  get(cache, 1);
+  CU_ASSERT_EQUAL(cc_lfu_cache_frequency(cache, CDC_FROM_INT(1)), 3);
+  CU_ASSERT_EQUAL(cc_lfu_cache_frequency(cache, CDC_FROM_INT(2)), 1);
+  CU_ASSERT_EQUAL(cc_lfu_cache_frequency(cache, CDC_FROM_INT(3)), 0);
+
+  void *value = NULL;
+  CU_ASSERT_EQUAL(cc_lfu_cache_get(cache, CDC_FROM_INT(3), &value),
+                  CDC_STATUS_NOT_FOUND);
+  cc_lfu_cache_dtor(cache);
+}
+
+void test_lfu_cache_eviction()
+{
+  struct cc_lfu_cache *cache = make_cache(3);
+  insert(cache, 1);
+  insert(cache, 2);
+  insert(cache, 3);
+  get(cache, 1);
+  get(cache, 3);
+  get(cache, 2);
+
+  // All frequencies are equal, so the least recently used is evicted.
+  insert(cache, 4);
+  CU_ASSERT(!cc_lfu_cache_contains(cache, CDC_FROM_INT(1)));
+
+  // 4 has the lowest frequency.
+  insert(cache, 5);
+  CU_ASSERT(!cc_lfu_cache_contains(cache, CDC_FROM_INT(4)));
+  CU_ASSERT(cc_lfu_cache_contains(cache, CDC_FROM_INT(2)));
+  CU_ASSERT(cc_lfu_cache_contains(cache, CDC_FROM_INT(3)));
+  CU_ASSERT_EQUAL(cc_lfu_cache_size(cache), 3);
+
+  bool inserted = true;
+  CU_ASSERT_EQUAL(cc_lfu_cache_insert_or_assign(cache, CDC_FROM_INT(5),
+                                                CDC_FROM_INT(5), &inserted),
+                  CDC_STATUS_OK);
+  CU_ASSERT(!inserted);
+  CU_ASSERT_EQUAL(cc_lfu_cache_frequency(cache, CDC_FROM_INT(5)), 2);
+
+  struct cdc_pair kv = {NULL, NULL};
+  cc_lfu_cache_take(cache, CDC_FROM_INT(3), &kv);
+  CU_ASSERT_EQUAL(CDC_TO_INT(kv.second), 3);
+  cc_lfu_cache_erase(cache, CDC_FROM_INT(2));
+  CU_ASSERT_EQUAL(cc_lfu_cache_size(cache), 1);
+
+  cc_lfu_cache_clear(cache);
+  CU_ASSERT(cc_lfu_cache_empty(cache));
+  cc_lfu_cache_dtor(cache);
+}
+
+void test_lfu_cache_decay()
+{
+  struct cc_lfu_cache *cache = make_cache(2);
+  insert(cache, 1);
+  for (int i = 0; i < 6; ++i) {
+    get(cache, 1);
+  }
+
+  insert(cache, 2);
+  get(cache, 2);
+  CU_ASSERT_EQUAL(cc_lfu_cache_frequency(cache, CDC_FROM_INT(1)), 7);
+  CU_ASSERT_EQUAL(cc_lfu_cache_frequency(cache, CDC_FROM_INT(2)), 2);
+
+  cc_lfu_cache_set_decay(cache, 3);
+  get(cache, 2);
+  get(cache, 2);
+  get(cache, 2);
+  // 7 -> 3 and 4 -> 2, then 2 -> 3.
+  CU_ASSERT_EQUAL(cc_lfu_cache_frequency(cache, CDC_FROM_INT(1)), 3);
+  CU_ASSERT_EQUAL(cc_lfu_cache_frequency(cache, CDC_FROM_INT(2)), 3);
+
+  get(cache, 2);
+  get(cache, 2);
+  get(cache, 1);
+  // 3 -> 1 and 5 -> 2, then 1 -> 2: both end up in the same bucket.
+  CU_ASSERT_EQUAL(cc_lfu_cache_frequency(cache, CDC_FROM_INT(1)), 2);
+  CU_ASSERT_EQUAL(cc_lfu_cache_frequency(cache, CDC_FROM_INT(2)), 2);
+  insert(cache, 3);
+  CU_ASSERT(!cc_lfu_cache_contains(cache, CDC_FROM_INT(2)));
+  cc_lfu_cache_dtor(cache);
+}
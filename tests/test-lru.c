@@ -20,6 +20,7 @@
 // IN THE SOFTWARE.
 #include "test-common.h"
 
+#include "ccache/handle.h"
 #include "ccache/lru.h"
 
 #include <stdarg.h>
@@ -43,6 +44,32 @@ static int eq(const void *l, const void *r)
 
 static size_t hash(const void *val) { return cdc_hash_int(CDC_TO_INT(val)); }
 
+static bool collect_key(void *key, void *value, void *ctx)
+{
+  CDC_UNUSED(value);
+
+  int **out = (int **)ctx;
+  *(*out)++ = CDC_TO_INT(key);
+  return CDC_TO_INT(key) != 0;
+}
+
+static int freed_values = 0;
+
+static void count_free(void *data)
+{
+  struct cdc_pair *kv = (struct cdc_pair *)data;
+  if (kv->second) {
+    __atomic_add_fetch(&freed_values, 1, __ATOMIC_RELAXED);
+  }
+}
+
+static size_t payload_size(void *key, void *value)
+{
+  CDC_UNUSED(key);
+
+  return (size_t)CDC_TO_INT(value) * 10;
+}
+
 void test_lru_cache_ctor()
 {
   struct cdc_data_info info = CDC_INIT_STRUCT;
@@ -223,3 +250,489 @@ void test_lru_cache_clear()
   CU_ASSERT(cc_lru_cache_empty(cache));
   cc_lru_cache_dtor(cache);
 }
+
+void test_lru_cache_set_max_size()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+
+  struct cc_lru_cache *cache = NULL;
+
+  CU_ASSERT_EQUAL(cc_lru_cache_ctor(&cache, 8 /* max_size */, &info),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_lru_cache_reserve(cache, 8), CDC_STATUS_OK);
+
+  struct cdc_pair *pairs[] = {&a, &b, &c, &d, &e, &f, &g, &h};
+  for (size_t i = 0; i < 8; ++i) {
+    CU_ASSERT_EQUAL(cc_lru_cache_insert(cache, pairs[i]->first,
+                                        pairs[i]->second, NULL /*inserted */),
+                    CDC_STATUS_OK);
+  }
+
+  cc_lru_cache_set_max_size(cache, 2);
+  CU_ASSERT_EQUAL(cc_lru_cache_max_size(cache), 2);
+  CU_ASSERT_EQUAL(cc_lru_cache_size(cache), 8);
+
+  CU_ASSERT_EQUAL(cc_lru_cache_trim(cache, 3 /* budget */), 3);
+  CU_ASSERT_EQUAL(cc_lru_cache_size(cache), 5);
+  CU_ASSERT(!cc_lru_cache_contains(cache, c.first));
+  CU_ASSERT(cc_lru_cache_contains(cache, d.first));
+
+  // d is the most recently used entry now.
+  CU_ASSERT_EQUAL(cc_lru_cache_trim(cache, 10 /* budget */), 3);
+  CU_ASSERT_EQUAL(cc_lru_cache_size(cache), 2);
+  CU_ASSERT(cc_lru_cache_contains(cache, h.first));
+  CU_ASSERT(cc_lru_cache_contains(cache, d.first));
+
+  cc_lru_cache_set_max_size(cache, 3);
+  CU_ASSERT_EQUAL(
+      cc_lru_cache_insert(cache, a.first, a.second, NULL /*inserted */),
+      CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_lru_cache_size(cache), 3);
+  CU_ASSERT_EQUAL(cc_lru_cache_trim(cache, 10 /* budget */), 0);
+  cc_lru_cache_dtor(cache);
+}
+
+void test_lru_cache_memory_usage()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+
+  struct cc_lru_cache *cache = NULL;
+
+  CU_ASSERT_EQUAL(cc_lru_cache_ctor(&cache, 2 /* max_size */, &info),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(
+      cc_lru_cache_insert(cache, b.first, b.second, NULL /*inserted */),
+      CDC_STATUS_OK);
+  cc_lru_cache_set_payload_size(cache, payload_size);
+
+  struct cc_memory_usage empty = cc_lru_cache_memory_usage(cache);
+  CU_ASSERT_EQUAL(empty.payload, 10);
+  CU_ASSERT(empty.metadata > 0);
+
+  CU_ASSERT_EQUAL(
+      cc_lru_cache_insert(cache, c.first, c.second, NULL /*inserted */),
+      CDC_STATUS_OK);
+  struct cc_memory_usage usage = cc_lru_cache_memory_usage(cache);
+  CU_ASSERT_EQUAL(usage.payload, 30);
+  CU_ASSERT(usage.metadata > empty.metadata);
+
+  CU_ASSERT_EQUAL(cc_lru_cache_insert_or_assign(cache, b.first, d.second,
+                                                NULL /*inserted */),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_lru_cache_memory_usage(cache).payload, 50);
+
+  // Evicts c.
+  CU_ASSERT_EQUAL(
+      cc_lru_cache_insert(cache, e.first, e.second, NULL /*inserted */),
+      CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_lru_cache_memory_usage(cache).payload, 70);
+
+  cc_lru_cache_erase(cache, b.first);
+  CU_ASSERT_EQUAL(cc_lru_cache_memory_usage(cache).payload, 40);
+
+  cc_lru_cache_clear(cache);
+  CU_ASSERT_EQUAL(cc_lru_cache_memory_usage(cache).payload, 0);
+  CU_ASSERT(cc_lru_cache_bytes_for(1000) > cc_lru_cache_bytes_for(10));
+
+  // The tag index and the handles count as metadata too.
+  CU_ASSERT_EQUAL(
+      cc_lru_cache_insert(cache, b.first, b.second, NULL /*inserted */),
+      CDC_STATUS_OK);
+  size_t metadata = cc_lru_cache_memory_usage(cache).metadata;
+  cc_lru_cache_erase(cache, b.first);
+  CU_ASSERT_EQUAL(cc_lru_cache_insert_tagged(cache, b.first, b.second,
+                                             c.first, NULL /*inserted */),
+                  CDC_STATUS_OK);
+  CU_ASSERT(cc_lru_cache_memory_usage(cache).metadata > metadata);
+  metadata = cc_lru_cache_memory_usage(cache).metadata;
+  struct cc_handle *h = NULL;
+  CU_ASSERT_EQUAL(cc_lru_cache_acquire(cache, b.first, &h), CDC_STATUS_OK);
+  CU_ASSERT(cc_lru_cache_memory_usage(cache).metadata > metadata);
+  cc_handle_release(h);
+  cc_lru_cache_dtor(cache);
+}
+
+void test_lru_cache_iterators()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+
+  struct cc_lru_cache *cache = NULL;
+
+  CU_ASSERT_EQUAL(cc_lru_cache_ctor(&cache, 3 /* max_size */, &info),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(
+      cc_lru_cache_insert(cache, a.first, a.second, NULL /*inserted */),
+      CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(
+      cc_lru_cache_insert(cache, b.first, b.second, NULL /*inserted */),
+      CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(
+      cc_lru_cache_insert(cache, c.first, c.second, NULL /*inserted */),
+      CDC_STATUS_OK);
+
+  struct cc_lru_cache_iter it;
+  cc_lru_cache_begin(cache, &it);
+  CU_ASSERT(cc_lru_cache_iter_valid(&it));
+  CU_ASSERT_EQUAL(cc_lru_cache_iter_key(&it), c.first);
+  cc_lru_cache_iter_next(&it);
+  CU_ASSERT_EQUAL(cc_lru_cache_iter_value(&it), b.second);
+  cc_lru_cache_iter_next(&it);
+  CU_ASSERT_EQUAL(cc_lru_cache_iter_key(&it), a.first);
+  cc_lru_cache_iter_prev(&it);
+  CU_ASSERT_EQUAL(cc_lru_cache_iter_key(&it), b.first);
+  cc_lru_cache_iter_next(&it);
+  cc_lru_cache_iter_next(&it);
+  CU_ASSERT(!cc_lru_cache_iter_valid(&it));
+
+  int keys[3] = {-1, -1, -1};
+  int *out = keys;
+  cc_lru_cache_rfor_each(cache, collect_key, &out);
+  CU_ASSERT_EQUAL(out - keys, 1);
+  CU_ASSERT_EQUAL(keys[0], 0);
+
+  out = keys;
+  cc_lru_cache_for_each(cache, collect_key, &out);
+  CU_ASSERT_EQUAL(out - keys, 3);
+  CU_ASSERT_EQUAL(keys[0], 2);
+  CU_ASSERT_EQUAL(keys[1], 1);
+  CU_ASSERT_EQUAL(keys[2], 0);
+
+  // Iteration does not change the eviction order.
+  CU_ASSERT_EQUAL(
+      cc_lru_cache_insert(cache, d.first, d.second, NULL /*inserted */),
+      CDC_STATUS_OK);
+  CU_ASSERT(!cc_lru_cache_contains(cache, a.first));
+  cc_lru_cache_dtor(cache);
+}
+
+void test_lru_cache_reclaim()
+{
+  struct cc_lru_cache *cache = NULL;
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+  info.dfree = count_free;
+
+  freed_values = 0;
+  CU_ASSERT_EQUAL(cc_lru_cache_ctor(&cache, 2 /* max_size */, &info),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_lru_cache_enable_reclaimer(cache, false /* background */),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_lru_cache_insert(cache, b.first, b.second, NULL),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_lru_cache_insert(cache, c.first, c.second, NULL),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_lru_cache_insert(cache, d.first, d.second, NULL),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_lru_cache_insert_or_assign(cache, c.first, e.second, NULL),
+                  CDC_STATUS_OK);
+  cc_lru_cache_erase(cache, d.first);
+  // The evicted, replaced and erased values wait for reclamation.
+  CU_ASSERT_EQUAL(freed_values, 0);
+  CU_ASSERT_EQUAL(cc_lru_cache_reclaim(cache, 2), 2);
+  CU_ASSERT_EQUAL(freed_values, 2);
+  CU_ASSERT_EQUAL(cc_lru_cache_reclaim(cache, 2), 1);
+  CU_ASSERT_EQUAL(cc_lru_cache_reclaim(cache, 2), 0);
+  CU_ASSERT_EQUAL(freed_values, 3);
+
+  cc_lru_cache_clear(cache);
+  CU_ASSERT_EQUAL(freed_values, 3);
+  CU_ASSERT_EQUAL(cc_lru_cache_size(cache), 0);
+  CU_ASSERT_EQUAL(cc_lru_cache_reclaim(cache, 10), 1);
+  CU_ASSERT_EQUAL(freed_values, 4);
+
+  CU_ASSERT_EQUAL(cc_lru_cache_enable_reclaimer(cache, true /* background */),
+                  CDC_STATUS_OK);
+  for (int i = 0; i < 8; ++i) {
+    CU_ASSERT_EQUAL(cc_lru_cache_insert(cache, CDC_FROM_INT(i),
+                                        CDC_FROM_INT(i + 1), NULL),
+                    CDC_STATUS_OK);
+  }
+
+  cc_lru_cache_clear(cache);
+  // Waits for the background thread.
+  cc_lru_cache_disable_reclaimer(cache);
+  CU_ASSERT_EQUAL(freed_values, 12);
+  cc_lru_cache_dtor(cache);
+}
+
+void test_lru_cache_bulk_load()
+{
+  struct cc_lru_cache *cache = NULL;
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+  info.dfree = count_free;
+
+  freed_values = 0;
+  CU_ASSERT_EQUAL(cc_lru_cache_ctor1(&cache, 4 /* max_size */, &info,
+                                     true /* reserve */),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_lru_cache_insert(cache, b.first, b.second, NULL),
+                  CDC_STATUS_OK);
+
+  // The key of b is cached, so its pair is skipped and not freed.
+  void *keys[] = {c.first, b.first, d.first, e.first};
+  void *values[] = {c.second, f.second, d.second, e.second};
+  size_t loaded = 0;
+  CU_ASSERT_EQUAL(cc_lru_cache_bulk_load(cache, keys, values, 4, &loaded),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(loaded, 3);
+  CU_ASSERT_EQUAL(freed_values, 0);
+  int order[4] = {-1, -1, -1, -1};
+  int *out = order;
+  cc_lru_cache_for_each(cache, collect_key, &out);
+  CU_ASSERT_EQUAL(out - order, 4);
+  CU_ASSERT_EQUAL(order[0], 4);
+  CU_ASSERT_EQUAL(order[3], 1);
+
+  // Loading past the capacity evicts the least recently used entries.
+  void *more_keys[] = {f.first, g.first};
+  void *more_values[] = {f.second, g.second};
+  CU_ASSERT_EQUAL(
+      cc_lru_cache_bulk_load(cache, more_keys, more_values, 2, &loaded),
+      CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(loaded, 2);
+  CU_ASSERT_EQUAL(freed_values, 2);
+  out = order;
+  cc_lru_cache_for_each(cache, collect_key, &out);
+  CU_ASSERT_EQUAL(out - order, 4);
+  CU_ASSERT_EQUAL(order[0], 6);
+  CU_ASSERT_EQUAL(order[1], 5);
+  CU_ASSERT_EQUAL(order[3], 3);
+
+  // Reserved nodes go through the reclaimer like allocated ones.
+  CU_ASSERT_EQUAL(cc_lru_cache_enable_reclaimer(cache, false /* background */),
+                  CDC_STATUS_OK);
+  cc_lru_cache_erase(cache, d.first);
+  CU_ASSERT_EQUAL(cc_lru_cache_insert(cache, h.first, h.second, NULL),
+                  CDC_STATUS_OK);
+  cc_lru_cache_clear(cache);
+  CU_ASSERT_EQUAL(freed_values, 2);
+  CU_ASSERT_EQUAL(cc_lru_cache_reclaim(cache, 10), 5);
+  CU_ASSERT_EQUAL(freed_values, 7);
+  cc_lru_cache_dtor(cache);
+}
+
+void test_lru_cache_handles()
+{
+  struct cc_lru_cache *cache = NULL;
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+  info.dfree = count_free;
+
+  freed_values = 0;
+  CU_ASSERT_EQUAL(cc_lru_cache_ctor(&cache, 2 /* max_size */, &info),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_lru_cache_insert(cache, b.first, b.second, NULL),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_lru_cache_insert(cache, c.first, c.second, NULL),
+                  CDC_STATUS_OK);
+
+  struct cc_handle *h1 = NULL;
+  struct cc_handle *h2 = NULL;
+  CU_ASSERT_EQUAL(cc_lru_cache_acquire(cache, a.first, &h1),
+                  CDC_STATUS_NOT_FOUND);
+  CU_ASSERT_EQUAL(cc_lru_cache_acquire(cache, b.first, &h1), CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_lru_cache_acquire(cache, b.first, &h2), CDC_STATUS_OK);
+  CU_ASSERT(h1 == h2);
+  CU_ASSERT_EQUAL(CDC_TO_INT(cc_handle_value(h1)), 1);
+
+  // b is evicted, but its value lives until the last release.
+  CU_ASSERT_EQUAL(cc_lru_cache_insert(cache, d.first, d.second, NULL),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_lru_cache_insert(cache, e.first, e.second, NULL),
+                  CDC_STATUS_OK);
+  CU_ASSERT(!cc_lru_cache_contains(cache, b.first));
+  CU_ASSERT_EQUAL(freed_values, 1);
+  cc_handle_release(h1);
+  CU_ASSERT_EQUAL(freed_values, 1);
+  CU_ASSERT_EQUAL(CDC_TO_INT(cc_handle_value(h2)), 1);
+  cc_handle_release(h2);
+  CU_ASSERT_EQUAL(freed_values, 2);
+
+  // A replaced value is kept for the handle, the key stays in the cache.
+  CU_ASSERT_EQUAL(cc_lru_cache_acquire(cache, d.first, &h1), CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_lru_cache_insert_or_assign(cache, d.first, f.second, NULL),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(freed_values, 2);
+  CU_ASSERT_EQUAL(CDC_TO_INT(cc_handle_value(h1)), 3);
+  cc_handle_release(h1);
+  CU_ASSERT_EQUAL(freed_values, 3);
+
+  // An acquired entry cannot be taken.
+  CU_ASSERT_EQUAL(cc_lru_cache_acquire(cache, e.first, &h1), CDC_STATUS_OK);
+  struct cdc_pair kv = {NULL, NULL};
+  cc_lru_cache_take(cache, e.first, &kv);
+  CU_ASSERT_PTR_NULL(kv.second);
+  CU_ASSERT(cc_lru_cache_contains(cache, e.first));
+  cc_handle_release(h1);
+
+  // A handle of a cached entry does not change how it is freed.
+  CU_ASSERT_EQUAL(cc_lru_cache_acquire(cache, e.first, &h1), CDC_STATUS_OK);
+  cc_handle_release(h1);
+  cc_lru_cache_erase(cache, e.first);
+  CU_ASSERT_EQUAL(freed_values, 4);
+
+  CU_ASSERT_EQUAL(cc_lru_cache_acquire(cache, d.first, &h1), CDC_STATUS_OK);
+  cc_lru_cache_clear(cache);
+  CU_ASSERT_EQUAL(freed_values, 4);
+  CU_ASSERT(cc_lru_cache_empty(cache));
+  cc_handle_release(h1);
+  CU_ASSERT_EQUAL(freed_values, 5);
+
+  CU_ASSERT_EQUAL(cc_lru_cache_insert(cache, g.first, g.second, NULL),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_lru_cache_acquire(cache, g.first, &h1), CDC_STATUS_OK);
+  cc_lru_cache_dtor(cache);
+  CU_ASSERT_EQUAL(freed_values, 5);
+  CU_ASSERT_EQUAL(CDC_TO_INT(cc_handle_value(h1)), 6);
+  cc_handle_release(h1);
+  CU_ASSERT_EQUAL(freed_values, 6);
+}
+
+void test_lru_cache_watermarks()
+{
+  struct cc_lru_cache *cache = NULL;
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+  info.dfree = count_free;
+
+  freed_values = 0;
+  CU_ASSERT_EQUAL(cc_lru_cache_ctor(&cache, 4 /* max_size */, &info),
+                  CDC_STATUS_OK);
+  cc_lru_cache_set_watermarks(cache, 1 /* low */, 3 /* high */);
+  for (int i = 0; i < 3; ++i) {
+    CU_ASSERT_EQUAL(cc_lru_cache_insert(cache, CDC_FROM_INT(i),
+                                        CDC_FROM_INT(i + 1), NULL),
+                    CDC_STATUS_OK);
+  }
+
+  // The insert at the high watermark evicts down to the low one.
+  CU_ASSERT_EQUAL(freed_values, 0);
+  CU_ASSERT_EQUAL(cc_lru_cache_insert(cache, d.first, d.second, NULL),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_lru_cache_size(cache), 2);
+  CU_ASSERT_EQUAL(freed_values, 2);
+  CU_ASSERT(cc_lru_cache_contains(cache, c.first));
+  CU_ASSERT(cc_lru_cache_contains(cache, d.first));
+
+  CU_ASSERT_EQUAL(cc_lru_cache_maintain(cache), 0);
+  CU_ASSERT_EQUAL(cc_lru_cache_insert(cache, e.first, e.second, NULL),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_lru_cache_maintain(cache), 2);
+  CU_ASSERT_EQUAL(cc_lru_cache_size(cache), 1);
+  CU_ASSERT(cc_lru_cache_contains(cache, e.first));
+  CU_ASSERT_EQUAL(freed_values, 4);
+
+  // Without watermarks a full cache evicts one entry per insert.
+  cc_lru_cache_set_watermarks(cache, 0 /* low */, 0 /* high */);
+  for (int i = 0; i < 4; ++i) {
+    CU_ASSERT_EQUAL(cc_lru_cache_insert(cache, CDC_FROM_INT(i),
+                                        CDC_FROM_INT(i + 1), NULL),
+                    CDC_STATUS_OK);
+  }
+
+  CU_ASSERT_EQUAL(cc_lru_cache_size(cache), 4);
+  CU_ASSERT_EQUAL(cc_lru_cache_maintain(cache), 0);
+  CU_ASSERT_EQUAL(freed_values, 5);
+  cc_lru_cache_dtor(cache);
+}
+
+void test_lru_cache_tags()
+{
+  struct cc_lru_cache *cache = NULL;
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+  info.dfree = count_free;
+
+  freed_values = 0;
+  void *odd = CDC_FROM_INT(1);
+  void *even = CDC_FROM_INT(2);
+  CU_ASSERT_EQUAL(cc_lru_cache_ctor(&cache, 10 /* max_size */, &info),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_lru_cache_invalidate_tag(cache, odd), 0);
+  for (int i = 1; i <= 8; ++i) {
+    bool inserted = false;
+    CU_ASSERT_EQUAL(cc_lru_cache_insert_tagged(cache, CDC_FROM_INT(i),
+                                               CDC_FROM_INT(i),
+                                               i % 2 ? odd : even, &inserted),
+                    CDC_STATUS_OK);
+    CU_ASSERT(inserted);
+  }
+
+  CU_ASSERT_EQUAL(cc_lru_cache_insert(cache, CDC_FROM_INT(9), CDC_FROM_INT(9),
+                                      NULL),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_lru_cache_invalidate_tag(cache, odd), 4);
+  CU_ASSERT_EQUAL(cc_lru_cache_size(cache), 5);
+  CU_ASSERT_EQUAL(freed_values, 4);
+  CU_ASSERT(!cc_lru_cache_contains(cache, CDC_FROM_INT(3)));
+  CU_ASSERT(cc_lru_cache_contains(cache, CDC_FROM_INT(4)));
+  CU_ASSERT(cc_lru_cache_contains(cache, CDC_FROM_INT(9)));
+  CU_ASSERT_EQUAL(cc_lru_cache_invalidate_tag(cache, odd), 0);
+
+  // Expired entries are dropped when their keys are accessed.
+  cc_lru_cache_expire_tag(cache, even);
+  CU_ASSERT_EQUAL(cc_lru_cache_size(cache), 5);
+  void *value = NULL;
+  CU_ASSERT_EQUAL(cc_lru_cache_get(cache, CDC_FROM_INT(2), &value),
+                  CDC_STATUS_NOT_FOUND);
+  CU_ASSERT_EQUAL(cc_lru_cache_size(cache), 4);
+  CU_ASSERT_EQUAL(freed_values, 5);
+  bool inserted = false;
+  CU_ASSERT_EQUAL(cc_lru_cache_insert(cache, CDC_FROM_INT(4), CDC_FROM_INT(4),
+                                      &inserted),
+                  CDC_STATUS_OK);
+  CU_ASSERT(inserted);
+  CU_ASSERT_EQUAL(freed_values, 6);
+  struct cdc_pair kv = {NULL, NULL};
+  cc_lru_cache_take(cache, CDC_FROM_INT(6), &kv);
+  CU_ASSERT_PTR_NULL(kv.first);
+  CU_ASSERT_PTR_NULL(kv.second);
+  CU_ASSERT_EQUAL(freed_values, 7);
+
+  // Entries tagged after the expiry stay valid.
+  CU_ASSERT_EQUAL(cc_lru_cache_insert_tagged(cache, CDC_FROM_INT(10),
+                                             CDC_FROM_INT(10), even, NULL),
+                  CDC_STATUS_OK);
+  CU_ASSERT(cc_lru_cache_contains(cache, CDC_FROM_INT(10)));
+  CU_ASSERT(!cc_lru_cache_contains(cache, CDC_FROM_INT(6)));
+  CU_ASSERT_EQUAL(cc_lru_cache_invalidate_tag(cache, even), 2);
+  CU_ASSERT_EQUAL(cc_lru_cache_size(cache), 2);
+  CU_ASSERT_EQUAL(freed_values, 9);
+
+  CU_ASSERT_EQUAL(cc_lru_cache_insert_tagged(cache, CDC_FROM_INT(11),
+                                             CDC_FROM_INT(11), odd, NULL),
+                  CDC_STATUS_OK);
+  cc_lru_cache_clear(cache);
+  CU_ASSERT_EQUAL(cc_lru_cache_invalidate_tag(cache, odd), 0);
+  CU_ASSERT_EQUAL(cc_lru_cache_insert_tagged(cache, CDC_FROM_INT(12),
+                                             CDC_FROM_INT(12), odd, NULL),
+                  CDC_STATUS_OK);
+
+  // A bulk load replaces a stale entry instead of skipping its key.
+  cc_lru_cache_expire_tag(cache, odd);
+  void *keys[] = {CDC_FROM_INT(12)};
+  void *values[] = {CDC_FROM_INT(120)};
+  size_t loaded = 0;
+  CU_ASSERT_EQUAL(cc_lru_cache_bulk_load(cache, keys, values, 1, &loaded),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(loaded, 1);
+  CU_ASSERT_EQUAL(freed_values, 13);
+  CU_ASSERT_EQUAL(cc_lru_cache_get(cache, CDC_FROM_INT(12), &value),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(CDC_TO_INT(value), 120);
+  CU_ASSERT_EQUAL(cc_lru_cache_size(cache), 1);
+  cc_lru_cache_dtor(cache);
+  CU_ASSERT_EQUAL(freed_values, 14);
+}
@@ -35,6 +35,29 @@ int main(int argc, char** argv)
     return CU_get_error();
   }
 
+  p_suite = CU_add_suite("CACHE", NULL, NULL);
+  if (p_suite == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  if (CU_add_test(p_suite, "test_policies", test_cache_policies) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  p_suite = CU_add_suite("2Q CACHE", NULL, NULL);
+  if (p_suite == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  if (CU_add_test(p_suite, "test_scan", test_2q_cache_scan) == NULL ||
+      CU_add_test(p_suite, "test_modifiers", test_2q_cache_modifiers) ==
+          NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
 
   p_suite = CU_add_suite("LRU CACHE", NULL, NULL);
   if (p_suite == NULL) {
@@ -48,7 +71,239 @@ int main(int argc, char** argv)
       CU_add_test(p_suite, "test_capacity", test_lru_cache_capacity) == NULL ||
       CU_add_test(p_suite, "test_insert", test_lru_cache_insert) == NULL ||
       CU_add_test(p_suite, "test_erase", test_lru_cache_erase) == NULL ||
-      CU_add_test(p_suite, "test_clear", test_lru_cache_clear) == NULL) {
+      CU_add_test(p_suite, "test_clear", test_lru_cache_clear) == NULL ||
+      CU_add_test(p_suite, "test_set_max_size",
+                  test_lru_cache_set_max_size) == NULL ||
+      CU_add_test(p_suite, "test_memory_usage",
+                  test_lru_cache_memory_usage) == NULL ||
+      CU_add_test(p_suite, "test_iterators", test_lru_cache_iterators) ==
+          NULL ||
+      CU_add_test(p_suite, "test_reclaim", test_lru_cache_reclaim) == NULL ||
+      CU_add_test(p_suite, "test_bulk_load", test_lru_cache_bulk_load) ==
+          NULL ||
+      CU_add_test(p_suite, "test_handles", test_lru_cache_handles) == NULL ||
+      CU_add_test(p_suite, "test_watermarks", test_lru_cache_watermarks) ==
+          NULL ||
+      CU_add_test(p_suite, "test_tags", test_lru_cache_tags) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  p_suite = CU_add_suite("LFU CACHE", NULL, NULL);
+  if (p_suite == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  if (CU_add_test(p_suite, "test_get", test_lfu_cache_get) == NULL ||
+      CU_add_test(p_suite, "test_eviction", test_lfu_cache_eviction) == NULL ||
+      CU_add_test(p_suite, "test_decay", test_lfu_cache_decay) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  p_suite = CU_add_suite("HASH", NULL, NULL);
+  if (p_suite == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  if (CU_add_test(p_suite, "test_bytes", test_hash_bytes) == NULL ||
+      CU_add_test(p_suite, "test_long_keys", test_hash_long_keys) == NULL ||
+      CU_add_test(p_suite, "test_string_keys", test_hash_string_keys) ==
+          NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  p_suite = CU_add_suite("BLOOM FILTER", NULL, NULL);
+  if (p_suite == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  if (CU_add_test(p_suite, "test_add_remove", test_bloom_filter_add_remove) ==
+          NULL ||
+      CU_add_test(p_suite, "test_cache", test_bloom_filter_cache) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  p_suite = CU_add_suite("CONCURRENT FIFO CACHE", NULL, NULL);
+  if (p_suite == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  if (CU_add_test(p_suite, "test_get", test_cfifo_cache_get) == NULL ||
+      CU_add_test(p_suite, "test_stress", test_cfifo_cache_stress) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  p_suite = CU_add_suite("COMPRESSED CACHE", NULL, NULL);
+  if (p_suite == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  if (CU_add_test(p_suite, "test_lz_codec", test_lz_codec) == NULL ||
+      CU_add_test(p_suite, "test_get", test_compressed_cache_get) == NULL ||
+      CU_add_test(p_suite, "test_capacity", test_compressed_cache_capacity) ==
+          NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  p_suite = CU_add_suite("FIFO CACHE", NULL, NULL);
+  if (p_suite == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  if (CU_add_test(p_suite, "test_set_max_size",
+                  test_fifo_cache_set_max_size) == NULL ||
+      CU_add_test(p_suite, "test_watermarks", test_fifo_cache_watermarks) ==
+          NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  p_suite = CU_add_suite("FROZEN CACHE", NULL, NULL);
+  if (p_suite == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  if (CU_add_test(p_suite, "test_get", test_frozen_cache_get) == NULL ||
+      CU_add_test(p_suite, "test_invalid", test_frozen_cache_invalid) ==
+          NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  p_suite = CU_add_suite("GDSF CACHE", NULL, NULL);
+  if (p_suite == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  if (CU_add_test(p_suite, "test_eviction", test_gdsf_cache_eviction) ==
+          NULL ||
+      CU_add_test(p_suite, "test_cost", test_gdsf_cache_cost) == NULL ||
+      CU_add_test(p_suite, "test_oversized", test_gdsf_cache_oversized) ==
+          NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  p_suite = CU_add_suite("NEAR CACHE", NULL, NULL);
+  if (p_suite == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  if (CU_add_test(p_suite, "test_get", test_near_cache_get) == NULL ||
+      CU_add_test(p_suite, "test_eviction", test_near_cache_eviction) ==
+          NULL ||
+      CU_add_test(p_suite, "test_no_dfree", test_near_cache_no_dfree) ==
+          NULL ||
+      CU_add_test(p_suite, "test_stress", test_near_cache_stress) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  p_suite = CU_add_suite("ORDERED CACHE", NULL, NULL);
+  if (p_suite == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  if (CU_add_test(p_suite, "test_lookup", test_ordered_cache_lookup) == NULL ||
+      CU_add_test(p_suite, "test_range", test_ordered_cache_range) == NULL ||
+      CU_add_test(p_suite, "test_eviction", test_ordered_cache_eviction) ==
+          NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  p_suite = CU_add_suite("PARTITIONED CACHE", NULL, NULL);
+  if (p_suite == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  if (CU_add_test(p_suite, "test_sharing", test_partitioned_cache_sharing) ==
+          NULL ||
+      CU_add_test(p_suite, "test_modifiers",
+                  test_partitioned_cache_modifiers) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  p_suite = CU_add_suite("REFRESH CACHE", NULL, NULL);
+  if (p_suite == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  if (CU_add_test(p_suite, "test_get", test_refresh_cache_get) == NULL ||
+      CU_add_test(p_suite, "test_expire", test_refresh_cache_expire) == NULL ||
+      CU_add_test(p_suite, "test_take", test_refresh_cache_take) == NULL ||
+      CU_add_test(p_suite, "test_reload_free",
+                  test_refresh_cache_reload_free) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  p_suite = CU_add_suite("SAMPLED CACHE", NULL, NULL);
+  if (p_suite == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  if (CU_add_test(p_suite, "test_eviction", test_sampled_cache_eviction) ==
+          NULL ||
+      CU_add_test(p_suite, "test_modifiers", test_sampled_cache_modifiers) ==
+          NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  p_suite = CU_add_suite("SLRU CACHE", NULL, NULL);
+  if (p_suite == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  if (CU_add_test(p_suite, "test_scan", test_slru_cache_scan) == NULL ||
+      CU_add_test(p_suite, "test_modifiers", test_slru_cache_modifiers) ==
+          NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  p_suite = CU_add_suite("SHARDS", NULL, NULL);
+  if (p_suite == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  if (CU_add_test(p_suite, "test_cyclic", test_shards_cyclic) == NULL ||
+      CU_add_test(p_suite, "test_sampling", test_shards_sampling) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  p_suite = CU_add_suite("TOP KEYS", NULL, NULL);
+  if (p_suite == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  if (CU_add_test(p_suite, "test_get", test_top_keys_get) == NULL ||
+      CU_add_test(p_suite, "test_heavy_hitters",
+                  test_top_keys_heavy_hitters) == NULL) {
     CU_cleanup_registry();
     return CU_get_error();
   }
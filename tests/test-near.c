@@ -0,0 +1,339 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "test-common.h"
+
+#include "ccache/near.h"
+
+#include <CUnit/Basic.h>
+#include <cdcontainers/cdc.h>
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#define STRESS_READERS 4
+#define STRESS_KEYS 64
+#define STRESS_WRITES 20000
+
+struct reader {
+  struct cc_shared_cache *shared;
+  int *stop;
+  size_t errors;
+};
+
+static int eq(const void *l, const void *r)
+{
+  return CDC_TO_INT(l) == CDC_TO_INT(r);
+}
+
+static size_t hash(const void *val) { return cdc_hash_int(CDC_TO_INT(val)); }
+
+static void free_value(void *data)
+{
+  struct cdc_pair *kv = (struct cdc_pair *)data;
+  free(kv->second);
+}
+
+static int *new_value(int key)
+{
+  int *value = (int *)malloc(sizeof(int));
+  *value = key;
+  return value;
+}
+
+static void *read_loop(void *arg)
+{
+  struct reader *r = (struct reader *)arg;
+  struct cc_near_cache *c = NULL;
+  if (cc_near_cache_ctor(&c, r->shared, 8 /* sets */) != CDC_STATUS_OK) {
+    ++r->errors;
+    return NULL;
+  }
+
+  unsigned seed = 1;
+  while (!__atomic_load_n(r->stop, __ATOMIC_ACQUIRE)) {
+    seed = seed * 1103515245 + 12345;
+    int key = (int)((seed >> 16) % STRESS_KEYS);
+    void *value = NULL;
+    cc_near_cache_enter(c);
+    if (cc_near_cache_get(c, CDC_FROM_INT(key), &value) == CDC_STATUS_OK) {
+      // A freed value would be caught by the sanitizers.
+      if (*(int *)value != key) {
+        ++r->errors;
+      }
+    }
+
+    cc_near_cache_leave(c);
+  }
+
+  cc_near_cache_dtor(c);
+  return NULL;
+}
+
+void test_near_cache_get()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+  info.dfree = free_value;
+
+  struct cc_cache_config config;
+  config.policy = CC_POLICY_LRU;
+  config.max_size = 2;
+  config.info = &info;
+  struct cc_shared_cache *s = NULL;
+  CU_ASSERT_EQUAL(cc_shared_cache_ctor(&s, &config), CDC_STATUS_OK);
+  struct cc_near_cache *a = NULL;
+  struct cc_near_cache *b = NULL;
+  CU_ASSERT_EQUAL(cc_near_cache_ctor(&a, s, 4 /* sets */), CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_near_cache_ctor(&b, s, 4 /* sets */), CDC_STATUS_OK);
+
+  bool inserted = false;
+  CU_ASSERT_EQUAL(
+      cc_near_cache_insert(a, CDC_FROM_INT(1), new_value(1), &inserted),
+      CDC_STATUS_OK);
+  CU_ASSERT(inserted);
+
+  void *value = NULL;
+  cc_near_cache_enter(a);
+  CU_ASSERT_EQUAL(cc_near_cache_get(a, CDC_FROM_INT(1), &value),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(*(int *)value, 1);
+  CU_ASSERT_EQUAL(cc_near_cache_get(a, CDC_FROM_INT(1), &value),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_near_cache_get(a, CDC_FROM_INT(2), &value),
+                  CDC_STATUS_NOT_FOUND);
+  cc_near_cache_leave(a);
+  CU_ASSERT_EQUAL(a->hits, 1);
+  CU_ASSERT_EQUAL(a->misses, 2);
+
+  // A write through b invalidates the copy held by a.
+  CU_ASSERT_EQUAL(cc_near_cache_insert_or_assign(b, CDC_FROM_INT(1),
+                                                 new_value(10), &inserted),
+                  CDC_STATUS_OK);
+  CU_ASSERT(!inserted);
+  cc_near_cache_enter(a);
+  CU_ASSERT_EQUAL(cc_near_cache_get(a, CDC_FROM_INT(1), &value),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(*(int *)value, 10);
+  CU_ASSERT_EQUAL(a->misses, 3);
+
+  // Evicts key 1, whose value stays valid until a leaves.
+  CU_ASSERT_EQUAL(
+      cc_near_cache_insert(b, CDC_FROM_INT(2), new_value(2), &inserted),
+      CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(
+      cc_near_cache_insert(b, CDC_FROM_INT(3), new_value(3), &inserted),
+      CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(*(int *)value, 10);
+  CU_ASSERT_EQUAL(cc_near_cache_get(a, CDC_FROM_INT(1), &value),
+                  CDC_STATUS_NOT_FOUND);
+  cc_near_cache_leave(a);
+
+  cc_near_cache_erase(b, CDC_FROM_INT(2));
+  cc_near_cache_enter(a);
+  CU_ASSERT_EQUAL(cc_near_cache_get(a, CDC_FROM_INT(2), &value),
+                  CDC_STATUS_NOT_FOUND);
+  CU_ASSERT_EQUAL(cc_near_cache_get(a, CDC_FROM_INT(3), &value),
+                  CDC_STATUS_OK);
+  cc_near_cache_leave(a);
+
+  cc_near_cache_clear(b);
+  cc_near_cache_enter(a);
+  CU_ASSERT_EQUAL(cc_near_cache_get(a, CDC_FROM_INT(3), &value),
+                  CDC_STATUS_NOT_FOUND);
+  cc_near_cache_leave(a);
+
+  cc_near_cache_dtor(a);
+  cc_near_cache_dtor(b);
+  cc_shared_cache_dtor(s);
+}
+
+// Reads key into a, evicts it through b and lets the epoch collect it.
+static void check_eviction(enum cc_policy policy, size_t max_size, int key,
+                           int first, int last)
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+  info.dfree = free_value;
+
+  struct cc_cache_config config;
+  config.policy = policy;
+  config.max_size = max_size;
+  config.info = &info;
+  struct cc_shared_cache *s = NULL;
+  CU_ASSERT_EQUAL(cc_shared_cache_ctor(&s, &config), CDC_STATUS_OK);
+  struct cc_near_cache *a = NULL;
+  struct cc_near_cache *b = NULL;
+  CU_ASSERT_EQUAL(cc_near_cache_ctor(&a, s, 4 /* sets */), CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_near_cache_ctor(&b, s, 4 /* sets */), CDC_STATUS_OK);
+
+  for (int i = first; i < last; ++i) {
+    CU_ASSERT_EQUAL(cc_near_cache_insert(b, CDC_FROM_INT(i), new_value(i),
+                                         NULL /* inserted */),
+                    CDC_STATUS_OK);
+  }
+
+  void *value = NULL;
+  cc_near_cache_enter(a);
+  CU_ASSERT_EQUAL(cc_near_cache_get(a, CDC_FROM_INT(key), &value),
+                  CDC_STATUS_OK);
+  cc_near_cache_leave(a);
+
+  CU_ASSERT_EQUAL(cc_near_cache_insert(b, CDC_FROM_INT(last),
+                                       new_value(last), NULL /* inserted */),
+                  CDC_STATUS_OK);
+  // Every write collects, so the value of key is freed by now.
+  for (int i = 0; i < 4; ++i) {
+    cc_near_cache_erase(b, CDC_FROM_INT(-1));
+  }
+
+  CU_ASSERT_EQUAL(s->epoch->retired_count, 0);
+  cc_near_cache_enter(a);
+  CU_ASSERT_EQUAL(cc_near_cache_get(a, CDC_FROM_INT(key), &value),
+                  CDC_STATUS_NOT_FOUND);
+  cc_near_cache_leave(a);
+
+  cc_near_cache_dtor(a);
+  cc_near_cache_dtor(b);
+  cc_shared_cache_dtor(s);
+}
+
+void test_near_cache_eviction()
+{
+  // Key 0 is a NULL pointer, like the key of a replaced value.
+  check_eviction(CC_POLICY_LRU, 1 /* max_size */, 0 /* key */, 0, 1);
+  // A demotion from a1_in to a1_out frees the value without its key.
+  check_eviction(CC_POLICY_2Q, 4 /* max_size */, 1 /* key */, 1, 5);
+}
+
+void test_near_cache_no_dfree()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+
+  struct cc_cache_config config;
+  config.policy = CC_POLICY_LRU;
+  config.max_size = 2;
+  config.info = &info;
+  struct cc_shared_cache *s = NULL;
+  CU_ASSERT_EQUAL(cc_shared_cache_ctor(&s, &config), CDC_STATUS_OK);
+  struct cc_near_cache *a = NULL;
+  struct cc_near_cache *b = NULL;
+  CU_ASSERT_EQUAL(cc_near_cache_ctor(&a, s, 4 /* sets */), CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_near_cache_ctor(&b, s, 4 /* sets */), CDC_STATUS_OK);
+
+  CU_ASSERT_EQUAL(cc_near_cache_insert(b, CDC_FROM_INT(1), CDC_FROM_INT(100),
+                                       NULL /* inserted */),
+                  CDC_STATUS_OK);
+  void *value = NULL;
+  cc_near_cache_enter(a);
+  CU_ASSERT_EQUAL(cc_near_cache_get(a, CDC_FROM_INT(1), &value),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(CDC_TO_INT(value), 100);
+  cc_near_cache_leave(a);
+
+  // Evicts key 1 and inserts it again with another value.
+  for (int i = 2; i <= 3; ++i) {
+    CU_ASSERT_EQUAL(cc_near_cache_insert(b, CDC_FROM_INT(i), CDC_FROM_INT(i),
+                                         NULL /* inserted */),
+                    CDC_STATUS_OK);
+  }
+
+  CU_ASSERT_EQUAL(cc_near_cache_insert(b, CDC_FROM_INT(1), CDC_FROM_INT(200),
+                                       NULL /* inserted */),
+                  CDC_STATUS_OK);
+  cc_near_cache_enter(a);
+  CU_ASSERT_EQUAL(cc_near_cache_get(a, CDC_FROM_INT(1), &value),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(CDC_TO_INT(value), 200);
+  cc_near_cache_leave(a);
+
+  cc_near_cache_dtor(a);
+  cc_near_cache_dtor(b);
+  cc_shared_cache_dtor(s);
+}
+
+void test_near_cache_stress()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+  info.dfree = free_value;
+
+  struct cc_cache_config config;
+  config.policy = CC_POLICY_LRU;
+  config.max_size = STRESS_KEYS / 2;
+  config.info = &info;
+  struct cc_shared_cache *s = NULL;
+  CU_ASSERT_EQUAL(cc_shared_cache_ctor(&s, &config), CDC_STATUS_OK);
+  struct cc_near_cache *c = NULL;
+  CU_ASSERT_EQUAL(cc_near_cache_ctor(&c, s, 8 /* sets */), CDC_STATUS_OK);
+
+  int stop = 0;
+  pthread_t threads[STRESS_READERS];
+  struct reader readers[STRESS_READERS];
+  for (int i = 0; i < STRESS_READERS; ++i) {
+    readers[i].shared = s;
+    readers[i].stop = &stop;
+    readers[i].errors = 0;
+    CU_ASSERT_EQUAL(pthread_create(&threads[i], NULL, read_loop, &readers[i]),
+                    0);
+  }
+
+  unsigned seed = 7;
+  for (int i = 0; i < STRESS_WRITES; ++i) {
+    seed = seed * 1103515245 + 12345;
+    int key = (int)((seed >> 16) % STRESS_KEYS);
+    switch (i % 8) {
+      case 0:
+        cc_near_cache_erase(c, CDC_FROM_INT(key));
+        break;
+      case 1:
+        cc_near_cache_insert_or_assign(c, CDC_FROM_INT(key), new_value(key),
+                                       NULL /* inserted */);
+        break;
+      default: {
+        bool inserted = false;
+        int *value = new_value(key);
+        cc_near_cache_insert(c, CDC_FROM_INT(key), value, &inserted);
+        if (!inserted) {
+          free(value);
+        }
+      }
+    }
+
+    if (i % 4096 == 0) {
+      cc_near_cache_clear(c);
+    }
+  }
+
+  __atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+  for (int i = 0; i < STRESS_READERS; ++i) {
+    pthread_join(threads[i], NULL);
+    CU_ASSERT_EQUAL(readers[i].errors, 0);
+  }
+
+  CU_ASSERT(cc_cache_size(s->cache) <= STRESS_KEYS / 2);
+  cc_near_cache_dtor(c);
+  cc_shared_cache_dtor(s);
+}
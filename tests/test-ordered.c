@@ -0,0 +1,218 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "test-common.h"
+
+#include "ccache/ordered.h"
+
+#include <CUnit/Basic.h>
+#include <cdcontainers/cdc.h>
+
+// A permutation of [0, 1000), so that the keys arrive out of order.
+#define SHUFFLE(i) ((i)*7919 % 1000)
+
+static int freed;
+
+static int lt(const void *l, const void *r)
+{
+  return CDC_TO_INT(l) < CDC_TO_INT(r);
+}
+
+static void count_free(void *kv)
+{
+  CDC_UNUSED(kv);
+
+  ++freed;
+}
+
+struct scan {
+  int keys[1000];
+  size_t count;
+  size_t limit;
+};
+
+static bool collect(void *key, void *value, void *ctx)
+{
+  struct scan *s = (struct scan *)ctx;
+  CU_ASSERT_EQUAL(CDC_TO_INT(key), CDC_TO_INT(value));
+  s->keys[s->count++] = CDC_TO_INT(key);
+  return s->count < s->limit;
+}
+
+static size_t scan(struct cc_ordered_cache *c, int lo, int hi,
+                   struct scan *s)
+{
+  s->count = 0;
+  s->limit = 1000;
+  return cc_ordered_cache_range_scan(c, CDC_FROM_INT(lo), CDC_FROM_INT(hi),
+                                     collect, s);
+}
+
+static struct cc_ordered_cache *make_cache(size_t max_size)
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.lt = lt;
+  info.dfree = count_free;
+  freed = 0;
+
+  struct cc_ordered_cache *c = NULL;
+  CU_ASSERT_EQUAL(cc_ordered_cache_ctor(&c, max_size, &info), CDC_STATUS_OK);
+  for (int i = 0; i < 1000; ++i) {
+    int key = SHUFFLE(i);
+    CU_ASSERT_EQUAL(cc_ordered_cache_insert(c, CDC_FROM_INT(key),
+                                            CDC_FROM_INT(key), NULL),
+                    CDC_STATUS_OK);
+  }
+
+  return c;
+}
+
+void test_ordered_cache_lookup()
+{
+  struct cc_ordered_cache *c = make_cache(1000);
+  CU_ASSERT_EQUAL(cc_ordered_cache_size(c), 1000);
+
+  void *value = NULL;
+  for (int i = 0; i < 1000; ++i) {
+    CU_ASSERT_EQUAL(cc_ordered_cache_get(c, CDC_FROM_INT(i), &value),
+                    CDC_STATUS_OK);
+    CU_ASSERT_EQUAL(CDC_TO_INT(value), i);
+  }
+
+  CU_ASSERT_EQUAL(cc_ordered_cache_get(c, CDC_FROM_INT(1000), &value),
+                  CDC_STATUS_NOT_FOUND);
+
+  bool inserted = true;
+  CU_ASSERT_EQUAL(cc_ordered_cache_insert(c, CDC_FROM_INT(5), CDC_FROM_INT(6),
+                                          &inserted),
+                  CDC_STATUS_OK);
+  CU_ASSERT(!inserted);
+  CU_ASSERT_EQUAL(cc_ordered_cache_insert_or_assign(c, CDC_FROM_INT(5),
+                                                    CDC_FROM_INT(6), &inserted),
+                  CDC_STATUS_OK);
+  CU_ASSERT(!inserted);
+  CU_ASSERT_EQUAL(freed, 1);
+  CU_ASSERT_EQUAL(cc_ordered_cache_get(c, CDC_FROM_INT(5), &value),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(CDC_TO_INT(value), 6);
+
+  // Erasing every other key merges the nodes of the tree.
+  for (int i = 0; i < 1000; i += 2) {
+    cc_ordered_cache_erase(c, CDC_FROM_INT(i));
+  }
+
+  CU_ASSERT_EQUAL(cc_ordered_cache_size(c), 500);
+  CU_ASSERT_EQUAL(freed, 501);
+  for (int i = 0; i < 1000; ++i) {
+    CU_ASSERT_EQUAL(cc_ordered_cache_contains(c, CDC_FROM_INT(i)), i % 2 == 1);
+  }
+
+  struct cdc_pair kv = {NULL, NULL};
+  cc_ordered_cache_take(c, CDC_FROM_INT(7), &kv);
+  CU_ASSERT_EQUAL(CDC_TO_INT(kv.first), 7);
+  CU_ASSERT_EQUAL(freed, 501);
+  for (int i = 1; i < 1000; i += 2) {
+    cc_ordered_cache_erase(c, CDC_FROM_INT(i));
+  }
+
+  CU_ASSERT(cc_ordered_cache_empty(c));
+  CU_ASSERT_EQUAL(freed, 1000);
+  cc_ordered_cache_dtor(c);
+}
+
+void test_ordered_cache_range()
+{
+  struct cc_ordered_cache *c = make_cache(1000);
+  struct cdc_pair kv = {NULL, NULL};
+  CU_ASSERT_EQUAL(cc_ordered_cache_lower_bound(c, CDC_FROM_INT(500), &kv),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(CDC_TO_INT(kv.first), 500);
+
+  struct scan s;
+  CU_ASSERT_EQUAL(scan(c, 0, 1000, &s), 1000);
+  for (int i = 0; i < 1000; ++i) {
+    CU_ASSERT_EQUAL(s.keys[i], i);
+  }
+
+  CU_ASSERT_EQUAL(scan(c, 250, 260, &s), 10);
+  CU_ASSERT_EQUAL(s.keys[0], 250);
+  CU_ASSERT_EQUAL(s.keys[9], 259);
+  CU_ASSERT_EQUAL(scan(c, 260, 250, &s), 0);
+
+  s.count = 0;
+  s.limit = 3;
+  CU_ASSERT_EQUAL(cc_ordered_cache_range_scan(c, CDC_FROM_INT(10),
+                                              CDC_FROM_INT(20), collect, &s),
+                  3);
+
+  for (int i = 100; i < 400; ++i) {
+    cc_ordered_cache_erase(c, CDC_FROM_INT(i));
+  }
+
+  CU_ASSERT_EQUAL(cc_ordered_cache_lower_bound(c, CDC_FROM_INT(100), &kv),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(CDC_TO_INT(kv.first), 400);
+  CU_ASSERT_EQUAL(scan(c, 50, 450, &s), 100);
+  CU_ASSERT_EQUAL(s.keys[49], 99);
+  CU_ASSERT_EQUAL(s.keys[50], 400);
+  CU_ASSERT_EQUAL(cc_ordered_cache_lower_bound(c, CDC_FROM_INT(1000), &kv),
+                  CDC_STATUS_NOT_FOUND);
+
+  cc_ordered_cache_clear(c);
+  CU_ASSERT(cc_ordered_cache_empty(c));
+  CU_ASSERT_EQUAL(freed, 1000);
+  CU_ASSERT_EQUAL(scan(c, 0, 1000, &s), 0);
+  CU_ASSERT_EQUAL(cc_ordered_cache_lower_bound(c, CDC_FROM_INT(0), &kv),
+                  CDC_STATUS_NOT_FOUND);
+  cc_ordered_cache_dtor(c);
+}
+
+void test_ordered_cache_eviction()
+{
+  struct cc_ordered_cache *c = make_cache(100);
+  CU_ASSERT_EQUAL(cc_ordered_cache_size(c), 100);
+  CU_ASSERT_EQUAL(freed, 900);
+
+  // The last 100 inserted keys stay.
+  struct scan s;
+  CU_ASSERT_EQUAL(scan(c, 0, 1000, &s), 100);
+  for (int i = 900; i < 1000; ++i) {
+    CU_ASSERT(cc_ordered_cache_contains(c, CDC_FROM_INT(SHUFFLE(i))));
+  }
+
+  for (size_t i = 1; i < s.count; ++i) {
+    CU_ASSERT(s.keys[i - 1] < s.keys[i]);
+  }
+
+  // A range read counts as use, so the scanned entries outlive the rest.
+  int first = s.keys[0];
+  int second = s.keys[1];
+  CU_ASSERT_EQUAL(scan(c, first, second + 1, &s), 2);
+  for (int i = 1000; i < 1098; ++i) {
+    CU_ASSERT_EQUAL(cc_ordered_cache_insert(c, CDC_FROM_INT(i),
+                                            CDC_FROM_INT(i), NULL),
+                    CDC_STATUS_OK);
+  }
+
+  CU_ASSERT(cc_ordered_cache_contains(c, CDC_FROM_INT(first)));
+  CU_ASSERT(cc_ordered_cache_contains(c, CDC_FROM_INT(second)));
+  CU_ASSERT_EQUAL(scan(c, 0, 1000, &s), 2);
+  cc_ordered_cache_dtor(c);
+}
@@ -0,0 +1,186 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "test-common.h"
+
+#include "ccache/partitioned.h"
+
+#include <CUnit/Basic.h>
+#include <cdcontainers/cdc.h>
+
+static int freed;
+
+static int eq(const void *l, const void *r)
+{
+  return CDC_TO_INT(l) == CDC_TO_INT(r);
+}
+
+static size_t hash(const void *val) { return cdc_hash_int(CDC_TO_INT(val)); }
+
+static void count_free(void *kv)
+{
+  CDC_UNUSED(kv);
+
+  ++freed;
+}
+
+static void insert(struct cc_partitioned_cache *c, size_t partition, int key)
+{
+  bool inserted = false;
+  CU_ASSERT_EQUAL(cc_partitioned_cache_insert(c, partition, CDC_FROM_INT(key),
+                                              CDC_FROM_INT(key), &inserted),
+                  CDC_STATUS_OK);
+  CU_ASSERT(inserted);
+}
+
+static size_t partition_size(struct cc_partitioned_cache *c, size_t partition)
+{
+  struct cc_partition_stats stats;
+  cc_partitioned_cache_stats(c, partition, &stats);
+  return stats.size;
+}
+
+void test_partitioned_cache_sharing()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+
+  struct cc_partitioned_cache *c = NULL;
+  CU_ASSERT_EQUAL(cc_partitioned_cache_ctor(&c, 10 /* max_size */,
+                                            3 /* partition_count */, &info),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_partitioned_cache_set_limits(c, 1, 3, 10),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_partitioned_cache_set_limits(c, 2, 8, 10),
+                  CDC_STATUS_OUT_OF_RANGE);
+
+  for (int key = 100; key < 104; ++key) {
+    insert(c, 1, key);
+  }
+
+  // A noisy partition takes the spare capacity but not the guarantee.
+  for (int key = 0; key < 50; ++key) {
+    insert(c, 0, key);
+  }
+
+  CU_ASSERT_EQUAL(cc_partitioned_cache_size(c), 10);
+  CU_ASSERT_EQUAL(partition_size(c, 1), 4);
+  CU_ASSERT_EQUAL(partition_size(c, 0), 6);
+  CU_ASSERT(cc_partitioned_cache_contains(c, CDC_FROM_INT(49)));
+  CU_ASSERT(cc_partitioned_cache_contains(c, CDC_FROM_INT(100)));
+  CU_ASSERT(!cc_partitioned_cache_contains(c, CDC_FROM_INT(43)));
+
+  // The partition furthest over its minimum gives way.
+  insert(c, 2, 200);
+  insert(c, 2, 201);
+  CU_ASSERT_EQUAL(partition_size(c, 0), 4);
+  CU_ASSERT_EQUAL(partition_size(c, 1), 4);
+  CU_ASSERT_EQUAL(partition_size(c, 2), 2);
+  insert(c, 0, 50);
+  CU_ASSERT_EQUAL(partition_size(c, 0), 4);
+  CU_ASSERT_EQUAL(partition_size(c, 2), 2);
+  insert(c, 1, 104);
+  CU_ASSERT_EQUAL(partition_size(c, 0), 3);
+  CU_ASSERT_EQUAL(partition_size(c, 1), 5);
+
+  // A cap applies even when the cache has room.
+  CU_ASSERT_EQUAL(cc_partitioned_cache_set_limits(c, 0, 0, 2), CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(partition_size(c, 0), 2);
+  insert(c, 0, 51);
+  CU_ASSERT_EQUAL(partition_size(c, 0), 2);
+  CU_ASSERT(cc_partitioned_cache_contains(c, CDC_FROM_INT(51)));
+
+  struct cc_partition_stats stats;
+  cc_partitioned_cache_stats(c, 0, &stats);
+  CU_ASSERT_EQUAL(stats.min_size, 0);
+  CU_ASSERT_EQUAL(stats.max_size, 2);
+  CU_ASSERT_EQUAL(stats.evictions, 50);
+  cc_partitioned_cache_dtor(c);
+}
+
+void test_partitioned_cache_modifiers()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+  info.dfree = count_free;
+
+  freed = 0;
+  struct cc_partitioned_cache *c = NULL;
+  CU_ASSERT_EQUAL(cc_partitioned_cache_ctor(&c, 4 /* max_size */,
+                                            2 /* partition_count */, &info),
+                  CDC_STATUS_OK);
+  insert(c, 0, 1);
+  insert(c, 1, 2);
+
+  void *value = NULL;
+  CU_ASSERT_EQUAL(cc_partitioned_cache_get(c, 0, CDC_FROM_INT(1), &value),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_partitioned_cache_get(c, 0, CDC_FROM_INT(2), &value),
+                  CDC_STATUS_NOT_FOUND);
+  struct cc_partition_stats stats;
+  cc_partitioned_cache_stats(c, 0, &stats);
+  CU_ASSERT_EQUAL(stats.hits, 1);
+  CU_ASSERT_EQUAL(stats.misses, 1);
+
+  // Assigning from another partition moves the entry.
+  bool inserted = true;
+  CU_ASSERT_EQUAL(cc_partitioned_cache_insert_or_assign(
+                      c, 0, CDC_FROM_INT(2), CDC_FROM_INT(20), &inserted),
+                  CDC_STATUS_OK);
+  CU_ASSERT(!inserted);
+  CU_ASSERT_EQUAL(freed, 1);
+  CU_ASSERT_EQUAL(partition_size(c, 0), 2);
+  CU_ASSERT_EQUAL(partition_size(c, 1), 0);
+  CU_ASSERT_EQUAL(cc_partitioned_cache_get(c, 0, CDC_FROM_INT(2), &value),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(CDC_TO_INT(value), 20);
+
+  struct cdc_pair kv = {NULL, NULL};
+  cc_partitioned_cache_take(c, CDC_FROM_INT(2), &kv);
+  CU_ASSERT_EQUAL(CDC_TO_INT(kv.second), 20);
+  CU_ASSERT_EQUAL(freed, 1);
+  cc_partitioned_cache_erase(c, CDC_FROM_INT(1));
+  CU_ASSERT_EQUAL(freed, 2);
+  CU_ASSERT(cc_partitioned_cache_empty(c));
+
+  // With every minimum taken, an empty partition cannot get an entry.
+  CU_ASSERT_EQUAL(cc_partitioned_cache_set_limits(c, 0, 4, 4), CDC_STATUS_OK);
+  for (int key = 10; key < 14; ++key) {
+    insert(c, 0, key);
+  }
+
+  CU_ASSERT_EQUAL(cc_partitioned_cache_insert(c, 1, CDC_FROM_INT(20),
+                                              CDC_FROM_INT(20), &inserted),
+                  CDC_STATUS_OK);
+  CU_ASSERT(!inserted);
+  insert(c, 0, 14);
+  CU_ASSERT_EQUAL(freed, 3);
+  CU_ASSERT(!cc_partitioned_cache_contains(c, CDC_FROM_INT(10)));
+
+  cc_partitioned_cache_clear(c);
+  CU_ASSERT_EQUAL(freed, 7);
+  CU_ASSERT(cc_partitioned_cache_empty(c));
+  CU_ASSERT_EQUAL(partition_size(c, 0), 0);
+  insert(c, 1, 30);
+  cc_partitioned_cache_dtor(c);
+  CU_ASSERT_EQUAL(freed, 8);
+}
@@ -0,0 +1,272 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "test-common.h"
+
+#include "ccache/refresh.h"
+
+#include <CUnit/Basic.h>
+#include <cdcontainers/cdc.h>
+
+#include <stdlib.h>
+
+struct loader {
+  size_t calls;
+  int next;
+};
+
+static int eq(const void *l, const void *r)
+{
+  return CDC_TO_INT(l) == CDC_TO_INT(r);
+}
+
+static size_t hash(const void *val) { return cdc_hash_int(CDC_TO_INT(val)); }
+
+static uint64_t fake_clock(void *ctx) { return *(uint64_t *)ctx; }
+
+static enum cdc_stat load(void *ctx, void *key, void **value)
+{
+  CDC_UNUSED(key);
+
+  struct loader *l = (struct loader *)ctx;
+  ++l->calls;
+  *value = CDC_FROM_INT(l->next);
+  return CDC_STATUS_OK;
+}
+
+static enum cdc_stat load_heap(void *ctx, void *key, void **value)
+{
+  CDC_UNUSED(key);
+
+  struct loader *l = (struct loader *)ctx;
+  int *v = (int *)malloc(sizeof(int));
+  if (!v) {
+    return CDC_STATUS_BAD_ALLOC;
+  }
+
+  ++l->calls;
+  *v = l->next;
+  *value = v;
+  return CDC_STATUS_OK;
+}
+
+static void free_value(void *data)
+{
+  struct cdc_pair *kv = (struct cdc_pair *)data;
+  free(kv->second);
+}
+
+static struct cc_executor sync_executor = {cc_executor_sync, NULL};
+
+// A reload replaces a heap value which the reader still uses.
+static void check_reload_free(struct cc_executor *executor)
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+  info.dfree = free_value;
+
+  uint64_t time = 0;
+  struct loader l = {0, 10};
+  struct cc_refresh_policy policy = {0};
+  policy.expire_after = 100;
+  policy.refresh_ratio = 0.5;
+  policy.load = load_heap;
+  policy.load_ctx = &l;
+  policy.clock = fake_clock;
+  policy.clock_ctx = &time;
+  policy.executor = executor;
+
+  struct cc_refresh_cache *cache = NULL;
+  CU_ASSERT_EQUAL(cc_refresh_cache_ctor(&cache, 2 /* max_size */, &info,
+                                        &policy),
+                  CDC_STATUS_OK);
+  struct cc_epoch_record *r = NULL;
+  CU_ASSERT_EQUAL(cc_refresh_cache_register(cache, &r), CDC_STATUS_OK);
+
+  void *value = NULL;
+  cc_refresh_cache_enter(r);
+  CU_ASSERT_EQUAL(cc_refresh_cache_get(cache, r, CDC_FROM_INT(1), &value),
+                  CDC_STATUS_OK);
+  cc_refresh_cache_leave(r);
+
+  l.next = 11;
+  time = 60;
+  cc_refresh_cache_enter(r);
+  CU_ASSERT_EQUAL(cc_refresh_cache_get(cache, r, CDC_FROM_INT(1), &value),
+                  CDC_STATUS_OK);
+  cc_refresh_cache_drain(cache);
+  // Replaced, but not freed before the reader leaves.
+  CU_ASSERT_EQUAL(*(int *)value, 10);
+  CU_ASSERT_EQUAL(l.calls, 2);
+  cc_refresh_cache_erase(cache, CDC_FROM_INT(1));
+  CU_ASSERT_EQUAL(*(int *)value, 10);
+  cc_refresh_cache_leave(r);
+
+  cc_refresh_cache_enter(r);
+  CU_ASSERT_EQUAL(cc_refresh_cache_get(cache, r, CDC_FROM_INT(1), &value),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(*(int *)value, 11);
+  cc_refresh_cache_leave(r);
+  cc_refresh_cache_unregister(r);
+  cc_refresh_cache_dtor(cache);
+}
+
+void test_refresh_cache_get()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+
+  uint64_t time = 0;
+  struct loader l = {0, 10};
+  struct cc_refresh_policy policy = {0};
+  policy.expire_after = 100;
+  policy.refresh_ratio = 0.5;
+  policy.load = load;
+  policy.load_ctx = &l;
+  policy.clock = fake_clock;
+  policy.clock_ctx = &time;
+  policy.executor = &sync_executor;
+
+  struct cc_refresh_cache *cache = NULL;
+  CU_ASSERT_EQUAL(cc_refresh_cache_ctor(&cache, 2 /* max_size */, &info,
+                                        &policy),
+                  CDC_STATUS_OK);
+  struct cc_epoch_record *r = NULL;
+  CU_ASSERT_EQUAL(cc_refresh_cache_register(cache, &r), CDC_STATUS_OK);
+  cc_refresh_cache_enter(r);
+
+  void *value = NULL;
+  CU_ASSERT_EQUAL(cc_refresh_cache_get(cache, r, CDC_FROM_INT(1), &value),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(CDC_TO_INT(value), 10);
+  CU_ASSERT_EQUAL(l.calls, 1);
+
+  l.next = 11;
+  time = 40;
+  CU_ASSERT_EQUAL(cc_refresh_cache_get(cache, r, CDC_FROM_INT(1), &value),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(CDC_TO_INT(value), 10);
+  CU_ASSERT_EQUAL(l.calls, 1);
+
+  // The stale value is returned and the reload is queued.
+  time = 60;
+  CU_ASSERT_EQUAL(cc_refresh_cache_get(cache, r, CDC_FROM_INT(1), &value),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(CDC_TO_INT(value), 10);
+  CU_ASSERT_EQUAL(l.calls, 2);
+
+  CU_ASSERT_EQUAL(cc_refresh_cache_get(cache, r, CDC_FROM_INT(1), &value),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(CDC_TO_INT(value), 11);
+  CU_ASSERT_EQUAL(l.calls, 2);
+
+  // The entry was rewritten at 60, so it expires at 160.
+  l.next = 12;
+  time = 160;
+  CU_ASSERT_EQUAL(cc_refresh_cache_get(cache, r, CDC_FROM_INT(1), &value),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(CDC_TO_INT(value), 12);
+  CU_ASSERT_EQUAL(l.calls, 3);
+  CU_ASSERT_EQUAL(cc_refresh_cache_size(cache), 1);
+  cc_refresh_cache_leave(r);
+  cc_refresh_cache_unregister(r);
+  cc_refresh_cache_dtor(cache);
+}
+
+void test_refresh_cache_expire()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+
+  uint64_t time = 0;
+  struct cc_refresh_policy policy = {0};
+  policy.expire_after = 100;
+  policy.refresh_ratio = 0.5;
+  policy.clock = fake_clock;
+  policy.clock_ctx = &time;
+
+  struct cc_refresh_cache *cache = NULL;
+  CU_ASSERT_EQUAL(cc_refresh_cache_ctor(&cache, 2 /* max_size */, &info,
+                                        &policy),
+                  CDC_STATUS_OK);
+
+  bool inserted = false;
+  CU_ASSERT_EQUAL(cc_refresh_cache_insert(cache, CDC_FROM_INT(1),
+                                          CDC_FROM_INT(1), &inserted),
+                  CDC_STATUS_OK);
+  CU_ASSERT(inserted);
+
+  time = 99;
+  CU_ASSERT(cc_refresh_cache_contains(cache, CDC_FROM_INT(1)));
+  CU_ASSERT_EQUAL(cc_refresh_cache_insert_or_assign(
+                      cache, CDC_FROM_INT(1), CDC_FROM_INT(2), &inserted),
+                  CDC_STATUS_OK);
+  CU_ASSERT(!inserted);
+
+  time = 198;
+  struct cc_epoch_record *r = NULL;
+  CU_ASSERT_EQUAL(cc_refresh_cache_register(cache, &r), CDC_STATUS_OK);
+  cc_refresh_cache_enter(r);
+  void *value = NULL;
+  CU_ASSERT_EQUAL(cc_refresh_cache_get(cache, r, CDC_FROM_INT(1), &value),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(CDC_TO_INT(value), 2);
+
+  time = 199;
+  CU_ASSERT_EQUAL(cc_refresh_cache_get(cache, r, CDC_FROM_INT(1), &value),
+                  CDC_STATUS_NOT_FOUND);
+  cc_refresh_cache_leave(r);
+  CU_ASSERT(cc_refresh_cache_empty(cache));
+  cc_refresh_cache_unregister(r);
+  cc_refresh_cache_dtor(cache);
+}
+
+void test_refresh_cache_take()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+
+  struct cc_refresh_policy policy = {0};
+  struct cc_refresh_cache *cache = NULL;
+  CU_ASSERT_EQUAL(cc_refresh_cache_ctor(&cache, 2 /* max_size */, &info,
+                                        &policy),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(cc_refresh_cache_insert(cache, CDC_FROM_INT(1),
+                                          CDC_FROM_INT(5), NULL /* inserted */),
+                  CDC_STATUS_OK);
+
+  struct cdc_pair kv = {NULL, NULL};
+  cc_refresh_cache_take(cache, CDC_FROM_INT(1), &kv);
+  CU_ASSERT_EQUAL(CDC_TO_INT(kv.first), 1);
+  CU_ASSERT_EQUAL(CDC_TO_INT(kv.second), 5);
+  CU_ASSERT(cc_refresh_cache_empty(cache));
+  cc_refresh_cache_dtor(cache);
+}
+
+void test_refresh_cache_reload_free()
+{
+  check_reload_free(&sync_executor);
+  // The internal pool.
+  check_reload_free(NULL);
+}
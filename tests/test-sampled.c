@@ -0,0 +1,153 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "test-common.h"
+
+#include "ccache/sampled.h"
+
+#include <CUnit/Basic.h>
+#include <cdcontainers/cdc.h>
+
+static int freed;
+
+static int eq(const void *l, const void *r)
+{
+  return CDC_TO_INT(l) == CDC_TO_INT(r);
+}
+
+static size_t hash(const void *val) { return cdc_hash_int(CDC_TO_INT(val)); }
+
+static void count_free(void *kv)
+{
+  CDC_UNUSED(kv);
+
+  ++freed;
+}
+
+static void insert(struct cc_sampled_cache *c, int key)
+{
+  CU_ASSERT_EQUAL(cc_sampled_cache_insert(c, CDC_FROM_INT(key),
+                                          CDC_FROM_INT(key),
+                                          NULL /* inserted */),
+                  CDC_STATUS_OK);
+}
+
+void test_sampled_cache_eviction()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+
+  const int count = 200;
+  struct cc_sampled_cache *c = NULL;
+  CU_ASSERT_EQUAL(cc_sampled_cache_ctor(&c, count /* max_size */, &info),
+                  CDC_STATUS_OK);
+  cc_sampled_cache_set_samples(c, 10);
+  for (int key = 0; key < count; ++key) {
+    insert(c, key);
+  }
+
+  // The first half is used again and should mostly survive the second wave.
+  void *value = NULL;
+  for (int key = 0; key < count / 2; ++key) {
+    CU_ASSERT_EQUAL(cc_sampled_cache_get(c, CDC_FROM_INT(key), &value),
+                    CDC_STATUS_OK);
+    CU_ASSERT_EQUAL(CDC_TO_INT(value), key);
+  }
+
+  for (int key = count; key < count + count / 2; ++key) {
+    insert(c, key);
+  }
+
+  CU_ASSERT_EQUAL(cc_sampled_cache_size(c), (size_t)count);
+  int survived = 0;
+  for (int key = 0; key < count / 2; ++key) {
+    survived += cc_sampled_cache_contains(c, CDC_FROM_INT(key));
+  }
+
+  CU_ASSERT(survived > count / 2 * 9 / 10);
+  for (int key = count; key < count + count / 2; ++key) {
+    CU_ASSERT(cc_sampled_cache_contains(c, CDC_FROM_INT(key)));
+  }
+
+  cc_sampled_cache_dtor(c);
+}
+
+void test_sampled_cache_modifiers()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+  info.dfree = count_free;
+
+  freed = 0;
+  struct cc_sampled_cache *c = NULL;
+  CU_ASSERT_EQUAL(cc_sampled_cache_ctor(&c, 3 /* max_size */, &info),
+                  CDC_STATUS_OK);
+  CU_ASSERT(cc_sampled_cache_empty(c));
+  insert(c, 1);
+  insert(c, 2);
+
+  bool inserted = true;
+  CU_ASSERT_EQUAL(cc_sampled_cache_insert(c, CDC_FROM_INT(1),
+                                          CDC_FROM_INT(5), &inserted),
+                  CDC_STATUS_OK);
+  CU_ASSERT(!inserted);
+  CU_ASSERT_EQUAL(cc_sampled_cache_insert_or_assign(c, CDC_FROM_INT(1),
+                                                    CDC_FROM_INT(5),
+                                                    &inserted),
+                  CDC_STATUS_OK);
+  CU_ASSERT(!inserted);
+  CU_ASSERT_EQUAL(freed, 1);
+
+  void *value = NULL;
+  CU_ASSERT_EQUAL(cc_sampled_cache_get(c, CDC_FROM_INT(1), &value),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(CDC_TO_INT(value), 5);
+
+  struct cdc_pair kv = {NULL, NULL};
+  cc_sampled_cache_take(c, CDC_FROM_INT(2), &kv);
+  CU_ASSERT_EQUAL(CDC_TO_INT(kv.first), 2);
+  CU_ASSERT_EQUAL(freed, 1);
+  cc_sampled_cache_erase(c, CDC_FROM_INT(1));
+  CU_ASSERT_EQUAL(freed, 2);
+  CU_ASSERT(cc_sampled_cache_empty(c));
+
+  // Freed slots are reused before anything is evicted.
+  for (int key = 1; key <= 3; ++key) {
+    insert(c, key);
+  }
+
+  CU_ASSERT_EQUAL(freed, 2);
+  insert(c, 4);
+  CU_ASSERT_EQUAL(freed, 3);
+  CU_ASSERT_EQUAL(cc_sampled_cache_size(c), 3);
+  CU_ASSERT(cc_sampled_cache_contains(c, CDC_FROM_INT(4)));
+  CU_ASSERT_EQUAL(cc_sampled_cache_get(c, CDC_FROM_INT(5), &value),
+                  CDC_STATUS_NOT_FOUND);
+
+  cc_sampled_cache_clear(c);
+  CU_ASSERT_EQUAL(freed, 6);
+  CU_ASSERT(cc_sampled_cache_empty(c));
+  insert(c, 7);
+  CU_ASSERT(cc_sampled_cache_contains(c, CDC_FROM_INT(7)));
+  cc_sampled_cache_dtor(c);
+  CU_ASSERT_EQUAL(freed, 7);
+}
@@ -0,0 +1,96 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "test-common.h"
+
+#include "ccache/lru.h"
+#include "ccache/shards.h"
+
+#include <CUnit/Basic.h>
+#include <cdcontainers/cdc.h>
+
+static int eq(const void *l, const void *r)
+{
+  return CDC_TO_INT(l) == CDC_TO_INT(r);
+}
+
+static size_t hash(const void *val) { return cdc_hash_int(CDC_TO_INT(val)); }
+
+void test_shards_cyclic()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+
+  struct cc_shards *s = NULL;
+  CU_ASSERT_EQUAL(cc_shards_ctor(&s, 1.0 /* rate */, 1000 /* max_samples */,
+                                 200 /* max_distance */, &info),
+                  CDC_STATUS_OK);
+
+  // A loop over 100 keys: every reuse distance is 99.
+  for (int round = 0; round < 10; ++round) {
+    for (int i = 0; i < 100; ++i) {
+      cc_shards_access(s, CDC_FROM_INT(i));
+    }
+  }
+
+  size_t sizes[] = {50, 99, 100, 400};
+  double ratios[4];
+  cc_shards_miss_ratio_curve(s, sizes, ratios, 4);
+  CU_ASSERT_DOUBLE_EQUAL(ratios[0], 1.0, 1e-9);
+  CU_ASSERT_DOUBLE_EQUAL(ratios[1], 1.0, 1e-9);
+  CU_ASSERT_DOUBLE_EQUAL(ratios[2], 0.1, 1e-9);
+  CU_ASSERT_DOUBLE_EQUAL(ratios[3], 0.1, 1e-9);
+
+  cc_shards_clear(s);
+  CU_ASSERT_DOUBLE_EQUAL(cc_shards_miss_ratio(s, 100), 1.0, 1e-9);
+  cc_shards_dtor(s);
+}
+
+void test_shards_sampling()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+
+  struct cc_shards *s = NULL;
+  CU_ASSERT_EQUAL(cc_shards_ctor(&s, 0.1 /* rate */, 100 /* max_samples */,
+                                 20000 /* max_distance */, &info),
+                  CDC_STATUS_OK);
+
+  struct cc_lru_cache *cache = NULL;
+  CU_ASSERT_EQUAL(cc_lru_cache_ctor(&cache, 1000 /* max_size */, &info),
+                  CDC_STATUS_OK);
+  cc_lru_cache_set_shards(cache, s);
+
+  void *value = NULL;
+  for (int round = 0; round < 20; ++round) {
+    for (int i = 0; i < 2000; ++i) {
+      cc_lru_cache_get(cache, CDC_FROM_INT(i), &value);
+    }
+  }
+
+  // The rate is lowered to keep at most 100 sampled keys.
+  CU_ASSERT(cc_shards_rate(s) < 0.1);
+  CU_ASSERT(cc_shards_miss_ratio(s, 1000) > 0.9);
+  CU_ASSERT(cc_shards_miss_ratio(s, 4000) < 0.2);
+  cc_lru_cache_dtor(cache);
+  cc_shards_dtor(s);
+}
@@ -0,0 +1,127 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "test-common.h"
+
+#include "ccache/slru.h"
+
+#include <CUnit/Basic.h>
+#include <cdcontainers/cdc.h>
+
+static int eq(const void *l, const void *r)
+{
+  return CDC_TO_INT(l) == CDC_TO_INT(r);
+}
+
+static size_t hash(const void *val) { return cdc_hash_int(CDC_TO_INT(val)); }
+
+static void insert(struct cc_slru_cache *c, int key)
+{
+  CU_ASSERT_EQUAL(cc_slru_cache_insert(c, CDC_FROM_INT(key), CDC_FROM_INT(key),
+                                       NULL /* inserted */),
+                  CDC_STATUS_OK);
+}
+
+static void get(struct cc_slru_cache *c, int key)
+{
+  void *value = NULL;
+  CU_ASSERT_EQUAL(cc_slru_cache_get(c, CDC_FROM_INT(key), &value),
+                  CDC_STATUS_OK);
+  CU_ASSERT_EQUAL(CDC_TO_INT(value), key);
+}
+
+void test_slru_cache_scan()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+
+  struct cc_slru_cache *c = NULL;
+  CU_ASSERT_EQUAL(cc_slru_cache_ctor(&c, 4 /* max_size */, &info),
+                  CDC_STATUS_OK);
+  cc_slru_cache_set_protected_share(c, 0.5);
+
+  insert(c, 1);
+  insert(c, 2);
+  get(c, 1);
+  get(c, 2);
+
+  // A scan only churns the probation segment.
+  for (int key = 3; key <= 10; ++key) {
+    insert(c, key);
+  }
+
+  CU_ASSERT_EQUAL(cc_slru_cache_size(c), 4);
+  CU_ASSERT(cc_slru_cache_contains(c, CDC_FROM_INT(1)));
+  CU_ASSERT(cc_slru_cache_contains(c, CDC_FROM_INT(2)));
+  CU_ASSERT(cc_slru_cache_contains(c, CDC_FROM_INT(9)));
+  CU_ASSERT(cc_slru_cache_contains(c, CDC_FROM_INT(10)));
+
+  // Promoting 9 demotes 1 to the head of probation, so 10 goes first.
+  get(c, 9);
+  insert(c, 11);
+  CU_ASSERT(cc_slru_cache_contains(c, CDC_FROM_INT(1)));
+  CU_ASSERT(!cc_slru_cache_contains(c, CDC_FROM_INT(10)));
+
+  cc_slru_cache_set_protected_share(c, 0);
+  CU_ASSERT_EQUAL(c->protected_size, 0);
+  insert(c, 12);
+  CU_ASSERT(!cc_slru_cache_contains(c, CDC_FROM_INT(1)));
+  CU_ASSERT(cc_slru_cache_contains(c, CDC_FROM_INT(9)));
+  cc_slru_cache_dtor(c);
+}
+
+void test_slru_cache_modifiers()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+
+  struct cc_slru_cache *c = NULL;
+  CU_ASSERT_EQUAL(cc_slru_cache_ctor(&c, 3 /* max_size */, &info),
+                  CDC_STATUS_OK);
+
+  bool inserted = false;
+  CU_ASSERT_EQUAL(cc_slru_cache_insert_or_assign(c, CDC_FROM_INT(1),
+                                                 CDC_FROM_INT(1), &inserted),
+                  CDC_STATUS_OK);
+  CU_ASSERT(inserted);
+  CU_ASSERT_EQUAL(cc_slru_cache_insert_or_assign(c, CDC_FROM_INT(1),
+                                                 CDC_FROM_INT(5), &inserted),
+                  CDC_STATUS_OK);
+  CU_ASSERT(!inserted);
+  CU_ASSERT_EQUAL(c->protected_size, 1);
+  insert(c, 2);
+  get(c, 2);
+
+  struct cdc_pair kv = {NULL, NULL};
+  cc_slru_cache_take(c, CDC_FROM_INT(1), &kv);
+  CU_ASSERT_EQUAL(CDC_TO_INT(kv.second), 5);
+  cc_slru_cache_erase(c, CDC_FROM_INT(2));
+  CU_ASSERT(cc_slru_cache_empty(c));
+  CU_ASSERT_EQUAL(c->protected_size, 0);
+
+  insert(c, 3);
+  get(c, 3);
+  cc_slru_cache_clear(c);
+  CU_ASSERT(cc_slru_cache_empty(c));
+  CU_ASSERT_EQUAL(c->protected_size, 0);
+  cc_slru_cache_dtor(c);
+}
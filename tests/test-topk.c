@@ -0,0 +1,108 @@
+// The MIT License (MIT)
+// Copyright (c) 2020 Maksim Andrianov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+#include "test-common.h"
+
+#include "ccache/fifo.h"
+#include "ccache/topk.h"
+
+#include <CUnit/Basic.h>
+#include <cdcontainers/cdc.h>
+
+static int eq(const void *l, const void *r)
+{
+  return CDC_TO_INT(l) == CDC_TO_INT(r);
+}
+
+static size_t hash(const void *val) { return cdc_hash_int(CDC_TO_INT(val)); }
+
+void test_top_keys_get()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+
+  struct cc_top_keys *t = NULL;
+  CU_ASSERT_EQUAL(cc_top_keys_ctor(&t, 3 /* capacity */, &info),
+                  CDC_STATUS_OK);
+
+  for (int i = 0; i < 5; ++i) {
+    cc_top_keys_add(t, CDC_FROM_INT(1));
+  }
+
+  for (int i = 0; i < 3; ++i) {
+    cc_top_keys_add(t, CDC_FROM_INT(2));
+  }
+
+  cc_top_keys_add(t, CDC_FROM_INT(3));
+
+  void *keys[4];
+  size_t counts[4];
+  CU_ASSERT_EQUAL(cc_top_keys_get(t, 4, keys, counts), 3);
+  CU_ASSERT_EQUAL(CDC_TO_INT(keys[0]), 1);
+  CU_ASSERT_EQUAL(counts[0], 5);
+  CU_ASSERT_EQUAL(CDC_TO_INT(keys[1]), 2);
+  CU_ASSERT_EQUAL(counts[1], 3);
+  CU_ASSERT_EQUAL(CDC_TO_INT(keys[2]), 3);
+  CU_ASSERT_EQUAL(counts[2], 1);
+
+  // Replaces key 3 and inherits its count.
+  cc_top_keys_add(t, CDC_FROM_INT(4));
+  CU_ASSERT_EQUAL(cc_top_keys_get(t, 4, keys, counts), 3);
+  CU_ASSERT_EQUAL(CDC_TO_INT(keys[2]), 4);
+  CU_ASSERT_EQUAL(counts[2], 2);
+
+  cc_top_keys_clear(t);
+  CU_ASSERT_EQUAL(cc_top_keys_get(t, 4, keys, counts), 0);
+  cc_top_keys_dtor(t);
+}
+
+void test_top_keys_heavy_hitters()
+{
+  struct cdc_data_info info = CDC_INIT_STRUCT;
+  info.eq = eq;
+  info.hash = hash;
+
+  struct cc_top_keys *t = NULL;
+  CU_ASSERT_EQUAL(cc_top_keys_ctor(&t, 16 /* capacity */, &info),
+                  CDC_STATUS_OK);
+
+  struct cc_fifo_cache *cache = NULL;
+  CU_ASSERT_EQUAL(cc_fifo_cache_ctor(&cache, 8 /* max_size */, &info),
+                  CDC_STATUS_OK);
+  cc_fifo_cache_set_top_keys(cache, t);
+
+  void *value = NULL;
+  for (int i = 0; i < 1000; ++i) {
+    int key = i % 2 == 0 ? 7 : (i % 4 == 1 ? 9 : 100 + i);
+    if (cc_fifo_cache_get(cache, CDC_FROM_INT(key), &value) ==
+        CDC_STATUS_NOT_FOUND) {
+      cc_fifo_cache_insert(cache, CDC_FROM_INT(key), CDC_FROM_INT(key),
+                           NULL /* inserted */);
+    }
+  }
+
+  void *keys[2];
+  CU_ASSERT_EQUAL(cc_fifo_cache_top_keys(cache, 2, keys), 2);
+  CU_ASSERT_EQUAL(CDC_TO_INT(keys[0]), 7);
+  CU_ASSERT_EQUAL(CDC_TO_INT(keys[1]), 9);
+  cc_fifo_cache_dtor(cache);
+  cc_top_keys_dtor(t);
+}